@@ -0,0 +1,120 @@
+/*
+Measures the broker consumer end to end without a Redis server: an
+in-process mock server streams pre-generated pub/sub frames to the
+subscription as fast as the consumer reads them, and counts the XADD
+commands of the workers without storing the entries.
+
+The throughput is the rate from the first frame until every message was
+added to the processing stream, for every dispatch mode and number of
+workers. Nothing of a real server's costs is included, so the numbers are an
+upper bound of what the consumer can take.
+*/
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <thread>
+
+#include "../include/Consumer/ConsumerGroups/RedisBrokerConsumer.hpp"
+#include "../include/Testing/MockRedisServer.hpp"
+
+namespace {
+using namespace std::chrono_literals;
+
+// The distinct messages, which are streamed over and over.
+constexpr int kNumberOfDistinctMessages = 1000;
+constexpr std::size_t kRepetitions = 200;
+
+const char *GetDispatchModeName(DispatchMode dispatch_mode) {
+  switch (dispatch_mode) {
+  case DispatchMode::RoundRobin:
+    return "round-robin";
+  case DispatchMode::KeyAffine:
+    return "key-affine";
+  case DispatchMode::WorkStealing:
+    return "work-stealing";
+  }
+  return "";
+}
+
+// Streams the frames to a broker consumer with the given workers and prints
+// its throughput.
+void MeasureConsumer(const std::string &frames, DispatchMode dispatch_mode,
+                     int number_of_workers) {
+  MockRedisServer server;
+  if (!server.Start(0)) {
+    std::cerr << server.GetLastError() << std::endl;
+    return;
+  }
+  server.SetStoresStreamEntries(false);
+
+  ConsumerOptions options;
+  options.dispatch_mode = dispatch_mode;
+  auto consumer = std::make_unique<RedisBrokerConsumer>(
+      false, number_of_workers, options);
+  consumer->EstablishConnection("127.0.0.1", server.GetPort());
+  std::thread subscription_thread([&consumer] {
+    consumer->SubscribeToChannel("orders", "processed");
+  });
+  if (!server.WaitForSubscribers("orders", 1, 10s)) {
+    std::cerr << "The consumer did not subscribe!" << std::endl;
+    server.Stop();
+    subscription_thread.join();
+    return;
+  }
+
+  const std::size_t number_of_messages =
+      kNumberOfDistinctMessages * kRepetitions;
+  const auto start = std::chrono::steady_clock::now();
+  const bool is_streamed = server.StreamFrames("orders", frames, kRepetitions);
+  const bool is_processed =
+      is_streamed &&
+      server.WaitForStreamLength("processed", number_of_messages, 60s);
+  const double elapsed_seconds =
+      std::chrono::duration<double>(std::chrono::steady_clock::now() - start)
+          .count();
+
+  std::cout << std::setw(16) << GetDispatchModeName(dispatch_mode)
+            << std::setw(10) << number_of_workers;
+  if (is_processed) {
+    std::cout << std::setw(16) << std::fixed << std::setprecision(0)
+              << number_of_messages / elapsed_seconds << std::defaultfloat
+              << std::endl;
+  } else {
+    std::cout << std::setw(16) << "incomplete"
+              << " (" << server.GetStreamLength("processed") << " of "
+              << number_of_messages << ")" << std::endl;
+  }
+
+  // Closing the subscription makes the consumer return.
+  server.Stop();
+  subscription_thread.join();
+  consumer.reset();
+}
+} // namespace
+
+int main() {
+  // Leaves the standard output to the results.
+  Logger::Get().SetMinimumLevel(LogLevel::Warning);
+
+  std::string frames;
+  for (int i = 0; i < kNumberOfDistinctMessages; ++i) {
+    MockRedisServer::AppendMessageFrame(
+        frames, "orders",
+        R"({"message_id": "id-)" + std::to_string(i) +
+            R"(", "customer": "c-)" + std::to_string(i % 97) +
+            R"(", "amount": 42.5, "text": "lorem ipsum dolor sit amet"})");
+  }
+
+  std::cout << std::setw(16) << "dispatch" << std::setw(10) << "workers"
+            << std::setw(16) << "messages/sec" << std::endl;
+  for (DispatchMode dispatch_mode :
+       {DispatchMode::RoundRobin, DispatchMode::KeyAffine,
+        DispatchMode::WorkStealing}) {
+    for (int number_of_workers : {1, 2, 4}) {
+      MeasureConsumer(frames, dispatch_mode, number_of_workers);
+    }
+  }
+  return 0;
+}
@@ -0,0 +1,150 @@
+/*
+Measures what counting costs per message on the hot path of a worker: a
+loop that hashes a message, without counters, with the relaxed per-thread
+ThreadCounters, and with the shared std::atomic fetch_add the workers used
+before.
+
+Every variant runs on several threads at once, while a reader sums up the
+counters as often as it can, like a monitor polling much faster than once a
+second. The per-thread counters should add well under 1 ns per message.
+*/
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <iomanip>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+#include "../include/Monitoring/CounterSet.hpp"
+
+namespace {
+constexpr long long kNumberOfMessages = 50'000'000;
+constexpr std::size_t kMessageSize = 64;
+
+// The counters of every thread next to each other, as the fields of the
+// workers were.
+struct SharedCounters {
+  std::atomic<long long> number_of_processed_messages{0};
+  std::atomic<long long> number_of_received_bytes{0};
+};
+
+// Stands in for the processing of a message.
+inline std::uint64_t ProcessMessage(long long message_number) {
+  std::uint64_t hash = 14695981039346656037ULL;
+  for (int i = 0; i < 4; ++i) {
+    hash = (hash ^ static_cast<std::uint64_t>(message_number + i)) *
+           1099511628211ULL;
+  }
+  return hash;
+}
+
+// Returns the nanoseconds per message on each of number_of_threads threads.
+// process_messages(thread_index) processes kNumberOfMessages and returns a
+// value that is summed up so the loop is not optimized away, and read()
+// is called in a loop by a reader thread meanwhile.
+template <typename ProcessMessages, typename Read>
+double MeasureNanosecondsPerMessage(int number_of_threads,
+                                    ProcessMessages &&process_messages,
+                                    Read &&read) {
+  std::atomic<bool> is_done{false};
+  std::atomic<std::uint64_t> checksum{0};
+  std::thread reader([&]() {
+    long long last_read = 0;
+    while (!is_done.load(std::memory_order_relaxed)) {
+      last_read = std::max(last_read, read());
+    }
+    checksum += last_read;
+  });
+  auto start = std::chrono::steady_clock::now();
+  std::vector<std::thread> threads;
+  for (int i = 0; i < number_of_threads; ++i) {
+    threads.emplace_back([&, i]() { checksum += process_messages(i); });
+  }
+  for (std::thread &thread : threads) {
+    thread.join();
+  }
+  std::chrono::duration<double, std::nano> elapsed =
+      std::chrono::steady_clock::now() - start;
+  is_done = true;
+  reader.join();
+  if (checksum == 0) {
+    std::cerr << "Processed nothing!" << std::endl;
+  }
+  return elapsed.count() / kNumberOfMessages;
+}
+} // namespace
+
+int main() {
+  const int maximum_number_of_threads = static_cast<int>(
+      std::max(2u, std::min(8u, std::thread::hardware_concurrency())));
+
+  std::cout << "Processing a message on every thread (ns)" << std::endl;
+  std::cout << std::setw(8) << "threads" << std::setw(12) << "uncounted"
+            << std::setw(12) << "per-thread" << std::setw(12) << "shared"
+            << std::setw(12) << "overhead" << std::endl;
+  std::cout << std::fixed << std::setprecision(2);
+  for (int number_of_threads = 1; number_of_threads <= maximum_number_of_threads;
+       number_of_threads *= 2) {
+    const double uncounted = MeasureNanosecondsPerMessage(
+        number_of_threads,
+        [](int) {
+          std::uint64_t sum = 0;
+          for (long long i = 0; i < kNumberOfMessages; ++i) {
+            sum += ProcessMessage(i);
+          }
+          return sum;
+        },
+        []() { return 0LL; });
+
+    CounterSet counter_set;
+    std::vector<ThreadCounters *> thread_counters;
+    for (int i = 0; i < number_of_threads; ++i) {
+      thread_counters.push_back(&counter_set.Register());
+    }
+    const double per_thread = MeasureNanosecondsPerMessage(
+        number_of_threads,
+        [&](int thread_index) {
+          ThreadCounters &counters = *thread_counters[thread_index];
+          std::uint64_t sum = 0;
+          for (long long i = 0; i < kNumberOfMessages; ++i) {
+            sum += ProcessMessage(i);
+            counters.Add(CounterId::ProcessedMessages);
+            counters.Add(CounterId::ReceivedBytes, kMessageSize);
+          }
+          return sum;
+        },
+        [&]() {
+          return counter_set.Read().Get(CounterId::ProcessedMessages);
+        });
+
+    std::vector<SharedCounters> shared_counters(number_of_threads);
+    const double shared = MeasureNanosecondsPerMessage(
+        number_of_threads,
+        [&](int thread_index) {
+          SharedCounters &counters = shared_counters[thread_index];
+          std::uint64_t sum = 0;
+          for (long long i = 0; i < kNumberOfMessages; ++i) {
+            sum += ProcessMessage(i);
+            counters.number_of_processed_messages++;
+            counters.number_of_received_bytes += kMessageSize;
+          }
+          return sum;
+        },
+        [&]() {
+          long long number_of_processed_messages = 0;
+          for (const SharedCounters &counters : shared_counters) {
+            number_of_processed_messages +=
+                counters.number_of_processed_messages;
+          }
+          return number_of_processed_messages;
+        });
+
+    std::cout << std::setw(8) << number_of_threads << std::setw(12)
+              << uncounted << std::setw(12) << per_thread << std::setw(12)
+              << shared << std::setw(12) << per_thread - uncounted
+              << std::endl;
+  }
+  return 0;
+}
@@ -0,0 +1,206 @@
+/*
+Compares the blocking socket path of the RedisConsumer with the io_uring
+path: a RespReader and a PipelinedStreamWriter, which make a system call per
+read, send and reply read, against an IoUringLoop with an IoUringStreamWriter,
+which make one io_uring_enter() per iteration of the loop.
+
+A publisher thread sends pub/sub messages in bursts and waits until every
+message of a burst has been added to the stream before sending the next one,
+and a second thread answers the XADD commands like Redis. The benchmark
+reports the consumer's system calls per message and its throughput.
+*/
+#include <atomic>
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <sys/socket.h>
+#include <thread>
+#include <unistd.h>
+
+#include "../include/Consumer/IoUringStreamWriter.hpp"
+#include "../include/Consumer/PipelinedStreamWriter.hpp"
+#include "../include/Networking/IoUringLoop.hpp"
+#include "../include/Parsing/RespReader.hpp"
+
+namespace {
+constexpr long long kNumberOfMessages = 64 * 1024;
+constexpr std::size_t kXaddPipelineDepth = 64;
+
+const std::string kMessage = "*3\r\n$7\r\nmessage\r\n$4\r\ntest\r\n$42\r\n"
+                             "{\"message_id\":\"12345\",\"payload\":\"abcdefg\"}"
+                             "\r\n";
+const std::string kXaddCommand =
+    "*5\r\n$4\r\nXADD\r\n$9\r\nprocessed\r\n$1\r\n*\r\n$7\r\nmessage\r\n"
+    "$5\r\n12345\r\n";
+const std::string kXaddReply = "$15\r\n1700000000000-0\r\n";
+
+struct Result {
+  double messages_per_second;
+  double system_calls_per_message;
+};
+
+// The consumer's side of the connections and the threads that stand in for
+// the publisher and Redis.
+class Setup {
+public:
+  explicit Setup(int messages_per_burst)
+      : number_of_completed_messages_{0} {
+    socketpair(AF_UNIX, SOCK_STREAM, 0, subscription_sockets_);
+    socketpair(AF_UNIX, SOCK_STREAM, 0, processing_sockets_);
+    publisher_ = std::thread([this, messages_per_burst]() {
+      std::string burst;
+      for (int i = 0; i < messages_per_burst; ++i) {
+        burst += kMessage;
+      }
+      for (long long sent = 0; sent < kNumberOfMessages;
+           sent += messages_per_burst) {
+        if (write(subscription_sockets_[1], burst.data(), burst.size()) !=
+            static_cast<ssize_t>(burst.size())) {
+          std::cerr << "Failed to publish!" << std::endl;
+          break;
+        }
+        while (number_of_completed_messages_.load(std::memory_order_acquire) <
+               sent + messages_per_burst) {
+          std::this_thread::yield();
+        }
+      }
+      close(subscription_sockets_[1]);
+    });
+    redis_ = std::thread([this]() {
+      RespReader reader(processing_sockets_[1]);
+      std::string replies;
+      while (reader.ReadFrames(
+          [&replies](const RespParser &) { replies += kXaddReply; })) {
+        if (!replies.empty() &&
+            write(processing_sockets_[1], replies.data(), replies.size()) !=
+                static_cast<ssize_t>(replies.size())) {
+          break;
+        }
+        replies.clear();
+      }
+    });
+  }
+
+  ~Setup() {
+    publisher_.join();
+    close(processing_sockets_[0]);
+    redis_.join();
+    close(subscription_sockets_[0]);
+    close(processing_sockets_[1]);
+  }
+
+  int GetSubscriptionSocket() const { return subscription_sockets_[0]; }
+  int GetProcessingSocket() const { return processing_sockets_[0]; }
+
+  void OnMessageCompleted() {
+    number_of_completed_messages_.fetch_add(1, std::memory_order_release);
+  }
+  long long GetNumberOfCompletedMessages() const {
+    return number_of_completed_messages_.load(std::memory_order_acquire);
+  }
+
+private:
+  int subscription_sockets_[2];
+  int processing_sockets_[2];
+  std::atomic<long long> number_of_completed_messages_;
+  std::thread publisher_;
+  std::thread redis_;
+};
+
+Result MeasureBlockingPath(int messages_per_burst) {
+  Setup setup(messages_per_burst);
+  auto start = std::chrono::steady_clock::now();
+
+  RespReader subscription_reader(setup.GetSubscriptionSocket());
+  PipelinedStreamWriter writer(
+      setup.GetProcessingSocket(), kXaddPipelineDepth,
+      [&setup](const StreamWriteResult &) { setup.OnMessageCompleted(); });
+  auto handle_message = [&writer](const RespParser &) {
+    (void)writer.Submit(kXaddCommand);
+  };
+  while (subscription_reader.ReadFrames(handle_message)) {
+    (void)writer.Flush();
+  }
+
+  std::chrono::duration<double> elapsed =
+      std::chrono::steady_clock::now() - start;
+  long long system_calls = subscription_reader.GetStatistics().number_of_reads +
+                           writer.GetNumberOfSystemCalls();
+  return {setup.GetNumberOfCompletedMessages() / elapsed.count(),
+          static_cast<double>(system_calls) / kNumberOfMessages};
+}
+
+#ifdef HAS_IO_URING
+bool MeasureIoUringPath(int messages_per_burst, Result &result) {
+  Setup setup(messages_per_burst);
+  auto start = std::chrono::steady_clock::now();
+
+  IoUringLoop io_uring_loop;
+  if (!io_uring_loop.Initialize()) {
+    std::cerr << io_uring_loop.GetLastError() << std::endl;
+    return false;
+  }
+  RespReader subscription_reader;
+  IoUringStreamWriter writer(
+      io_uring_loop, setup.GetProcessingSocket(), kXaddPipelineDepth,
+      [&setup](const StreamWriteResult &) { setup.OnMessageCompleted(); });
+  auto handle_message = [&writer](const RespParser &) {
+    (void)writer.Submit(kXaddCommand);
+  };
+  if (!writer.Start() ||
+      !io_uring_loop.Receive(
+          setup.GetSubscriptionSocket(), [&](std::string_view data) {
+            if (data.empty() ||
+                !subscription_reader.ParseFrames(data, handle_message)) {
+              io_uring_loop.Stop();
+              return;
+            }
+            (void)writer.Flush();
+          })) {
+    std::cerr << io_uring_loop.GetLastError() << std::endl;
+    return false;
+  }
+  (void)io_uring_loop.Run();
+  while (writer.GetNumberOfInFlightCommands() > 0 &&
+         io_uring_loop.RunOnce()) {
+  }
+
+  std::chrono::duration<double> elapsed =
+      std::chrono::steady_clock::now() - start;
+  result = {setup.GetNumberOfCompletedMessages() / elapsed.count(),
+            static_cast<double>(io_uring_loop.GetNumberOfSystemCalls()) /
+                kNumberOfMessages};
+  return true;
+}
+#endif
+} // namespace
+
+int main() {
+  std::cout << "Consuming " << kNumberOfMessages
+            << " messages and adding them to a stream" << std::endl;
+  std::cout << std::setw(8) << "burst" << std::setw(16) << "blocking msg/s"
+            << std::setw(16) << "syscalls/msg" << std::setw(16)
+            << "io_uring msg/s" << std::setw(16) << "syscalls/msg"
+            << std::endl;
+  for (int messages_per_burst : {1, 16, 256}) {
+    Result blocking_result = MeasureBlockingPath(messages_per_burst);
+    std::cout << std::setw(8) << messages_per_burst << std::fixed
+              << std::setprecision(0) << std::setw(16)
+              << blocking_result.messages_per_second << std::setprecision(3)
+              << std::setw(16) << blocking_result.system_calls_per_message;
+#ifdef HAS_IO_URING
+    Result io_uring_result;
+    if (MeasureIoUringPath(messages_per_burst, io_uring_result)) {
+      std::cout << std::setprecision(0) << std::setw(16)
+                << io_uring_result.messages_per_second << std::setprecision(3)
+                << std::setw(16) << io_uring_result.system_calls_per_message;
+    }
+#endif
+    std::cout << std::endl;
+  }
+#ifndef HAS_IO_URING
+  std::cout << "Built without io_uring support." << std::endl;
+#endif
+  return 0;
+}
@@ -0,0 +1,181 @@
+/*
+Measures what the write-ahead journal costs the broker: the subscriber
+thread copies every message into a pooled buffer and hands it to a worker,
+which processes the JSON payload and, with a journal, marks its record
+complete, as it would once the XADD reply arrived.
+
+The throughput is measured without a journal, with group commits (every
+5 ms or 1000 records, the defaults) and with a commit after every record.
+Group commits are bound by the write bandwidth of the disk once the records
+are large, a commit per record by the latency of fdatasync().
+
+The journal is written to a new directory in the directory given as the
+first argument, or /tmp, which is removed at the end.
+*/
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <dirent.h>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+#include "../include/Concurrency/Backoff.hpp"
+#include "../include/Concurrency/BufferPool.hpp"
+#include "../include/Concurrency/MpmcRingBuffer.hpp"
+#include "../include/Consumer/JsonMessageProcessorImpl.hpp"
+#include "../include/Storage/Journal.hpp"
+
+namespace {
+using namespace std::chrono_literals;
+
+constexpr std::size_t kQueueCapacity = 64 * 1024;
+constexpr std::size_t kSegmentSize = 64 * 1024 * 1024;
+constexpr std::size_t kBufferSize = 2048;
+
+enum class Durability { None, GroupCommit, CommitEveryRecord };
+
+struct QueuedMessage {
+  PooledBuffer buffer;
+  std::uint64_t journal_sequence = 0;
+};
+
+const char *GetName(Durability durability) {
+  switch (durability) {
+  case Durability::None:
+    return "none";
+  case Durability::GroupCommit:
+    return "group commit";
+  case Durability::CommitEveryRecord:
+    return "every record";
+  }
+  return "";
+}
+
+std::string MakePayload(std::size_t size) {
+  std::string payload = "{\"message_id\":\"1234567\",\"publish_time_ns\":"
+                        "1700000000000000000,\"message\":\"";
+  payload.append(size > payload.size() + 2 ? size - payload.size() - 2 : 0,
+                 'x');
+  payload.append("\"}");
+  return payload;
+}
+
+void RemoveDirectory(const std::string &directory) {
+  if (DIR *entries = opendir(directory.c_str())) {
+    while (const dirent *entry = readdir(entries)) {
+      if (entry->d_name[0] != '.') {
+        unlink((directory + "/" + entry->d_name).c_str());
+      }
+    }
+    closedir(entries);
+  }
+  rmdir(directory.c_str());
+}
+
+// Returns the number of messages per second that went through the broker.
+double MeasureThroughput(const std::string &directory, Durability durability,
+                         std::size_t message_size,
+                         long long number_of_messages) {
+  std::unique_ptr<Journal> journal;
+  if (durability != Durability::None) {
+    journal = std::make_unique<Journal>(directory, kSegmentSize, 5ms, 1000);
+    if (!journal->Open()) {
+      std::cerr << journal->GetLastError() << std::endl;
+      return 0;
+    }
+  }
+  BufferPool buffer_pool(kBufferSize, 2 * kQueueCapacity + 2);
+  MpmcRingBuffer<QueuedMessage> queue(kQueueCapacity);
+  const std::string payload = MakePayload(message_size);
+
+  std::thread worker([&]() {
+    JsonMessageProcessorImpl message_processor;
+    MessageView processed_message{};
+    std::string message_id_storage;
+    QueuedMessage message;
+    Backoff backoff;
+    for (long long i = 0; i < number_of_messages;) {
+      if (!queue.TryPop(message)) {
+        backoff.Pause();
+        continue;
+      }
+      backoff.Reset();
+      message_processor.ProcessMessageInPlace(
+          message.buffer.View(), processed_message, message_id_storage);
+      message.buffer.Release();
+      if (journal) {
+        journal->Complete(message.journal_sequence);
+      }
+      ++i;
+    }
+  });
+
+  auto start = std::chrono::steady_clock::now();
+  for (long long i = 0; i < number_of_messages; ++i) {
+    QueuedMessage message;
+    if (journal) {
+      message.journal_sequence = journal->Append({payload});
+      if (durability == Durability::CommitEveryRecord) {
+        journal->Commit();
+      }
+    }
+    message.buffer = buffer_pool.Acquire(payload.size());
+    payload.copy(message.buffer.Data(), payload.size());
+    Backoff backoff;
+    while (!queue.TryPush(std::move(message))) {
+      backoff.Pause();
+    }
+  }
+  worker.join();
+  auto elapsed = std::chrono::steady_clock::now() - start;
+  journal.reset();
+  return number_of_messages / std::chrono::duration<double>(elapsed).count();
+}
+} // namespace
+
+int main(int argc, char **argv) {
+  std::string path_template =
+      std::string(argc > 1 ? argv[1] : "/tmp") + "/bench_journal.XXXXXX";
+  std::vector<char> path(path_template.begin(), path_template.end());
+  path.push_back('\0');
+  if (mkdtemp(path.data()) == nullptr) {
+    std::cerr << "Failed to create a directory for the journal!" << std::endl;
+    return 1;
+  }
+  const std::string directory = path.data();
+  std::cout << "Journaling the received messages in " << directory
+            << " (messages per second)" << std::endl;
+  std::cout << std::setw(8) << "size" << std::setw(16) << "durability"
+            << std::setw(14) << "throughput" << std::setw(10) << "cost"
+            << std::endl;
+  for (std::size_t message_size : {256, 1024}) {
+    double baseline = 0;
+    for (Durability durability :
+         {Durability::None, Durability::GroupCommit,
+          Durability::CommitEveryRecord}) {
+      // A commit per record waits for the disk every time, so it gets fewer
+      // messages.
+      const long long number_of_messages =
+          durability == Durability::CommitEveryRecord ? 2'000 : 2'000'000;
+      const double throughput = MeasureThroughput(directory, durability,
+                                                  message_size,
+                                                  number_of_messages);
+      if (durability == Durability::None) {
+        baseline = throughput;
+      }
+      std::cout << std::setw(8) << message_size << std::setw(16)
+                << GetName(durability) << std::fixed << std::setprecision(0)
+                << std::setw(14) << throughput << std::setprecision(1)
+                << std::setw(9)
+                << (baseline > 0 ? 100.0 * (1.0 - throughput / baseline) : 0)
+                << "%" << std::endl;
+    }
+  }
+  RemoveDirectory(directory);
+  return 0;
+}
@@ -0,0 +1,115 @@
+/*
+Compares the extraction of the message_id field by the previous
+JsonMessageProcessorImpl (a search for "message_id" followed by a search for
+the last quoted string) and by the JsonScanner with each kernel that the CPU
+supports, and by a SchemaProcessor with the fastest kernel.
+
+The messages have the message_id as their last field, after a nested object
+and a text, so that every implementation reads the whole message.
+*/
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "../include/Consumer/SchemaProcessor.hpp"
+#include "../include/Parsing/JsonScanner.hpp"
+
+namespace {
+constexpr std::size_t kBytesPerSize = 256 * 1024 * 1024;
+
+std::optional<std::string_view> ExtractLastQuotedString(std::string_view json) {
+  if (json.find("message_id") == std::string_view::npos) {
+    return {};
+  }
+  auto end = json.find_last_of('\"');
+  if (end != std::string_view::npos) {
+    auto start = json.find_last_of('\"', end - 1);
+    if (start != std::string_view::npos) {
+      return json.substr(start + 1, end - start - 1);
+    }
+  }
+  return {};
+}
+
+std::string CreateMessage(std::size_t size) {
+  std::string message = R"({"user": {"name": "Jane", "tags": ["a", "b"]}, )"
+                        R"("text": ")";
+  const std::string tail = R"(", "message_id": "id-1234567"})";
+  while (message.size() + tail.size() < size) {
+    message += message.size() % 97 == 0 ? "\\\"" : "lorem ipsum, {dolor} ";
+  }
+  message.resize(size - tail.size(), 'x');
+  if (message.back() == '\\') {
+    message.back() = 'x';
+  }
+  return message + tail;
+}
+
+// Returns the throughput in GB/s.
+template <typename Extractor>
+double MeasureThroughput(const std::string &message, Extractor &&extract) {
+  const std::size_t iterations = kBytesPerSize / message.size();
+  std::size_t number_of_matches = 0;
+  auto start = std::chrono::steady_clock::now();
+  for (std::size_t i = 0; i < iterations; ++i) {
+    std::optional<std::string_view> message_id = extract(message);
+    number_of_matches += message_id && *message_id == "id-1234567";
+  }
+  std::chrono::duration<double> elapsed =
+      std::chrono::steady_clock::now() - start;
+  if (number_of_matches != iterations) {
+    std::cerr << "Extracted a wrong message_id!" << std::endl;
+  }
+  return iterations * message.size() / elapsed.count() / 1e9;
+}
+} // namespace
+
+int main() {
+  std::vector<JsonScannerKernel> kernels;
+  for (JsonScannerKernel kernel :
+       {JsonScannerKernel::Scalar, JsonScannerKernel::Sse42,
+        JsonScannerKernel::Avx2}) {
+    if (IsJsonScannerKernelSupported(kernel)) {
+      kernels.push_back(kernel);
+    }
+  }
+
+  std::cout << "Extraction of the message_id field (GB/s)" << std::endl;
+  std::cout << std::setw(8) << "size" << std::setw(14) << "previous";
+  for (JsonScannerKernel kernel : kernels) {
+    std::cout << std::setw(14) << GetJsonScannerKernelName(kernel);
+  }
+  std::cout << std::setw(14) << "schema" << std::endl;
+
+  using MessageSchemaProcessor = SchemaProcessor<MessageIdField>;
+  const MessageSchemaProcessor schema_processor;
+  auto extract_with_schema = [&schema_processor](std::string_view json) {
+    MessageSchemaProcessor::Record record;
+    if (!schema_processor.Extract(json, record)) {
+      return std::optional<std::string_view>{};
+    }
+    return MessageSchemaProcessor::Get<MessageIdField>(json, record);
+  };
+
+  for (std::size_t size : {200, 2 * 1024, 64 * 1024}) {
+    const std::string message = CreateMessage(size);
+    std::cout << std::setw(8) << message.size() << std::fixed
+              << std::setprecision(2) << std::setw(14)
+              << MeasureThroughput(message, ExtractLastQuotedString);
+    for (JsonScannerKernel kernel : kernels) {
+      const JsonScanner scanner(kernel);
+      auto extract_message_id = [&scanner](std::string_view json) {
+        return scanner.ExtractField(json, "message_id");
+      };
+      std::cout << std::setw(14)
+                << MeasureThroughput(message, extract_message_id);
+    }
+    std::cout << std::setw(14)
+              << MeasureThroughput(message, extract_with_schema) << std::endl;
+  }
+  return 0;
+}
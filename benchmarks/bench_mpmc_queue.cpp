@@ -0,0 +1,141 @@
+/*
+Compares the broker's hand-off queues: a std::queue guarded by a mutex and a
+condition variable (the previous implementation) and the lock-free
+MpmcRingBuffer with an EventCount for idle workers.
+
+One producer thread pushes messages that are consumed by 1 to 16 worker
+threads, like the subscriber thread and the BrokerWorkers.
+*/
+#include <chrono>
+#include <condition_variable>
+#include <iomanip>
+#include <iostream>
+#include <mutex>
+#include <queue>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "../include/Concurrency/EventCount.hpp"
+#include "../include/Concurrency/MpmcRingBuffer.hpp"
+
+namespace {
+constexpr long long kNumberOfMessages = 1000000;
+constexpr std::size_t kQueueCapacity = 64 * 1024;
+
+class MutexQueue {
+public:
+  void Push(std::string &&message) {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      queue_.push(std::move(message));
+    }
+    cv_.notify_one();
+  }
+
+  bool Pop(std::string &message) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    cv_.wait(lock, [this] { return !queue_.empty() || stop_; });
+    if (queue_.empty()) {
+      return false;
+    }
+    message = std::move(queue_.front());
+    queue_.pop();
+    return true;
+  }
+
+  void Stop() {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      stop_ = true;
+    }
+    cv_.notify_all();
+  }
+
+private:
+  std::queue<std::string> queue_;
+  std::mutex mutex_;
+  std::condition_variable cv_;
+  bool stop_ = false;
+};
+
+class RingQueue {
+public:
+  RingQueue() : ring_(kQueueCapacity), stop_{false} {}
+
+  void Push(std::string &&message) {
+    Backoff backoff;
+    while (!ring_.TryPush(std::move(message))) {
+      backoff.Pause();
+    }
+    event_count_.NotifyOne();
+  }
+
+  bool Pop(std::string &message) {
+    while (!ring_.TryPop(message)) {
+      if (stop_) {
+        return false;
+      }
+      event_count_.Wait([this] { return !ring_.IsEmpty() || stop_; });
+    }
+    return true;
+  }
+
+  void Stop() {
+    stop_ = true;
+    event_count_.NotifyAll();
+  }
+
+private:
+  MpmcRingBuffer<std::string> ring_;
+  EventCount event_count_;
+  std::atomic<bool> stop_;
+};
+
+template <typename Queue> double MeasureMessagesPerSecond(int workers) {
+  Queue queue;
+  std::atomic<long long> number_of_consumed_bytes{0};
+  std::vector<std::thread> consumers;
+  for (int i = 0; i < workers; ++i) {
+    consumers.emplace_back([&queue, &number_of_consumed_bytes]() {
+      std::string message;
+      long long consumed_bytes = 0;
+      while (queue.Pop(message)) {
+        consumed_bytes += message.size();
+      }
+      number_of_consumed_bytes += consumed_bytes;
+    });
+  }
+
+  auto start = std::chrono::steady_clock::now();
+  for (long long i = 0; i < kNumberOfMessages; ++i) {
+    queue.Push(std::string(64, 'm'));
+  }
+  queue.Stop();
+  for (auto &consumer : consumers) {
+    consumer.join();
+  }
+  std::chrono::duration<double> elapsed =
+      std::chrono::steady_clock::now() - start;
+
+  if (number_of_consumed_bytes != kNumberOfMessages * 64) {
+    std::cerr << "Lost messages!" << std::endl;
+  }
+  return kNumberOfMessages / elapsed.count();
+}
+} // namespace
+
+int main() {
+  std::cout << "Hand-off of " << kNumberOfMessages
+            << " messages from one producer (messages/sec)" << std::endl;
+  std::cout << std::setw(8) << "workers" << std::setw(22)
+            << "mutex + cv queue" << std::setw(22) << "MPMC ring" << std::endl;
+  for (int workers : {1, 2, 4, 8, 16}) {
+    double mutex_queue_rate = MeasureMessagesPerSecond<MutexQueue>(workers);
+    double ring_rate = MeasureMessagesPerSecond<RingQueue>(workers);
+    std::cout << std::setw(8) << workers << std::fixed << std::setprecision(0)
+              << std::setw(22) << mutex_queue_rate << std::setw(22)
+              << ring_rate << std::endl;
+  }
+  return 0;
+}
@@ -0,0 +1,142 @@
+/*
+Compares the XADD commands of the processed messages built by the previous
+ostringstream builder, by CreateWriteMessageToStreamCommand(), which returns
+a new string built by a RespWriter, and by a RespWriter that reuses its
+buffer.
+
+Then compares copying a large payload into a command with appending it by
+reference and gathering the command with FillIoVectors().
+*/
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "../include/Consumer/RedisConsumerUtils/redis_consumer_utils.hpp"
+#include "../include/Parsing/RespWriter.hpp"
+
+namespace {
+constexpr int kNumberOfCommands = 2'000'000;
+
+std::string PreviousBulkString(const std::string &value) {
+  return "$" + std::to_string(value.length()) + "\r\n" + value + "\r\n";
+}
+
+std::string PreviousWriteMessageToStreamCommand(const std::string &stream_name,
+                                                const Message &message) {
+  std::ostringstream command_output_stream;
+  command_output_stream << "*11\r\n";
+  command_output_stream << PreviousBulkString("XADD");
+  command_output_stream << PreviousBulkString(stream_name);
+  command_output_stream << PreviousBulkString("*");
+  command_output_stream << PreviousBulkString("Processor_id")
+                        << PreviousBulkString(
+                               std::to_string(message.processor_id));
+  command_output_stream << PreviousBulkString("Processing_date_time")
+                        << PreviousBulkString(message.processing_date_time);
+  command_output_stream << PreviousBulkString("Source_channel_name")
+                        << PreviousBulkString(message.source_channel_name);
+  command_output_stream << PreviousBulkString("Message_id")
+                        << PreviousBulkString(message.message_id);
+  return command_output_stream.str();
+}
+
+// Returns the nanoseconds per command. build_command returns the size of the
+// command, which is summed up so the commands are not optimized away.
+template <typename CommandBuilder>
+double MeasureNanosecondsPerCommand(int number_of_commands,
+                                    CommandBuilder &&build_command) {
+  std::size_t number_of_bytes = 0;
+  auto start = std::chrono::steady_clock::now();
+  for (int i = 0; i < number_of_commands; ++i) {
+    number_of_bytes += build_command(i);
+  }
+  std::chrono::duration<double, std::nano> elapsed =
+      std::chrono::steady_clock::now() - start;
+  if (number_of_bytes == 0) {
+    std::cerr << "Built empty commands!" << std::endl;
+  }
+  return elapsed.count() / number_of_commands;
+}
+} // namespace
+
+int main() {
+  const std::string stream_name = "messages:processed";
+  Message message{3, "2024-01-02 03:04:05.678", "messages:published",
+                  "id-1234567"};
+  const MessageView message_view{message.processor_id,
+                                 message.processing_date_time,
+                                 message.source_channel_name,
+                                 message.message_id};
+
+  std::cout << "Building an XADD command of a processed message (ns)"
+            << std::endl;
+  std::cout << std::fixed << std::setprecision(1);
+  std::cout << std::setw(16) << "previous" << std::setw(10)
+            << MeasureNanosecondsPerCommand(
+                   kNumberOfCommands,
+                   [&](int i) {
+                     message.processor_id = i;
+                     return PreviousWriteMessageToStreamCommand(stream_name,
+                                                                message)
+                         .size();
+                   })
+            << std::endl;
+  std::cout << std::setw(16) << "new string" << std::setw(10)
+            << MeasureNanosecondsPerCommand(
+                   kNumberOfCommands,
+                   [&](int i) {
+                     message.processor_id = i;
+                     return CreateWriteMessageToStreamCommand(stream_name,
+                                                              message)
+                         .size();
+                   })
+            << std::endl;
+  std::string buffer;
+  RespWriter writer(buffer);
+  MessageView reused_message_view = message_view;
+  std::cout << std::setw(16) << "reused buffer" << std::setw(10)
+            << MeasureNanosecondsPerCommand(
+                   kNumberOfCommands,
+                   [&](int i) {
+                     reused_message_view.processor_id = i;
+                     writer.Clear();
+                     AppendWriteMessageToStreamCommand(writer, stream_name,
+                                                       reused_message_view);
+                     return writer.View().size();
+                   })
+            << std::endl;
+
+  std::cout << "Building a SET command with a large payload (ns)" << std::endl;
+  std::vector<iovec> io_vectors;
+  for (std::size_t payload_size : {1024, 64 * 1024, 1024 * 1024}) {
+    const std::string payload(payload_size, 'p');
+    const int number_of_commands =
+        static_cast<int>(16ULL * 1024 * 1024 * 1024 / payload_size / 64);
+    auto build_command = [&](bool is_copied) {
+      writer.Clear();
+      writer.AppendArrayHeader(3);
+      writer.AppendBulkString("SET");
+      writer.AppendBulkString("key");
+      if (is_copied) {
+        writer.AppendBulkString(payload);
+      } else {
+        writer.AppendBulkStringReference(payload);
+      }
+      return writer.FillIoVectors(io_vectors);
+    };
+    std::cout << std::setw(8) << payload_size << std::setw(8) << "copied"
+              << std::setw(10)
+              << MeasureNanosecondsPerCommand(
+                     number_of_commands,
+                     [&](int) { return build_command(true); })
+              << std::setw(12) << "referenced" << std::setw(10)
+              << MeasureNanosecondsPerCommand(
+                     number_of_commands,
+                     [&](int) { return build_command(false); })
+              << std::endl;
+  }
+  return 0;
+}
@@ -0,0 +1,107 @@
+/*
+Measures how fast the SpillQueue absorbs a burst: a producer appends
+messages as fast as it can, first with no consumer, as when the workers are
+stalled, and then while a consumer drains the queue at the same time, as
+when the workers catch up during the burst.
+
+The segments are created in the directory given as the first argument, or
+/tmp. The throughput includes the page faults of the first writes to every
+segment; reused segments are faster.
+*/
+#include <atomic>
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <thread>
+
+#include "../include/Storage/SpillQueue.hpp"
+
+namespace {
+constexpr std::size_t kSegmentSize = 64 * 1024 * 1024;
+constexpr std::size_t kMaximumNumberOfSegments = 8;
+// Less than the queue holds, so the producer never has to wait.
+constexpr std::size_t kBurstSize = 256 * 1024 * 1024;
+
+double GetMegabytesPerSecond(std::size_t number_of_bytes,
+                             std::chrono::steady_clock::duration elapsed) {
+  return number_of_bytes / (1024.0 * 1024.0) /
+         std::chrono::duration<double>(elapsed).count();
+}
+
+// Appends a burst of messages of message_size bytes and prints the
+// producer's throughput, and the consumer's if there is one.
+void MeasureBurst(const std::string &directory, std::size_t message_size,
+                  bool is_drained) {
+  SpillQueue queue(directory, kSegmentSize, kMaximumNumberOfSegments);
+  if (!queue.Open()) {
+    std::cerr << queue.GetLastError() << std::endl;
+    return;
+  }
+  const std::string header(16, 'h');
+  const std::string body(message_size - header.size(), 'b');
+  const std::size_t number_of_messages = kBurstSize / message_size;
+
+  std::atomic<bool> is_producing{true};
+  std::size_t number_of_drained_bytes = 0;
+  std::chrono::steady_clock::duration drain_time{};
+  std::thread consumer;
+  if (is_drained) {
+    consumer = std::thread([&]() {
+      auto start = std::chrono::steady_clock::now();
+      while (true) {
+        bool is_done = !is_producing.load(std::memory_order_relaxed);
+        if (queue.TryPop([&](std::string_view record) {
+              number_of_drained_bytes += record.size();
+            })) {
+          continue;
+        }
+        if (is_done) {
+          break;
+        }
+      }
+      drain_time = std::chrono::steady_clock::now() - start;
+    });
+  }
+
+  auto start = std::chrono::steady_clock::now();
+  std::size_t number_of_appended_messages = 0;
+  for (std::size_t i = 0; i < number_of_messages; ++i) {
+    number_of_appended_messages += queue.TryAppend({header, body});
+  }
+  auto append_time = std::chrono::steady_clock::now() - start;
+  is_producing = false;
+  if (consumer.joinable()) {
+    consumer.join();
+  }
+
+  std::cout << std::setw(8) << message_size << std::setw(12)
+            << (is_drained ? "drained" : "stalled") << std::setw(14)
+            << GetMegabytesPerSecond(number_of_appended_messages * message_size,
+                                     append_time);
+  if (is_drained) {
+    std::cout << std::setw(14)
+              << GetMegabytesPerSecond(number_of_drained_bytes, drain_time);
+  }
+  if (number_of_appended_messages != number_of_messages) {
+    std::cout << "  (" << number_of_messages - number_of_appended_messages
+              << " messages did not fit)";
+  }
+  std::cout << std::endl;
+}
+} // namespace
+
+int main(int argc, char **argv) {
+  const std::string directory = argc > 1 ? argv[1] : "/tmp";
+  std::cout << "Absorbing a burst of " << kBurstSize / (1024 * 1024)
+            << " MB in " << directory << " (MB/s)" << std::endl;
+  std::cout << std::setw(8) << "size" << std::setw(12) << "workers"
+            << std::setw(14) << "appended" << std::setw(14) << "drained"
+            << std::endl;
+  std::cout << std::fixed << std::setprecision(0);
+  for (std::size_t message_size : {256, 2048}) {
+    MeasureBurst(directory, message_size, false);
+    MeasureBurst(directory, message_size, true);
+  }
+  return 0;
+}
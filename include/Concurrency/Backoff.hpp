@@ -0,0 +1,49 @@
+#pragma once
+#include <chrono>
+#include <thread>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
+
+// Progressive waiting for busy loops: spins first, then yields the processor
+// and finally sleeps, so short waits stay cheap and long waits do not burn a
+// core.
+class Backoff {
+public:
+  Backoff() : number_of_attempts_{0} {}
+
+  void Pause() {
+    if (number_of_attempts_ < kNumberOfSpins) {
+      for (unsigned int i = 0; i < (1u << (number_of_attempts_ / 8)); ++i) {
+        CpuRelax();
+      }
+    } else if (number_of_attempts_ < kNumberOfSpins + kNumberOfYields) {
+      std::this_thread::yield();
+    } else {
+      std::this_thread::sleep_for(std::chrono::microseconds(50));
+    }
+    ++number_of_attempts_;
+  }
+
+  // True once the backoff has gone past the spinning and yielding phases.
+  bool IsSleeping() const {
+    return number_of_attempts_ >= kNumberOfSpins + kNumberOfYields;
+  }
+
+  void Reset() { number_of_attempts_ = 0; }
+
+private:
+  static constexpr unsigned int kNumberOfSpins = 64;
+  static constexpr unsigned int kNumberOfYields = 16;
+
+  static void CpuRelax() {
+#if defined(__x86_64__) || defined(__i386__)
+    _mm_pause();
+#elif defined(__aarch64__)
+    asm volatile("yield");
+#endif
+  }
+
+  unsigned int number_of_attempts_;
+};
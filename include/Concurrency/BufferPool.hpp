@@ -0,0 +1,169 @@
+#pragma once
+#include <atomic>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "MpmcRingBuffer.hpp"
+
+class BufferPool;
+
+/*
+A buffer of a BufferPool, returned to the pool when it is destroyed. It can
+only be moved, so the bytes are never copied on their way through a queue.
+
+Buffers that are larger than the pool's buffers, or that are acquired while
+all of the pool's buffers are in use, are allocated on their own and freed
+when they are destroyed.
+*/
+class PooledBuffer {
+public:
+  PooledBuffer() : data_{nullptr}, size_{0}, pool_{nullptr} {}
+  PooledBuffer(PooledBuffer &&other) noexcept
+      : data_{std::exchange(other.data_, nullptr)},
+        size_{std::exchange(other.size_, 0)},
+        pool_{std::exchange(other.pool_, nullptr)} {}
+  PooledBuffer &operator=(PooledBuffer &&other) noexcept {
+    if (this != &other) {
+      Release();
+      data_ = std::exchange(other.data_, nullptr);
+      size_ = std::exchange(other.size_, 0);
+      pool_ = std::exchange(other.pool_, nullptr);
+    }
+    return *this;
+  }
+  PooledBuffer(const PooledBuffer &) = delete;
+  PooledBuffer &operator=(const PooledBuffer &) = delete;
+  ~PooledBuffer() { Release(); }
+
+  char *Data() { return data_; }
+  std::size_t Size() const { return size_; }
+  std::string_view View() const { return {data_, size_}; }
+
+  // Returns the buffer to its pool, or frees it.
+  inline void Release();
+
+private:
+  friend class BufferPool;
+  PooledBuffer(char *data, std::size_t size, BufferPool *pool)
+      : data_{data}, size_{size}, pool_{pool} {}
+
+  char *data_;
+  std::size_t size_;
+  // Not set for the buffers that were allocated on their own.
+  BufferPool *pool_;
+};
+
+/*
+Fixed-size buffers that are recycled instead of being allocated for every
+message.
+
+The buffers are carved out of slabs of kBuffersPerSlab buffers, which are
+allocated when the pool runs out of free buffers, up to
+maximum_number_of_buffers. The free buffers are kept in a lock-free queue,
+so any thread can acquire and release them, and once the pool has grown to
+the number of buffers in use at the same time, acquiring a buffer no longer
+allocates memory.
+
+The pool has to outlive its buffers.
+*/
+class BufferPool {
+public:
+  static constexpr std::size_t kBuffersPerSlab = 64;
+
+  BufferPool(std::size_t buffer_size, std::size_t maximum_number_of_buffers)
+      : buffer_size_{buffer_size},
+        maximum_number_of_slabs_{
+            (maximum_number_of_buffers + kBuffersPerSlab - 1) /
+            kBuffersPerSlab},
+        free_buffers_(maximum_number_of_slabs_ * kBuffersPerSlab),
+        number_of_slabs_{0}, number_of_unpooled_buffers_{0} {
+    slabs_.reserve(maximum_number_of_slabs_);
+  }
+
+  BufferPool(const BufferPool &) = delete;
+  BufferPool &operator=(const BufferPool &) = delete;
+
+  // A buffer of size bytes, with undefined contents.
+  [[nodiscard]] PooledBuffer Acquire(std::size_t size) {
+    if (size <= buffer_size_) {
+      char *data = nullptr;
+      if (free_buffers_.TryPop(data) || (data = AddSlab()) != nullptr) {
+        return PooledBuffer(data, size, this);
+      }
+    }
+    number_of_unpooled_buffers_.fetch_add(1, std::memory_order_relaxed);
+    return PooledBuffer(new char[size], size, nullptr);
+  }
+
+  std::size_t GetBufferSize() const { return buffer_size_; }
+
+  std::size_t GetNumberOfSlabs() const {
+    return number_of_slabs_.load(std::memory_order_relaxed);
+  }
+
+  // The number of buffers that were allocated on their own so far.
+  long long GetNumberOfUnpooledBuffers() const {
+    return number_of_unpooled_buffers_.load(std::memory_order_relaxed);
+  }
+
+private:
+  friend class PooledBuffer;
+
+  void Recycle(char *data) {
+    bool is_pushed = free_buffers_.TryPush(std::move(data));
+    // The queue has room for every buffer of every slab.
+    assert(is_pushed);
+    (void)is_pushed;
+  }
+
+  // Returns the first buffer of a new slab and adds the others to the free
+  // ones, or returns nullptr once the pool has reached its maximum size.
+  //
+  // A buffer that another thread is still recycling hides the buffers behind
+  // it in the queue until its push completes, so the queue can look empty
+  // while it holds free buffers. The pool then grows by a slab instead of
+  // waiting for the other thread, and the caller gets its buffer without
+  // going through the queue. The extra buffers stay as headroom.
+  char *AddSlab() {
+    std::lock_guard<std::mutex> lock(slabs_mutex_);
+    if (slabs_.size() == maximum_number_of_slabs_) {
+      return nullptr;
+    }
+    slabs_.push_back(
+        std::make_unique<char[]>(buffer_size_ * kBuffersPerSlab));
+    char *slab = slabs_.back().get();
+    for (std::size_t i = 1; i < kBuffersPerSlab; ++i) {
+      Recycle(slab + i * buffer_size_);
+    }
+    number_of_slabs_.store(slabs_.size(), std::memory_order_relaxed);
+    return slab;
+  }
+
+  std::size_t buffer_size_;
+  std::size_t maximum_number_of_slabs_;
+  MpmcRingBuffer<char *> free_buffers_;
+  std::vector<std::unique_ptr<char[]>> slabs_;
+  std::mutex slabs_mutex_;
+  std::atomic<std::size_t> number_of_slabs_;
+  std::atomic<long long> number_of_unpooled_buffers_;
+};
+
+void PooledBuffer::Release() {
+  if (data_ == nullptr) {
+    return;
+  }
+  if (pool_ != nullptr) {
+    pool_->Recycle(data_);
+  } else {
+    delete[] data_;
+  }
+  data_ = nullptr;
+  size_ = 0;
+  pool_ = nullptr;
+}
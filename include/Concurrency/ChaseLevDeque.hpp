@@ -0,0 +1,117 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <type_traits>
+
+#include "MpmcRingBuffer.hpp"
+
+/*
+A bounded Chase-Lev work-stealing deque.
+
+The owner thread pushes and pops at the bottom of the deque, like a stack,
+without any read-modify-write operation unless it races for the last item.
+Any other thread can steal from the top with a single compare-and-swap. The
+memory orderings follow "Correct and Efficient Work-Stealing for Weak Memory
+Models" (Le, Pop, Cohen and Zappa Nardelli, 2013).
+
+A thief reads an item before it knows whether its steal succeeds, so the items
+have to be trivially copyable, typically pointers.
+*/
+template <typename T> class ChaseLevDeque {
+  static_assert(std::is_trivially_copyable_v<T>,
+                "The items of a ChaseLevDeque have to be trivially copyable.");
+
+public:
+  explicit ChaseLevDeque(std::size_t capacity)
+      : capacity_{RoundUpToPowerOfTwo(capacity)}, mask_{capacity_ - 1},
+        slots_(std::make_unique<std::atomic<T>[]>(capacity_)), top_{0},
+        bottom_{0} {}
+
+  ChaseLevDeque(const ChaseLevDeque &) = delete;
+  ChaseLevDeque &operator=(const ChaseLevDeque &) = delete;
+
+  // Owner only. Returns false when the deque is full.
+  [[nodiscard]] bool TryPush(T value) {
+    std::int64_t bottom = bottom_.load(std::memory_order_relaxed);
+    std::int64_t top = top_.load(std::memory_order_acquire);
+    if (bottom - top >= static_cast<std::int64_t>(capacity_)) {
+      return false;
+    }
+    slots_[bottom & mask_].store(value, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    bottom_.store(bottom + 1, std::memory_order_relaxed);
+    return true;
+  }
+
+  // Owner only. Takes the most recently pushed item.
+  [[nodiscard]] bool TryPop(T &value) {
+    std::int64_t bottom = bottom_.load(std::memory_order_relaxed) - 1;
+    bottom_.store(bottom, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    std::int64_t top = top_.load(std::memory_order_relaxed);
+
+    if (top > bottom) {
+      bottom_.store(bottom + 1, std::memory_order_relaxed);
+      return false;
+    }
+
+    value = slots_[bottom & mask_].load(std::memory_order_relaxed);
+    if (top < bottom) {
+      return true;
+    }
+    // The last item: race the thieves for it.
+    bool is_won = top_.compare_exchange_strong(
+        top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed);
+    bottom_.store(bottom + 1, std::memory_order_relaxed);
+    return is_won;
+  }
+
+  // Any thread. Takes the least recently pushed item. Also returns false when
+  // another thread won the race for that item.
+  [[nodiscard]] bool TrySteal(T &value) {
+    std::int64_t top = top_.load(std::memory_order_acquire);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    std::int64_t bottom = bottom_.load(std::memory_order_acquire);
+    if (top >= bottom) {
+      return false;
+    }
+
+    T stolen_value = slots_[top & mask_].load(std::memory_order_relaxed);
+    if (!top_.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst,
+                                      std::memory_order_relaxed)) {
+      return false;
+    }
+    value = stolen_value;
+    return true;
+  }
+
+  std::size_t GetApproximateSize() const {
+    std::int64_t bottom = bottom_.load(std::memory_order_relaxed);
+    std::int64_t top = top_.load(std::memory_order_relaxed);
+    return bottom > top ? static_cast<std::size_t>(bottom - top) : 0;
+  }
+
+  bool IsEmpty() const { return GetApproximateSize() == 0; }
+
+  std::size_t GetCapacity() const { return capacity_; }
+
+private:
+  static std::size_t RoundUpToPowerOfTwo(std::size_t value) {
+    std::size_t power_of_two = 2;
+    while (power_of_two < value) {
+      power_of_two <<= 1;
+    }
+    return power_of_two;
+  }
+
+  const std::size_t capacity_;
+  const std::size_t mask_;
+  std::unique_ptr<std::atomic<T>[]> slots_;
+
+  // Written by the thieves and, for the last item, by the owner.
+  alignas(kCacheLineSize) std::atomic<std::int64_t> top_;
+  // Written by the owner.
+  alignas(kCacheLineSize) std::atomic<std::int64_t> bottom_;
+};
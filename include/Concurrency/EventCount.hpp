@@ -0,0 +1,71 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+
+#include "Backoff.hpp"
+
+/*
+Lets consumers of a lock-free queue sleep while the queue is empty without
+making producers pay for a lock and a notification per item.
+
+Waiters spin and yield for a short while before registering themselves and
+blocking on a condition variable. Producers only take the mutex when a waiter
+is registered, which on a busy queue is almost never the case.
+*/
+class EventCount {
+public:
+  EventCount() : number_of_waiters_{0}, epoch_{0} {}
+
+  // Wakes up one waiter. Call after publishing an item.
+  void NotifyOne() {
+    // Orders the publication of the item before the check for waiters. Pairs
+    // with the registration of the waiter in Wait().
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (number_of_waiters_.load(std::memory_order_relaxed) > 0) {
+      {
+        std::lock_guard<std::mutex> lock(mutex_);
+        ++epoch_;
+      }
+      condition_.notify_one();
+    }
+  }
+
+  void NotifyAll() {
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      ++epoch_;
+    }
+    condition_.notify_all();
+  }
+
+  // Returns once is_ready() is true. Every change that can make is_ready()
+  // true has to be followed by NotifyOne() or NotifyAll(), as the waiters
+  // block without a timeout.
+  template <typename Predicate> void Wait(Predicate &&is_ready) {
+    Backoff backoff;
+    while (!backoff.IsSleeping()) {
+      if (is_ready()) {
+        return;
+      }
+      backoff.Pause();
+    }
+
+    std::unique_lock<std::mutex> lock(mutex_);
+    number_of_waiters_.fetch_add(1, std::memory_order_seq_cst);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    while (!is_ready()) {
+      std::uint64_t epoch = epoch_;
+      condition_.wait(lock, [this, epoch] { return epoch_ != epoch; });
+    }
+    number_of_waiters_.fetch_sub(1, std::memory_order_relaxed);
+  }
+
+private:
+  std::atomic<int> number_of_waiters_;
+  std::uint64_t epoch_;
+  std::mutex mutex_;
+  std::condition_variable condition_;
+};
@@ -0,0 +1,126 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <utility>
+
+// The assumed size of a cache line. Hot atomics are aligned to it so that
+// producers and consumers do not invalidate each other's cache lines.
+constexpr std::size_t kCacheLineSize = 64;
+
+/*
+A bounded, lock-free, multi-producer / multi-consumer queue.
+
+This is Dmitry Vyukov's bounded MPMC queue: every slot carries a sequence
+number that tells producers and consumers whether the slot is ready to be
+written or read for their current lap around the ring. An operation claims a
+position with a single compare-and-swap and never waits for another thread
+that is in the middle of an operation on a different slot.
+
+The capacity is rounded up to a power of two so positions map to slots with
+a mask. The enqueue and dequeue positions and every slot live on their own
+cache lines.
+*/
+template <typename T> class MpmcRingBuffer {
+public:
+  explicit MpmcRingBuffer(std::size_t capacity)
+      : capacity_{RoundUpToPowerOfTwo(capacity)}, mask_{capacity_ - 1},
+        slots_(std::make_unique<Slot[]>(capacity_)), enqueue_position_{0},
+        dequeue_position_{0} {
+    for (std::size_t i = 0; i < capacity_; ++i) {
+      slots_[i].sequence.store(i, std::memory_order_relaxed);
+    }
+  }
+
+  MpmcRingBuffer(const MpmcRingBuffer &) = delete;
+  MpmcRingBuffer &operator=(const MpmcRingBuffer &) = delete;
+
+  // Moves the value into the queue. Returns false, without touching the
+  // value, when the queue is full.
+  [[nodiscard]] bool TryPush(T &&value) {
+    Slot *slot;
+    std::size_t position = enqueue_position_.load(std::memory_order_relaxed);
+    while (true) {
+      slot = &slots_[position & mask_];
+      std::size_t sequence = slot->sequence.load(std::memory_order_acquire);
+      std::ptrdiff_t difference = static_cast<std::ptrdiff_t>(sequence) -
+                                  static_cast<std::ptrdiff_t>(position);
+      if (difference == 0) {
+        if (enqueue_position_.compare_exchange_weak(
+                position, position + 1, std::memory_order_relaxed)) {
+          break;
+        }
+      } else if (difference < 0) {
+        return false;
+      } else {
+        position = enqueue_position_.load(std::memory_order_relaxed);
+      }
+    }
+
+    slot->value = std::move(value);
+    slot->sequence.store(position + 1, std::memory_order_release);
+    return true;
+  }
+
+  // Moves the oldest value out of the queue. Returns false when it is empty.
+  [[nodiscard]] bool TryPop(T &value) {
+    Slot *slot;
+    std::size_t position = dequeue_position_.load(std::memory_order_relaxed);
+    while (true) {
+      slot = &slots_[position & mask_];
+      std::size_t sequence = slot->sequence.load(std::memory_order_acquire);
+      std::ptrdiff_t difference = static_cast<std::ptrdiff_t>(sequence) -
+                                  static_cast<std::ptrdiff_t>(position + 1);
+      if (difference == 0) {
+        if (dequeue_position_.compare_exchange_weak(
+                position, position + 1, std::memory_order_relaxed)) {
+          break;
+        }
+      } else if (difference < 0) {
+        return false;
+      } else {
+        position = dequeue_position_.load(std::memory_order_relaxed);
+      }
+    }
+
+    value = std::move(slot->value);
+    slot->sequence.store(position + mask_ + 1, std::memory_order_release);
+    return true;
+  }
+
+  // Only exact while no other thread is using the queue.
+  std::size_t GetApproximateSize() const {
+    std::size_t enqueue_position =
+        enqueue_position_.load(std::memory_order_relaxed);
+    std::size_t dequeue_position =
+        dequeue_position_.load(std::memory_order_relaxed);
+    return enqueue_position > dequeue_position
+               ? enqueue_position - dequeue_position
+               : 0;
+  }
+
+  bool IsEmpty() const { return GetApproximateSize() == 0; }
+
+  std::size_t GetCapacity() const { return capacity_; }
+
+private:
+  struct alignas(kCacheLineSize) Slot {
+    std::atomic<std::size_t> sequence;
+    T value;
+  };
+
+  static std::size_t RoundUpToPowerOfTwo(std::size_t value) {
+    std::size_t power_of_two = 2;
+    while (power_of_two < value) {
+      power_of_two <<= 1;
+    }
+    return power_of_two;
+  }
+
+  const std::size_t capacity_;
+  const std::size_t mask_;
+  std::unique_ptr<Slot[]> slots_;
+
+  alignas(kCacheLineSize) std::atomic<std::size_t> enqueue_position_;
+  alignas(kCacheLineSize) std::atomic<std::size_t> dequeue_position_;
+};
@@ -0,0 +1,84 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <utility>
+
+#include "MpmcRingBuffer.hpp"
+
+/*
+A bounded, lock-free, single-producer / single-consumer queue.
+
+Only one thread may push and only one thread may pop. Each side keeps a
+cached copy of the other side's position and only reloads the shared atomic
+when the cached value says the queue is full (or empty), so in the common
+case an operation touches no cache line written by the other thread.
+*/
+template <typename T> class SpscRingBuffer {
+public:
+  explicit SpscRingBuffer(std::size_t capacity)
+      : capacity_{RoundUpToPowerOfTwo(capacity)}, mask_{capacity_ - 1},
+        slots_(std::make_unique<T[]>(capacity_)), tail_{0},
+        cached_head_{0}, head_{0}, cached_tail_{0} {}
+
+  SpscRingBuffer(const SpscRingBuffer &) = delete;
+  SpscRingBuffer &operator=(const SpscRingBuffer &) = delete;
+
+  // Producer only. Returns false, without touching the value, when full.
+  [[nodiscard]] bool TryPush(T &&value) {
+    const std::size_t tail = tail_.load(std::memory_order_relaxed);
+    if (tail - cached_head_ == capacity_) {
+      cached_head_ = head_.load(std::memory_order_acquire);
+      if (tail - cached_head_ == capacity_) {
+        return false;
+      }
+    }
+    slots_[tail & mask_] = std::move(value);
+    tail_.store(tail + 1, std::memory_order_release);
+    return true;
+  }
+
+  // Consumer only. Returns false when empty.
+  [[nodiscard]] bool TryPop(T &value) {
+    const std::size_t head = head_.load(std::memory_order_relaxed);
+    if (head == cached_tail_) {
+      cached_tail_ = tail_.load(std::memory_order_acquire);
+      if (head == cached_tail_) {
+        return false;
+      }
+    }
+    value = std::move(slots_[head & mask_]);
+    head_.store(head + 1, std::memory_order_release);
+    return true;
+  }
+
+  std::size_t GetApproximateSize() const {
+    std::size_t tail = tail_.load(std::memory_order_relaxed);
+    std::size_t head = head_.load(std::memory_order_relaxed);
+    return tail > head ? tail - head : 0;
+  }
+
+  bool IsEmpty() const { return GetApproximateSize() == 0; }
+
+  std::size_t GetCapacity() const { return capacity_; }
+
+private:
+  static std::size_t RoundUpToPowerOfTwo(std::size_t value) {
+    std::size_t power_of_two = 2;
+    while (power_of_two < value) {
+      power_of_two <<= 1;
+    }
+    return power_of_two;
+  }
+
+  const std::size_t capacity_;
+  const std::size_t mask_;
+  std::unique_ptr<T[]> slots_;
+
+  // Written by the producer.
+  alignas(kCacheLineSize) std::atomic<std::size_t> tail_;
+  std::size_t cached_head_;
+  // Written by the consumer.
+  alignas(kCacheLineSize) std::atomic<std::size_t> head_;
+  std::size_t cached_tail_;
+};
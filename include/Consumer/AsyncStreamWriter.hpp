@@ -0,0 +1,89 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "../Concurrency/MpmcRingBuffer.hpp"
+#include "../Networking/EventLoop.hpp"
+#include "PipelinedStreamWriter.hpp"
+
+/*
+The non-blocking counterpart of PipelinedStreamWriter, driven by an
+EventLoop.
+
+Any thread can submit commands. They are queued and handed to the loop
+thread, which writes them to the connection while fewer than max_in_flight
+commands are awaiting a reply, and matches the replies to the commands in
+order. The completion handler runs on the loop thread.
+
+Every submitted command is completed exactly once. Once the connection has
+failed, the commands that are submitted afterwards are completed as failed
+on the submitting thread.
+*/
+class AsyncStreamWriter {
+public:
+  using CompletionHandler = PipelinedStreamWriter::CompletionHandler;
+
+  // The file descriptor has to be a connected, non-blocking socket. The writer
+  // does not close it.
+  AsyncStreamWriter(EventLoop &event_loop, int file_descriptor,
+                    std::size_t max_in_flight,
+                    CompletionHandler completion_handler);
+
+  // Registers the connection with the event loop. Has to be called on the
+  // loop thread or before the loop runs.
+  [[nodiscard]] bool Start();
+
+  // Queues a RESP formatted command. Safe to call from any thread. Waits
+  // while the queue of submitted commands is full.
+  [[nodiscard]] bool Submit(std::string &&resp_formatted_command,
+                            std::uint64_t tag = 0);
+
+  // The number of commands that were submitted but not completed yet.
+  std::size_t GetNumberOfInFlightCommands() const {
+    return number_of_uncompleted_commands_.load(std::memory_order_relaxed);
+  }
+
+  bool HasFailed() const { return has_failed_.load(std::memory_order_acquire); }
+
+  // Only valid once HasFailed() returns true.
+  const std::string &GetLastError() const { return last_error_; }
+
+private:
+  struct SubmittedCommand {
+    std::string command;
+    std::uint64_t tag;
+  };
+
+  // The following methods run on the loop thread.
+  void OnEvents(std::uint32_t events);
+  // Moves submitted commands to the output buffer while the window allows.
+  void TakeSubmittedCommands();
+  [[nodiscard]] bool SendOutputBuffer();
+  [[nodiscard]] bool ReadReplies();
+  void Fail(const std::string &error);
+  void Complete(const StreamWriteResult &result);
+
+  EventLoop &event_loop_;
+  int file_descriptor_;
+  std::size_t max_in_flight_;
+  CompletionHandler completion_handler_;
+
+  MpmcRingBuffer<SubmittedCommand> submitted_commands_;
+  // Set while a task that takes the submitted commands is posted to the loop.
+  std::atomic<bool> is_take_posted_;
+  std::atomic<std::size_t> number_of_uncompleted_commands_;
+  std::atomic<bool> has_failed_;
+
+  std::string output_buffer_;
+  std::size_t output_offset_;
+  bool is_waiting_for_writability_;
+  // A ring of the tags of the commands that are awaiting a reply.
+  std::vector<std::uint64_t> pending_tags_;
+  std::size_t pending_head_;
+  std::size_t number_of_pending_commands_;
+
+  RespReader reply_reader_;
+  std::string last_error_;
+};
@@ -0,0 +1,229 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "../Concurrency/BufferPool.hpp"
+#include "../Parsing/RespParser.hpp"
+#include "IMessageProcessor.hpp"
+
+// A subscribed channel or pattern, interned to a small integer. The ids are
+// assigned in the order of the subscriptions, starting at 0.
+using ChannelId = std::uint32_t;
+constexpr ChannelId kUnknownChannelId = ~ChannelId{0};
+
+// A channel, or a glob-style pattern, and how its messages are handled.
+struct ChannelSubscription {
+  ChannelSubscription() = default;
+  ChannelSubscription(
+      std::string name, bool is_pattern, std::string processing_stream = "",
+      std::shared_ptr<IMessageProcessor> message_processor = nullptr)
+      : name(std::move(name)), is_pattern{is_pattern},
+        processing_stream(std::move(processing_stream)),
+        message_processor(std::move(message_processor)) {}
+
+  std::string name;
+  bool is_pattern = false;
+  // The stream that the processed messages are added to. When it is empty,
+  // the messages are only counted.
+  std::string processing_stream;
+  // Shared by every thread that processes the messages of the subscription.
+  // The consumers use their JSON processor when it is not set.
+  std::shared_ptr<IMessageProcessor> message_processor;
+};
+
+// A received message that waits to be processed.
+struct ReceivedMessage {
+  ChannelId channel_id = kUnknownChannelId;
+  // Only set for the messages of pattern subscriptions. For the others the
+  // channel is the name of the subscription.
+  std::string channel;
+  std::string payload;
+};
+
+// A received message in a single buffer of a BufferPool: the channel, only
+// for the messages of pattern subscriptions, followed by the payload. It is
+// moved through the queues, so its bytes are copied once, out of the
+// receive buffer.
+struct PooledMessage {
+  ChannelId channel_id = kUnknownChannelId;
+  std::uint32_t channel_size = 0;
+  // When the message was received, in nanoseconds on the steady clock.
+  long long receive_time_in_nanoseconds = 0;
+  // The message's record in the broker's journal, or 0 without one.
+  std::uint64_t journal_sequence = 0;
+  PooledBuffer buffer;
+
+  std::string_view GetChannel() const {
+    return buffer.View().substr(0, channel_size);
+  }
+  std::string_view GetPayload() const {
+    return buffer.View().substr(channel_size);
+  }
+};
+
+/*
+The channels and patterns that a consumer is subscribed to.
+
+Every subscription is interned to a ChannelId when it is added, and the
+received messages are resolved to their subscription through a flat open
+addressing table, with a single hash of the channel name and, usually, a
+single comparison. The table is filled before the messages are received and
+is only read afterwards, so it can be shared by the workers.
+*/
+class ChannelTable {
+public:
+  // Fails when the channel or pattern has already been added.
+  [[nodiscard]] bool Add(ChannelSubscription subscription) {
+    if (Find(subscription.name, subscription.is_pattern) != kUnknownChannelId) {
+      return false;
+    }
+    if ((subscriptions_.size() + 1) * 2 > slots_.size()) {
+      Rehash(slots_.empty() ? kMinimumNumberOfSlots : slots_.size() * 2);
+    }
+    const ChannelId channel_id = static_cast<ChannelId>(subscriptions_.size());
+    const std::uint64_t hash =
+        Hash(subscription.name, subscription.is_pattern);
+    subscriptions_.push_back(std::move(subscription));
+    Insert(hash, channel_id);
+    return true;
+  }
+
+  ChannelId Find(std::string_view name, bool is_pattern) const {
+    if (slots_.empty()) {
+      return kUnknownChannelId;
+    }
+    const std::uint64_t hash = Hash(name, is_pattern);
+    for (std::size_t i = hash & (slots_.size() - 1);;
+         i = (i + 1) & (slots_.size() - 1)) {
+      const Slot &slot = slots_[i];
+      if (slot.channel_id == kUnknownChannelId) {
+        return kUnknownChannelId;
+      }
+      const ChannelSubscription &subscription =
+          subscriptions_[slot.channel_id];
+      if (slot.hash == hash && subscription.is_pattern == is_pattern &&
+          subscription.name == name) {
+        return slot.channel_id;
+      }
+    }
+  }
+
+  // The subscription that a message was delivered for: its pattern for
+  // pattern messages, and its channel otherwise.
+  ChannelId Resolve(const PubSubMessage &pubsub_message) const {
+    if (pubsub_message.kind == PubSubMessageKind::PatternMessage) {
+      return Find(pubsub_message.pattern, true);
+    }
+    return Find(pubsub_message.channel, false);
+  }
+
+  const ChannelSubscription &Get(ChannelId channel_id) const {
+    return subscriptions_[channel_id];
+  }
+
+  // The channel that published the message.
+  std::string_view GetChannelName(const ReceivedMessage &message) const {
+    return subscriptions_[message.channel_id].is_pattern
+               ? std::string_view(message.channel)
+               : std::string_view(subscriptions_[message.channel_id].name);
+  }
+
+  std::string_view GetChannelName(const PooledMessage &message) const {
+    return subscriptions_[message.channel_id].is_pattern
+               ? message.GetChannel()
+               : std::string_view(subscriptions_[message.channel_id].name);
+  }
+
+  std::size_t GetNumberOfSubscriptions() const {
+    return subscriptions_.size();
+  }
+
+  bool HasProcessingStreams() const {
+    for (const ChannelSubscription &subscription : subscriptions_) {
+      if (!subscription.processing_stream.empty()) {
+        return true;
+      }
+    }
+    return false;
+  }
+
+  // Sets the processor of every subscription that does not have one.
+  void SetDefaultMessageProcessor(
+      const std::shared_ptr<IMessageProcessor> &message_processor) {
+    for (ChannelSubscription &subscription : subscriptions_) {
+      if (!subscription.message_processor) {
+        subscription.message_processor = message_processor;
+      }
+    }
+  }
+
+  // A single SUBSCRIBE command for all of the channels, followed by a single
+  // PSUBSCRIBE command for all of the patterns.
+  std::string CreateSubscriptionCommands() const {
+    return CreateSubscriptionCommand("SUBSCRIBE", false) +
+           CreateSubscriptionCommand("PSUBSCRIBE", true);
+  }
+
+private:
+  static constexpr std::size_t kMinimumNumberOfSlots = 16;
+
+  struct Slot {
+    std::uint64_t hash;
+    ChannelId channel_id;
+  };
+
+  // 64-bit FNV-1a, with channels and patterns of the same name kept apart.
+  static std::uint64_t Hash(std::string_view name, bool is_pattern) {
+    std::uint64_t hash = 14695981039346656037ULL ^ (is_pattern ? 1 : 0);
+    for (unsigned char character : name) {
+      hash ^= character;
+      hash *= 1099511628211ULL;
+    }
+    return hash;
+  }
+
+  void Insert(std::uint64_t hash, ChannelId channel_id) {
+    std::size_t i = hash & (slots_.size() - 1);
+    while (slots_[i].channel_id != kUnknownChannelId) {
+      i = (i + 1) & (slots_.size() - 1);
+    }
+    slots_[i] = {hash, channel_id};
+  }
+
+  void Rehash(std::size_t number_of_slots) {
+    slots_.assign(number_of_slots, Slot{0, kUnknownChannelId});
+    for (ChannelId channel_id = 0; channel_id < subscriptions_.size();
+         ++channel_id) {
+      const ChannelSubscription &subscription = subscriptions_[channel_id];
+      Insert(Hash(subscription.name, subscription.is_pattern), channel_id);
+    }
+  }
+
+  std::string CreateSubscriptionCommand(std::string_view command,
+                                        bool is_pattern) const {
+    std::size_t number_of_arguments = 1;
+    std::string arguments;
+    for (const ChannelSubscription &subscription : subscriptions_) {
+      if (subscription.is_pattern == is_pattern) {
+        ++number_of_arguments;
+        arguments += "$" + std::to_string(subscription.name.size()) + "\r\n" +
+                     subscription.name + "\r\n";
+      }
+    }
+    if (number_of_arguments == 1) {
+      return "";
+    }
+    return "*" + std::to_string(number_of_arguments) + "\r\n$" +
+           std::to_string(command.size()) + "\r\n" + std::string(command) +
+           "\r\n" + arguments;
+  }
+
+  // Open addressing with linear probing, at most half full.
+  std::vector<Slot> slots_;
+  std::vector<ChannelSubscription> subscriptions_;
+};
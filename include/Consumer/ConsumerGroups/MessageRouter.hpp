@@ -0,0 +1,52 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <utility>
+
+#include "../../Parsing/JsonFieldExtractor.hpp"
+
+/*
+Assigns the received messages to the broker's workers by their routing key.
+
+Messages with the same value of the routing key field are always assigned to
+the same worker, so they are processed and added to the processing stream in
+the order in which they were received. Messages without the field are spread
+over the workers in turn.
+
+Only the subscriber thread uses the router.
+*/
+class MessageRouter {
+public:
+  MessageRouter(std::string routing_key, std::size_t number_of_workers)
+      : routing_key_(std::move(routing_key)),
+        number_of_workers_{number_of_workers ? number_of_workers : 1},
+        next_worker_for_unkeyed_messages_{0} {}
+
+  std::size_t SelectWorker(std::string_view message) {
+    auto key = ExtractJsonField(message, routing_key_);
+    if (!key) {
+      std::size_t worker = next_worker_for_unkeyed_messages_;
+      next_worker_for_unkeyed_messages_ = (worker + 1) % number_of_workers_;
+      return worker;
+    }
+    return HashKey(*key) % number_of_workers_;
+  }
+
+  // 64-bit FNV-1a. It is stable across runs, so a key keeps its worker when
+  // the consumer is restarted with the same number of workers.
+  static std::uint64_t HashKey(std::string_view key) {
+    std::uint64_t hash = 14695981039346656037ULL;
+    for (unsigned char character : key) {
+      hash ^= character;
+      hash *= 1099511628211ULL;
+    }
+    return hash;
+  }
+
+private:
+  std::string routing_key_;
+  std::size_t number_of_workers_;
+  std::size_t next_worker_for_unkeyed_messages_;
+};
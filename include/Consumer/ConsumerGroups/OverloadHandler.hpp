@@ -0,0 +1,116 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <functional>
+#include <type_traits>
+#include <utility>
+
+#include "../../Concurrency/Backoff.hpp"
+#include "../../Concurrency/MpmcRingBuffer.hpp"
+#include "../ConsumerOptions.hpp"
+
+/*
+Pushes the received messages into the bounded queues of the broker's workers
+and decides what happens to a message whose queue is full, as set by the
+overload policy.
+
+Only the subscriber thread pushes. It also counts the dropped messages and
+keeps the high-water mark of the queues, which any thread can read.
+
+Dropping the oldest message takes it off the queue, which only a queue with
+multiple consumers allows. The single-consumer queues of the workers in
+key-affine and work-stealing mode drop the received message instead.
+
+A drop handler is called with every dropped message before it is destroyed,
+e.g. to mark it complete in the journal.
+*/
+template <typename T> class OverloadHandler {
+public:
+  OverloadHandler(OverloadPolicy policy, std::size_t sample_interval)
+      : policy_{policy}, sample_interval_{std::max<std::size_t>(
+                             sample_interval, 1)},
+        number_of_overloaded_pushes_{0}, number_of_dropped_messages_{0},
+        high_water_mark_{0} {}
+
+  // Has to be set before the first push.
+  void SetDropHandler(std::function<void(const T &)> drop_handler) {
+    drop_handler_ = std::move(drop_handler);
+  }
+
+  // Returns false when the value was dropped instead of queued.
+  template <typename Queue> bool Push(Queue &queue, T &&value) {
+    if (!queue.TryPush(std::move(value))) {
+      if (!PushToFullQueue(queue, std::move(value))) {
+        Drop(value);
+        return false;
+      }
+    }
+    const long long size = static_cast<long long>(queue.GetApproximateSize());
+    if (size > high_water_mark_.load(std::memory_order_relaxed)) {
+      high_water_mark_.store(size, std::memory_order_relaxed);
+    }
+    return true;
+  }
+
+  long long GetNumberOfDroppedMessages() const {
+    return number_of_dropped_messages_.load(std::memory_order_relaxed);
+  }
+
+  // The most messages that any of the queues held right after a push.
+  long long GetHighWaterMark() const {
+    return high_water_mark_.load(std::memory_order_relaxed);
+  }
+
+private:
+  template <typename Queue> bool PushToFullQueue(Queue &queue, T &&value) {
+    constexpr bool kCanDropOldest =
+        std::is_same<Queue, MpmcRingBuffer<T>>::value;
+    switch (policy_) {
+    case OverloadPolicy::DropNewest:
+      return false;
+    case OverloadPolicy::DropOldest:
+      if constexpr (kCanDropOldest) {
+        while (!queue.TryPush(std::move(value))) {
+          // The workers may have emptied the queue in the meantime.
+          T oldest;
+          if (queue.TryPop(oldest)) {
+            Drop(oldest);
+          }
+        }
+        return true;
+      }
+      return false;
+    case OverloadPolicy::Sample:
+      // Every sample_interval_-th message that finds its queue full waits
+      // for room, the others are dropped.
+      if (number_of_overloaded_pushes_++ % sample_interval_ != 0) {
+        return false;
+      }
+      break;
+    case OverloadPolicy::Block:
+      break;
+    }
+    Backoff backoff;
+    while (!queue.TryPush(std::move(value))) {
+      backoff.Pause();
+    }
+    return true;
+  }
+
+  void Drop(const T &value) {
+    if (drop_handler_) {
+      drop_handler_(value);
+    }
+    number_of_dropped_messages_.store(
+        number_of_dropped_messages_.load(std::memory_order_relaxed) + 1,
+        std::memory_order_relaxed);
+  }
+
+  const OverloadPolicy policy_;
+  const std::size_t sample_interval_;
+  std::size_t number_of_overloaded_pushes_;
+  std::atomic<long long> number_of_dropped_messages_;
+  std::atomic<long long> high_water_mark_;
+  std::function<void(const T &)> drop_handler_;
+};
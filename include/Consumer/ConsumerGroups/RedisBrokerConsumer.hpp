@@ -1,32 +1,55 @@
 #pragma once
 #include "../../common.hpp"
 #include <atomic>
-#include <condition_variable>
 #include <memory>
-#include <mutex>
-#include <queue>
+#include <string_view>
 #include <thread>
 #include <vector>
 
+#include "../../Concurrency/BufferPool.hpp"
+#include "../../Concurrency/EventCount.hpp"
+#include "../../Concurrency/MpmcRingBuffer.hpp"
+#include "../../Concurrency/SpscRingBuffer.hpp"
+#include "../../Parsing/RespReader.hpp"
+#include "../../Storage/Journal.hpp"
+#include "../../Storage/SpillQueue.hpp"
+#include "../ChannelTable.hpp"
+#include "../ConsumerOptions.hpp"
 #include "../IObservableConsumer.hpp"
+#include "MessageRouter.hpp"
+#include "OverloadHandler.hpp"
 // Forward declaration for Pimpl
 // Pointers only need a forward declaration to compile.
 class IMessageProcessor;
+class ShardedSubscriber;
 
 class RedisBrokerConsumer : public IObservableConsumer {
 private:
   void ReportError(const std::string &error_message) const {
-    std::cerr << "[RedisBrokerConsumer] " << error_message << std::endl;
+    LOG(LogLevel::Error, "[RedisBrokerConsumer] {}", error_message);
   }
 
-  void ProcessMessage(const std::string &message);
+  void ProcessMessage(ChannelId channel_id, std::string_view channel,
+                      std::string_view message);
+  // Appends the message to the spill queue. Returns false when it is full.
+  bool SpillMessage(const PooledMessage &queued_message,
+                    std::string_view channel, std::string_view message);
+  // Hands the messages that the journal recovered from the previous run to
+  // the workers, which journal them again, and discards the old records.
+  void ReplayJournal();
 
   void EstablishConnection(const std::string &redis_server_hostname,
                            unsigned short redis_server_port,
                            int &file_descriptor) const;
 
+  // Subscribes to the sharded channels and selects the cluster node that the
+  // workers add the processed messages to.
+  void SubscribeToShards(std::string &processing_hostname,
+                         unsigned short &processing_port);
+
 public:
-  RedisBrokerConsumer(bool verbose_outputs, int number_of_workers);
+  RedisBrokerConsumer(bool verbose_outputs, int number_of_workers,
+                      const ConsumerOptions &options = {});
   ~RedisBrokerConsumer();
 
   void EstablishConnection(const std::string &redis_server_hostname,
@@ -35,27 +58,66 @@ public:
   void SubscribeToChannel(const std::string &channel_name,
                           const std::string &processing_stream = "");
 
+  // Subscribes to all of the channels and patterns over the subscription
+  // connection. The workers process every message with the processor of the
+  // subscription that it was delivered for and add it to its stream.
+  //
+  // With sharded pub/sub, the connected server is a node of a Redis Cluster
+  // and the channels are subscribed to on the nodes that own their slots.
+  void SubscribeToChannels(std::vector<ChannelSubscription> subscriptions);
+
   long long GetNumberOfProcessedMessages() const override;
+  std::vector<WorkerStatistics> GetWorkerStatistics() const override;
+  IngestStatistics GetIngestStatistics() const override;
+  LatencyStatistics GetLatencyStatistics() const override;
+  long long GetNumberOfQueuedMessages() const override;
+  CounterValues GetCounters() const override;
+  QueueStatistics GetQueueStatistics() const override;
 
 private:
   bool verbose_outputs_;
   int number_of_workers_;
+  ConsumerOptions options_;
 
   std::string redis_server_hostname_;
   unsigned short redis_server_port_;
 
   int subscription_socket_file_descriptor_;
+  RespReader subscription_reader_;
   bool initial_connection_established_;
+  // Only set with sharded pub/sub, where it reads the subscriptions instead
+  // of subscription_reader_.
+  std::unique_ptr<ShardedSubscriber> sharded_subscriber_;
 
-  std::string subsciption_channel_;
+  ChannelTable channel_table_;
 
   class MessageProcessorImpl;
   std::shared_ptr<MessageProcessorImpl> message_processor_impl_;
-  std::queue<std::string> message_queue_;
+  // The buffers of the received messages. It outlives the queues and the
+  // workers, which hold its buffers.
+  BufferPool message_buffer_pool_;
+  // Hands the received messages over to the workers.
+  MpmcRingBuffer<PooledMessage> message_queue_;
+  EventCount message_queue_event_count_;
+  // Pushes the received messages into the shared queue or the workers' own
+  // queues.
+  OverloadHandler<PooledMessage> overload_handler_;
+  // Only set with a spill directory in round-robin mode, where it takes the
+  // messages that do not fit into message_queue_.
+  std::unique_ptr<SpillQueue> spill_queue_;
+  // Only set with a journal directory. It outlives the workers, which
+  // complete its records.
+  std::unique_ptr<Journal> journal_;
+  // Only set in key-affine mode, where every worker has its own queue.
+  std::unique_ptr<MessageRouter> message_router_;
+  // The worker that gets the next message in work-stealing mode.
+  std::size_t next_worker_;
+
+  // The counters of the subscriber thread and of every worker. They outlive
+  // the workers, which hold their counters.
+  CounterSet counters_;
+  ThreadCounters &subscriber_counters_;
 
   class BrokerWorker;
   std::vector<std::unique_ptr<BrokerWorker>> workers_;
-
-  std::mutex queue_mutex_;
-  std::condition_variable cv_;
 };
\ No newline at end of file
@@ -0,0 +1,111 @@
+#pragma once
+#include "../../common.hpp"
+#include <atomic>
+#include <deque>
+#include <memory>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include "../../Concurrency/EventCount.hpp"
+#include "../../Concurrency/MpmcRingBuffer.hpp"
+#include "../../Networking/EventLoop.hpp"
+#include "../../Parsing/RespReader.hpp"
+#include "../ChannelTable.hpp"
+#include "../ConsumerOptions.hpp"
+#include "../IObservableConsumer.hpp"
+
+class JsonMessageProcessorImpl;
+
+/*
+A consumer group whose Redis connections are driven by event loops instead
+of a thread per connection.
+
+The subscription connection and the processing connections of the workers
+are non-blocking sockets multiplexed by one or more EventLoops (reactor
+threads). The subscription is always read on the first loop, on the thread
+that calls SubscribeToChannel(). The processing connections are spread over
+the other loops, if there are any.
+
+The received messages are processed by a separate pool of worker threads
+that hand their XADD commands back to the loops. When the workers fall
+behind and their queue is full, the subscription is not read until they have
+caught up.
+*/
+class RedisReactorConsumer : public IObservableConsumer {
+private:
+  void ReportError(const std::string &error_message) const {
+    LOG(LogLevel::Error, "[RedisReactorConsumer] {}", error_message);
+  }
+
+  void EstablishConnection(const std::string &redis_server_hostname,
+                           unsigned short redis_server_port,
+                           int &file_descriptor) const;
+
+  // These run on the thread of the first event loop.
+  void OnSubscriptionEvents(std::uint32_t events);
+  void HandleSubscriptionReply(const RespParser &resp_parser);
+  void QueueMessage(ChannelId channel_id, std::string_view channel,
+                    std::string_view message);
+  void PauseReading();
+  void ResumeReading();
+
+  struct Worker;
+  void ProcessMessages(Worker &worker);
+
+public:
+  RedisReactorConsumer(bool verbose_outputs, int number_of_workers,
+                       const ConsumerOptions &options = {});
+  ~RedisReactorConsumer();
+
+  void EstablishConnection(const std::string &redis_server_hostname,
+                           unsigned short redis_server_port);
+
+  // Runs the first event loop until the subscription connection is closed.
+  void SubscribeToChannel(const std::string &channel_name,
+                          const std::string &processing_stream = "");
+  // Like SubscribeToChannel(), for all of the channels and patterns. Every
+  // message is processed by the processor of the subscription that it was
+  // delivered for and added to its stream.
+  void SubscribeToChannels(std::vector<ChannelSubscription> subscriptions);
+
+  long long GetNumberOfProcessedMessages() const override;
+  IngestStatistics GetIngestStatistics() const override {
+    return subscription_reader_.GetStatistics();
+  }
+  std::vector<WorkerStatistics> GetWorkerStatistics() const override;
+  long long GetNumberOfQueuedMessages() const override {
+    return message_queue_.GetApproximateSize();
+  }
+
+private:
+  bool verbose_outputs_;
+  int number_of_workers_;
+  ConsumerOptions options_;
+
+  std::string redis_server_hostname_;
+  unsigned short redis_server_port_;
+
+  int subscription_socket_file_descriptor_;
+  RespReader subscription_reader_;
+  PubSubMessage pubsub_message_;
+  bool initial_connection_established_;
+
+  ChannelTable channel_table_;
+
+  std::vector<std::unique_ptr<EventLoop>> event_loops_;
+  // The threads of every event loop but the first one.
+  std::vector<std::thread> event_loop_threads_;
+
+  std::shared_ptr<JsonMessageProcessorImpl> message_processor_;
+  MpmcRingBuffer<ReceivedMessage> message_queue_;
+  EventCount message_queue_event_count_;
+  // The received messages that did not fit into the full queue. Only used on
+  // the first loop's thread.
+  std::deque<ReceivedMessage> message_backlog_;
+  std::atomic<bool> is_reading_paused_;
+  std::atomic<bool> is_resume_posted_;
+
+  std::vector<std::unique_ptr<Worker>> workers_;
+  std::atomic<bool> stop_;
+};
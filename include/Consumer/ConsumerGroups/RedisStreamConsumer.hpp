@@ -0,0 +1,103 @@
+#pragma once
+#include "../../common.hpp"
+#include <atomic>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "../../Concurrency/EventCount.hpp"
+#include "../../Concurrency/MpmcRingBuffer.hpp"
+#include "../../Parsing/RespReader.hpp"
+#include "../ConsumerOptions.hpp"
+#include "../IObservableConsumer.hpp"
+#include "../StreamGroupSubscription.hpp"
+
+class IMessageProcessor;
+
+/*
+Reads messages from a Redis stream as a member of a consumer group, instead
+of from a pub/sub channel, so no message is lost while the consumer is slow,
+disconnected or restarted.
+
+A reader thread fetches up to xreadgroup_count entries with every blocking
+XREADGROUP and hands them to a pool of workers. The workers process the
+entries, add them to the processing stream and acknowledge them with a
+single XACK per batch, pipelined with the XADD commands on their own
+connection. An entry is only acknowledged once it was added to the
+processing stream, so entries whose processing fails stay pending in the
+group.
+
+When the consumer starts, it first processes the entries that were delivered
+to it before, but never acknowledged.
+*/
+class RedisStreamConsumer : public IObservableConsumer {
+private:
+  void ReportError(const std::string &error_message) const {
+    LOG(LogLevel::Error, "[RedisStreamConsumer] {}", error_message);
+  }
+
+  void EstablishConnection(const std::string &redis_server_hostname,
+                           unsigned short redis_server_port,
+                           int &file_descriptor) const;
+
+  // Sends a command over the reading connection and waits for its reply.
+  template <typename ReplyHandler>
+  [[nodiscard]] bool Execute(const std::string &command,
+                             ReplyHandler &&reply_handler);
+  [[nodiscard]] bool CreateGroup();
+  void UpdatePendingEntries();
+
+public:
+  RedisStreamConsumer(bool verbose_outputs, int number_of_workers,
+                      const ConsumerOptions &options = {});
+  ~RedisStreamConsumer();
+
+  void EstablishConnection(const std::string &redis_server_hostname,
+                           unsigned short redis_server_port);
+
+  // Reads the stream until the reading connection fails.
+  void ConsumeStream(StreamGroupSubscription subscription);
+
+  long long GetNumberOfProcessedMessages() const override;
+  IngestStatistics GetIngestStatistics() const override {
+    return reader_.GetStatistics();
+  }
+  std::vector<WorkerStatistics> GetWorkerStatistics() const override;
+  long long GetNumberOfQueuedMessages() const override {
+    return entry_queue_.GetApproximateSize();
+  }
+  std::optional<PendingEntryStatistics>
+  GetPendingEntryStatistics() const override;
+
+private:
+  bool verbose_outputs_;
+  int number_of_workers_;
+  ConsumerOptions options_;
+
+  std::string redis_server_hostname_;
+  unsigned short redis_server_port_;
+
+  int reading_socket_file_descriptor_;
+  RespReader reader_;
+  bool initial_connection_established_;
+
+  StreamGroupSubscription subscription_;
+  std::shared_ptr<IMessageProcessor> message_processor_;
+
+  // An entry that waits for a worker.
+  struct QueuedEntry {
+    std::string id;
+    std::string payload;
+    bool has_payload;
+  };
+  MpmcRingBuffer<QueuedEntry> entry_queue_;
+  EventCount entry_queue_event_count_;
+
+  std::atomic<long long> number_of_read_entries_;
+  // As reported by the last XPENDING.
+  std::atomic<long long> number_of_pending_entries_;
+
+  class StreamWorker;
+  std::vector<std::unique_ptr<StreamWorker>> workers_;
+};
@@ -0,0 +1,121 @@
+#pragma once
+#include <cstddef>
+#include <string>
+
+// How the broker consumer hands the received messages to its workers.
+enum class DispatchMode {
+  // Any idle worker takes the next message from a shared queue.
+  RoundRobin,
+  // Every routing key is owned by one worker, which preserves the order of
+  // the messages with the same key.
+  KeyAffine,
+  // The messages are spread over the workers' own deques and idle workers
+  // steal from the busy ones. Does not preserve the order of the messages.
+  WorkStealing
+};
+
+// What the broker's subscriber does with a received message whose queue is
+// full.
+enum class OverloadPolicy {
+  // Waits for the workers to make room. The subscription connection is not
+  // read meanwhile, so the messages pile up in Redis' output buffer of the
+  // client, which Redis limits.
+  Block,
+  // Drops the received message.
+  DropNewest,
+  // Drops the oldest queued message to make room for the received one. The
+  // workers' own queues drop the received message instead.
+  DropOldest,
+  // Waits for room for one in every overload_sample_interval of the
+  // messages that find their queue full and drops the others.
+  Sample
+};
+
+// How the consumers drive their Redis connections.
+enum class IoEngine {
+  // Blocking sockets, each one used by its own thread.
+  Threads,
+  // Non-blocking sockets multiplexed by epoll event loops.
+  Epoll,
+  // Like Threads, but the subscription is read with a multishot receive of
+  // an io_uring, which also sends the XADD commands of a single consumer.
+  // Falls back to Threads when io_uring is not available.
+  IoUring
+};
+
+// Where the consumers read the messages from.
+enum class IngestMode {
+  // Subscriptions to pub/sub channels and patterns.
+  PubSub,
+  // A Redis stream, read with XREADGROUP as a member of a consumer group.
+  Stream
+};
+
+// The clock that the processing times of the messages are read from.
+enum class TimestampClock {
+  // CLOCK_REALTIME, precise to the nanosecond.
+  Realtime,
+  // CLOCK_REALTIME_COARSE, which is cheaper to read but only advances every
+  // few milliseconds.
+  RealtimeCoarse
+};
+
+// How the processing times are written to the processing streams.
+enum class TimestampFormat {
+  // The local time as YYYY-MM-DD HH:MM:SS.mmm.
+  DateTime,
+  // The nanoseconds since the epoch.
+  EpochNanoseconds
+};
+
+// Tuning parameters shared by the consumer implementations.
+struct ConsumerOptions {
+  // The maximum number of XADD commands that can be awaiting a reply on a
+  // single processing connection.
+  std::size_t xadd_pipeline_depth = 64;
+  DispatchMode dispatch_mode = DispatchMode::RoundRobin;
+  // The JSON field whose value selects the worker in key-affine mode.
+  std::string routing_key = "message_id";
+  // The number of received messages that can wait for the broker's or the
+  // reactor's workers, rounded up to a power of two. With their own queues,
+  // the broker's workers share it.
+  std::size_t broker_queue_capacity = 64 * 1024;
+  OverloadPolicy overload_policy = OverloadPolicy::Block;
+  std::size_t overload_sample_interval = 10;
+  // A directory for the messages that do not fit into the broker's queue in
+  // round-robin mode. Empty to keep every message in memory. The messages go
+  // to the disk while the queue is full, and until the workers have drained
+  // the spilled ones, and the overload policy only applies once the disk
+  // space is used up too.
+  std::string spill_directory;
+  std::size_t spill_segment_size = 64 * 1024 * 1024;
+  std::size_t spill_max_segments = 16;
+  // A directory for the write-ahead journal of the broker's received
+  // messages. Empty to disable it. Every message is journaled before it is
+  // queued and stays in the journal until its XADD is answered, so the
+  // messages that were not processed before a crash are processed after the
+  // restart.
+  std::string journal_directory;
+  std::size_t journal_segment_size = 64 * 1024 * 1024;
+  // The journal is flushed to the disk every interval, or after that many
+  // messages, whichever comes first.
+  std::size_t journal_commit_interval_in_milliseconds = 5;
+  std::size_t journal_commit_records = 1000;
+  IoEngine io_engine = IoEngine::Threads;
+  // The number of event loop threads of the epoll engine.
+  std::size_t number_of_reactor_threads = 1;
+  // Subscribes to the channels with SSUBSCRIBE on the masters of a Redis
+  // Cluster that own their hash slots, instead of with SUBSCRIBE on the
+  // server that the consumer connected to. Only the broker consumer supports
+  // it, and it does not support patterns.
+  bool sharded_pubsub = false;
+  IngestMode ingest_mode = IngestMode::PubSub;
+  // The maximum number of entries that the stream consumer reads with a
+  // single XREADGROUP. The workers acknowledge up to as many entries with a
+  // single XACK.
+  std::size_t xreadgroup_count = 100;
+  // How long a XREADGROUP waits for new entries before it is sent again.
+  std::size_t xreadgroup_block_in_milliseconds = 1000;
+  TimestampClock timestamp_clock = TimestampClock::Realtime;
+  TimestampFormat timestamp_format = TimestampFormat::DateTime;
+};
@@ -0,0 +1,71 @@
+#pragma once
+#include "../Monitoring/LatencyHistogram.hpp"
+#include "../Parsing/IngestStatistics.hpp"
+
+// Statistics about one of a consumer's worker threads.
+struct WorkerStatistics {
+  int worker_id;
+  long long number_of_processed_messages;
+  // The number of messages that the worker took from other workers' queues.
+  long long number_of_stolen_messages;
+  // The time spent processing messages, as opposed to waiting for them.
+  long long busy_time_in_nanoseconds;
+  long long number_of_processing_errors;
+  // The XADD (or XACK) commands that await a reply.
+  long long number_of_in_flight_stream_writes;
+  // The messages in the worker's own queue, when it has one.
+  long long number_of_queued_messages;
+};
+
+// Statistics about the bounded queues that the received messages wait in for
+// the workers.
+struct QueueStatistics {
+  // The number of messages that a queue can hold.
+  long long capacity;
+  // The most messages that a queue held so far.
+  long long high_water_mark;
+  // The received messages that were dropped because their queue was full.
+  long long number_of_dropped_messages;
+  // The received messages that were spilled to the disk so far, and the ones
+  // that still wait there.
+  long long number_of_spilled_messages;
+  long long number_of_messages_on_disk;
+};
+
+// Statistics about the entries that a consumer group reads from a stream.
+struct PendingEntryStatistics {
+  // The entries that this consumer has read, but not acknowledged yet.
+  long long number_of_unacknowledged_entries;
+  // The entries of the whole group that await an acknowledgement, as last
+  // reported by XPENDING.
+  long long number_of_pending_entries;
+  long long number_of_acknowledged_entries;
+};
+
+// The latencies of the messages of a consumer, in nanoseconds. The stages
+// that a consumer does not measure stay empty.
+struct LatencyStatistics {
+  // From the publish time in the payload's publish_time_ns field to the
+  // message's receipt. Only recorded for the payloads that carry the field.
+  LatencySnapshot publish_to_receive;
+  // From the message's receipt until a worker takes it off its queue.
+  LatencySnapshot receive_to_dequeue;
+  // The time spent in the IMessageProcessor.
+  LatencySnapshot processing;
+  // From the submission of an XADD command until its reply.
+  LatencySnapshot stream_write_round_trip;
+
+  void Merge(const LatencyStatistics &other) {
+    publish_to_receive.Merge(other.publish_to_receive);
+    receive_to_dequeue.Merge(other.receive_to_dequeue);
+    processing.Merge(other.processing);
+    stream_write_round_trip.Merge(other.stream_write_round_trip);
+  }
+
+  LatencyStatistics Since(const LatencyStatistics &earlier) const {
+    return {publish_to_receive.Since(earlier.publish_to_receive),
+            receive_to_dequeue.Since(earlier.receive_to_dequeue),
+            processing.Since(earlier.processing),
+            stream_write_round_trip.Since(earlier.stream_write_round_trip)};
+  }
+};
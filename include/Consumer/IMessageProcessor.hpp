@@ -1,9 +1,27 @@
 #pragma once
 #include "Message.hpp"
 #include <optional>
+#include <string_view>
 
 class IMessageProcessor {
 public:
   virtual ~IMessageProcessor() = default;
-  virtual std::optional<Message> ProcessMessage(const std::string &) = 0;
-};
\ No newline at end of file
+  virtual std::optional<Message> ProcessMessage(std::string_view) = 0;
+
+  // Like ProcessMessage(), but only sets the message id of the view, which
+  // stays valid as long as the payload and the storage. Processors that find
+  // the id in the payload override it to avoid allocating, and set the
+  // publish time in the same pass; the default copies the id into storage,
+  // whose capacity the caller reuses.
+  virtual bool ProcessMessageInPlace(std::string_view payload,
+                                     MessageView &message,
+                                     std::string &storage) {
+    std::optional<Message> processed_message = ProcessMessage(payload);
+    if (!processed_message) {
+      return false;
+    }
+    storage.assign(processed_message->message_id);
+    message.message_id = storage;
+    return true;
+  }
+};
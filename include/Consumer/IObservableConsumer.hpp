@@ -1,7 +1,36 @@
 #pragma once
+#include "../Monitoring/CounterSet.hpp"
+#include "ConsumerStatistics.hpp"
+#include <optional>
+#include <vector>
 
 class IObservableConsumer {
 public:
   virtual ~IObservableConsumer() = default;
   virtual long long GetNumberOfProcessedMessages() const = 0;
+  virtual IngestStatistics GetIngestStatistics() const { return {}; }
+  virtual std::vector<WorkerStatistics> GetWorkerStatistics() const {
+    return {};
+  }
+  virtual LatencyStatistics GetLatencyStatistics() const { return {}; }
+  // The counters summed over the consumer's threads. Consumers without
+  // counters of their own only report the processed messages and, as the
+  // received bytes, the bytes read from the subscription connection.
+  virtual CounterValues GetCounters() const {
+    CounterValues counters;
+    counters.Set(CounterId::ProcessedMessages, GetNumberOfProcessedMessages());
+    counters.Set(CounterId::ReceivedBytes,
+                 GetIngestStatistics().number_of_bytes);
+    return counters;
+  }
+  // The received messages that wait for any of the workers.
+  virtual long long GetNumberOfQueuedMessages() const { return 0; }
+  // Only filled in by the consumers with bounded queues and an overload
+  // policy.
+  virtual QueueStatistics GetQueueStatistics() const { return {}; }
+  // Only set for the consumers that read from a stream as a consumer group.
+  virtual std::optional<PendingEntryStatistics>
+  GetPendingEntryStatistics() const {
+    return std::nullopt;
+  }
 };
\ No newline at end of file
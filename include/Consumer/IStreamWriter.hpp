@@ -0,0 +1,39 @@
+#pragma once
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <string_view>
+
+// The outcome of a single command sent through an IStreamWriter.
+struct StreamWriteResult {
+  bool is_success;
+  // The reply's payload: the id of the added stream entry, the text of an
+  // integer reply, e.g. the number of entries acknowledged by XACK, or an
+  // error text.
+  std::string_view reply;
+  // The tag that was passed to Submit() together with the command.
+  std::uint64_t tag;
+};
+
+/*
+A connection that sends pipelined XADD (or XACK) commands and reports the
+outcome of every command through a completion handler, in submission order.
+*/
+class IStreamWriter {
+public:
+  using CompletionHandler = std::function<void(const StreamWriteResult &)>;
+
+  virtual ~IStreamWriter() = default;
+
+  // Queues a RESP formatted command. May wait for replies when too many
+  // commands are awaiting one. A command that is rejected (false) is still
+  // completed through the completion handler, as failed, so callers must not
+  // count it again.
+  [[nodiscard]] virtual bool Submit(std::string_view resp_formatted_command,
+                                    std::uint64_t tag = 0) = 0;
+
+  // Sends every queued command. Blocking writers also wait for the replies.
+  [[nodiscard]] virtual bool Flush() = 0;
+
+  virtual const std::string &GetLastError() const = 0;
+};
@@ -0,0 +1,73 @@
+#pragma once
+#ifdef HAS_IO_URING
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "../Networking/IoUringLoop.hpp"
+#include "../Parsing/RespReader.hpp"
+#include "IStreamWriter.hpp"
+
+/*
+Sends pipelined XADD commands through an IoUringLoop.
+
+Works like the PipelinedStreamWriter, but makes no system calls of its own:
+Flush() hands the buffered commands to the loop as a single send, which is
+submitted together with the loop's next wait for completions, and the
+replies arrive through a multishot receive. Only Submit() runs the loop
+itself, when max_in_flight commands are already awaiting a reply.
+
+Only one send is in flight at a time, so the commands reach Redis in the
+order they were submitted. Must be used on the loop thread.
+*/
+class IoUringStreamWriter : public IStreamWriter {
+public:
+  // The writer does not close the file descriptor.
+  IoUringStreamWriter(IoUringLoop &io_uring_loop, int file_descriptor,
+                      std::size_t max_in_flight,
+                      CompletionHandler completion_handler);
+
+  // Starts receiving the replies.
+  [[nodiscard]] bool Start();
+
+  [[nodiscard]] bool Submit(std::string_view resp_formatted_command,
+                            std::uint64_t tag = 0) override;
+
+  // Queues the send of the buffered commands without waiting for it.
+  [[nodiscard]] bool Flush() override;
+
+  std::size_t GetNumberOfInFlightCommands() const {
+    return number_of_pending_commands_;
+  }
+
+  bool HasFailed() const { return has_failed_; }
+
+  const std::string &GetLastError() const override { return last_error_; }
+
+private:
+  void OnSendCompleted(bool is_success);
+  void OnReceive(std::string_view data);
+  // Completes every outstanding command as failed.
+  void Fail(const std::string &error);
+
+  IoUringLoop &io_uring_loop_;
+  int file_descriptor_;
+  std::size_t max_in_flight_;
+  CompletionHandler completion_handler_;
+  bool has_failed_;
+
+  // The commands are collected in the output buffer while the sending
+  // buffer is handed to the kernel.
+  std::string output_buffer_;
+  std::string sending_buffer_;
+  bool is_sending_;
+
+  // A ring of the tags of the commands that are awaiting a reply.
+  std::vector<std::uint64_t> pending_tags_;
+  std::size_t pending_head_;
+  std::size_t number_of_pending_commands_;
+
+  RespReader reply_reader_;
+  std::string last_error_;
+};
+#endif
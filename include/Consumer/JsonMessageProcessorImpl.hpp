@@ -3,5 +3,8 @@
 
 class JsonMessageProcessorImpl : public IMessageProcessor {
 public:
-  std::optional<Message> ProcessMessage(const std::string &json) override;
+  std::optional<Message> ProcessMessage(std::string_view json) override;
+  // The message id points into the json.
+  bool ProcessMessageInPlace(std::string_view json, MessageView &message,
+                             std::string &storage) override;
 };
\ No newline at end of file
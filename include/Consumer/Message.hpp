@@ -1,9 +1,23 @@
 #pragma once
 #include <string>
+#include <string_view>
 
 struct Message {
   int processor_id;
   std::string processing_date_time;
   std::string source_channel_name;
   std::string message_id;
-};
\ No newline at end of file
+};
+
+// A Message whose fields point into buffers owned by the caller, such as the
+// received payload, so it can be filled without allocating.
+struct MessageView {
+  int processor_id;
+  std::string_view processing_date_time;
+  std::string_view source_channel_name;
+  std::string_view message_id;
+  // The payload's publish_time_ns field, when the processor found one, which
+  // the broker measures the publish-to-receive latency with. It is not
+  // written to the processing stream.
+  std::string_view publish_time = {};
+};
@@ -0,0 +1,71 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "../Parsing/RespReader.hpp"
+#include "IStreamWriter.hpp"
+
+/*
+Sends XADD commands over a single connection without waiting for the reply
+of one command before sending the next one.
+
+Up to max_in_flight commands can be awaiting a reply at the same time. Redis
+answers the commands of a connection in order, so every reply is matched to
+the oldest command that has not been answered yet and reported through the
+completion handler, together with the tag the command was submitted with.
+
+Commands are collected in an output buffer and written with a single send()
+once the buffer is large enough, the window is full, or Flush() is called.
+Every submitted command is completed exactly once, also when the connection
+fails, so the handler can keep exact success and error counts.
+*/
+class PipelinedStreamWriter : public IStreamWriter {
+public:
+  PipelinedStreamWriter(int file_descriptor, std::size_t max_in_flight,
+                        CompletionHandler completion_handler);
+
+  // Queues a RESP formatted command. Blocks while waiting for replies when
+  // the window of in-flight commands is full.
+  [[nodiscard]] bool Submit(std::string_view resp_formatted_command,
+                            std::uint64_t tag = 0) override;
+
+  // Sends every queued command and waits for all of the outstanding replies.
+  [[nodiscard]] bool Flush() override;
+
+  std::size_t GetNumberOfInFlightCommands() const {
+    return number_of_in_flight_commands_.load(std::memory_order_relaxed);
+  }
+
+  // The number of send() and read system calls made so far.
+  long long GetNumberOfSystemCalls() const {
+    return number_of_sends_ + reply_reader_.GetStatistics().number_of_reads;
+  }
+
+  const std::string &GetLastError() const override { return last_error_; }
+
+private:
+  [[nodiscard]] bool SendOutputBuffer();
+  // Reads once from the connection and completes the answered commands.
+  [[nodiscard]] bool ReadReplies();
+  // Completes every outstanding command as failed after a connection error.
+  void FailPendingCommands();
+
+  int file_descriptor_;
+  std::size_t max_in_flight_;
+  CompletionHandler completion_handler_;
+
+  std::string output_buffer_;
+  // A ring of the tags of the commands that are awaiting a reply.
+  std::vector<std::uint64_t> pending_tags_;
+  std::size_t pending_head_;
+  std::size_t number_of_pending_commands_;
+  std::atomic<std::size_t> number_of_in_flight_commands_;
+  long long number_of_sends_;
+
+  RespReader reply_reader_;
+  std::string last_error_;
+};
@@ -2,13 +2,20 @@
 #include "../common.hpp"
 #include <atomic>
 #include <memory>
+#include <string_view>
 #include <vector>
 
+#include "../Parsing/RespReader.hpp"
+#include "ChannelTable.hpp"
+#include "ConsumerOptions.hpp"
 #include "IObservableConsumer.hpp"
+#include "TimestampService.hpp"
 
 // Forward declaration for Pimpl
 // Pointers only need a forward declaration to compile.
 class IMessageProcessor;
+class IStreamWriter;
+struct StreamWriteResult;
 
 class RedisConsumer : public IObservableConsumer {
 private:
@@ -16,31 +23,48 @@ private:
   std::unique_ptr<MessageProcessorImpl> message_processor_impl_;
 
   void ReportError(const std::string &error_message) const {
-    std::cerr << "[Consumer Id = " << id_ << "] " << error_message << std::endl;
+    LOG(LogLevel::Error, "[Consumer Id = {}] {}", id_, error_message);
   }
 
-  void ProcessMessage(const std::string &message);
+  void ProcessMessage(ChannelId channel_id, std::string_view channel,
+                      std::string_view message);
+  void OnStreamWriteCompleted(const StreamWriteResult &result);
 
   void EstablishConnection(const std::string &redis_server_hostname,
                            unsigned short redis_server_port,
                            int &file_descriptor) const;
-  [[nodiscard]] bool AddDataToStream(const std::string &resp_formatted_command,
-                                     bool is_internal_call) const;
+  [[nodiscard]] bool
+  AddDataToStream(const std::string &resp_formatted_command) const;
 
 public:
-  RedisConsumer(bool verbose_outputs);
+  RedisConsumer(bool verbose_outputs, const ConsumerOptions &options = {});
   ~RedisConsumer();
 
   long long GetNumberOfProcessedMessages() const override {
     return number_of_processed_messages_;
   }
 
+  IngestStatistics GetIngestStatistics() const override {
+    return subscription_reader_.GetStatistics();
+  }
+
+  CounterValues GetCounters() const override {
+    CounterValues counters = IObservableConsumer::GetCounters();
+    counters.Set(CounterId::ProcessingErrors, number_of_processing_errors_);
+    return counters;
+  }
+
   void EstablishConnection(const std::string &redis_server_hostname,
                            unsigned short redis_server_port);
 
   void SubscribeToChannel(const std::string &channel_name,
                           const std::string &processing_stream = "");
 
+  // Subscribes to all of the channels and patterns over the subscription
+  // connection. Every message is processed by the processor of the
+  // subscription that it was delivered for and added to its stream.
+  void SubscribeToChannels(std::vector<ChannelSubscription> subscriptions);
+
   [[nodiscard]] bool
   AddDataToStream(const std::string &stream_name,
                   const std::vector<std::string> &values) const;
@@ -49,18 +73,21 @@ private:
   static int next_id_;
   int id_;
   bool verbose_outputs_;
+  ConsumerOptions options_;
+  TimestampService timestamp_service_;
 
   std::string redis_server_hostname_;
   unsigned short redis_server_port_;
 
   int subscription_socket_file_descriptor_;
   int processing_socket_file_descriptor_;
+  RespReader subscription_reader_;
+  std::unique_ptr<IStreamWriter> processing_writer_;
 
   bool initial_connection_established_;
   bool write_connection_established_;
 
-  std::string subsciption_channel_;
-  std::string processing_stream_;
+  ChannelTable channel_table_;
 
   std::atomic<long long> number_of_processed_messages_;
   std::atomic<long long> number_of_processing_errors_;
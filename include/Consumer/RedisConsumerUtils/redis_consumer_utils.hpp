@@ -1,25 +1,42 @@
 #pragma once
-#include <ctime>
-#include <iomanip>
-#include <sstream>
+#include <cassert>
+#include <charconv>
 #include <string>
+#include <string_view>
 #include <vector>
 
+#include "../../Parsing/RespWriter.hpp"
 #include "../Message.hpp"
+#include "../TimestampService.hpp"
 
 inline std::string
 StringToRespProtocolFormat(const std::string &string_to_format) {
-  return "$" + std::to_string(string_to_format.length()) + "\r\n" +
-         string_to_format + "\r\n";
+  std::string bulk_string;
+  RespWriter(bulk_string).AppendBulkString(string_to_format);
+  return bulk_string;
 }
 
 inline std::string CreateSubscriptionCommand(const std::string &channel_name) {
-  const std::string resp_formatted_subscription_command =
-      "*2\r\n$9\r\nSUBSCRIBE\r\n";
-  const std::string resp_formatted_channel_name =
-      StringToRespProtocolFormat(channel_name);
+  std::string command;
+  RespWriter writer(command);
+  writer.AppendArrayHeader(2);
+  writer.Append(kRespSubscribe);
+  writer.AppendBulkString(channel_name);
+  return command;
+}
 
-  return resp_formatted_subscription_command + resp_formatted_channel_name;
+// A single SSUBSCRIBE command for sharded channels. In a Redis Cluster all of
+// the channels have to hash to the same slot.
+inline std::string CreateShardedSubscriptionCommand(
+    const std::vector<std::string> &channel_names) {
+  std::string command;
+  RespWriter writer(command);
+  writer.AppendArrayHeader(channel_names.size() + 1);
+  writer.Append(kRespShardedSubscribe);
+  for (const std::string &channel_name : channel_names) {
+    writer.AppendBulkString(channel_name);
+  }
+  return command;
 }
 
 inline std::string
@@ -29,76 +46,77 @@ CreateWriteMessageToStreamCommand(const std::string &stream_name,
     return "";
   }
 
-  std::ostringstream command_output_stream;
+  std::string command;
+  RespWriter writer(command);
   // Add XADD + the stream's name + '*' = 3
   // Plus 2 * the number of values in the "values" vector.
-  command_output_stream << "*" + std::to_string(3 + (2 * values.size())) +
-                               "\r\n";
-  command_output_stream << StringToRespProtocolFormat(
-      "XADD"); // The XADD command
-  command_output_stream << StringToRespProtocolFormat(
-      stream_name); // The stream's name
-  command_output_stream << StringToRespProtocolFormat(
-      "*"); // Auto generate stream id
+  writer.AppendArrayHeader(3 + (2 * values.size()));
+  writer.Append(kRespXadd);
+  writer.AppendBulkString(stream_name);
+  writer.Append(kRespAutoGeneratedId);
 
-  for (int i = 0; i < values.size(); ++i) {
-    command_output_stream << StringToRespProtocolFormat("value" +
-                                                        std::to_string(i + 1))
-                          << StringToRespProtocolFormat(values[i]);
+  char field[32] = "value";
+  for (std::size_t i = 0; i < values.size(); ++i) {
+    const auto result = std::to_chars(field + 5, field + sizeof(field), i + 1);
+    writer.AppendBulkString(std::string_view(field, result.ptr - field));
+    writer.AppendBulkString(values[i]);
   }
-  return command_output_stream.str();
+  return command;
 }
 
-inline std::string
-CreateWriteMessageToStreamCommand(const std::string &stream_name,
-                                  const Message &message) {
+inline constexpr auto kRespProcessorIdField =
+    EncodeRespBulkString("Processor_id");
+inline constexpr auto kRespProcessingDateTimeField =
+    EncodeRespBulkString("Processing_date_time");
+inline constexpr auto kRespSourceChannelNameField =
+    EncodeRespBulkString("Source_channel_name");
+inline constexpr auto kRespMessageIdField = EncodeRespBulkString("Message_id");
+
+/* Appends the XADD command that adds the following values to the stream:
+  "Processor_id", <The ID of the consumer / worker that processed the message>
+  "Processing_date_time", <The date and time when the message was processed>
+  "Source_channel_name", <The name of the channel that sent the message>
+  "Message_id", <The ID of the message>
+*/
+inline void AppendWriteMessageToStreamCommand(RespWriter &writer,
+                                              std::string_view stream_name,
+                                              const MessageView &message) {
   assert(!stream_name.empty());
 
-  std::ostringstream command_output_stream;
-  // Apply RESP formatting
-  command_output_stream << "*11\r\n"; // The number of parameters
-  command_output_stream << StringToRespProtocolFormat(
-      "XADD"); // The XADD command
-  command_output_stream << StringToRespProtocolFormat(
-      stream_name); // The stream's name
-  command_output_stream << StringToRespProtocolFormat(
-      "*"); // Auto generate stream id
+  writer.AppendArrayHeader(11);
+  writer.Append(kRespXadd);
+  writer.AppendBulkString(stream_name);
+  writer.Append(kRespAutoGeneratedId);
+  writer.Append(kRespProcessorIdField);
+  writer.AppendBulkString(static_cast<long long>(message.processor_id));
+  writer.Append(kRespProcessingDateTimeField);
+  writer.AppendBulkString(message.processing_date_time);
+  writer.Append(kRespSourceChannelNameField);
+  writer.AppendBulkString(message.source_channel_name);
+  writer.Append(kRespMessageIdField);
+  writer.AppendBulkString(message.message_id);
+}
 
-  /* Add the following values to the stream:
-    "Processor_id", <The ID of the consumer / worker that processed the message>
-    "Processing_date_time", <The date and time when the message was processed>
-    "Source_channel_name", <The name of the channel that sent the message>
-    "Message_id", <The ID of the message>
-  */
-  command_output_stream << StringToRespProtocolFormat("Processor_id")
-                        << StringToRespProtocolFormat(
-                               std::to_string(message.processor_id));
-  command_output_stream << StringToRespProtocolFormat("Processing_date_time")
-                        << StringToRespProtocolFormat(
-                               message.processing_date_time);
-  command_output_stream << StringToRespProtocolFormat("Source_channel_name")
-                        << StringToRespProtocolFormat(
-                               message.source_channel_name);
-  command_output_stream << StringToRespProtocolFormat("Message_id")
-                        << StringToRespProtocolFormat(message.message_id);
-  return command_output_stream.str();
+inline void AppendWriteMessageToStreamCommand(std::string &command,
+                                              std::string_view stream_name,
+                                              const MessageView &message) {
+  RespWriter writer(command);
+  AppendWriteMessageToStreamCommand(writer, stream_name, message);
 }
 
+inline std::string
+CreateWriteMessageToStreamCommand(const std::string &stream_name,
+                                  const Message &message) {
+  std::string command;
+  AppendWriteMessageToStreamCommand(
+      command, stream_name,
+      MessageView{message.processor_id, message.processing_date_time,
+                  message.source_channel_name, message.message_id});
+  return command;
+}
+
+// The current local time, with milliseconds.
 inline std::string GetCurrentTime() {
-  // Get current time as a system clock time point with milliseconds
-  // precision
-  auto now = std::chrono::system_clock::now();
-  // Convert time_point to time_t (for C-style time formatting)
-  std::time_t now_time = std::chrono::system_clock::to_time_t(now);
-  // Convert to tm struct for local time formatting
-  std::tm local_time = *std::localtime(&now_time);
-  // Extract milliseconds as duration
-  auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(
-                now.time_since_epoch()) %
-            1000;
-  // Use stringstream to store formatted time in a string
-  std::ostringstream time_stream;
-  time_stream << std::put_time(&local_time, "%Y-%m-%d %H:%M:%S") << '.'
-              << std::setw(3) << std::setfill('0') << ms.count();
-  return time_stream.str();
-}
\ No newline at end of file
+  thread_local TimestampService timestamp_service;
+  return std::string(timestamp_service.Now());
+}
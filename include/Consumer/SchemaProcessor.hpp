@@ -0,0 +1,180 @@
+#pragma once
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <optional>
+#include <string_view>
+#include <type_traits>
+
+#include "../Parsing/JsonScanner.hpp"
+#include "IMessageProcessor.hpp"
+
+// The position of a field's value in the message that it was extracted from.
+struct FieldSpan {
+  static constexpr std::uint32_t kMissingOffset = UINT32_MAX;
+
+  std::uint32_t offset = kMissingOffset;
+  std::uint32_t length = 0;
+
+  bool IsPresent() const { return offset != kMissingOffset; }
+};
+
+// The FNV-1a hash of a field's key.
+constexpr std::uint64_t HashSchemaKey(std::string_view key) {
+  std::uint64_t hash = 14695981039346656037ull;
+  for (char character : key) {
+    hash = (hash ^ static_cast<unsigned char>(character)) * 1099511628211ull;
+  }
+  return hash;
+}
+
+// The field that every schema has to contain, as IMessageProcessor produces
+// Messages.
+struct MessageIdField {
+  static constexpr std::string_view kKey = "message_id";
+};
+
+// The time at which the message was published, in nanoseconds since the
+// epoch. With it in the schema, the broker measures the publish-to-receive
+// latency.
+struct PublishTimeField {
+  static constexpr std::string_view kKey = "publish_time_ns";
+};
+
+/*
+An IMessageProcessor for messages with a fixed schema: a JSON object with
+(at least) the top-level fields Fields..., each of them a type with a
+static constexpr std::string_view kKey. For example
+
+  struct UserField {
+    static constexpr std::string_view kKey = "user";
+  };
+  using OrderProcessor = SchemaProcessor<MessageIdField, UserField>;
+
+The lengths and hashes of the keys are computed at compile time, so the keys
+of a message are matched by their length first, and only keys of a matching
+length are hashed and compared. Extract() writes the offsets and lengths of
+the values into a fixed-size Record instead of copying them, and stops as
+soon as all of the fields were found.
+
+A message is only processed when it has all of the fields.
+*/
+template <typename... Fields> class SchemaProcessor : public IMessageProcessor {
+public:
+  static constexpr std::size_t kNumberOfFields = sizeof...(Fields);
+
+  // The values of a message's fields, in the order of Fields...
+  struct Record {
+    std::array<FieldSpan, kNumberOfFields> fields;
+  };
+
+  explicit SchemaProcessor(
+      JsonScannerKernel kernel = GetBestJsonScannerKernel())
+      : scanner_(kernel) {
+    static_assert(HasUniqueKeys(), "The keys of a schema have to be unique");
+    static_assert(IndexOf<MessageIdField>() < kNumberOfFields,
+                  "A schema has to contain the MessageIdField");
+  }
+
+  // Returns false when the message is malformed or misses a field.
+  [[nodiscard]] bool Extract(std::string_view message, Record &record) const {
+    record = Record{};
+    std::size_t number_of_found_fields = 0;
+    const bool is_valid = scanner_.ForEachField(
+        message, [&](std::string_view key, std::string_view value) {
+          const std::size_t index = FindField(key);
+          if (index < kNumberOfFields && !record.fields[index].IsPresent()) {
+            record.fields[index] = {
+                static_cast<std::uint32_t>(value.data() - message.data()),
+                static_cast<std::uint32_t>(value.size())};
+            ++number_of_found_fields;
+          }
+          return number_of_found_fields < kNumberOfFields;
+        });
+    return is_valid && number_of_found_fields == kNumberOfFields;
+  }
+
+  // The value of Field in the message that the record was extracted from.
+  template <typename Field>
+  static std::optional<std::string_view> Get(std::string_view message,
+                                             const Record &record) {
+    const FieldSpan &span = record.fields[IndexOf<Field>()];
+    if (!span.IsPresent()) {
+      return {};
+    }
+    return message.substr(span.offset, span.length);
+  }
+
+  template <typename Field> static constexpr std::size_t IndexOf() {
+    constexpr bool kIsField[] = {std::is_same_v<Field, Fields>...};
+    for (std::size_t i = 0; i < kNumberOfFields; ++i) {
+      if (kIsField[i]) {
+        return i;
+      }
+    }
+    return kNumberOfFields;
+  }
+
+  std::optional<Message> ProcessMessage(std::string_view message) override {
+    Record record;
+    if (message.size() >= FieldSpan::kMissingOffset ||
+        !Extract(message, record)) {
+      return {};
+    }
+    Message processed_message{};
+    processed_message.message_id =
+        std::string(*Get<MessageIdField>(message, record));
+    return processed_message;
+  }
+
+  bool ProcessMessageInPlace(std::string_view payload, MessageView &message,
+                             std::string &) override {
+    Record record;
+    if (payload.size() >= FieldSpan::kMissingOffset ||
+        !Extract(payload, record)) {
+      return false;
+    }
+    message.message_id = *Get<MessageIdField>(payload, record);
+    if constexpr (IndexOf<PublishTimeField>() < kNumberOfFields) {
+      message.publish_time = *Get<PublishTimeField>(payload, record);
+    }
+    return true;
+  }
+
+private:
+  static constexpr std::array<std::string_view, kNumberOfFields> kKeys = {
+      Fields::kKey...};
+  static constexpr std::array<std::uint64_t, kNumberOfFields> kKeyHashes = {
+      HashSchemaKey(Fields::kKey)...};
+
+  static constexpr bool HasUniqueKeys() {
+    for (std::size_t i = 0; i < kNumberOfFields; ++i) {
+      for (std::size_t j = i + 1; j < kNumberOfFields; ++j) {
+        if (kKeys[i] == kKeys[j]) {
+          return false;
+        }
+      }
+    }
+    return true;
+  }
+
+  // Returns kNumberOfFields for keys that are not in the schema.
+  static std::size_t FindField(std::string_view key) {
+    std::optional<std::uint64_t> key_hash;
+    for (std::size_t i = 0; i < kNumberOfFields; ++i) {
+      if (key.size() != kKeys[i].size()) {
+        continue;
+      }
+      if (!key_hash) {
+        key_hash = HashSchemaKey(key);
+      }
+      if (*key_hash == kKeyHashes[i] &&
+          std::memcmp(key.data(), kKeys[i].data(), key.size()) == 0) {
+        return i;
+      }
+    }
+    return kNumberOfFields;
+  }
+
+  JsonScanner scanner_;
+};
@@ -0,0 +1,117 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "../Logging/Logger.hpp"
+#include "../Networking/ClusterTopology.hpp"
+#include "../Networking/EventLoop.hpp"
+#include "../Parsing/RespReader.hpp"
+#include "ConsumerStatistics.hpp"
+
+/*
+Receives the messages of sharded channels (SSUBSCRIBE, Redis 7) from a Redis
+Cluster.
+
+A sharded message is only delivered by the master that owns the hash slot of
+its channel, so the subscriber keeps one connection per owning node and
+subscribes to the channels of every slot with a single SSUBSCRIBE on it. All
+of the connections are read by an EventLoop on the thread that calls Run(),
+so the messages reach the handler from a single thread, in the order in which
+every node delivered them.
+
+When a slot moves to another node, its old owner unsubscribes the slot's
+channels (sunsubscribe) or rejects their subscription with a MOVED error. The
+subscriber then subscribes to the channels again on the new owner, which it
+learns from the MOVED error or by reloading the slots with CLUSTER SLOTS.
+*/
+class ShardedSubscriber {
+public:
+  // Invoked for the ssubscribe replies and the smessage messages. The views
+  // of the message are only valid during the call.
+  using MessageHandler = std::function<void(const PubSubMessage &)>;
+
+  ShardedSubscriber();
+  ~ShardedSubscriber();
+
+  ShardedSubscriber(const ShardedSubscriber &) = delete;
+  ShardedSubscriber &operator=(const ShardedSubscriber &) = delete;
+
+  // Loads the slots from the seed node and subscribes to every channel on
+  // the node that owns its slot.
+  [[nodiscard]] bool Subscribe(const ClusterNode &seed_node,
+                               const std::vector<std::string> &channels);
+
+  // Handles the subscriptions on the calling thread until Stop() is called
+  // or the channels of a slot cannot be subscribed to anymore, e.g. because
+  // no node of the cluster is reachable. Returns false in the latter case.
+  [[nodiscard]] bool Run(MessageHandler message_handler);
+  // Safe to call from any thread.
+  void Stop();
+
+  // The slots as they were last loaded or redirected. Not safe to use while
+  // Run() is in progress.
+  const ClusterTopology &GetTopology() const { return topology_; }
+
+  // The sum over the connections that are open, and the reconnects so far.
+  // Safe to call from any thread.
+  IngestStatistics GetStatistics() const;
+
+  const std::string &GetLastError() const { return last_error_; }
+
+private:
+  struct Connection {
+    Connection(const ClusterNode &node, int file_descriptor)
+        : node(node), file_descriptor{file_descriptor},
+          reader(file_descriptor) {}
+
+    ClusterNode node;
+    int file_descriptor;
+    RespReader reader;
+  };
+
+  void ReportError(const std::string &error_message) const {
+    LOG(LogLevel::Error, "[ShardedSubscriber] {}", error_message);
+  }
+
+  // Reloads the slots from preferred_node, or from any other known node when
+  // it cannot be reached.
+  [[nodiscard]] bool RefreshTopology(const ClusterNode *preferred_node);
+  [[nodiscard]] bool SubscribeToSlot(std::uint16_t slot);
+  // Connects to the node when there is no connection to it yet.
+  Connection *GetConnection(const ClusterNode &node);
+  void CloseConnection(const Connection &connection);
+
+  void OnReadable(Connection &connection);
+  void OnReply(const Connection &connection, const RespParser &reply);
+  // Subscribes to the slots that were redirected or unsubscribed while
+  // handling the last read.
+  void ResubscribeMovedSlots(const ClusterNode &reporting_node);
+
+  ClusterNode seed_node_;
+  ClusterTopology topology_;
+  EventLoop event_loop_;
+  // The subscribed channels, grouped by their slot.
+  std::unordered_map<std::uint16_t, std::vector<std::string>>
+      channels_by_slot_;
+
+  // Guards the list, but not the connections, against GetStatistics().
+  mutable std::mutex connections_mutex_;
+  std::vector<std::unique_ptr<Connection>> connections_;
+
+  std::vector<std::uint16_t> moved_slots_;
+  // Set when the new owners of the moved slots are not known yet.
+  bool is_topology_outdated_;
+  bool is_failed_;
+  // Set once the subscription has been established.
+  bool is_subscribed_;
+  std::atomic<long long> number_of_reconnects_;
+
+  MessageHandler message_handler_;
+  std::string last_error_;
+};
@@ -0,0 +1,17 @@
+#pragma once
+#include <string>
+
+// The stream that a consumer group reads, and where the processed entries go.
+struct StreamGroupSubscription {
+  std::string stream;
+  // The group is created, starting at the end of the stream, when it does
+  // not exist yet.
+  std::string group;
+  // Entries that were delivered to a consumer and not acknowledged are
+  // delivered again when a consumer of the same name restarts.
+  std::string consumer;
+  // The field of the entries that holds the message.
+  std::string payload_field = "message";
+  // When it is empty, the processed entries are only counted.
+  std::string processing_stream;
+};
@@ -0,0 +1,82 @@
+#pragma once
+#include <charconv>
+#include <cstddef>
+#include <ctime>
+#include <string_view>
+
+#include "ConsumerOptions.hpp"
+
+/*
+Formats the processing times of the messages without allocating.
+
+The local date and time of the current second is only formatted once, with
+localtime_r() and strftime(), and the milliseconds are patched into the
+cached text for every other time of the same second. This keeps the calls to
+localtime_r(), which take the time zone lock, to one per second and thread.
+
+A service is used by a single thread, so every worker has its own.
+*/
+class TimestampService {
+public:
+  // The longest timestamp: a date and time, or an epoch in nanoseconds.
+  static constexpr std::size_t kMaximumTimestampSize = 32;
+
+  explicit TimestampService(TimestampClock clock = TimestampClock::Realtime,
+                            TimestampFormat format = TimestampFormat::DateTime)
+      : clock_id_{clock == TimestampClock::RealtimeCoarse
+                      ? CLOCK_REALTIME_COARSE
+                      : CLOCK_REALTIME},
+        format_{format}, cached_second_{-1}, date_time_size_{0},
+        number_of_formatted_seconds_{0}, timestamp_{} {}
+
+  // The current time. Valid until the next call.
+  std::string_view Now() {
+    timespec now;
+    clock_gettime(clock_id_, &now);
+    return Format(now);
+  }
+
+  // The given time since the epoch. Valid until the next call.
+  std::string_view Format(const timespec &time) {
+    if (format_ == TimestampFormat::EpochNanoseconds) {
+      const long long nanoseconds =
+          static_cast<long long>(time.tv_sec) * 1'000'000'000LL +
+          time.tv_nsec;
+      const auto result =
+          std::to_chars(timestamp_, timestamp_ + sizeof(timestamp_),
+                        nanoseconds);
+      return std::string_view(timestamp_, result.ptr - timestamp_);
+    }
+
+    if (time.tv_sec != cached_second_) {
+      std::tm local_time;
+      localtime_r(&time.tv_sec, &local_time);
+      date_time_size_ = std::strftime(timestamp_, sizeof(timestamp_) - 4,
+                                      "%Y-%m-%d %H:%M:%S", &local_time);
+      timestamp_[date_time_size_] = '.';
+      cached_second_ = time.tv_sec;
+      ++number_of_formatted_seconds_;
+    }
+    const long milliseconds = time.tv_nsec / 1'000'000;
+    timestamp_[date_time_size_ + 1] =
+        static_cast<char>('0' + milliseconds / 100);
+    timestamp_[date_time_size_ + 2] =
+        static_cast<char>('0' + milliseconds / 10 % 10);
+    timestamp_[date_time_size_ + 3] =
+        static_cast<char>('0' + milliseconds % 10);
+    return std::string_view(timestamp_, date_time_size_ + 4);
+  }
+
+  // The number of times that the date and time of a second were formatted.
+  long long GetNumberOfFormattedSeconds() const {
+    return number_of_formatted_seconds_;
+  }
+
+private:
+  clockid_t clock_id_;
+  TimestampFormat format_;
+  std::time_t cached_second_;
+  std::size_t date_time_size_;
+  long long number_of_formatted_seconds_;
+  char timestamp_[kMaximumTimestampSize];
+};
@@ -0,0 +1,349 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <ctime>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+#include "../Concurrency/SpscRingBuffer.hpp"
+
+enum class LogLevel : std::uint8_t { Debug, Info, Warning, Error };
+
+// The number of records per second that are logged for an event which
+// happens for every message.
+inline constexpr int kLogSamplesPerSecond = 10;
+
+// An argument of a log record, stored in binary form until the record is
+// formatted.
+struct LogArgument {
+  enum class Type : std::uint8_t { Integer, UnsignedInteger, Double, Text };
+
+  Type type;
+  union {
+    long long integer;
+    unsigned long long unsigned_integer;
+    double floating_point;
+    // The bytes of the text in the record's text area.
+    struct {
+      std::uint32_t offset;
+      std::uint32_t size;
+    } text;
+  };
+};
+
+/*
+A log record as it waits in a thread's ring buffer: the format, which has to
+be a string literal, and its arguments, with the texts copied to an inline
+area. Texts that do not fit into it are copied to an allocated area instead,
+which the logger frees once the record was formatted.
+*/
+struct LogRecord {
+  static constexpr std::size_t kMaximumNumberOfArguments = 8;
+  static constexpr std::size_t kInlineTextCapacity = 256;
+
+  const char *format;
+  LogLevel level;
+  bool ends_line;
+  std::uint8_t number_of_arguments;
+  long long time_in_nanoseconds;
+  // The number of records of the same call site that were suppressed by
+  // sampling since the previous one.
+  long long number_of_suppressed_records;
+  char *allocated_text;
+  LogArgument arguments[kMaximumNumberOfArguments];
+  char inline_text[kInlineTextCapacity];
+
+  const char *GetText() const {
+    return allocated_text != nullptr ? allocated_text : inline_text;
+  }
+};
+
+// Receives every formatted record, including the line break of the records
+// that end a line, on the logger's background thread.
+using LogSink = std::function<void(LogLevel level, std::string_view text)>;
+
+/*
+Allows a call site to log up to records_per_second records per second, and
+counts the ones that it suppresses. Shared by all of the threads that run
+through the call site.
+*/
+class LogRateLimiter {
+public:
+  explicit LogRateLimiter(int records_per_second)
+      : records_per_second_{records_per_second}, second_{-1},
+        number_of_records_in_second_{0}, number_of_suppressed_records_{0} {}
+
+  // Returns false when the record has to be suppressed. Otherwise, sets
+  // number_of_suppressed_records to the number of records that were
+  // suppressed since the previous one that was allowed.
+  [[nodiscard]] bool TryAcquire(long long &number_of_suppressed_records) {
+    timespec now;
+    clock_gettime(CLOCK_MONOTONIC_COARSE, &now);
+    return TryAcquire(now.tv_sec, number_of_suppressed_records);
+  }
+
+  [[nodiscard]] bool TryAcquire(long long second,
+                                long long &number_of_suppressed_records) {
+    long long current_second = second_.load(std::memory_order_relaxed);
+    if (current_second != second &&
+        second_.compare_exchange_strong(current_second, second,
+                                        std::memory_order_relaxed)) {
+      number_of_records_in_second_.store(0, std::memory_order_relaxed);
+    }
+    if (number_of_records_in_second_.fetch_add(
+            1, std::memory_order_relaxed) >= records_per_second_) {
+      number_of_suppressed_records_.fetch_add(1, std::memory_order_relaxed);
+      return false;
+    }
+    number_of_suppressed_records =
+        number_of_suppressed_records_.exchange(0, std::memory_order_relaxed);
+    return true;
+  }
+
+private:
+  const int records_per_second_;
+  std::atomic<long long> second_;
+  std::atomic<int> number_of_records_in_second_;
+  std::atomic<long long> number_of_suppressed_records_;
+};
+
+/*
+An asynchronous logger that keeps formatting and output off the threads that
+log.
+
+Every thread that logs gets a single-producer / single-consumer ring buffer
+of its own, so logging never takes a lock: the arguments of a record are
+copied in binary form into the buffer and a background thread formats the
+records of all of the buffers, in the order of their times, and hands them
+to the sink. When a thread's buffer is full its records are dropped and
+counted, instead of waiting for the background thread.
+
+The formats are string literals in which every {} is replaced by the next
+argument. Integers, floating point numbers, characters, strings and string
+views can be logged.
+*/
+class Logger {
+public:
+  static constexpr std::size_t kDefaultRecordsPerThread = 512;
+  static constexpr std::chrono::milliseconds kDefaultPollInterval{5};
+
+  // Writes the records of level Warning and above to the standard error and
+  // the others to the standard output.
+  static void WriteToStandardStreams(LogLevel level, std::string_view text);
+
+  explicit Logger(LogSink sink = WriteToStandardStreams,
+                  std::size_t records_per_thread = kDefaultRecordsPerThread,
+                  std::chrono::milliseconds poll_interval =
+                      kDefaultPollInterval);
+  ~Logger();
+
+  Logger(const Logger &) = delete;
+  Logger &operator=(const Logger &) = delete;
+
+  // The logger of the process. It is never destroyed, and flushed when the
+  // process exits.
+  static Logger &Get();
+
+  void SetMinimumLevel(LogLevel level) {
+    minimum_level_.store(level, std::memory_order_relaxed);
+  }
+
+  bool IsEnabled(LogLevel level) const {
+    return level >= minimum_level_.load(std::memory_order_relaxed);
+  }
+
+  template <typename... Arguments>
+  void Log(LogLevel level, const char *format,
+           const Arguments &...arguments) {
+    Submit(level, 0, true, format, arguments...);
+  }
+
+  template <typename... Arguments>
+  void LogSampled(LogLevel level, long long number_of_suppressed_records,
+                  const char *format, const Arguments &...arguments) {
+    Submit(level, number_of_suppressed_records, true, format, arguments...);
+  }
+
+  // Logs preformatted text, which only ends a line when ends_line is set.
+  void Write(LogLevel level, std::string_view text, bool ends_line) {
+    Submit(level, 0, ends_line, "{}", text);
+  }
+
+  // Formats and outputs every record that was logged so far.
+  void Flush();
+
+  long long GetNumberOfDroppedRecords() const {
+    return number_of_dropped_records_.load(std::memory_order_relaxed);
+  }
+
+  struct ThreadBuffer;
+
+private:
+
+  template <typename Argument>
+  static std::size_t GetTextSize(const Argument &argument) {
+    if constexpr (std::is_same_v<Argument, char>) {
+      return 1;
+    } else if constexpr (std::is_arithmetic_v<Argument>) {
+      return 0;
+    } else {
+      return std::string_view(argument).size();
+    }
+  }
+
+  template <typename Argument>
+  static void AddArgument(LogRecord &record, char *text,
+                          std::size_t &text_size, const Argument &argument) {
+    LogArgument &log_argument = record.arguments[record.number_of_arguments++];
+    if constexpr (std::is_same_v<Argument, char>) {
+      log_argument.type = LogArgument::Type::Text;
+      log_argument.text = {static_cast<std::uint32_t>(text_size), 1};
+      text[text_size++] = argument;
+    } else if constexpr (std::is_same_v<Argument, bool>) {
+      log_argument.type = LogArgument::Type::UnsignedInteger;
+      log_argument.unsigned_integer = argument;
+    } else if constexpr (std::is_floating_point_v<Argument>) {
+      log_argument.type = LogArgument::Type::Double;
+      log_argument.floating_point = argument;
+    } else if constexpr (std::is_integral_v<Argument> &&
+                         std::is_signed_v<Argument>) {
+      log_argument.type = LogArgument::Type::Integer;
+      log_argument.integer = argument;
+    } else if constexpr (std::is_integral_v<Argument>) {
+      log_argument.type = LogArgument::Type::UnsignedInteger;
+      log_argument.unsigned_integer = argument;
+    } else {
+      const std::string_view value(argument);
+      log_argument.type = LogArgument::Type::Text;
+      log_argument.text = {static_cast<std::uint32_t>(text_size),
+                           static_cast<std::uint32_t>(value.size())};
+      std::memcpy(text + text_size, value.data(), value.size());
+      text_size += value.size();
+    }
+  }
+
+  template <typename... Arguments>
+  void Submit(LogLevel level, long long number_of_suppressed_records,
+              bool ends_line, const char *format,
+              const Arguments &...arguments) {
+    static_assert(sizeof...(Arguments) <= LogRecord::kMaximumNumberOfArguments,
+                  "Too many arguments for a log record");
+    if (!IsEnabled(level)) {
+      return;
+    }
+    LogRecord record;
+    record.format = format;
+    record.level = level;
+    record.ends_line = ends_line;
+    record.number_of_arguments = 0;
+    record.number_of_suppressed_records = number_of_suppressed_records;
+    record.allocated_text = nullptr;
+
+    if constexpr (sizeof...(Arguments) > 0) {
+      const std::size_t text_size = (std::size_t{0} + ... +
+                                     GetTextSize(arguments));
+      char *text = record.inline_text;
+      if (text_size > LogRecord::kInlineTextCapacity) {
+        record.allocated_text = new char[text_size];
+        text = record.allocated_text;
+      }
+      std::size_t text_position = 0;
+      (AddArgument(record, text, text_position, arguments), ...);
+    }
+    Enqueue(std::move(record));
+  }
+
+  // Hands the record to the thread's buffer, or drops it when it is full.
+  void Enqueue(LogRecord &&record);
+  ThreadBuffer &GetThreadBuffer();
+
+  void FormatRecord(const LogRecord &record);
+  // Formats and outputs the records of all of the buffers. Only one thread
+  // drains the buffers at a time.
+  void Drain();
+  void RunBackgroundThread();
+
+  const std::uint64_t id_;
+  LogSink sink_;
+  const std::size_t records_per_thread_;
+  const std::chrono::milliseconds poll_interval_;
+  std::atomic<LogLevel> minimum_level_;
+
+  std::mutex thread_buffers_mutex_;
+  std::vector<std::shared_ptr<ThreadBuffer>> thread_buffers_;
+
+  std::mutex drain_mutex_;
+  // Only used while draining.
+  std::vector<LogRecord> pending_records_;
+  std::string line_;
+  long long number_of_reported_dropped_records_;
+
+  std::atomic<long long> number_of_dropped_records_;
+  std::mutex stop_mutex_;
+  std::condition_variable stop_condition_;
+  bool stop_;
+  std::thread background_thread_;
+};
+
+// Collects the output of the print and println macros and logs it as a
+// single record.
+class LogStream {
+public:
+  LogStream(LogLevel level, bool ends_line)
+      : level_{level}, ends_line_{ends_line} {}
+  ~LogStream() { Logger::Get().Write(level_, stream_.str(), ends_line_); }
+
+  template <typename Value> LogStream &operator<<(const Value &value) {
+    stream_ << value;
+    return *this;
+  }
+
+  LogStream &operator<<(std::ostream &(*manipulator)(std::ostream &)) {
+    stream_ << manipulator;
+    return *this;
+  }
+
+private:
+  LogLevel level_;
+  bool ends_line_;
+  std::ostringstream stream_;
+};
+
+// Logs a record with the process' logger, e.g.
+//   LOG(LogLevel::Info, "Processed {} messages", number_of_messages);
+// The arguments are not evaluated when the level is disabled.
+#define LOG(level, ...)                                                        \
+  do {                                                                         \
+    Logger &logger_of_call_site = Logger::Get();                               \
+    if (logger_of_call_site.IsEnabled(level)) {                                \
+      logger_of_call_site.Log(level, __VA_ARGS__);                             \
+    }                                                                          \
+  } while (false)
+
+// Like LOG, but logs at most records_per_second records per second at this
+// call site, for events that happen for every message.
+#define LOG_SAMPLED(level, records_per_second, ...)                            \
+  do {                                                                         \
+    Logger &logger_of_call_site = Logger::Get();                               \
+    if (logger_of_call_site.IsEnabled(level)) {                                \
+      static LogRateLimiter rate_limiter_of_call_site(records_per_second);     \
+      long long number_of_suppressed_records = 0;                              \
+      if (rate_limiter_of_call_site.TryAcquire(                                \
+              number_of_suppressed_records)) {                                 \
+        logger_of_call_site.LogSampled(level, number_of_suppressed_records,    \
+                                       __VA_ARGS__);                           \
+      }                                                                        \
+    }                                                                          \
+  } while (false)
@@ -0,0 +1,82 @@
+#pragma once
+#include <cstddef>
+#include <deque>
+#include <optional>
+
+#include "CounterSet.hpp"
+
+// The values of the counters at one point in time.
+struct CounterSnapshot {
+  // On the steady clock.
+  long long time_in_nanoseconds;
+  CounterValues counters;
+};
+
+// The rates of the counters between two snapshots.
+struct CounterRates {
+  // The time between the snapshots, which the rates are averaged over.
+  double window_in_seconds;
+  double messages_per_second;
+  double errors_per_second;
+  double bytes_per_second;
+};
+
+/*
+The last snapshots of the counters, taken at a regular interval, e.g. every
+second, by the monitor.
+
+The rates over a window are computed between the latest snapshot and the one
+that was taken a window earlier, and are averaged over the time that really
+passed between the two, so a late sample does not skew them.
+*/
+class CounterHistory {
+public:
+  explicit CounterHistory(std::size_t capacity) : capacity_{capacity} {}
+
+  void Add(const CounterSnapshot &snapshot) {
+    snapshots_.push_back(snapshot);
+    if (snapshots_.size() > capacity_) {
+      snapshots_.pop_front();
+    }
+  }
+
+  // The rates between the latest snapshot and the latest one that is at
+  // least window_in_nanoseconds older, or the oldest one when none is. Not
+  // set before two snapshots were added.
+  std::optional<CounterRates>
+  GetRates(long long window_in_nanoseconds) const {
+    if (snapshots_.size() < 2) {
+      return std::nullopt;
+    }
+    const CounterSnapshot &latest = snapshots_.back();
+    const CounterSnapshot *earlier = &snapshots_.front();
+    for (auto it = snapshots_.rbegin() + 1; it != snapshots_.rend(); ++it) {
+      if (latest.time_in_nanoseconds - it->time_in_nanoseconds >=
+          window_in_nanoseconds) {
+        earlier = &*it;
+        break;
+      }
+    }
+    return GetCounterRates(*earlier, latest);
+  }
+
+  static CounterRates GetCounterRates(const CounterSnapshot &earlier,
+                                      const CounterSnapshot &later) {
+    const double window_in_seconds =
+        (later.time_in_nanoseconds - earlier.time_in_nanoseconds) / 1e9;
+    auto get_rate = [&](CounterId id) {
+      if (window_in_seconds <= 0) {
+        return 0.0;
+      }
+      return (later.counters.Get(id) - earlier.counters.Get(id)) /
+             window_in_seconds;
+    };
+    return {window_in_seconds, get_rate(CounterId::ProcessedMessages),
+            get_rate(CounterId::ProcessingErrors),
+            get_rate(CounterId::ReceivedBytes)};
+  }
+
+private:
+  std::size_t capacity_;
+  std::deque<CounterSnapshot> snapshots_;
+};
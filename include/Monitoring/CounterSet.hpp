@@ -0,0 +1,117 @@
+#pragma once
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "../Concurrency/MpmcRingBuffer.hpp"
+
+// The counters that every thread of a consumer keeps.
+enum class CounterId : std::size_t {
+  ReceivedMessages,
+  // The bytes of the received payloads.
+  ReceivedBytes,
+  ProcessedMessages,
+  ProcessingErrors,
+  // The messages that a worker took from other workers' queues.
+  StolenMessages,
+  // The time spent processing messages, as opposed to waiting for them.
+  BusyTimeInNanoseconds
+};
+
+constexpr std::size_t kNumberOfCounters = 6;
+
+// The values of every counter, e.g. summed over the threads of a consumer.
+struct CounterValues {
+  std::array<long long, kNumberOfCounters> values{};
+
+  long long Get(CounterId id) const {
+    return values[static_cast<std::size_t>(id)];
+  }
+  void Set(CounterId id, long long value) {
+    values[static_cast<std::size_t>(id)] = value;
+  }
+  void Merge(const CounterValues &other) {
+    for (std::size_t i = 0; i < kNumberOfCounters; ++i) {
+      values[i] += other.values[i];
+    }
+  }
+};
+
+/*
+The counters of a single thread, on a cache line of their own.
+
+Only the owning thread may add to them, so an addition is a relaxed load and
+store, without a read-modify-write or a fence, and no other thread writes to
+the cache line. Any thread can read them at any time.
+*/
+class alignas(kCacheLineSize) ThreadCounters {
+public:
+  ThreadCounters() {
+    for (std::atomic<long long> &value : values_) {
+      value.store(0, std::memory_order_relaxed);
+    }
+  }
+
+  ThreadCounters(const ThreadCounters &) = delete;
+  ThreadCounters &operator=(const ThreadCounters &) = delete;
+
+  // Owning thread only.
+  void Add(CounterId id, long long amount = 1) {
+    std::atomic<long long> &value = values_[static_cast<std::size_t>(id)];
+    value.store(value.load(std::memory_order_relaxed) + amount,
+                std::memory_order_relaxed);
+  }
+
+  long long Get(CounterId id) const {
+    return values_[static_cast<std::size_t>(id)].load(
+        std::memory_order_relaxed);
+  }
+
+  CounterValues Read() const {
+    CounterValues counter_values;
+    for (std::size_t i = 0; i < kNumberOfCounters; ++i) {
+      counter_values.values[i] = values_[i].load(std::memory_order_relaxed);
+    }
+    return counter_values;
+  }
+
+private:
+  std::array<std::atomic<long long>, kNumberOfCounters> values_;
+};
+
+static_assert(sizeof(ThreadCounters) == kCacheLineSize,
+              "The counters of a thread have to fit into a cache line.");
+
+/*
+Hands out the ThreadCounters of a consumer's threads and sums them up.
+
+Registering takes a lock, so threads register before they start counting.
+The counters live as long as the set.
+*/
+class CounterSet {
+public:
+  ThreadCounters &Register() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    thread_counters_.push_back(std::make_unique<ThreadCounters>());
+    return *thread_counters_.back();
+  }
+
+  // The sum over every thread. Every counter is read once, so the sum is
+  // not an atomic snapshot, but no counter is ever ahead of the time at
+  // which it was read.
+  CounterValues Read() const {
+    CounterValues total;
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (const auto &counters : thread_counters_) {
+      total.Merge(counters->Read());
+    }
+    return total;
+  }
+
+private:
+  mutable std::mutex mutex_;
+  std::vector<std::unique_ptr<ThreadCounters>> thread_counters_;
+};
@@ -0,0 +1,165 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+/*
+The counts of a LatencyHistogram at one point in time.
+
+Snapshots of several histograms can be merged, and the snapshot taken at the
+previous report can be subtracted to get the latencies recorded since.
+*/
+class LatencySnapshot {
+public:
+  // The number of linear sub-buckets per power of two. Every recorded value
+  // is off by less than 1 / kSubBucketCount (about 3%).
+  static constexpr int kSubBucketBits = 5;
+  static constexpr std::uint64_t kSubBucketCount = 1 << kSubBucketBits;
+  // Values from 2^kMaximumValueBits nanoseconds (about 18 minutes) on are
+  // counted as the highest value.
+  static constexpr int kMaximumValueBits = 40;
+  static constexpr std::size_t kNumberOfBuckets =
+      (kMaximumValueBits - kSubBucketBits + 1) * kSubBucketCount;
+
+  static std::size_t GetBucketIndex(std::uint64_t value) {
+    constexpr std::uint64_t kMaximumValue =
+        (std::uint64_t{1} << kMaximumValueBits) - 1;
+    value = std::min(value, kMaximumValue);
+    // Values below 2 * kSubBucketCount have a bucket of their own. Above,
+    // every power of two is split into kSubBucketCount buckets.
+    const int magnitude = 63 - __builtin_clzll(value | 1);
+    const int shift = std::max(magnitude - kSubBucketBits, 0);
+    return shift * kSubBucketCount + (value >> shift);
+  }
+
+  // The highest value that is counted in the bucket.
+  static std::uint64_t GetBucketUpperBound(std::size_t index) {
+    const int shift =
+        index < 2 * kSubBucketCount ? 0 : index / kSubBucketCount - 1;
+    const std::uint64_t offset = index - shift * kSubBucketCount;
+    return ((offset + 1) << shift) - 1;
+  }
+
+  LatencySnapshot() = default;
+  explicit LatencySnapshot(std::vector<std::uint64_t> counts)
+      : counts_(std::move(counts)) {}
+
+  void Merge(const LatencySnapshot &other) {
+    if (other.counts_.empty()) {
+      return;
+    }
+    counts_.resize(kNumberOfBuckets);
+    for (std::size_t i = 0; i < kNumberOfBuckets; ++i) {
+      counts_[i] += other.counts_[i];
+    }
+  }
+
+  // Returns the values recorded after the earlier snapshot was taken.
+  LatencySnapshot Since(const LatencySnapshot &earlier) const {
+    LatencySnapshot difference(*this);
+    if (!earlier.counts_.empty() && !difference.counts_.empty()) {
+      for (std::size_t i = 0; i < kNumberOfBuckets; ++i) {
+        difference.counts_[i] -= earlier.counts_[i];
+      }
+    }
+    return difference;
+  }
+
+  std::uint64_t GetTotalCount() const {
+    std::uint64_t total_count = 0;
+    for (std::uint64_t count : counts_) {
+      total_count += count;
+    }
+    return total_count;
+  }
+
+  // Returns the number of values in the buckets below the bucket of value.
+  // It is exact when value is the lowest value of its bucket, e.g. a power
+  // of two.
+  std::uint64_t GetCountBelow(std::uint64_t value) const {
+    const std::size_t bucket_index =
+        std::min(GetBucketIndex(value), counts_.size());
+    std::uint64_t count = 0;
+    for (std::size_t i = 0; i < bucket_index; ++i) {
+      count += counts_[i];
+    }
+    return count;
+  }
+
+  // Returns the upper bound of the bucket of the value that the given
+  // percentage of the values is lower than or equal to, or 0 without values.
+  std::uint64_t GetValueAtPercentile(double percentile) const {
+    const std::uint64_t total_count = GetTotalCount();
+    if (total_count == 0) {
+      return 0;
+    }
+    const double rank = percentile / 100.0 * total_count;
+    std::uint64_t target_count = std::max<std::uint64_t>(
+        static_cast<std::uint64_t>(rank + 0.5), std::uint64_t{1});
+    std::uint64_t count_so_far = 0;
+    for (std::size_t i = 0; i < counts_.size(); ++i) {
+      count_so_far += counts_[i];
+      if (count_so_far >= target_count) {
+        return GetBucketUpperBound(i);
+      }
+    }
+    return GetMaximum();
+  }
+
+  std::uint64_t GetMaximum() const {
+    for (std::size_t i = counts_.size(); i > 0; --i) {
+      if (counts_[i - 1] > 0) {
+        return GetBucketUpperBound(i - 1);
+      }
+    }
+    return 0;
+  }
+
+private:
+  // Empty until a value was recorded.
+  std::vector<std::uint64_t> counts_;
+};
+
+/*
+A log-linear (HDR style) histogram of latencies in nanoseconds.
+
+Only one thread may record values, so every count is a relaxed load and store
+without a read-modify-write. Any thread can take a snapshot of the counts at
+any time, e.g. the monitor while the worker records.
+*/
+class LatencyHistogram {
+public:
+  LatencyHistogram()
+      : counts_(std::make_unique<std::atomic<std::uint64_t>[]>(
+            LatencySnapshot::kNumberOfBuckets)) {
+    for (std::size_t i = 0; i < LatencySnapshot::kNumberOfBuckets; ++i) {
+      counts_[i].store(0, std::memory_order_relaxed);
+    }
+  }
+
+  LatencyHistogram(const LatencyHistogram &) = delete;
+  LatencyHistogram &operator=(const LatencyHistogram &) = delete;
+
+  // Recording thread only. Negative latencies, e.g. from clocks that were
+  // adjusted, are counted as 0.
+  void Record(long long value_in_nanoseconds) {
+    std::atomic<std::uint64_t> &count = counts_[LatencySnapshot::GetBucketIndex(
+        value_in_nanoseconds > 0 ? value_in_nanoseconds : 0)];
+    count.store(count.load(std::memory_order_relaxed) + 1,
+                std::memory_order_relaxed);
+  }
+
+  LatencySnapshot GetSnapshot() const {
+    std::vector<std::uint64_t> counts(LatencySnapshot::kNumberOfBuckets);
+    for (std::size_t i = 0; i < LatencySnapshot::kNumberOfBuckets; ++i) {
+      counts[i] = counts_[i].load(std::memory_order_relaxed);
+    }
+    return LatencySnapshot(std::move(counts));
+  }
+
+private:
+  std::unique_ptr<std::atomic<std::uint64_t>[]> counts_;
+};
@@ -0,0 +1,71 @@
+#pragma once
+#include <memory>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "../Consumer/IObservableConsumer.hpp"
+#include "../Logging/Logger.hpp"
+#include "../Networking/EventLoop.hpp"
+
+/*
+Serves the statistics of the consumers at http://127.0.0.1:<port>/metrics in
+the OpenMetrics text format, for Prometheus to scrape.
+
+The listener runs an EventLoop on a thread of its own. Every scrape renders
+the metrics from the consumers' statistics, which are snapshots of relaxed
+atomic counters, so the consumers' threads are never blocked or slowed down
+by a scrape. A connection serves a single request and is then closed.
+
+The consumers are labelled with their position in the list, e.g.
+consumer="0", and the workers with their id.
+*/
+class MetricsExporter {
+public:
+  explicit MetricsExporter(std::vector<IObservableConsumer *> consumers);
+  ~MetricsExporter();
+
+  MetricsExporter(const MetricsExporter &) = delete;
+  MetricsExporter &operator=(const MetricsExporter &) = delete;
+
+  // Listens on the loopback interface and starts serving the metrics. With
+  // port 0, the system picks a free port.
+  [[nodiscard]] bool Start(unsigned short port);
+  void Stop();
+
+  // The port that the exporter listens on, once started.
+  unsigned short GetPort() const { return port_; }
+
+  std::string RenderMetrics() const;
+
+  const std::string &GetLastError() const { return last_error_; }
+
+private:
+  struct Connection {
+    std::string request;
+    std::string response;
+    std::size_t bytes_sent = 0;
+  };
+
+  void ReportError(const std::string &error_message) const {
+    LOG(LogLevel::Error, "[MetricsExporter] {}", error_message);
+  }
+
+  void OnAcceptable();
+  void OnReadable(int file_descriptor);
+  void OnWritable(int file_descriptor);
+  // Sends what is left of the response, and closes the connection once all
+  // of it was sent.
+  void SendResponse(int file_descriptor);
+  void CloseConnection(int file_descriptor);
+
+  std::vector<IObservableConsumer *> consumers_;
+  int listening_socket_file_descriptor_;
+  unsigned short port_;
+  EventLoop event_loop_;
+  std::thread thread_;
+  // Only used on the loop thread.
+  std::unordered_map<int, std::unique_ptr<Connection>> connections_;
+  std::string last_error_;
+};
@@ -1,6 +1,11 @@
 #pragma once
 #include "../Consumer/IObservableConsumer.hpp"
+#include "CounterHistory.hpp"
+#include <algorithm>
 #include <chrono>
+#include <cmath>
+#include <iomanip>
+#include <map>
 #include <thread>
 
 class ProcessedMessagesMonitor {
@@ -20,21 +25,18 @@ public:
       return;
     }
 
-    long long last_reported_count = 0;
+    // A snapshot every second, enough for the rates over a report interval.
+    CounterHistory counter_history(report_interval_in_seconds_ + 1);
+    counter_history.Add(TakeCounterSnapshot());
+    IngestStatistics last_reported_ingest_statistics{};
+    std::map<int, WorkerStatistics> last_reported_worker_statistics;
+    LatencyStatistics last_reported_latency_statistics{};
     steady_clock::time_point last_report_time = steady_clock::now();
 
     while (true) {
       std::this_thread::sleep_for(seconds(1));
 
-      long long messages_processed_this_second = 0;
-      for (auto &consumer : redis_observable_consumers_) {
-        messages_processed_this_second +=
-            consumer->GetNumberOfProcessedMessages();
-      }
-
-      double messages_per_second =
-          (messages_processed_this_second - last_reported_count) /
-          static_cast<double>(report_interval_in_seconds_);
+      counter_history.Add(TakeCounterSnapshot());
 
       auto seconds_since_last_report =
           duration_cast<seconds>(steady_clock::now() - last_report_time)
@@ -42,19 +44,187 @@ public:
 
       if (seconds_since_last_report >= report_interval_in_seconds_) {
         std::time_t now_time_t = system_clock::to_time_t(system_clock::now());
-        std::cout << "Current report time: " << std::ctime(&now_time_t)
-                  << "Messages processed per second in last "
-                  << report_interval_in_seconds_
-                  << " seconds: " << messages_per_second << " messages/sec"
-                  << std::endl;
+        std::cout << "Current report time: " << std::ctime(&now_time_t);
+        ReportCounterRates(counter_history.GetRates(
+            duration_cast<nanoseconds>(seconds(report_interval_in_seconds_))
+                .count()));
+
+        IngestStatistics ingest_statistics = GetIngestStatistics();
+        long long reads_since_last_report =
+            ingest_statistics.number_of_reads -
+            last_reported_ingest_statistics.number_of_reads;
+        if (reads_since_last_report > 0) {
+          std::cout << "Frames received per read: "
+                    << (ingest_statistics.number_of_frames -
+                        last_reported_ingest_statistics.number_of_frames) /
+                           static_cast<double>(reads_since_last_report)
+                    << " on average, " << ingest_statistics.max_frames_per_read
+                    << " at most" << std::endl;
+        }
 
-        last_reported_count = messages_processed_this_second;
+        ReportPendingEntryStatistics();
+        ReportQueueStatistics();
+        ReportWorkerStatistics(
+            last_reported_worker_statistics,
+            duration_cast<nanoseconds>(steady_clock::now() - last_report_time)
+                .count());
+        LatencyStatistics latency_statistics = GetLatencyStatistics();
+        ReportLatencyStatistics(
+            latency_statistics.Since(last_reported_latency_statistics));
+
+        last_reported_ingest_statistics = ingest_statistics;
+        last_reported_latency_statistics = std::move(latency_statistics);
         last_report_time = steady_clock::now();
       }
     }
   }
 
 private:
+  // The counters of every consumer, summed up and stamped with the time they
+  // were read at.
+  CounterSnapshot TakeCounterSnapshot() const {
+    CounterSnapshot snapshot{};
+    for (auto &consumer : redis_observable_consumers_) {
+      snapshot.counters.Merge(consumer->GetCounters());
+    }
+    snapshot.time_in_nanoseconds =
+        std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch())
+            .count();
+    return snapshot;
+  }
+
+  // Prints the rates over the time that really passed between the
+  // snapshots, which is longer than the report interval when the monitor
+  // woke up late.
+  static void ReportCounterRates(const std::optional<CounterRates> &rates) {
+    if (!rates) {
+      return;
+    }
+    std::cout << "Messages processed per second in last " << std::fixed
+              << std::setprecision(3) << rates->window_in_seconds
+              << " seconds: " << std::defaultfloat
+              << rates->messages_per_second << " messages/sec, "
+              << rates->errors_per_second << " errors/sec, "
+              << rates->bytes_per_second << " bytes/sec received"
+              << std::endl;
+  }
+
+  IngestStatistics GetIngestStatistics() const {
+    IngestStatistics total{};
+    for (auto &consumer : redis_observable_consumers_) {
+      IngestStatistics consumer_statistics = consumer->GetIngestStatistics();
+      total.number_of_reads += consumer_statistics.number_of_reads;
+      total.number_of_frames += consumer_statistics.number_of_frames;
+      total.number_of_bytes += consumer_statistics.number_of_bytes;
+      total.max_frames_per_read = std::max(
+          total.max_frames_per_read, consumer_statistics.max_frames_per_read);
+    }
+    return total;
+  }
+
+  LatencyStatistics GetLatencyStatistics() const {
+    LatencyStatistics total{};
+    for (auto &consumer : redis_observable_consumers_) {
+      total.Merge(consumer->GetLatencyStatistics());
+    }
+    return total;
+  }
+
+  // Prints the percentiles of the latencies recorded since the last report.
+  void ReportLatencyStatistics(const LatencyStatistics &statistics) const {
+    ReportLatencies("Publish to receive", statistics.publish_to_receive);
+    ReportLatencies("Receive to dequeue", statistics.receive_to_dequeue);
+    ReportLatencies("Processing", statistics.processing);
+    ReportLatencies("XADD round trip", statistics.stream_write_round_trip);
+  }
+
+  static void ReportLatencies(const char *stage,
+                              const LatencySnapshot &latencies) {
+    const std::uint64_t number_of_samples = latencies.GetTotalCount();
+    if (number_of_samples == 0) {
+      return;
+    }
+    auto in_microseconds = [](std::uint64_t nanoseconds) {
+      return nanoseconds / 1000.0;
+    };
+    std::cout << stage << " latency (us) of " << number_of_samples
+              << " messages: " << std::fixed << std::setprecision(1)
+              << "p50 " << in_microseconds(latencies.GetValueAtPercentile(50))
+              << ", p90 "
+              << in_microseconds(latencies.GetValueAtPercentile(90))
+              << ", p99 "
+              << in_microseconds(latencies.GetValueAtPercentile(99))
+              << ", p999 "
+              << in_microseconds(latencies.GetValueAtPercentile(99.9))
+              << ", max " << in_microseconds(latencies.GetMaximum())
+              << std::defaultfloat << std::endl;
+  }
+
+  // Prints how full the bounded queues got and how many messages they
+  // dropped.
+  void ReportQueueStatistics() const {
+    for (auto &consumer : redis_observable_consumers_) {
+      QueueStatistics statistics = consumer->GetQueueStatistics();
+      if (statistics.capacity == 0) {
+        continue;
+      }
+      std::cout << "Queue high-water mark: " << statistics.high_water_mark
+                << " of " << statistics.capacity << " messages, "
+                << statistics.number_of_dropped_messages
+                << " messages dropped";
+      if (statistics.number_of_spilled_messages > 0) {
+        std::cout << ", " << statistics.number_of_spilled_messages
+                  << " spilled to the disk, "
+                  << statistics.number_of_messages_on_disk << " still there";
+      }
+      std::cout << std::endl;
+    }
+  }
+
+  // Prints how many stream entries await an acknowledgement.
+  void ReportPendingEntryStatistics() const {
+    for (auto &consumer : redis_observable_consumers_) {
+      if (auto statistics = consumer->GetPendingEntryStatistics()) {
+        std::cout << "Stream entries pending: "
+                  << statistics->number_of_pending_entries
+                  << " in the group, "
+                  << statistics->number_of_unacknowledged_entries
+                  << " unacknowledged by this consumer, "
+                  << statistics->number_of_acknowledged_entries
+                  << " acknowledged so far" << std::endl;
+      }
+    }
+  }
+
+  // Prints how busy every worker was since the last report and how many
+  // messages it stole from other workers.
+  void ReportWorkerStatistics(
+      std::map<int, WorkerStatistics> &last_reported_worker_statistics,
+      long long nanoseconds_since_last_report) const {
+    if (nanoseconds_since_last_report <= 0) {
+      return;
+    }
+    for (auto &consumer : redis_observable_consumers_) {
+      for (const WorkerStatistics &worker_statistics :
+           consumer->GetWorkerStatistics()) {
+        WorkerStatistics &last_reported =
+            last_reported_worker_statistics[worker_statistics.worker_id];
+        double utilization = 100.0 *
+                             (worker_statistics.busy_time_in_nanoseconds -
+                              last_reported.busy_time_in_nanoseconds) /
+                             nanoseconds_since_last_report;
+        long long stolen_messages =
+            worker_statistics.number_of_stolen_messages -
+            last_reported.number_of_stolen_messages;
+        std::cout << "Worker " << worker_statistics.worker_id << ": "
+                  << std::round(utilization * 10) / 10 << "% busy, "
+                  << stolen_messages << " messages stolen" << std::endl;
+        last_reported = worker_statistics;
+      }
+    }
+  }
+
   std::vector<IObservableConsumer *> redis_observable_consumers_;
   unsigned int report_interval_in_seconds_;
 };
\ No newline at end of file
@@ -0,0 +1,70 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "../Parsing/RespParser.hpp"
+
+// A Redis Cluster spreads its keys and sharded channels over 16384 hash slots.
+constexpr std::uint16_t kNumberOfHashSlots = 16384;
+
+// The hash slot of a key or a sharded channel: the CRC16 (XMODEM) of the key
+// modulo 16384. When the key contains a non-empty {hash tag}, only the tag is
+// hashed, so keys with the same tag share their slot.
+std::uint16_t GetHashSlot(std::string_view key);
+
+struct ClusterNode {
+  std::string host;
+  unsigned short port = 0;
+
+  bool operator==(const ClusterNode &other) const {
+    return port == other.port && host == other.host;
+  }
+  bool operator!=(const ClusterNode &other) const { return !(*this == other); }
+};
+
+/*
+Interprets the error reply that a cluster node sends for a slot that it does
+not own, e.g. "MOVED 3999 127.0.0.1:6381". The host is left empty when the
+node did not know it, meaning the host of the node that replied.
+*/
+[[nodiscard]] bool ParseMovedError(std::string_view error,
+                                   std::uint16_t &slot, ClusterNode &node);
+
+/*
+The master node that serves every hash slot of a Redis Cluster, as reported by
+CLUSTER SLOTS and corrected by MOVED redirections.
+*/
+class ClusterTopology {
+public:
+  ClusterTopology();
+
+  /*
+  Replaces the owners of the slots with a CLUSTER SLOTS reply. queried_node is
+  the node that sent the reply; it stands in for the masters whose host is
+  unknown. Fails, without changing the topology, when the reply is malformed.
+  */
+  [[nodiscard]] bool Update(const RespParser &cluster_slots_reply,
+                            const ClusterNode &queried_node);
+
+  // The owner of a slot, or nullptr when it is not known.
+  const ClusterNode *GetNode(std::uint16_t slot) const;
+  // Records a new owner of a slot, e.g. after a MOVED redirection.
+  void SetNode(std::uint16_t slot, const ClusterNode &node);
+
+  // Every node that owns at least one slot.
+  std::vector<ClusterNode> GetNodes() const;
+
+  const std::string &GetLastError() const { return last_error_; }
+
+private:
+  static constexpr std::uint16_t kUnknownNode = 0xFFFF;
+
+  std::uint16_t AddNode(const ClusterNode &node);
+
+  // The owner of every slot, as an index into nodes_.
+  std::vector<std::uint16_t> slot_owners_;
+  std::vector<ClusterNode> nodes_;
+  std::string last_error_;
+};
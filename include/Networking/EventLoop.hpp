@@ -0,0 +1,88 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <sys/epoll.h>
+#include <unordered_map>
+#include <vector>
+
+// Switches a socket to non-blocking mode.
+[[nodiscard]] bool MakeNonBlocking(int file_descriptor);
+
+/*
+A single-threaded reactor built on epoll.
+
+Run() waits for readiness events on the watched file descriptors and invokes
+their handlers on the calling thread, the loop thread. Watch(), UpdateEvents()
+and Unwatch() may only be used on the loop thread or before Run() is called.
+Other threads hand work to the loop with Post(), which wakes the loop up
+through an eventfd.
+
+The descriptors are watched level-triggered, so a handler does not have to
+drain a socket completely before returning.
+*/
+class EventLoop {
+public:
+  using EventHandler = std::function<void(std::uint32_t events)>;
+  using Task = std::function<void()>;
+
+  EventLoop();
+  ~EventLoop();
+
+  EventLoop(const EventLoop &) = delete;
+  EventLoop &operator=(const EventLoop &) = delete;
+
+  // Creates the epoll instance. Has to succeed before the loop is used.
+  [[nodiscard]] bool Initialize();
+
+  // Starts watching file_descriptor for the given EPOLL* events.
+  [[nodiscard]] bool Watch(int file_descriptor, std::uint32_t events,
+                           EventHandler handler);
+  [[nodiscard]] bool UpdateEvents(int file_descriptor, std::uint32_t events);
+  // The descriptor's handler is not invoked anymore, even for events that
+  // were already received in the current iteration of the loop.
+  void Unwatch(int file_descriptor);
+
+  // Runs task on the loop thread. Safe to call from any thread.
+  void Post(Task task);
+
+  // Dispatches events and posted tasks until Stop() is called.
+  void Run();
+  // Dispatches the events of a single wait of at most timeout_in_milliseconds
+  // (-1 waits for the next event) and the posted tasks. Also works after
+  // Stop(), to complete the work of a loop that is not running anymore.
+  // Returns false when waiting for events failed.
+  [[nodiscard]] bool RunOnce(int timeout_in_milliseconds);
+  // Safe to call from any thread.
+  void Stop();
+
+  const std::string &GetLastError() const { return last_error_; }
+
+private:
+  struct Watcher {
+    int file_descriptor;
+    EventHandler handler;
+    bool is_active;
+  };
+
+  void WakeUp();
+  void RunPostedTasks();
+
+  int epoll_file_descriptor_;
+  int wake_up_file_descriptor_;
+  std::atomic<bool> stop_;
+
+  std::unordered_map<int, std::unique_ptr<Watcher>> watchers_;
+  // Watchers removed during the dispatch of events. They are freed after
+  // the dispatch, as pending events may still point to them.
+  std::vector<std::unique_ptr<Watcher>> removed_watchers_;
+
+  std::mutex posted_tasks_mutex_;
+  std::vector<Task> posted_tasks_;
+  std::vector<Task> running_tasks_;
+
+  std::string last_error_;
+};
@@ -0,0 +1,149 @@
+#pragma once
+#ifdef HAS_IO_URING
+#include <cstddef>
+#include <cstdint>
+#include <linux/io_uring.h>
+#include <string>
+
+// A completed operation, copied out of the completion queue.
+struct IoUringCompletion {
+  std::uint64_t user_data;
+  std::int32_t result;
+  std::uint32_t flags;
+};
+
+/*
+A minimal io_uring instance. It is set up with the raw system calls, so the
+project does not depend on liburing.
+
+Operations are prepared in the entries returned by GetSubmissionEntry() and
+handed to the kernel by SubmitAndWait(), which also waits for completions,
+all in a single io_uring_enter(). Only one thread may use the instance.
+*/
+class IoUring {
+public:
+  IoUring();
+  ~IoUring();
+
+  IoUring(const IoUring &) = delete;
+  IoUring &operator=(const IoUring &) = delete;
+
+  // Fails when the kernel does not support io_uring or forbids its use.
+  [[nodiscard]] bool Initialize(unsigned number_of_entries);
+  // Cancels every operation that has not completed yet.
+  void Close();
+
+  // Returns a cleared entry. When the submission queue is full, the prepared
+  // entries are submitted first. Returns nullptr if there is still no room.
+  io_uring_sqe *GetSubmissionEntry();
+
+  // Submits the prepared entries and waits until at least
+  // minimum_number_of_completions operations have completed.
+  [[nodiscard]] bool SubmitAndWait(unsigned minimum_number_of_completions);
+
+  /*
+  Invokes completion_handler(const IoUringCompletion &) for every completed
+  operation. Every completion is removed from the queue before its handler is
+  invoked, so the handler may prepare, submit and wait for operations itself.
+  */
+  template <typename CompletionHandler>
+  void ForEachCompletion(CompletionHandler &&completion_handler) {
+    while (true) {
+      const unsigned head = *completion_head_;
+      if (head == __atomic_load_n(completion_tail_, __ATOMIC_ACQUIRE)) {
+        return;
+      }
+      const io_uring_cqe &entry =
+          completion_entries_[head & completion_ring_mask_];
+      const IoUringCompletion completion{entry.user_data, entry.res,
+                                         entry.flags};
+      __atomic_store_n(completion_head_, head + 1, __ATOMIC_RELEASE);
+      completion_handler(completion);
+    }
+  }
+
+  // Registers a ring of provided buffers, see ProvidedBuffers.
+  [[nodiscard]] bool RegisterBufferRing(void *ring_address,
+                                        std::uint16_t number_of_entries,
+                                        std::uint16_t group_id);
+  void UnregisterBufferRing(std::uint16_t group_id);
+
+  // The number of io_uring_enter() calls made so far.
+  long long GetNumberOfSystemCalls() const { return number_of_system_calls_; }
+
+  const std::string &GetLastError() const { return last_error_; }
+
+private:
+  int file_descriptor_;
+
+  void *submission_ring_;
+  std::size_t submission_ring_size_;
+  void *completion_ring_;
+  std::size_t completion_ring_size_;
+  io_uring_sqe *submission_entries_;
+  std::size_t submission_entries_size_;
+
+  unsigned *submission_head_;
+  unsigned *submission_tail_;
+  unsigned submission_ring_mask_;
+  unsigned submission_ring_entries_;
+  // The tail of the entries prepared, but not yet made visible to the kernel.
+  unsigned local_submission_tail_;
+  unsigned number_of_unsubmitted_entries_;
+
+  unsigned *completion_head_;
+  unsigned *completion_tail_;
+  unsigned completion_ring_mask_;
+  io_uring_cqe *completion_entries_;
+
+  long long number_of_system_calls_;
+  std::string last_error_;
+};
+
+/*
+A group of equally sized buffers that the kernel picks from when data
+arrives on a socket, instead of the receiver passing a buffer with every
+receive. A buffer that was handed out has to be given back with Recycle()
+once its data has been handled.
+
+The buffers are handed to the kernel through a ring that is shared with it
+(Linux 5.19), or with IORING_OP_PROVIDE_BUFFERS operations, which are
+submitted together with the next operations of the io_uring.
+*/
+class ProvidedBuffers {
+public:
+  ProvidedBuffers();
+  ~ProvidedBuffers();
+
+  ProvidedBuffers(const ProvidedBuffers &) = delete;
+  ProvidedBuffers &operator=(const ProvidedBuffers &) = delete;
+
+  // number_of_buffers has to be a power of two.
+  [[nodiscard]] bool Initialize(IoUring &io_uring, std::uint16_t group_id,
+                                std::uint16_t number_of_buffers,
+                                std::size_t buffer_size, bool use_ring);
+
+  std::uint16_t GetGroupId() const { return group_id_; }
+  const char *GetBuffer(std::uint16_t buffer_id) const {
+    return buffers_ + static_cast<std::size_t>(buffer_id) * buffer_size_;
+  }
+
+  [[nodiscard]] bool Recycle(std::uint16_t buffer_id);
+
+private:
+  // Adds the buffer to the ring without making it visible to the kernel.
+  void AddToRing(std::uint16_t buffer_id, std::uint16_t offset);
+  [[nodiscard]] bool Provide(std::uint16_t first_buffer_id,
+                             std::uint16_t number_of_buffers);
+
+  IoUring *io_uring_;
+  io_uring_buf_ring *ring_;
+  std::size_t ring_size_;
+  char *buffers_;
+  std::size_t buffers_size_;
+  std::size_t buffer_size_;
+  std::uint16_t number_of_buffers_;
+  std::uint16_t group_id_;
+  std::uint16_t tail_;
+};
+#endif
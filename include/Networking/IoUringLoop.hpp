@@ -0,0 +1,132 @@
+#pragma once
+#ifdef HAS_IO_URING
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "IoUring.hpp"
+
+/*
+A single-threaded driver for sockets that are read and written through an
+io_uring instead of with a system call per operation.
+
+Every socket passed to Receive() gets a multishot receive, which keeps
+delivering data into the socket's own group of provided buffers until it is
+cancelled, so receives do not have to be requested again. Send() queues the
+send of a buffer owned by the caller. Every iteration of RunOnce() submits
+all of the queued operations and waits for completions with a single
+io_uring_enter().
+
+RunOnce() may be called from a handler, e.g. to wait for replies. The data
+that arrives meanwhile on the socket whose handler is running is handed to
+that handler after it has returned.
+*/
+class IoUringLoop {
+public:
+  // Invoked with the received data, which is valid only during the call.
+  // An empty view means that the connection was closed or has failed.
+  using ReceiveHandler = std::function<void(std::string_view data)>;
+  using SendHandler = std::function<void(bool is_success)>;
+
+  static constexpr unsigned kDefaultNumberOfEntries = 256;
+  static constexpr std::uint16_t kDefaultNumberOfBuffers = 64;
+  static constexpr std::size_t kDefaultBufferSize = 16 * 1024;
+
+  IoUringLoop();
+  ~IoUringLoop();
+
+  IoUringLoop(const IoUringLoop &) = delete;
+  IoUringLoop &operator=(const IoUringLoop &) = delete;
+
+  // Fails when the kernel does not support io_uring or forbids its use.
+  [[nodiscard]] bool
+  Initialize(unsigned number_of_entries = kDefaultNumberOfEntries,
+             std::uint16_t number_of_buffers_per_socket =
+                 kDefaultNumberOfBuffers,
+             std::size_t buffer_size = kDefaultBufferSize);
+
+  // Starts receiving from file_descriptor until the connection is closed.
+  [[nodiscard]] bool Receive(int file_descriptor, ReceiveHandler handler);
+
+  // Sends all of data, which has to stay valid until handler was invoked.
+  // The sends of a socket may only overlap if their order does not matter.
+  [[nodiscard]] bool Send(int file_descriptor, std::string_view data,
+                          SendHandler handler);
+
+  // Submits the queued operations, waits for at least one completion and
+  // invokes the handlers of the completed operations.
+  [[nodiscard]] bool RunOnce();
+  // Runs iterations until Stop() is called. Returns false when the io_uring
+  // fails.
+  [[nodiscard]] bool Run();
+  // May only be called on the loop thread, e.g. by a handler.
+  void Stop() { stop_ = true; }
+
+  long long GetNumberOfSystemCalls() const {
+    return io_uring_.GetNumberOfSystemCalls();
+  }
+
+  // False when the buffers are provided with IORING_OP_PROVIDE_BUFFERS.
+  bool UsesBufferRings() const { return uses_buffer_rings_; }
+
+  const std::string &GetLastError() const { return last_error_; }
+
+private:
+  enum class OperationKind { Receive, Send };
+
+  // The user data of a submitted operation points to its Operation.
+  struct Operation {
+    OperationKind kind;
+    int file_descriptor;
+  };
+
+  struct ReceivedChunk {
+    std::int32_t result;
+    std::uint16_t buffer_id;
+    bool has_buffer;
+    bool is_armed;
+  };
+
+  struct Receiver : Operation {
+    ReceiveHandler handler;
+    ProvidedBuffers buffers;
+    std::deque<ReceivedChunk> received_chunks;
+    bool is_dispatching;
+    bool is_closed;
+  };
+
+  struct SendOperation : Operation {
+    std::string_view data;
+    std::size_t offset;
+    SendHandler handler;
+  };
+
+  // Some kernels accept rings of provided buffers, but never pick a buffer
+  // from them. Receives a byte through a socket pair to find out.
+  bool IsBufferRingUsable();
+  [[nodiscard]] bool ArmReceive(Receiver &receiver);
+  [[nodiscard]] bool SubmitSend(SendOperation &send_operation);
+
+  void OnCompletion(const IoUringCompletion &completion);
+  void OnSendCompletion(SendOperation &send_operation, std::int32_t result);
+  void DispatchReceivedChunks(Receiver &receiver);
+
+  IoUring io_uring_;
+  std::uint16_t number_of_buffers_per_socket_;
+  std::size_t buffer_size_;
+  bool uses_buffer_rings_;
+  bool stop_;
+
+  std::unordered_map<int, std::unique_ptr<Receiver>> receivers_;
+  // Send operations are reused, so sending does not allocate memory.
+  std::vector<std::unique_ptr<SendOperation>> send_operations_;
+  std::vector<SendOperation *> free_send_operations_;
+
+  std::string last_error_;
+};
+#endif
@@ -0,0 +1,16 @@
+#pragma once
+
+// Statistics about the replies received on a RESP connection, e.g. a
+// consumer's subscription connection.
+struct IngestStatistics {
+  // The number of read system calls.
+  long long number_of_reads;
+  // The number of complete replies (frames) that were extracted.
+  long long number_of_frames;
+  long long number_of_bytes;
+  // The highest number of frames extracted from a single read.
+  long long max_frames_per_read;
+  // The connections that were opened again after the subscription was
+  // established, e.g. to the new owner of a moved hash slot.
+  long long number_of_reconnects;
+};
@@ -0,0 +1,26 @@
+#pragma once
+#include <cstddef>
+#include <optional>
+#include <string_view>
+
+/*
+Finds the value of a top-level field in a JSON object without building a
+document.
+
+Nested objects and arrays are skipped as a whole, so only the fields of the
+outermost object are matched. The returned view points into the given json:
+string values are returned without their quotes (escape sequences are left as
+they are) and numbers, booleans and null are returned as written.
+
+Uses a JsonScanner with the fastest kernel that the CPU supports.
+*/
+[[nodiscard]] std::optional<std::string_view>
+ExtractJsonField(std::string_view json, std::string_view field_name);
+
+// Like ExtractJsonField(), for several fields in a single pass. Stores the
+// value of field_names[i] in values[i], or std::nullopt when the object does
+// not have the field. Returns false when the json is malformed.
+[[nodiscard]] bool ExtractJsonFields(std::string_view json,
+                                     const std::string_view *field_names,
+                                     std::optional<std::string_view> *values,
+                                     std::size_t number_of_fields);
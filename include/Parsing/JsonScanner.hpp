@@ -0,0 +1,271 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <optional>
+#include <string_view>
+
+// The instruction set that classifies the characters of a JSON document.
+enum class JsonScannerKernel { Scalar, Sse42, Avx2 };
+
+// The positions of the characters of a 64 byte block, one bit per byte.
+struct JsonBlockMasks {
+  std::uint64_t quotes;
+  std::uint64_t backslashes;
+  // {, }, [, ], : and ,
+  std::uint64_t structurals;
+};
+
+[[nodiscard]] bool IsJsonScannerKernelSupported(JsonScannerKernel kernel);
+// The fastest kernel that the CPU supports, detected once.
+[[nodiscard]] JsonScannerKernel GetBestJsonScannerKernel();
+[[nodiscard]] const char *GetJsonScannerKernelName(JsonScannerKernel kernel);
+
+/*
+Finds the values of top-level fields of a JSON object in a single pass,
+without building a document and without allocating.
+
+The document is classified in blocks of 64 bytes with SIMD instructions into
+bit masks of quotes, backslashes and structural characters. Escaped quotes and
+the structural characters inside strings are masked out with a few bit
+operations per block, so only the remaining structural characters are
+visited, one at a time, to follow the fields of the outermost object. Nested
+objects and arrays are skipped as a whole.
+
+The returned views point into the given json: string values are returned
+without their quotes (escape sequences are left as they are) and other values
+as written.
+*/
+class JsonScanner {
+public:
+  static constexpr std::size_t kBlockSize = 64;
+
+  explicit JsonScanner(JsonScannerKernel kernel = GetBestJsonScannerKernel());
+
+  // Stores the value of field_names[i] in values[i], or std::nullopt when the
+  // object does not have the field. Returns false, with all of the values
+  // reset, when the json is not an object or is malformed before the last of
+  // the fields was found.
+  [[nodiscard]] bool ExtractFields(std::string_view json,
+                                   const std::string_view *field_names,
+                                   std::optional<std::string_view> *values,
+                                   std::size_t number_of_fields) const;
+
+  [[nodiscard]] std::optional<std::string_view>
+  ExtractField(std::string_view json, std::string_view field_name) const {
+    std::optional<std::string_view> value;
+    if (!ExtractFields(json, &field_name, &value, 1)) {
+      return {};
+    }
+    return value;
+  }
+
+  // Calls handle_field(key, value) for the top-level fields of the object in
+  // order, until it returns false. Keys are passed as written, without their
+  // quotes. Returns false when the json is not an object or is malformed
+  // before the scan stopped.
+  template <typename FieldHandler>
+  [[nodiscard]] bool ForEachField(std::string_view json,
+                                  FieldHandler &&handle_field) const;
+
+  // Classifies the 64 bytes at block.
+  [[nodiscard]] JsonBlockMasks ClassifyBlock(const char *block) const {
+    return classify_block_(block);
+  }
+
+  JsonScannerKernel GetKernel() const { return kernel_; }
+
+private:
+  using ClassifyBlockFunction = JsonBlockMasks (*)(const char *block);
+
+  static bool IsWhitespace(char character) {
+    return character == ' ' || character == '\t' || character == '\r' ||
+           character == '\n';
+  }
+
+  // The characters that follow an escaping backslash. A backslash that is
+  // escaped itself does not escape the next character. escape_carry is 1
+  // when the previous block ended with an escaping backslash.
+  static std::uint64_t FindEscapedCharacters(std::uint64_t backslashes,
+                                             std::uint64_t &escape_carry) {
+    std::uint64_t escaped = escape_carry;
+    std::uint64_t escaping_backslashes = backslashes & ~escaped;
+    escape_carry = 0;
+    while (escaping_backslashes != 0) {
+      const std::uint64_t backslash =
+          escaping_backslashes & (~escaping_backslashes + 1);
+      const std::uint64_t next_character = backslash << 1;
+      if (next_character == 0) {
+        escape_carry = 1;
+      }
+      escaped |= next_character;
+      escaping_backslashes &= ~(backslash | next_character);
+    }
+    return escaped;
+  }
+
+  // Every bit is the parity of the set bits up to and including it, so the
+  // opening quote of a string and its contents are set, but not its closing
+  // quote.
+  static std::uint64_t PrefixXor(std::uint64_t bits) {
+    bits ^= bits << 1;
+    bits ^= bits << 2;
+    bits ^= bits << 4;
+    bits ^= bits << 8;
+    bits ^= bits << 16;
+    bits ^= bits << 32;
+    return bits;
+  }
+
+  // Removes the surrounding whitespace and the quotes of a string value.
+  // Returns false for empty values and for nested values whose brackets do
+  // not match.
+  static bool TrimValue(std::string_view &value) {
+    std::size_t start = 0;
+    std::size_t end = value.size();
+    while (start < end && IsWhitespace(value[start])) {
+      ++start;
+    }
+    while (end > start && IsWhitespace(value[end - 1])) {
+      --end;
+    }
+    if (start == end) {
+      return false;
+    }
+    const char first_character = value[start];
+    const char last_character = value[end - 1];
+    if (first_character == '"') {
+      if (end - start < 2 || last_character != '"') {
+        return false;
+      }
+      ++start;
+      --end;
+    } else if ((first_character == '{' && last_character != '}') ||
+               (first_character == '[' && last_character != ']')) {
+      return false;
+    }
+    value = value.substr(start, end - start);
+    return true;
+  }
+
+  JsonScannerKernel kernel_;
+  ClassifyBlockFunction classify_block_;
+};
+
+template <typename FieldHandler>
+bool JsonScanner::ForEachField(std::string_view json,
+                               FieldHandler &&handle_field) const {
+  std::size_t object_start = 0;
+  while (object_start < json.size() && IsWhitespace(json[object_start])) {
+    ++object_start;
+  }
+  if (object_start == json.size() || json[object_start] != '{') {
+    return false;
+  }
+
+  // Where the scanner is within the fields of the outermost object.
+  enum class State { ExpectKey, InKey, ExpectColon, InValue };
+  State state = State::ExpectKey;
+  int depth = 0;
+  std::size_t key_start = 0;
+  std::size_t key_end = 0;
+  std::size_t value_start = 0;
+
+  std::uint64_t escape_carry = 0;
+  // All ones when the previous block ended inside a string.
+  std::uint64_t in_string_carry = 0;
+  char padded_block[kBlockSize];
+  for (std::size_t block_start = object_start; block_start < json.size();
+       block_start += kBlockSize) {
+    const char *block = json.data() + block_start;
+    if (json.size() - block_start < kBlockSize) {
+      std::memset(padded_block, ' ', kBlockSize);
+      std::memcpy(padded_block, block, json.size() - block_start);
+      block = padded_block;
+    }
+    const JsonBlockMasks masks = classify_block_(block);
+    const std::uint64_t quotes =
+        masks.quotes & ~FindEscapedCharacters(masks.backslashes, escape_carry);
+    const std::uint64_t in_string = PrefixXor(quotes) ^ in_string_carry;
+    in_string_carry = 0 - (in_string >> 63);
+
+    std::uint64_t tokens = quotes | (masks.structurals & ~in_string);
+    while (tokens != 0) {
+      const std::size_t position = block_start + __builtin_ctzll(tokens);
+      tokens &= tokens - 1;
+      const char character = json[position];
+
+      // Nested objects and arrays are skipped as a whole.
+      if (depth > 1) {
+        if (character == '{' || character == '[') {
+          ++depth;
+        } else if (character == '}' || character == ']') {
+          --depth;
+        }
+        continue;
+      }
+      if (depth == 0) {
+        // The first token is the opening brace of the object.
+        ++depth;
+        continue;
+      }
+
+      switch (character) {
+      case '"':
+        if (state == State::ExpectKey) {
+          key_start = position + 1;
+          state = State::InKey;
+        } else if (state == State::InKey) {
+          key_end = position;
+          state = State::ExpectColon;
+        } else if (state == State::ExpectColon) {
+          return false;
+        }
+        break;
+      case ':':
+        if (state != State::ExpectColon) {
+          return false;
+        }
+        for (std::size_t i = key_end + 1; i < position; ++i) {
+          if (!IsWhitespace(json[i])) {
+            return false;
+          }
+        }
+        value_start = position + 1;
+        state = State::InValue;
+        break;
+      case ',':
+      case '}':
+        if (state == State::InValue) {
+          std::string_view value =
+              json.substr(value_start, position - value_start);
+          if (!TrimValue(value)) {
+            return false;
+          }
+          if (!handle_field(json.substr(key_start, key_end - key_start),
+                            value)) {
+            return true;
+          }
+        } else if (character == ',' || state != State::ExpectKey) {
+          return false;
+        }
+        if (character == '}') {
+          return true;
+        }
+        state = State::ExpectKey;
+        break;
+      case '{':
+      case '[':
+        if (state != State::InValue) {
+          return false;
+        }
+        ++depth;
+        break;
+      default:
+        return false;
+      }
+    }
+  }
+  // The object, or a string, was not closed.
+  return false;
+}
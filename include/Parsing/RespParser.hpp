@@ -0,0 +1,168 @@
+#pragma once
+#include <cstddef>
+#include <string_view>
+#include <vector>
+
+/*
+A streaming parser for the Redis Serialization Protocol (RESP2 and RESP3).
+
+The parser works directly on the caller's receive buffer. Every parsed value
+is described by a RespValue node whose string_view points into that buffer,
+so no memory is allocated per reply once the parser's internal node storage
+has grown to fit the largest reply seen so far.
+
+Aggregates (arrays, sets, maps and pushes) are stored in pre-order: the
+children of the node at index i start at index i + 1 and the next sibling of
+a node at index j is at index j + nodes[j].subtree_size.
+
+The parsed views are only valid for as long as the parsed bytes stay in the
+buffer that was passed to Parse().
+*/
+
+enum class RespType : char {
+  SimpleString = '+',
+  Error = '-',
+  Integer = ':',
+  BulkString = '$',
+  Array = '*',
+  Null = '_',
+  Double = ',',
+  Boolean = '#',
+  BlobError = '!',
+  VerbatimString = '=',
+  BigNumber = '(',
+  Map = '%',
+  Set = '~',
+  Push = '>'
+};
+
+struct RespValue {
+  RespType type;
+  // Set for RESP3 nulls and for the RESP2 null bulk string / null array.
+  bool is_null;
+  // The payload of string-like values and the raw text of numeric values.
+  std::string_view string;
+  // The value of integers and booleans.
+  long long integer;
+  // The number of direct children of an aggregate (2 * n for maps).
+  std::size_t number_of_elements;
+  // The number of nodes in the subtree rooted at this value, itself included.
+  std::size_t subtree_size;
+
+  bool IsAggregate() const {
+    return type == RespType::Array || type == RespType::Set ||
+           type == RespType::Map || type == RespType::Push;
+  }
+
+  bool IsString() const {
+    return !is_null &&
+           (type == RespType::SimpleString || type == RespType::BulkString ||
+            type == RespType::VerbatimString);
+  }
+
+  bool IsError() const {
+    return type == RespType::Error || type == RespType::BlobError;
+  }
+};
+
+enum class RespParseStatus { Complete, Incomplete, Error };
+
+class RespParser {
+public:
+  RespParser();
+
+  /*
+  Parses a single reply from the beginning of [data, data + length).
+
+  Returns:
+    - Complete when a whole reply was parsed. bytes_consumed is then set to the
+      size of the reply and the reply is accessible through Root() / Child().
+    - Incomplete when more data is needed. Parsing has to be retried from the
+      same position once more bytes have been received.
+    - Error when the data is not valid RESP. GetLastError() describes why.
+  */
+  RespParseStatus Parse(const char *data, std::size_t length,
+                        std::size_t &bytes_consumed);
+
+  const RespValue &Root() const { return nodes_.front(); }
+
+  // Returns the index-th direct child of an aggregate node or nullptr.
+  const RespValue *Child(const RespValue &aggregate, std::size_t index) const;
+
+  // When Parse() returned Incomplete, the total number of bytes (counted from
+  // the start of the reply) known to be needed. 0 when it is not yet known.
+  std::size_t GetBytesNeeded() const { return bytes_needed_; }
+
+  const char *GetLastError() const { return last_error_; }
+
+private:
+  struct PendingAggregate {
+    std::size_t node_index;
+    std::size_t remaining_elements;
+    // RESP3 attributes carry metadata about the next value and are dropped.
+    bool is_attribute;
+  };
+
+  RespParseStatus Fail(const char *error_message) {
+    last_error_ = error_message;
+    return RespParseStatus::Error;
+  }
+
+  // Accounts for a value that has been fully parsed. Returns true when the
+  // whole reply is complete.
+  bool CompleteValue();
+
+  std::vector<RespValue> nodes_;
+  std::vector<PendingAggregate> pending_aggregates_;
+  std::size_t bytes_needed_;
+  const char *last_error_;
+};
+
+enum class PubSubMessageKind {
+  Unknown,
+  Subscribe,
+  Unsubscribe,
+  PatternSubscribe,
+  PatternUnsubscribe,
+  Message,
+  PatternMessage,
+  // Sharded pub/sub of Redis Cluster (SSUBSCRIBE, Redis 7).
+  ShardSubscribe,
+  ShardUnsubscribe,
+  ShardMessage
+};
+
+struct PubSubMessage {
+  PubSubMessageKind kind;
+  // Only set for pattern messages and pattern subscriptions.
+  std::string_view pattern;
+  std::string_view channel;
+  std::string_view payload;
+  // The number of active subscriptions reported by (un)subscribe replies.
+  long long number_of_subscriptions;
+};
+
+// Interprets a parsed reply as a pub/sub message. Both the RESP2 array and
+// the RESP3 push encodings are accepted. Returns false when the reply is not
+// a pub/sub message.
+[[nodiscard]] bool ParsePubSubMessage(const RespParser &parser,
+                                      PubSubMessage &pubsub_message);
+
+// An entry of a stream, as returned by XREAD and XREADGROUP.
+struct StreamEntry {
+  std::string_view id;
+  // The value of the entry's payload field. Not set for the entries that were
+  // deleted after they had been delivered, or that lack the field.
+  std::string_view payload;
+  bool has_payload;
+};
+
+/*
+Collects the entries of a reply to XREAD or XREADGROUP for a single stream,
+in both the RESP2 array and the RESP3 map encoding. A null reply, which
+means that no entries arrived in time, yields no entries. Returns false when
+the reply is an error or malformed.
+*/
+[[nodiscard]] bool ParseStreamEntries(const RespParser &parser,
+                                      std::string_view payload_field,
+                                      std::vector<StreamEntry> &entries);
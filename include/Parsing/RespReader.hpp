@@ -0,0 +1,178 @@
+#pragma once
+#include <atomic>
+#include <cerrno>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <sys/uio.h>
+
+#include "IngestStatistics.hpp"
+#include "RespParser.hpp"
+#include "RespReceiveBuffer.hpp"
+
+/*
+Reads RESP replies from a connected socket.
+
+Every call to ReadFrames() performs a single readv() and then hands every
+complete reply that is available to the caller before returning, so bursts of
+small messages that arrive in one read are not left waiting in the buffer.
+
+The receive buffer starts at 64 KB. The readv() reads into the free space of
+the buffer and into a 64 KB overflow area, so a single system call can return
+more data than currently fits into the buffer. The buffer grows when a reply
+does not fit into it and shrinks back once the large reply has been consumed.
+*/
+class RespReader {
+public:
+  static constexpr std::size_t kDefaultBufferSize = 64 * 1024;
+  static constexpr std::size_t kOverflowBufferSize = 64 * 1024;
+
+  explicit RespReader(int file_descriptor = -1,
+                      std::size_t initial_buffer_size = kDefaultBufferSize)
+      : file_descriptor_{file_descriptor},
+        initial_buffer_size_{initial_buffer_size},
+        receive_buffer_(initial_buffer_size),
+        overflow_buffer_(std::make_unique<char[]>(kOverflowBufferSize)),
+        last_error_{}, number_of_reads_{0}, number_of_frames_{0},
+        number_of_bytes_{0}, max_frames_per_read_{0},
+        number_of_reconnects_{0} {}
+
+  // Replacing a connection with a new one counts as a reconnect.
+  void SetFileDescriptor(int file_descriptor) {
+    if (file_descriptor_ >= 0 && file_descriptor >= 0 &&
+        file_descriptor != file_descriptor_) {
+      number_of_reconnects_.fetch_add(1, std::memory_order_relaxed);
+    }
+    file_descriptor_ = file_descriptor;
+  }
+
+  /*
+  Reads once from the socket and invokes frame_handler(const RespParser &) for
+  every complete reply. The parsed views are valid only during the call.
+
+  Returns false when the connection was closed or an error occurred.
+  GetLastError() describes the reason. On a non-blocking socket without data,
+  returns true without invoking the handler.
+  */
+  template <typename FrameHandler>
+  bool ReadFrames(FrameHandler &&frame_handler) {
+    receive_buffer_.EnsureWritable(RespReceiveBuffer::kMinimumReadSize);
+
+    struct iovec io_vectors[2];
+    io_vectors[0].iov_base = receive_buffer_.GetWritableData();
+    io_vectors[0].iov_len = receive_buffer_.GetWritableSize();
+    io_vectors[1].iov_base = overflow_buffer_.get();
+    io_vectors[1].iov_len = kOverflowBufferSize;
+
+    ssize_t bytes_read;
+    do {
+      bytes_read = readv(file_descriptor_, io_vectors, 2);
+    } while (bytes_read < 0 && errno == EINTR);
+
+    if (bytes_read < 0) {
+      if (errno == EAGAIN || errno == EWOULDBLOCK) {
+        return true;
+      }
+      last_error_ = "Failed to read from the server!";
+      return false;
+    }
+    if (bytes_read == 0) {
+      last_error_ = "The server has closed the connection!";
+      return false;
+    }
+
+    const std::size_t bytes_in_buffer =
+        std::min<std::size_t>(bytes_read, io_vectors[0].iov_len);
+    receive_buffer_.CommitWrite(bytes_in_buffer);
+    if (static_cast<std::size_t>(bytes_read) > bytes_in_buffer) {
+      receive_buffer_.Append(overflow_buffer_.get(),
+                             bytes_read - bytes_in_buffer);
+    }
+    return HandleReceivedFrames(bytes_read, frame_handler);
+  }
+
+  /*
+  Parses data that was received by other means, e.g. through an io_uring,
+  and invokes frame_handler for every reply that is complete now. Replies may
+  be split over several calls.
+
+  Returns false when the data is not valid RESP.
+  */
+  template <typename FrameHandler>
+  bool ParseFrames(std::string_view data, FrameHandler &&frame_handler) {
+    receive_buffer_.Append(data.data(), data.size());
+    return HandleReceivedFrames(data.size(), frame_handler);
+  }
+
+  const std::string &GetLastError() const { return last_error_; }
+
+  // Safe to call from other threads while the reader is in use.
+  IngestStatistics GetStatistics() const {
+    return {number_of_reads_.load(std::memory_order_relaxed),
+            number_of_frames_.load(std::memory_order_relaxed),
+            number_of_bytes_.load(std::memory_order_relaxed),
+            max_frames_per_read_.load(std::memory_order_relaxed),
+            number_of_reconnects_.load(std::memory_order_relaxed)};
+  }
+
+private:
+  template <typename FrameHandler>
+  bool HandleReceivedFrames(std::size_t bytes_received,
+                            FrameHandler &frame_handler) {
+    long long frames_in_this_read = 0;
+    while (receive_buffer_.GetReadableSize() > 0) {
+      std::size_t bytes_consumed = 0;
+      RespParseStatus status =
+          parser_.Parse(receive_buffer_.GetReadableData(),
+                        receive_buffer_.GetReadableSize(), bytes_consumed);
+      if (status == RespParseStatus::Error) {
+        last_error_ = std::string("Failed to parse a Redis reply! ") +
+                      parser_.GetLastError();
+        return false;
+      }
+      if (status == RespParseStatus::Incomplete) {
+        // Make room for the rest of a large reply up front, so it is read
+        // directly into the buffer.
+        if (parser_.GetBytesNeeded() > receive_buffer_.GetReadableSize()) {
+          receive_buffer_.EnsureWritable(parser_.GetBytesNeeded() -
+                                         receive_buffer_.GetReadableSize());
+        }
+        break;
+      }
+
+      frame_handler(static_cast<const RespParser &>(parser_));
+      receive_buffer_.Consume(bytes_consumed);
+      ++frames_in_this_read;
+    }
+
+    // Only give back memory that was taken for unusually large replies, so
+    // the buffer does not oscillate between two sizes.
+    if (receive_buffer_.GetCapacity() > 4 * initial_buffer_size_) {
+      receive_buffer_.ShrinkTo(initial_buffer_size_);
+    }
+
+    number_of_reads_.fetch_add(1, std::memory_order_relaxed);
+    number_of_frames_.fetch_add(frames_in_this_read, std::memory_order_relaxed);
+    number_of_bytes_.fetch_add(bytes_received, std::memory_order_relaxed);
+    if (frames_in_this_read >
+        max_frames_per_read_.load(std::memory_order_relaxed)) {
+      max_frames_per_read_.store(frames_in_this_read,
+                                 std::memory_order_relaxed);
+    }
+    return true;
+  }
+
+  int file_descriptor_;
+  std::size_t initial_buffer_size_;
+
+  RespReceiveBuffer receive_buffer_;
+  std::unique_ptr<char[]> overflow_buffer_;
+  RespParser parser_;
+  std::string last_error_;
+
+  std::atomic<long long> number_of_reads_;
+  std::atomic<long long> number_of_frames_;
+  std::atomic<long long> number_of_bytes_;
+  std::atomic<long long> max_frames_per_read_;
+  std::atomic<long long> number_of_reconnects_;
+};
@@ -0,0 +1,89 @@
+#pragma once
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include <vector>
+
+/*
+A reusable receive buffer for RESP connections.
+
+Data is received at the write position and parsed from the read position.
+Consumed bytes are reclaimed lazily by moving the unparsed tail to the front
+of the buffer, which only happens when there is not enough room left for the
+next read. The buffer grows when a single reply does not fit into it.
+*/
+class RespReceiveBuffer {
+public:
+  // The smallest amount of free space offered to a single read.
+  static constexpr std::size_t kMinimumReadSize = 16 * 1024;
+
+  explicit RespReceiveBuffer(std::size_t initial_capacity = 64 * 1024)
+      : storage_(initial_capacity), read_position_{0}, write_position_{0} {}
+
+  char *GetWritableData() { return storage_.data() + write_position_; }
+  std::size_t GetWritableSize() const {
+    return storage_.size() - write_position_;
+  }
+  void CommitWrite(std::size_t number_of_bytes) {
+    write_position_ += number_of_bytes;
+  }
+
+  const char *GetReadableData() const {
+    return storage_.data() + read_position_;
+  }
+  std::size_t GetReadableSize() const {
+    return write_position_ - read_position_;
+  }
+  void Consume(std::size_t number_of_bytes) {
+    read_position_ += number_of_bytes;
+    if (read_position_ == write_position_) {
+      read_position_ = write_position_ = 0;
+    }
+  }
+
+  std::size_t GetCapacity() const { return storage_.size(); }
+
+  void Append(const char *data, std::size_t number_of_bytes) {
+    EnsureWritable(number_of_bytes);
+    memcpy(GetWritableData(), data, number_of_bytes);
+    CommitWrite(number_of_bytes);
+  }
+
+  // Gives memory back after a large reply. Only possible when all of the
+  // received data has been consumed.
+  void ShrinkTo(std::size_t capacity) {
+    if (GetReadableSize() == 0 && storage_.size() > capacity) {
+      storage_.resize(capacity);
+      storage_.shrink_to_fit();
+    }
+  }
+
+  // Makes room for at least minimum_writable_size bytes. Invalidates all
+  // pointers and views into the buffer.
+  void EnsureWritable(std::size_t minimum_writable_size) {
+    if (GetWritableSize() >= minimum_writable_size) {
+      return;
+    }
+
+    const std::size_t readable_size = GetReadableSize();
+    if (read_position_ > 0) {
+      memmove(storage_.data(), storage_.data() + read_position_,
+              readable_size);
+      read_position_ = 0;
+      write_position_ = readable_size;
+    }
+
+    if (GetWritableSize() < minimum_writable_size) {
+      std::size_t new_capacity = std::max<std::size_t>(storage_.size(), 1024);
+      while (new_capacity - readable_size < minimum_writable_size) {
+        new_capacity *= 2;
+      }
+      storage_.resize(new_capacity);
+    }
+  }
+
+private:
+  std::vector<char> storage_;
+  std::size_t read_position_;
+  std::size_t write_position_;
+};
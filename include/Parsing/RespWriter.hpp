@@ -0,0 +1,212 @@
+#pragma once
+#include <algorithm>
+#include <cerrno>
+#include <charconv>
+#include <climits>
+#include <cstddef>
+#include <string>
+#include <string_view>
+#include <sys/uio.h>
+#include <vector>
+
+/*
+A RESP bulk string that is encoded at compile time, for the constant tokens
+of commands:
+
+  inline constexpr auto kRespXadd = EncodeRespBulkString("XADD");
+*/
+template <std::size_t Capacity> class RespConstant {
+public:
+  constexpr explicit RespConstant(std::string_view value) : data_{}, size_{0} {
+    data_[size_++] = '$';
+    char digits[20] = {};
+    std::size_t number_of_digits = 0;
+    std::size_t length = value.size();
+    do {
+      digits[number_of_digits++] = static_cast<char>('0' + length % 10);
+      length /= 10;
+    } while (length != 0);
+    while (number_of_digits != 0) {
+      data_[size_++] = digits[--number_of_digits];
+    }
+    data_[size_++] = '\r';
+    data_[size_++] = '\n';
+    for (char character : value) {
+      data_[size_++] = character;
+    }
+    data_[size_++] = '\r';
+    data_[size_++] = '\n';
+  }
+
+  constexpr std::string_view View() const { return {data_, size_}; }
+
+private:
+  char data_[Capacity];
+  std::size_t size_;
+};
+
+// The value of a string literal, with its terminating null character, as a
+// RespConstant.
+template <std::size_t N>
+constexpr RespConstant<N + 24> EncodeRespBulkString(const char (&value)[N]) {
+  return RespConstant<N + 24>(std::string_view(value, N - 1));
+}
+
+inline constexpr auto kRespXadd = EncodeRespBulkString("XADD");
+inline constexpr auto kRespXack = EncodeRespBulkString("XACK");
+inline constexpr auto kRespAutoGeneratedId = EncodeRespBulkString("*");
+inline constexpr auto kRespSubscribe = EncodeRespBulkString("SUBSCRIBE");
+inline constexpr auto kRespShardedSubscribe =
+    EncodeRespBulkString("SSUBSCRIBE");
+inline constexpr auto kRespPublish = EncodeRespBulkString("PUBLISH");
+
+/*
+Serializes RESP commands into a buffer that is owned by the caller, so a
+buffer that is cleared and reused for every command stops allocating once it
+has grown to the size of the largest command.
+
+Lengths and integers are formatted with std::to_chars, and the constant
+tokens of a command can be appended as RespConstants, which are encoded at
+compile time.
+
+Bulk strings that are appended by reference are not copied: only their
+headers are written to the buffer, and FillIoVectors() or WriteTo() send
+their bytes from where they are, with writev(). They have to stay valid
+until the command was written.
+*/
+class RespWriter {
+public:
+  explicit RespWriter(std::string &buffer) : buffer_(buffer) {}
+
+  RespWriter(const RespWriter &) = delete;
+  RespWriter &operator=(const RespWriter &) = delete;
+
+  // Starts the next command, keeping the capacity of the buffers.
+  void Clear() {
+    buffer_.clear();
+    references_.clear();
+  }
+
+  void AppendArrayHeader(std::size_t number_of_elements) {
+    AppendHeader('*', number_of_elements);
+  }
+
+  void AppendBulkString(std::string_view value) {
+    AppendHeader('$', value.size());
+    buffer_ += value;
+    buffer_ += "\r\n";
+  }
+
+  // An integer as a bulk string, the way Redis expects integer arguments.
+  void AppendBulkString(long long value) {
+    char digits[24];
+    const auto result = std::to_chars(digits, digits + sizeof(digits), value);
+    AppendBulkString(std::string_view(digits, result.ptr - digits));
+  }
+
+  template <std::size_t Capacity>
+  void Append(const RespConstant<Capacity> &constant) {
+    buffer_ += constant.View();
+  }
+
+  // Appends a bulk string whose bytes are not copied into the buffer.
+  void AppendBulkStringReference(std::string_view value) {
+    AppendHeader('$', value.size());
+    references_.push_back({buffer_.size(), value});
+    buffer_ += "\r\n";
+  }
+
+  // The serialized commands. Only complete when nothing was appended by
+  // reference.
+  std::string_view View() const { return buffer_; }
+
+  bool HasReferences() const { return !references_.empty(); }
+
+  // The buffer and the referenced bulk strings in the order in which they
+  // are sent. Returns the number of bytes that they add up to.
+  std::size_t FillIoVectors(std::vector<iovec> &io_vectors) const {
+    io_vectors.clear();
+    std::size_t buffer_position = 0;
+    for (const Reference &reference : references_) {
+      AddIoVector(io_vectors, buffer_.data() + buffer_position,
+                  reference.buffer_position - buffer_position);
+      AddIoVector(io_vectors, reference.value.data(), reference.value.size());
+      buffer_position = reference.buffer_position;
+    }
+    AddIoVector(io_vectors, buffer_.data() + buffer_position,
+                buffer_.size() - buffer_position);
+    return buffer_.size() + GetReferencedSize();
+  }
+
+  // Writes the commands to a blocking socket with as few writev() calls as
+  // possible. Returns false, with errno set, when a write fails.
+  [[nodiscard]] bool WriteTo(int file_descriptor) {
+    FillIoVectors(io_vectors_);
+    std::size_t first_io_vector = 0;
+    while (first_io_vector < io_vectors_.size()) {
+      const int number_of_io_vectors = static_cast<int>(
+          std::min<std::size_t>(io_vectors_.size() - first_io_vector, IOV_MAX));
+      ssize_t bytes_written = writev(
+          file_descriptor, &io_vectors_[first_io_vector], number_of_io_vectors);
+      if (bytes_written < 0) {
+        if (errno == EINTR) {
+          continue;
+        }
+        return false;
+      }
+      // Skips the io vectors that were written and the written part of the
+      // first one that was not.
+      while (first_io_vector < io_vectors_.size() &&
+             static_cast<std::size_t>(bytes_written) >=
+                 io_vectors_[first_io_vector].iov_len) {
+        bytes_written -= io_vectors_[first_io_vector].iov_len;
+        ++first_io_vector;
+      }
+      if (bytes_written > 0) {
+        iovec &io_vector = io_vectors_[first_io_vector];
+        io_vector.iov_base = static_cast<char *>(io_vector.iov_base) +
+                             bytes_written;
+        io_vector.iov_len -= bytes_written;
+      }
+    }
+    return true;
+  }
+
+private:
+  // A bulk string whose bytes belong at buffer_position, in front of the
+  // bulk string's terminating CRLF.
+  struct Reference {
+    std::size_t buffer_position;
+    std::string_view value;
+  };
+
+  void AppendHeader(char type, std::size_t size) {
+    char header[24];
+    header[0] = type;
+    const auto result = std::to_chars(header + 1, header + sizeof(header) - 2,
+                                      size);
+    char *end = result.ptr;
+    *end++ = '\r';
+    *end++ = '\n';
+    buffer_.append(header, end - header);
+  }
+
+  static void AddIoVector(std::vector<iovec> &io_vectors, const char *data,
+                          std::size_t size) {
+    if (size != 0) {
+      io_vectors.push_back({const_cast<char *>(data), size});
+    }
+  }
+
+  std::size_t GetReferencedSize() const {
+    std::size_t size = 0;
+    for (const Reference &reference : references_) {
+      size += reference.value.size();
+    }
+    return size;
+  }
+
+  std::string &buffer_;
+  std::vector<Reference> references_;
+  std::vector<iovec> io_vectors_;
+};
@@ -1,14 +1,130 @@
 #pragma once
 #include <algorithm>
+#include <climits>
+#include <cstring>
 #include <fstream>
 #include <iostream>
 #include <sstream>
 #include <string>
 #include <unordered_map>
 #include <unordered_set>
+#include <unistd.h>
+#include <vector>
 
+#include "../Consumer/ChannelTable.hpp"
+#include "../Consumer/ConsumerOptions.hpp"
+#include "../Consumer/StreamGroupSubscription.hpp"
 #include "../common.hpp"
 
+[[nodiscard]] bool ParseDispatchMode(const std::string &name,
+                                     DispatchMode &dispatch_mode) {
+  if (name == "round_robin") {
+    dispatch_mode = DispatchMode::RoundRobin;
+  } else if (name == "key_affine") {
+    dispatch_mode = DispatchMode::KeyAffine;
+  } else if (name == "work_stealing") {
+    dispatch_mode = DispatchMode::WorkStealing;
+  } else {
+    return false;
+  }
+  return true;
+}
+
+[[nodiscard]] bool ParseOverloadPolicy(const std::string &name,
+                                       OverloadPolicy &overload_policy) {
+  if (name == "block") {
+    overload_policy = OverloadPolicy::Block;
+  } else if (name == "drop_newest") {
+    overload_policy = OverloadPolicy::DropNewest;
+  } else if (name == "drop_oldest") {
+    overload_policy = OverloadPolicy::DropOldest;
+  } else if (name == "sample") {
+    overload_policy = OverloadPolicy::Sample;
+  } else {
+    return false;
+  }
+  return true;
+}
+
+[[nodiscard]] bool ParseIoEngine(const std::string &name,
+                                 IoEngine &io_engine) {
+  if (name == "threads") {
+    io_engine = IoEngine::Threads;
+  } else if (name == "epoll") {
+    io_engine = IoEngine::Epoll;
+  } else if (name == "io_uring") {
+    io_engine = IoEngine::IoUring;
+  } else {
+    return false;
+  }
+  return true;
+}
+
+[[nodiscard]] bool ParseIngestMode(const std::string &name,
+                                   IngestMode &ingest_mode) {
+  if (name == "pubsub") {
+    ingest_mode = IngestMode::PubSub;
+  } else if (name == "stream") {
+    ingest_mode = IngestMode::Stream;
+  } else {
+    return false;
+  }
+  return true;
+}
+
+[[nodiscard]] bool ParseTimestampClock(const std::string &name,
+                                       TimestampClock &timestamp_clock) {
+  if (name == "realtime") {
+    timestamp_clock = TimestampClock::Realtime;
+  } else if (name == "realtime_coarse") {
+    timestamp_clock = TimestampClock::RealtimeCoarse;
+  } else {
+    return false;
+  }
+  return true;
+}
+
+[[nodiscard]] bool ParseTimestampFormat(const std::string &name,
+                                        TimestampFormat &timestamp_format) {
+  if (name == "date_time") {
+    timestamp_format = TimestampFormat::DateTime;
+  } else if (name == "epoch_ns") {
+    timestamp_format = TimestampFormat::EpochNanoseconds;
+  } else {
+    return false;
+  }
+  return true;
+}
+
+// Splits a comma separated list of subscriptions. Every entry is a channel
+// or pattern name, optionally followed by "->" and the name of its processing
+// stream. Returns false when an entry has an empty name or stream.
+[[nodiscard]] bool
+ParseChannelSubscriptions(const std::string &list, bool is_pattern,
+                          const std::string &default_processing_stream,
+                          std::vector<ChannelSubscription> &subscriptions) {
+  std::stringstream list_stream(list);
+  std::string entry;
+  while (std::getline(list_stream, entry, ',')) {
+    ChannelSubscription subscription;
+    subscription.is_pattern = is_pattern;
+    subscription.processing_stream = default_processing_stream;
+    std::size_t arrow_position = entry.find("->");
+    subscription.name = entry.substr(0, arrow_position);
+    if (arrow_position != std::string::npos) {
+      subscription.processing_stream = entry.substr(arrow_position + 2);
+      if (subscription.processing_stream.empty()) {
+        return false;
+      }
+    }
+    if (subscription.name.empty()) {
+      return false;
+    }
+    subscriptions.push_back(std::move(subscription));
+  }
+  return true;
+}
+
 [[nodiscard]] std::unordered_map<std::string, std::string>
 CreateDefaultConfiguration() {
   std::unordered_map<std::string, std::string> config;
@@ -22,6 +138,16 @@ CreateDefaultConfiguration() {
   config[CFG_KEY_PROC_STREAM] = "messages:processed";
   // Monitoring interval in seconds
   config[CFG_KEY_MONITORING_INTERVAL] = "3";
+  // Pipelining of the XADD commands
+  config[CFG_KEY_XADD_PIPELINE_DEPTH] =
+      std::to_string(ConsumerOptions{}.xadd_pipeline_depth);
+  // Hand-off of the messages to the broker's workers
+  config[CFG_KEY_DISPATCH_MODE] = "round_robin";
+  config[CFG_KEY_ROUTING_KEY] = ConsumerOptions{}.routing_key;
+  // The I/O engine for the Redis connections
+  config[CFG_KEY_IO_ENGINE] = "threads";
+  config[CFG_KEY_REACTOR_THREADS] =
+      std::to_string(ConsumerOptions{}.number_of_reactor_threads);
 
   std::cout << "Created a default configuration." << std::endl;
   return config;
@@ -147,8 +273,273 @@ CreateCustomConfiguration(int number_of_consumers = 0) {
       }
     }
 
+    // The optional integer parameters are only validated when present and
+    // have to be positive.
+    for (const char *parameter :
+         {CFG_KEY_XADD_PIPELINE_DEPTH, CFG_KEY_REACTOR_THREADS,
+          CFG_KEY_XREADGROUP_COUNT, CFG_KEY_XREADGROUP_BLOCK,
+          CFG_KEY_BROKER_QUEUE_CAPACITY, CFG_KEY_OVERLOAD_SAMPLE_INTERVAL,
+          CFG_KEY_SPILL_SEGMENT_SIZE_MB, CFG_KEY_SPILL_MAX_SEGMENTS,
+          CFG_KEY_JOURNAL_SEGMENT_SIZE_MB, CFG_KEY_JOURNAL_COMMIT_INTERVAL,
+          CFG_KEY_JOURNAL_COMMIT_RECORDS}) {
+      if (config.find(parameter) == config.end()) {
+        continue;
+      }
+      std::stringstream ss(config.at(parameter));
+      unsigned int buffer{0};
+      ss >> buffer;
+
+      if (ss.fail() || buffer == 0 ||
+          (config.at(parameter) != std::to_string(buffer))) {
+        std::cerr << " The value of parameter " << parameter
+                  << " is invalid. Value (" << config.at(parameter) << ")"
+                  << std::endl;
+        all_numeric_values_are_valid = false;
+      }
+    }
+
+    // The metrics port is optional and 0 disables the exporter.
+    if (auto it = config.find(CFG_KEY_METRICS_PORT); it != config.end()) {
+      std::stringstream ss(it->second);
+      unsigned short buffer{0};
+      ss >> buffer;
+
+      if (ss.fail() || (it->second != std::to_string(buffer))) {
+        std::cerr << " The value of parameter " << CFG_KEY_METRICS_PORT
+                  << " is invalid. Value (" << it->second << ")" << std::endl;
+        all_numeric_values_are_valid = false;
+      }
+    }
+
+    if (auto it = config.find(CFG_KEY_DISPATCH_MODE); it != config.end()) {
+      DispatchMode dispatch_mode;
+      if (!ParseDispatchMode(it->second, dispatch_mode)) {
+        std::cerr << " The value of parameter " << CFG_KEY_DISPATCH_MODE
+                  << " is invalid. Value (" << it->second
+                  << "). Expected round_robin, key_affine or work_stealing."
+                  << std::endl;
+        return false;
+      }
+    }
+    if (auto it = config.find(CFG_KEY_OVERLOAD_POLICY); it != config.end()) {
+      OverloadPolicy overload_policy;
+      if (!ParseOverloadPolicy(it->second, overload_policy)) {
+        std::cerr << " The value of parameter " << CFG_KEY_OVERLOAD_POLICY
+                  << " is invalid. Value (" << it->second
+                  << "). Expected block, drop_newest, drop_oldest or sample."
+                  << std::endl;
+        return false;
+      }
+    }
+    if (auto it = config.find(CFG_KEY_IO_ENGINE); it != config.end()) {
+      IoEngine io_engine;
+      if (!ParseIoEngine(it->second, io_engine)) {
+        std::cerr << " The value of parameter " << CFG_KEY_IO_ENGINE
+                  << " is invalid. Value (" << it->second
+                  << "). Expected threads, epoll or io_uring." << std::endl;
+        return false;
+      }
+    }
+    if (auto it = config.find(CFG_KEY_INGEST_MODE); it != config.end()) {
+      IngestMode ingest_mode;
+      if (!ParseIngestMode(it->second, ingest_mode)) {
+        std::cerr << " The value of parameter " << CFG_KEY_INGEST_MODE
+                  << " is invalid. Value (" << it->second
+                  << "). Expected pubsub or stream." << std::endl;
+        return false;
+      }
+    }
+    if (auto it = config.find(CFG_KEY_TIMESTAMP_CLOCK); it != config.end()) {
+      TimestampClock timestamp_clock;
+      if (!ParseTimestampClock(it->second, timestamp_clock)) {
+        std::cerr << " The value of parameter " << CFG_KEY_TIMESTAMP_CLOCK
+                  << " is invalid. Value (" << it->second
+                  << "). Expected realtime or realtime_coarse." << std::endl;
+        return false;
+      }
+    }
+    if (auto it = config.find(CFG_KEY_TIMESTAMP_FORMAT); it != config.end()) {
+      TimestampFormat timestamp_format;
+      if (!ParseTimestampFormat(it->second, timestamp_format)) {
+        std::cerr << " The value of parameter " << CFG_KEY_TIMESTAMP_FORMAT
+                  << " is invalid. Value (" << it->second
+                  << "). Expected date_time or epoch_ns." << std::endl;
+        return false;
+      }
+    }
+    for (const char *parameter :
+         {CFG_KEY_INGEST_STREAM, CFG_KEY_CONSUMER_GROUP,
+          CFG_KEY_CONSUMER_NAME}) {
+      if (auto it = config.find(parameter);
+          it != config.end() && it->second.empty()) {
+        std::cerr << " The value of parameter " << parameter << " is empty."
+                  << std::endl;
+        return false;
+      }
+    }
+    if (auto it = config.find(CFG_KEY_SHARDED_PUBSUB);
+        it != config.end() && it->second != "true" && it->second != "false") {
+      std::cerr << " The value of parameter " << CFG_KEY_SHARDED_PUBSUB
+                << " is invalid. Value (" << it->second
+                << "). Expected true or false." << std::endl;
+      return false;
+    }
+    if (auto it = config.find(CFG_KEY_ROUTING_KEY);
+        it != config.end() && it->second.empty()) {
+      std::cerr << " The value of parameter " << CFG_KEY_ROUTING_KEY
+                << " is empty." << std::endl;
+      return false;
+    }
+    for (const char *parameter :
+         {CFG_KEY_SUB_CHANNELS, CFG_KEY_SUB_PATTERNS}) {
+      std::vector<ChannelSubscription> subscriptions;
+      if (auto it = config.find(parameter);
+          it != config.end() &&
+          !ParseChannelSubscriptions(it->second, false, "", subscriptions)) {
+        std::cerr << " The value of parameter " << parameter
+                  << " is invalid. Value (" << it->second
+                  << "). Expected a comma separated list of names, each one "
+                     "optionally followed by ->stream."
+                  << std::endl;
+        return false;
+      }
+    }
+
     return all_numeric_values_are_valid;
   } catch (...) {
     return false;
   }
-}
\ No newline at end of file
+}
+
+// Creates the consumers' options from a validated configuration. Optional keys
+// that are missing keep their default values.
+[[nodiscard]] ConsumerOptions CreateConsumerOptions(
+    const std::unordered_map<std::string, std::string> &config) {
+  ConsumerOptions options;
+  if (auto it = config.find(CFG_KEY_XADD_PIPELINE_DEPTH); it != config.end()) {
+    options.xadd_pipeline_depth = std::stoul(it->second);
+  }
+  if (auto it = config.find(CFG_KEY_DISPATCH_MODE); it != config.end()) {
+    (void)ParseDispatchMode(it->second, options.dispatch_mode);
+  }
+  if (auto it = config.find(CFG_KEY_ROUTING_KEY); it != config.end()) {
+    options.routing_key = it->second;
+  }
+  if (auto it = config.find(CFG_KEY_BROKER_QUEUE_CAPACITY);
+      it != config.end()) {
+    options.broker_queue_capacity = std::stoul(it->second);
+  }
+  if (auto it = config.find(CFG_KEY_OVERLOAD_POLICY); it != config.end()) {
+    (void)ParseOverloadPolicy(it->second, options.overload_policy);
+  }
+  if (auto it = config.find(CFG_KEY_OVERLOAD_SAMPLE_INTERVAL);
+      it != config.end()) {
+    options.overload_sample_interval = std::stoul(it->second);
+  }
+  if (auto it = config.find(CFG_KEY_SPILL_DIRECTORY); it != config.end()) {
+    options.spill_directory = it->second;
+  }
+  if (auto it = config.find(CFG_KEY_SPILL_SEGMENT_SIZE_MB);
+      it != config.end()) {
+    options.spill_segment_size = std::stoul(it->second) * 1024 * 1024;
+  }
+  if (auto it = config.find(CFG_KEY_SPILL_MAX_SEGMENTS); it != config.end()) {
+    options.spill_max_segments = std::stoul(it->second);
+  }
+  if (auto it = config.find(CFG_KEY_JOURNAL_DIRECTORY); it != config.end()) {
+    options.journal_directory = it->second;
+  }
+  if (auto it = config.find(CFG_KEY_JOURNAL_SEGMENT_SIZE_MB);
+      it != config.end()) {
+    options.journal_segment_size = std::stoul(it->second) * 1024 * 1024;
+  }
+  if (auto it = config.find(CFG_KEY_JOURNAL_COMMIT_INTERVAL);
+      it != config.end()) {
+    options.journal_commit_interval_in_milliseconds = std::stoul(it->second);
+  }
+  if (auto it = config.find(CFG_KEY_JOURNAL_COMMIT_RECORDS);
+      it != config.end()) {
+    options.journal_commit_records = std::stoul(it->second);
+  }
+  if (auto it = config.find(CFG_KEY_IO_ENGINE); it != config.end()) {
+    (void)ParseIoEngine(it->second, options.io_engine);
+  }
+  if (auto it = config.find(CFG_KEY_REACTOR_THREADS); it != config.end()) {
+    options.number_of_reactor_threads = std::stoul(it->second);
+  }
+  if (auto it = config.find(CFG_KEY_SHARDED_PUBSUB); it != config.end()) {
+    options.sharded_pubsub = it->second == "true";
+  }
+  if (auto it = config.find(CFG_KEY_INGEST_MODE); it != config.end()) {
+    (void)ParseIngestMode(it->second, options.ingest_mode);
+  }
+  if (auto it = config.find(CFG_KEY_XREADGROUP_COUNT); it != config.end()) {
+    options.xreadgroup_count = std::stoul(it->second);
+  }
+  if (auto it = config.find(CFG_KEY_XREADGROUP_BLOCK); it != config.end()) {
+    options.xreadgroup_block_in_milliseconds = std::stoul(it->second);
+  }
+  if (auto it = config.find(CFG_KEY_TIMESTAMP_CLOCK); it != config.end()) {
+    (void)ParseTimestampClock(it->second, options.timestamp_clock);
+  }
+  if (auto it = config.find(CFG_KEY_TIMESTAMP_FORMAT); it != config.end()) {
+    (void)ParseTimestampFormat(it->second, options.timestamp_format);
+  }
+  return options;
+}
+
+// Creates the subscriptions of a validated configuration: the default
+// subscription channel, followed by the optional lists of channels and
+// patterns. The default processing stream is used by the entries that do not
+// name their own, and the channels that appear more than once are only
+// subscribed to once.
+[[nodiscard]] std::vector<ChannelSubscription> CreateChannelSubscriptions(
+    const std::unordered_map<std::string, std::string> &config) {
+  const std::string &default_processing_stream =
+      config.at(CFG_KEY_PROC_STREAM);
+  std::vector<ChannelSubscription> subscriptions;
+  (void)ParseChannelSubscriptions(config.at(CFG_KEY_SUB_CHANNEL), false,
+                                  default_processing_stream, subscriptions);
+  if (auto it = config.find(CFG_KEY_SUB_CHANNELS); it != config.end()) {
+    (void)ParseChannelSubscriptions(it->second, false,
+                                    default_processing_stream, subscriptions);
+  }
+  if (auto it = config.find(CFG_KEY_SUB_PATTERNS); it != config.end()) {
+    (void)ParseChannelSubscriptions(it->second, true,
+                                    default_processing_stream, subscriptions);
+  }
+
+  ChannelTable unique_subscriptions;
+  std::vector<ChannelSubscription> result;
+  for (ChannelSubscription &subscription : subscriptions) {
+    if (unique_subscriptions.Add(
+            {subscription.name, subscription.is_pattern})) {
+      result.push_back(std::move(subscription));
+    }
+  }
+  return result;
+}
+
+// Creates the consumer group subscription of a validated configuration. The
+// stream defaults to the default subscription channel's name, the group to
+// "processors" and the consumer to the name of the host, so that a restarted
+// consumer reads the entries that it has not acknowledged.
+[[nodiscard]] StreamGroupSubscription CreateStreamGroupSubscription(
+    const std::unordered_map<std::string, std::string> &config) {
+  StreamGroupSubscription subscription;
+  auto get_value = [&config](const std::string &key,
+                             const std::string &default_value) {
+    auto it = config.find(key);
+    return it != config.end() ? it->second : default_value;
+  };
+  subscription.stream =
+      get_value(CFG_KEY_INGEST_STREAM, config.at(CFG_KEY_SUB_CHANNEL));
+  subscription.group = get_value(CFG_KEY_CONSUMER_GROUP, "processors");
+  char hostname[HOST_NAME_MAX + 1] = {};
+  if (gethostname(hostname, sizeof(hostname) - 1) != 0) {
+    std::strcpy(hostname, "consumer");
+  }
+  subscription.consumer = get_value(CFG_KEY_CONSUMER_NAME, hostname);
+  subscription.processing_stream = config.at(CFG_KEY_PROC_STREAM);
+  return subscription;
+}
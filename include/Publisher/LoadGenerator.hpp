@@ -0,0 +1,240 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <random>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "../Monitoring/LatencyHistogram.hpp"
+#include "../Parsing/RespReader.hpp"
+
+enum class LoadMode {
+  // Publishes at a fixed rate, whether or not the server keeps up.
+  OpenLoop,
+  // Keeps a fixed number of PUBLISH commands awaiting a reply.
+  ClosedLoop
+};
+
+struct LoadGeneratorOptions {
+  std::string redis_server_hostname = "127.0.0.1";
+  unsigned short redis_server_port = 6379;
+  std::string channel = "messages:published";
+  // The stream that the consumers add the processed messages to. Empty to
+  // only publish.
+  std::string processed_stream = "messages:processed";
+  LoadMode mode = LoadMode::OpenLoop;
+  // Open loop only.
+  double messages_per_second = 100000;
+  // The number of PUBLISH commands awaiting a reply in closed loop, and the
+  // most that are sent with a single write in open loop.
+  std::size_t pipeline_depth = 64;
+  std::chrono::milliseconds duration{10000};
+  // The sizes of the payloads are evenly distributed between the two.
+  std::size_t minimum_payload_size = 128;
+  std::size_t maximum_payload_size = 512;
+  // How long to wait for the processed messages after the last PUBLISH.
+  std::chrono::milliseconds drain_timeout{5000};
+  std::uint64_t seed = 1;
+};
+
+/*
+What identifies a published message in the processed stream, which only
+keeps its message_id: the run that published it, its sequence number from 1
+on, and the times (of the system clock, in nanoseconds) at which it was
+meant to be and was published.
+*/
+struct LoadMessageId {
+  std::uint64_t run_id;
+  std::uint64_t sequence;
+  std::int64_t intended_publish_time_ns;
+  std::int64_t publish_time_ns;
+};
+
+// Appends the message_id "<run>-<sequence>-<intended time>-<publish time>".
+void AppendLoadMessageId(std::string &message_id, const LoadMessageId &id);
+
+// Returns false when the message_id was not appended by
+// AppendLoadMessageId().
+[[nodiscard]] bool ParseLoadMessageId(std::string_view message_id,
+                                      LoadMessageId &id);
+
+// Replaces the payload with the JSON object
+//   {"message_id":"...","sequence":N,"publish_time_ns":T,"padding":"xx..."}
+// which is padded to the given size, unless it is larger without padding.
+void FormatLoadMessage(std::string &payload, const LoadMessageId &id,
+                       std::size_t size);
+
+// The time after the start at which the message with the sequence number is
+// published at the given rate.
+inline std::int64_t GetIntendedPublishOffset(double messages_per_second,
+                                             std::uint64_t sequence) {
+  return std::llround((sequence - 1) * (1e9 / messages_per_second));
+}
+
+// The number of messages that are due at the given time after the start.
+inline std::uint64_t GetNumberOfDueMessages(double messages_per_second,
+                                            std::int64_t elapsed_time_ns) {
+  if (elapsed_time_ns < 0) {
+    return 0;
+  }
+  return static_cast<std::uint64_t>(elapsed_time_ns * messages_per_second /
+                                    1e9) +
+         1;
+}
+
+// A range of consecutive sequence numbers that were not received.
+struct SequenceGap {
+  std::uint64_t first;
+  std::uint64_t last;
+};
+
+/*
+Tracks which sequence numbers were received, in a bitmap, to find the
+duplicates, the messages that arrived after one with a higher sequence number,
+and the gaps that the lost messages leave.
+*/
+class SequenceTracker {
+public:
+  // Returns false when the sequence number was already received.
+  bool Record(std::uint64_t sequence) {
+    const std::size_t word_index = sequence / 64;
+    if (word_index >= words_.size()) {
+      words_.resize(std::max(word_index + 1, 2 * words_.size()));
+    }
+    const std::uint64_t bit = std::uint64_t{1} << (sequence % 64);
+    if (words_[word_index] & bit) {
+      ++number_of_duplicates_;
+      return false;
+    }
+    words_[word_index] |= bit;
+    ++number_of_received_;
+    if (sequence < highest_sequence_) {
+      ++number_of_reordered_;
+    } else {
+      highest_sequence_ = sequence;
+    }
+    return true;
+  }
+
+  bool Contains(std::uint64_t sequence) const {
+    const std::size_t word_index = sequence / 64;
+    return word_index < words_.size() &&
+           (words_[word_index] >> (sequence % 64) & 1) != 0;
+  }
+
+  // The ranges of the sequence numbers from 1 to last_sequence that were not
+  // received, in ascending order.
+  std::vector<SequenceGap> GetGaps(std::uint64_t last_sequence) const;
+
+  long long GetNumberOfReceived() const { return number_of_received_; }
+  long long GetNumberOfDuplicates() const { return number_of_duplicates_; }
+  long long GetNumberOfReordered() const { return number_of_reordered_; }
+
+private:
+  std::vector<std::uint64_t> words_;
+  std::uint64_t highest_sequence_ = 0;
+  long long number_of_received_ = 0;
+  long long number_of_duplicates_ = 0;
+  long long number_of_reordered_ = 0;
+};
+
+struct LoadResults {
+  long long number_of_published_messages;
+  double publishing_time_in_seconds;
+  // The PUBLISH commands that failed, and those that reached no subscriber.
+  long long number_of_publish_errors;
+  long long number_of_unsubscribed_messages;
+  // Open loop: how far the publisher fell behind its schedule at most.
+  std::int64_t maximum_schedule_lag_ns;
+  // The messages of this run that were found in the processed stream.
+  long long number_of_processed_messages;
+  long long number_of_duplicates;
+  long long number_of_reordered;
+  std::vector<SequenceGap> gaps;
+  // From the time at which a message was meant to be published until it was
+  // read from the processed stream. In open loop, this includes the time
+  // that the message waited because the publisher was held up, so a stall
+  // counts for every message that it delayed (coordinated omission).
+  LatencySnapshot latencies;
+  // From the time at which a message was really published.
+  LatencySnapshot uncorrected_latencies;
+};
+
+/*
+Publishes JSON messages of varying size to a channel, as pipelined PUBLISH
+commands, and measures how long they take to come out of the consumers by
+reading their message_ids back from the processed stream.
+
+The PUBLISH replies are read on a thread of their own, so the publisher
+never waits for them in open loop. The processed stream is read by another
+thread over a second connection, with blocking XREADs from the last entry
+that was in the stream before the run.
+*/
+class LoadGenerator {
+public:
+  explicit LoadGenerator(LoadGeneratorOptions options);
+  ~LoadGenerator();
+
+  LoadGenerator(const LoadGenerator &) = delete;
+  LoadGenerator &operator=(const LoadGenerator &) = delete;
+
+  [[nodiscard]] bool Connect();
+
+  // Publishes for the configured duration and then waits for the processed
+  // messages. Returns false when a connection failed.
+  [[nodiscard]] bool Run();
+
+  const LoadResults &GetResults() const { return results_; }
+
+  const std::string &GetLastError() const { return last_error_; }
+
+private:
+  // Publishes the next messages with a single write.
+  [[nodiscard]] bool Publish(std::uint64_t number_of_messages);
+  [[nodiscard]] bool RunOpenLoop();
+  [[nodiscard]] bool RunClosedLoop();
+  void ReadPublishReplies();
+  void ReadProcessedStream();
+  // Reads the ID of the last entry of the processed stream.
+  [[nodiscard]] bool ReadLastStreamId();
+
+  const LoadGeneratorOptions options_;
+  const std::uint64_t run_id_;
+  std::mt19937_64 random_engine_;
+  std::uniform_int_distribution<std::size_t> payload_size_distribution_;
+
+  int publish_file_descriptor_;
+  int stream_file_descriptor_;
+  RespReader publish_reader_;
+  RespReader stream_reader_;
+  std::string command_;
+  std::string payload_;
+  std::string stream_command_;
+  std::string last_stream_id_;
+
+  std::int64_t start_time_ns_;
+  std::int64_t start_system_time_ns_;
+  std::uint64_t next_sequence_;
+  std::int64_t maximum_schedule_lag_ns_;
+
+  std::atomic<long long> number_of_published_messages_;
+  std::atomic<long long> number_of_replies_;
+  std::atomic<bool> is_publishing_done_;
+  std::atomic<std::int64_t> publishing_end_time_ns_;
+  // Only written by the threads that read the replies and the stream, and
+  // read once they were joined.
+  long long number_of_publish_errors_;
+  long long number_of_unsubscribed_messages_;
+  std::string stream_error_;
+  SequenceTracker sequence_tracker_;
+  LatencyHistogram latencies_;
+  LatencyHistogram uncorrected_latencies_;
+
+  LoadResults results_;
+  std::string last_error_;
+};
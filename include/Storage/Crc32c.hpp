@@ -0,0 +1,14 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+
+// CRC-32C (Castagnoli) of the bytes, continuing from crc, the checksum of the
+// bytes that came before. Uses the crc32 instruction of SSE 4.2 where the
+// processor has it, and a table otherwise.
+std::uint32_t Crc32c(const void *data, std::size_t size,
+                     std::uint32_t crc = 0);
+
+// Copies size bytes from source to destination, which do not overlap, and
+// returns their CRC-32C like Crc32c(), reading the bytes only once.
+std::uint32_t Crc32cCopy(void *destination, const void *source,
+                         std::size_t size, std::uint32_t crc = 0);
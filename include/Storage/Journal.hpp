@@ -0,0 +1,223 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <initializer_list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include "../Concurrency/MpmcRingBuffer.hpp"
+#include "../Logging/Logger.hpp"
+#include "MappedFile.hpp"
+
+/*
+A write-ahead journal of records that have to survive a crash until they are
+marked complete.
+
+A single producer appends every record to memory-mapped segment files, front
+to back, as its length, a CRC-32C checksum, its sequence number and its
+payload. A new segment is started when a record does not fit into the current
+one. The committer thread prepares the next segment ahead of time and faults
+in the pages ahead of the producer, so appending usually copies and
+checksums the record in one pass, without a lock, a system call or a page
+fault.
+
+The records are made durable in groups: a committer thread flushes the
+segments with fdatasync() every commit interval, or sooner, once the given
+number of records was appended since the last commit. Any thread can mark a
+record complete. The committer then advances the low-water mark below which
+every record is complete, persists it in a checkpoint file and deletes the
+segments that only hold complete records.
+
+On the next start, Open() recovers the records above the checkpoint that
+have a valid checksum, up to the first torn or corrupt record of every
+segment. They can be replayed, e.g. appended again and handed to the
+workers, and then discarded. A record can be recovered although it was
+completed shortly before the crash, so it is delivered at least once.
+*/
+class Journal {
+public:
+  Journal(std::string directory, std::size_t segment_size,
+          std::chrono::milliseconds commit_interval,
+          std::size_t records_per_commit);
+  ~Journal();
+
+  Journal(const Journal &) = delete;
+  Journal &operator=(const Journal &) = delete;
+
+  // Recovers the records of the previous run, creates the first segment and
+  // starts the committer thread.
+  [[nodiscard]] bool Open();
+
+  // The number of records that were recovered by Open() and not discarded
+  // yet.
+  std::size_t GetNumberOfRecoveredRecords() const {
+    return number_of_recovered_records_;
+  }
+
+  // Calls replay_record with the payload of every recovered record, in the
+  // order in which they were appended. The payload is only valid during the
+  // call.
+  [[nodiscard]] bool ReplayRecoveredRecords(
+      const std::function<void(std::string_view)> &replay_record);
+
+  // Commits the records that were appended so far, which includes the
+  // replayed ones, and deletes the segments of the previous run. Until then,
+  // the checkpoint is not advanced, so a crash during the replay recovers
+  // the same records again.
+  void DiscardRecoveredRecords();
+
+  // Producer only. Appends a record of the parts, one after the other, and
+  // returns its sequence number, or 0 when the record does not fit into a
+  // segment or a new segment could not be created. Waits while the oldest
+  // incomplete record is too far behind.
+  std::uint64_t Append(std::initializer_list<std::string_view> parts);
+
+  // Marks the record complete. Any thread can call it, once per record.
+  void Complete(std::uint64_t sequence) {
+    if (sequence != 0) {
+      completed_[sequence & kCompletionMask].store(1,
+                                                   std::memory_order_release);
+    }
+  }
+
+  // Flushes the appended records to the disk and advances the checkpoint
+  // right away, instead of waiting for the committer thread.
+  void Commit();
+
+  long long GetNumberOfAppendedRecords() const {
+    return number_of_appended_records_.load(std::memory_order_relaxed);
+  }
+
+  // The number of appended records that are not below the low-water mark
+  // yet.
+  long long GetNumberOfPendingRecords() const;
+
+  // The number of commits that flushed records to the disk.
+  long long GetNumberOfCommits() const {
+    return number_of_commits_.load(std::memory_order_relaxed);
+  }
+
+  const std::string &GetLastError() const { return last_error_; }
+
+private:
+  // The errors of the committer thread are only logged.
+  void ReportError(const std::string &error_message) const {
+    LOG(LogLevel::Error, "[Journal] {}", error_message);
+  }
+
+  struct Segment {
+    MappedFile file;
+    std::string path;
+    // Written by the producer, read by the committer.
+    alignas(kCacheLineSize) std::atomic<std::size_t> write_position{0};
+    std::atomic<std::uint64_t> last_sequence{0};
+    // Set once the producer has moved on to the next segment.
+    std::atomic<bool> is_sealed{false};
+    // Only used under the commit lock.
+    std::size_t synced_position = 0;
+    std::size_t populated_position = 0;
+  };
+
+  // The header in front of every record's payload. A size of 0 marks the
+  // end of the records of a segment.
+  struct RecordHeader {
+    // Of the whole record, including the header.
+    std::uint32_t size;
+    // Over the size, the sequence number and the payload.
+    std::uint32_t checksum;
+    std::uint64_t sequence;
+  };
+
+  // Reads the records of a segment that are above the sequence number.
+  // read_record may be empty, to only count them. Returns false when the
+  // file can not be read.
+  bool ReadSegment(const std::string &path, std::uint64_t after_sequence,
+                   const std::function<void(std::string_view)> &read_record,
+                   std::uint64_t &first_sequence, std::uint64_t &last_sequence,
+                   std::size_t &number_of_records);
+  bool ReadCheckpoint();
+  // Commit lock only.
+  bool WriteCheckpoint(std::uint64_t sequence);
+  std::unique_ptr<Segment> CreateSegment(std::string &error);
+  // Commit lock only. Creates the segment that the producer starts next and
+  // faults in its first pages.
+  void PrepareSegment();
+  // Commit lock only. Faults in the pages up to kPopulatedSize ahead of the
+  // write position.
+  void PopulateSegment(Segment &segment, std::size_t write_position);
+  // Committer only. Keeps the pages ahead of the producer faulted in and the
+  // next segment prepared, after a commit rather than as part of it.
+  void PrepareAppends();
+  // Moves the producer on to the prepared or a new segment.
+  bool StartSegment();
+  // Makes the names of the created segments durable.
+  void SyncDirectory() const;
+  void RunCommitter();
+  void RequestCommit();
+
+  // The completion flags are a ring that is indexed by the sequence number,
+  // so the producer waits once the low-water mark is that far behind.
+  static constexpr std::size_t kMaximumNumberOfPendingRecords = 1 << 20;
+  static constexpr std::uint64_t kCompletionMask =
+      kMaximumNumberOfPendingRecords - 1;
+  // How far ahead of the producer the committer faults in the pages of the
+  // segment, which is more than is appended between two commits.
+  static constexpr std::size_t kPopulatedSize = 8 * 1024 * 1024;
+
+  const std::string directory_;
+  const std::size_t segment_size_;
+  const std::chrono::milliseconds commit_interval_;
+  const std::size_t records_per_commit_;
+
+  // The segments of the previous run, in the order of their records, and
+  // their records above its checkpoint.
+  std::vector<std::string> recovered_segment_paths_;
+  std::size_t number_of_recovered_records_;
+  std::uint64_t recovered_checkpoint_;
+
+  // The segments of this run, oldest first. The producer only adds to the
+  // back and the committer only removes from the front, both under the
+  // lock.
+  std::mutex segments_mutex_;
+  std::deque<std::unique_ptr<Segment>> segments_;
+  std::unique_ptr<Segment> prepared_segment_;
+  // The segments are numbered in the order in which they are created.
+  std::uint64_t next_segment_number_;
+  // The producer's segment, the last one of segments_.
+  Segment *write_segment_;
+  // The sequence number of the first record of this run.
+  std::uint64_t first_sequence_;
+  std::uint64_t next_sequence_;
+  std::size_t records_since_commit_request_;
+
+  std::unique_ptr<std::atomic<std::uint8_t>[]> completed_;
+  // Every record up to the low-water mark is complete.
+  alignas(kCacheLineSize) std::atomic<std::uint64_t> low_water_mark_;
+
+  // Serializes the commits of the committer thread and Commit().
+  std::mutex commit_mutex_;
+  std::vector<Segment *> segments_to_sync_;
+  int checkpoint_file_descriptor_;
+  std::uint64_t checkpointed_sequence_;
+  bool has_recovered_records_;
+
+  std::mutex committer_mutex_;
+  std::condition_variable committer_condition_;
+  bool is_commit_requested_;
+  bool stop_;
+  std::thread committer_thread_;
+
+  alignas(kCacheLineSize) std::atomic<long long> number_of_appended_records_;
+  std::atomic<long long> number_of_commits_;
+  // Only set by Open(), the replay and the producer.
+  std::string last_error_;
+};
@@ -0,0 +1,46 @@
+#pragma once
+#include <cstddef>
+#include <string>
+
+/*
+A file of a fixed size that is mapped into memory with MAP_SHARED, so writes
+to the mapping go to the page cache without a system call and the kernel
+writes them back to the disk in the background.
+*/
+class MappedFile {
+public:
+  MappedFile() = default;
+  ~MappedFile();
+
+  MappedFile(const MappedFile &) = delete;
+  MappedFile &operator=(const MappedFile &) = delete;
+
+  // Creates a file of size bytes in the directory and maps it. The file is
+  // unlinked right away, so it never outlives the process, even when it
+  // crashes.
+  [[nodiscard]] bool CreateTemporary(const std::string &directory,
+                                     std::size_t size);
+  // Creates a new file of size bytes at the path and maps it. Fails when the
+  // file exists.
+  [[nodiscard]] bool Create(const std::string &path, std::size_t size);
+  void Close();
+
+  // Faults the pages of the range in for writing, without changing them, so
+  // that the first write to every page does not fault. Does nothing on
+  // kernels without MADV_POPULATE_WRITE (before 5.14).
+  void Populate(std::size_t offset, std::size_t size) const;
+
+  char *GetData() const { return data_; }
+  std::size_t GetSize() const { return size_; }
+  int GetFileDescriptor() const { return file_descriptor_; }
+
+  const std::string &GetLastError() const { return last_error_; }
+
+private:
+  [[nodiscard]] bool Map(std::size_t size);
+
+  int file_descriptor_ = -1;
+  char *data_ = nullptr;
+  std::size_t size_ = 0;
+  std::string last_error_;
+};
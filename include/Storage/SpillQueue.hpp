@@ -0,0 +1,127 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <initializer_list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+
+#include "../Concurrency/MpmcRingBuffer.hpp"
+#include "MappedFile.hpp"
+
+/*
+An overflow queue of records on the disk, for bursts that do not fit into
+the memory.
+
+The records are appended to memory-mapped segment files, front to back, and
+a new segment is started when a record does not fit into the current one. A
+single producer appends without a lock or a system call, except when it
+starts a new segment, and any number of consumers take the records off the
+queue in the order in which they were appended, under a lock.
+
+The segments are unlinked as soon as they are created, so the records do not
+survive the process: the queue absorbs bursts, it does not make them
+durable. A drained segment is kept for reuse, so a queue that is filled and
+drained over and over does not create files.
+*/
+class SpillQueue {
+public:
+  SpillQueue(std::string directory, std::size_t segment_size,
+             std::size_t maximum_number_of_segments);
+
+  SpillQueue(const SpillQueue &) = delete;
+  SpillQueue &operator=(const SpillQueue &) = delete;
+
+  // Creates the first segment.
+  [[nodiscard]] bool Open();
+
+  // Producer only. Appends a record of the parts, one after the other.
+  // Returns false when the record does not fit into a segment, or every
+  // segment is in use, or a new segment could not be created.
+  [[nodiscard]] bool TryAppend(std::initializer_list<std::string_view> parts);
+
+  // Takes the oldest record off the queue and calls read_record with it. The
+  // record is only valid during the call. Returns false when the queue is
+  // empty.
+  template <typename ReadRecord> bool TryPop(ReadRecord &&read_record) {
+    std::lock_guard<std::mutex> lock(consumer_mutex_);
+    std::string_view record;
+    if (!TryReadRecord(record)) {
+      return false;
+    }
+    read_record(record);
+    number_of_popped_records_.store(
+        number_of_popped_records_.load(std::memory_order_relaxed) + 1,
+        std::memory_order_release);
+    return true;
+  }
+
+  bool IsEmpty() const { return GetApproximateSize() == 0; }
+
+  // The number of records on the queue.
+  std::size_t GetApproximateSize() const {
+    const long long number_of_appended_records =
+        number_of_appended_records_.load(std::memory_order_acquire);
+    const long long number_of_popped_records =
+        number_of_popped_records_.load(std::memory_order_acquire);
+    return number_of_appended_records > number_of_popped_records
+               ? number_of_appended_records - number_of_popped_records
+               : 0;
+  }
+
+  // The number of records appended so far.
+  long long GetNumberOfAppendedRecords() const {
+    return number_of_appended_records_.load(std::memory_order_relaxed);
+  }
+
+  // The number of segment files that were created so far.
+  long long GetNumberOfCreatedSegments() const {
+    return number_of_created_segments_.load(std::memory_order_relaxed);
+  }
+
+  const std::string &GetLastError() const { return last_error_; }
+
+private:
+  struct Segment {
+    MappedFile file;
+    // Written by the producer, read by the consumers.
+    alignas(kCacheLineSize) std::atomic<std::size_t> write_position{0};
+    // Set once the producer has moved on to the next segment.
+    std::atomic<bool> is_sealed{false};
+    // Only used under the consumer lock.
+    std::size_t read_position = 0;
+  };
+
+  // Every record starts with its size.
+  using RecordSize = std::uint32_t;
+
+  // Consumer lock only.
+  bool TryReadRecord(std::string_view &record);
+  // Moves the producer on to a spare or a new segment.
+  bool StartSegment();
+
+  const std::string directory_;
+  const std::size_t segment_size_;
+  const std::size_t maximum_number_of_segments_;
+
+  // The segments that hold records, oldest first. The producer only adds to
+  // the back and the consumers only remove from the front, both under the
+  // lock.
+  std::mutex segments_mutex_;
+  std::deque<std::unique_ptr<Segment>> segments_;
+  // A drained segment that the producer can start over with.
+  std::unique_ptr<Segment> spare_segment_;
+  // The producer's segment, the last one of segments_.
+  Segment *write_segment_;
+
+  std::mutex consumer_mutex_;
+
+  alignas(kCacheLineSize) std::atomic<long long> number_of_appended_records_;
+  alignas(kCacheLineSize) std::atomic<long long> number_of_popped_records_;
+  std::atomic<long long> number_of_created_segments_;
+  std::string last_error_;
+};
@@ -0,0 +1,218 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+/*
+An in-process Redis server for tests and benchmarks, which speaks RESP2 on
+the loopback interface and needs neither a redis-server nor hiredis.
+
+It implements what the consumers use: PING, SUBSCRIBE and PSUBSCRIBE with
+pushed messages, PUBLISH, PUBSUB NUMSUB, XADD, XLEN, XGROUP CREATE, XREAD,
+XREADGROUP and XACK. Every connection is served by a thread of its own,
+which answers the commands of every read with a single write, so pipelined
+commands are answered in batches as Redis does.
+
+Faults can be injected while the server runs, and apply to the next read or
+write of every connection:
+  - SetReplyDelay() delays every write of replies.
+  - SetPartialWrites() splits the writes into small pieces, which arrive in
+    separate reads, e.g. in the middle of a reply.
+  - SetSlowReads() reads little at a time and pauses in between, so the
+    client's writes back up.
+  - DisconnectAfterCommands() and DisconnectAll() close connections.
+
+StreamFrames() sends pre-generated pub/sub frames to the subscribers with
+large writes and no per-message work, so a consumer can be measured at the
+rate it can take without the costs of a real server.
+*/
+class MockRedisServer {
+public:
+  MockRedisServer();
+  ~MockRedisServer();
+
+  MockRedisServer(const MockRedisServer &) = delete;
+  MockRedisServer &operator=(const MockRedisServer &) = delete;
+
+  // Listens on the loopback interface. With port 0, the system picks a free
+  // port.
+  [[nodiscard]] bool Start(unsigned short port);
+  // Closes the connections and waits for their threads.
+  void Stop();
+
+  // The port that the server listens on, once started.
+  unsigned short GetPort() const { return port_; }
+
+  const std::string &GetLastError() const { return last_error_; }
+
+  void SetReplyDelay(std::chrono::microseconds delay);
+  // Writes at most maximum_write_size bytes at once, and pauses between the
+  // writes. 0 writes everything at once.
+  void SetPartialWrites(std::size_t maximum_write_size,
+                        std::chrono::microseconds pause);
+  // Reads at most maximum_read_size bytes at once, after a pause. 0 reads
+  // whatever arrived.
+  void SetSlowReads(std::size_t maximum_read_size,
+                    std::chrono::microseconds pause);
+  // Closes the connection that receives the given number of commands from
+  // now on, without answering the last one. 0 turns it off.
+  void DisconnectAfterCommands(long long number_of_commands);
+  // Closes every connection. New connections are still accepted.
+  void DisconnectAll();
+
+  // Delivers the message like PUBLISH and returns the number of
+  // subscribers that it was sent to.
+  long long Publish(std::string_view channel, std::string_view message);
+
+  // The number of connections that subscribed to the channel or pattern.
+  std::size_t GetNumberOfSubscribers(const std::string &subscription) const;
+  [[nodiscard]] bool WaitForSubscribers(const std::string &subscription,
+                                        std::size_t number_of_subscribers,
+                                        std::chrono::milliseconds timeout);
+
+  // Appends the frames of a message and of a pattern message, as a
+  // subscribed connection receives them.
+  static void AppendMessageFrame(std::string &frames, std::string_view channel,
+                                 std::string_view message);
+  static void AppendPatternMessageFrame(std::string &frames,
+                                        std::string_view pattern,
+                                        std::string_view channel,
+                                        std::string_view message);
+
+  // Sends the frames to every connection that subscribed to the channel or
+  // pattern, the given number of times. Returns false when there is no
+  // subscriber or a connection was closed.
+  [[nodiscard]] bool StreamFrames(const std::string &subscription,
+                                  std::string_view frames,
+                                  std::size_t repetitions);
+
+  // Without storing the entries, XADD only counts them, so a benchmark can
+  // add any number. They can not be read then.
+  void SetStoresStreamEntries(bool stores_stream_entries);
+
+  // The number of entries that were added to the stream.
+  std::size_t GetStreamLength(const std::string &stream) const;
+  [[nodiscard]] bool WaitForStreamLength(const std::string &stream,
+                                         std::size_t length,
+                                         std::chrono::milliseconds timeout);
+  // The fields and values of the stored entries, in the order of the
+  // entries.
+  std::vector<std::vector<std::string>>
+  GetStreamEntries(const std::string &stream) const;
+  // The entries that were delivered to the group's consumers and not
+  // acknowledged yet.
+  std::size_t GetNumberOfPendingEntries(const std::string &stream,
+                                        const std::string &group) const;
+
+  long long GetNumberOfCommands() const {
+    return number_of_commands_.load(std::memory_order_relaxed);
+  }
+
+  // The number of connections that are open.
+  std::size_t GetNumberOfConnections() const;
+
+private:
+  struct Connection {
+    int file_descriptor;
+    std::thread thread;
+    // Serializes the replies and the messages that other connections
+    // publish.
+    std::mutex write_mutex;
+    std::atomic<bool> is_closed{false};
+    // Only used under the server's lock.
+    std::size_t number_of_subscriptions = 0;
+  };
+
+  struct StreamId {
+    std::uint64_t milliseconds;
+    std::uint64_t sequence;
+
+    bool operator<(const StreamId &other) const {
+      return milliseconds < other.milliseconds ||
+             (milliseconds == other.milliseconds && sequence < other.sequence);
+    }
+  };
+
+  struct StreamEntry {
+    StreamId id;
+    std::vector<std::string> fields;
+  };
+
+  struct ConsumerGroup {
+    StreamId last_delivered_id;
+    // The consumer that every pending entry was delivered to.
+    std::map<StreamId, std::string> pending_entries;
+  };
+
+  struct Stream {
+    std::vector<StreamEntry> entries;
+    std::size_t length = 0;
+    StreamId last_id{0, 0};
+    std::map<std::string, ConsumerGroup> groups;
+  };
+
+  void AcceptConnections();
+  void ServeConnection(Connection &connection);
+  // Appends the reply to the command to output. A blocking command first
+  // sends what is in output.
+  void ExecuteCommand(Connection &connection,
+                      const std::vector<std::string_view> &arguments,
+                      std::string &output);
+  void Subscribe(Connection &connection,
+                 const std::vector<std::string_view> &arguments,
+                 bool is_pattern, std::string &output);
+  void AddStreamEntry(const std::vector<std::string_view> &arguments,
+                      std::string &output);
+  void CreateConsumerGroup(const std::vector<std::string_view> &arguments,
+                           std::string &output);
+  void ReadStreams(Connection &connection,
+                   const std::vector<std::string_view> &arguments,
+                   bool is_group_read, std::string &output);
+  void AcknowledgeStreamEntries(const std::vector<std::string_view> &arguments,
+                                std::string &output);
+  // Sends the data with the injected delays and partial writes. Returns false
+  // when the connection was closed.
+  bool Send(Connection &connection, std::string_view data);
+  bool SendAll(Connection &connection, std::string_view data,
+               std::size_t maximum_write_size,
+               std::chrono::microseconds pause);
+  void CloseConnection(Connection &connection);
+
+  int listening_socket_file_descriptor_;
+  unsigned short port_;
+  std::thread accepting_thread_;
+  std::atomic<bool> is_stopping_;
+
+  // Guards the connections, the subscriptions and the streams.
+  mutable std::mutex mutex_;
+  // Signalled when a subscription or a stream entry was added, or a
+  // connection closed.
+  std::condition_variable condition_;
+  // The connections are only destroyed by Stop(), so the subscriptions can
+  // point to them.
+  std::vector<std::unique_ptr<Connection>> connections_;
+  std::unordered_map<std::string, std::vector<Connection *>> channels_;
+  std::unordered_map<std::string, std::vector<Connection *>> patterns_;
+  std::unordered_map<std::string, Stream> streams_;
+  bool stores_stream_entries_;
+
+  std::atomic<long long> reply_delay_in_microseconds_;
+  std::atomic<std::size_t> maximum_write_size_;
+  std::atomic<long long> write_pause_in_microseconds_;
+  std::atomic<std::size_t> maximum_read_size_;
+  std::atomic<long long> read_pause_in_microseconds_;
+  std::atomic<long long> commands_until_disconnect_;
+  std::atomic<long long> number_of_commands_;
+
+  std::string last_error_;
+};
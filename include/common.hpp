@@ -2,6 +2,8 @@
 #include <iostream>
 #include <string.h>
 
+#include "Logging/Logger.hpp"
+
 #define REDIS_SERVER_HOSTNAME "127.0.0.1"
 #define REDIS_SERVER_PORT "6379"
 
@@ -11,9 +13,38 @@
 #define CFG_KEY_SUB_CHANNEL "default_subscription_channel"
 #define CFG_KEY_PROC_STREAM "default_processing_stream"
 #define CFG_KEY_MONITORING_INTERVAL "monitoring_interval"
+// Optional keys
+#define CFG_KEY_XADD_PIPELINE_DEPTH "xadd_pipeline_depth"
+#define CFG_KEY_DISPATCH_MODE "dispatch_mode"
+#define CFG_KEY_ROUTING_KEY "routing_key"
+#define CFG_KEY_IO_ENGINE "io_engine"
+#define CFG_KEY_REACTOR_THREADS "reactor_threads"
+#define CFG_KEY_SUB_CHANNELS "subscription_channels"
+#define CFG_KEY_SUB_PATTERNS "subscription_patterns"
+#define CFG_KEY_SHARDED_PUBSUB "sharded_pubsub"
+#define CFG_KEY_INGEST_MODE "ingest_mode"
+#define CFG_KEY_INGEST_STREAM "ingest_stream"
+#define CFG_KEY_CONSUMER_GROUP "consumer_group"
+#define CFG_KEY_CONSUMER_NAME "consumer_name"
+#define CFG_KEY_XREADGROUP_COUNT "xreadgroup_count"
+#define CFG_KEY_XREADGROUP_BLOCK "xreadgroup_block_ms"
+#define CFG_KEY_TIMESTAMP_CLOCK "timestamp_clock"
+#define CFG_KEY_TIMESTAMP_FORMAT "timestamp_format"
+#define CFG_KEY_METRICS_PORT "metrics_port"
+#define CFG_KEY_BROKER_QUEUE_CAPACITY "broker_queue_capacity"
+#define CFG_KEY_OVERLOAD_POLICY "overload_policy"
+#define CFG_KEY_OVERLOAD_SAMPLE_INTERVAL "overload_sample_interval"
+#define CFG_KEY_SPILL_DIRECTORY "spill_directory"
+#define CFG_KEY_SPILL_SEGMENT_SIZE_MB "spill_segment_size_mb"
+#define CFG_KEY_SPILL_MAX_SEGMENTS "spill_max_segments"
+#define CFG_KEY_JOURNAL_DIRECTORY "journal_directory"
+#define CFG_KEY_JOURNAL_SEGMENT_SIZE_MB "journal_segment_size_mb"
+#define CFG_KEY_JOURNAL_COMMIT_INTERVAL "journal_commit_interval_ms"
+#define CFG_KEY_JOURNAL_COMMIT_RECORDS "journal_commit_records"
 
-#define print(param) std::cout << param
-#define println(param) print(param) << std::endl
+// Logged at level Info, so the output is written by the logger's thread.
+#define print(param) LogStream(LogLevel::Info, false) << param
+#define println(param) LogStream(LogLevel::Info, true) << param
 
 #define case_break(condition, statement)                                       \
   case condition: {                                                            \
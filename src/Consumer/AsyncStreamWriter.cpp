@@ -0,0 +1,192 @@
+#include <cerrno>
+#include <sys/socket.h>
+
+#include "../../include/Concurrency/Backoff.hpp"
+#include "../../include/Consumer/AsyncStreamWriter.hpp"
+
+namespace {
+// The number of submitted commands that can wait for the loop thread.
+constexpr std::size_t kSubmittedCommandsCapacity = 4096;
+} // namespace
+
+AsyncStreamWriter::AsyncStreamWriter(EventLoop &event_loop,
+                                     int file_descriptor,
+                                     std::size_t max_in_flight,
+                                     CompletionHandler completion_handler)
+    : event_loop_(event_loop), file_descriptor_{file_descriptor},
+      max_in_flight_{max_in_flight > 0 ? max_in_flight : 1},
+      completion_handler_(std::move(completion_handler)),
+      submitted_commands_(kSubmittedCommandsCapacity), is_take_posted_{false},
+      number_of_uncompleted_commands_{0}, has_failed_{false},
+      output_buffer_{}, output_offset_{0}, is_waiting_for_writability_{false},
+      pending_tags_(max_in_flight_), pending_head_{0},
+      number_of_pending_commands_{0},
+      reply_reader_(file_descriptor, RespReceiveBuffer::kMinimumReadSize),
+      last_error_{} {}
+
+bool AsyncStreamWriter::Start() {
+  if (!event_loop_.Watch(file_descriptor_, EPOLLIN,
+                         [this](std::uint32_t events) { OnEvents(events); })) {
+    last_error_ = event_loop_.GetLastError();
+    return false;
+  }
+  return true;
+}
+
+bool AsyncStreamWriter::Submit(std::string &&resp_formatted_command,
+                               std::uint64_t tag) {
+  if (HasFailed()) {
+    completion_handler_({false, last_error_, tag});
+    return false;
+  }
+
+  number_of_uncompleted_commands_.fetch_add(1, std::memory_order_relaxed);
+  SubmittedCommand submitted_command{std::move(resp_formatted_command), tag};
+  Backoff backoff;
+  while (!submitted_commands_.TryPush(std::move(submitted_command))) {
+    if (HasFailed()) {
+      number_of_uncompleted_commands_.fetch_sub(1, std::memory_order_relaxed);
+      completion_handler_({false, last_error_, tag});
+      return false;
+    }
+    backoff.Pause();
+  }
+
+  // A single posted task takes every command that was submitted before it
+  // runs, so there is no need to post one per command.
+  if (!is_take_posted_.exchange(true, std::memory_order_acq_rel)) {
+    event_loop_.Post([this]() {
+      is_take_posted_.store(false, std::memory_order_release);
+      TakeSubmittedCommands();
+    });
+  }
+  return true;
+}
+
+void AsyncStreamWriter::OnEvents(std::uint32_t events) {
+  if (events & (EPOLLIN | EPOLLERR | EPOLLHUP)) {
+    if (!ReadReplies()) {
+      Fail(last_error_);
+      return;
+    }
+    // The replies made room in the window.
+    TakeSubmittedCommands();
+  }
+  if ((events & EPOLLOUT) && !has_failed_ && !SendOutputBuffer()) {
+    Fail(last_error_);
+  }
+}
+
+void AsyncStreamWriter::TakeSubmittedCommands() {
+  SubmittedCommand submitted_command;
+  if (HasFailed()) {
+    while (submitted_commands_.TryPop(submitted_command)) {
+      Complete({false, last_error_, submitted_command.tag});
+    }
+    return;
+  }
+
+  while (number_of_pending_commands_ < max_in_flight_ &&
+         submitted_commands_.TryPop(submitted_command)) {
+    output_buffer_.append(submitted_command.command);
+    pending_tags_[(pending_head_ + number_of_pending_commands_) %
+                  max_in_flight_] = submitted_command.tag;
+    ++number_of_pending_commands_;
+  }
+  if (!SendOutputBuffer()) {
+    Fail(last_error_);
+  }
+}
+
+bool AsyncStreamWriter::SendOutputBuffer() {
+  while (output_offset_ < output_buffer_.size()) {
+    ssize_t result =
+        send(file_descriptor_, output_buffer_.data() + output_offset_,
+             output_buffer_.size() - output_offset_, MSG_NOSIGNAL);
+    if (result < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      if (errno == EAGAIN || errno == EWOULDBLOCK) {
+        // Continue once the socket can take more data.
+        if (!is_waiting_for_writability_) {
+          is_waiting_for_writability_ = true;
+          if (!event_loop_.UpdateEvents(file_descriptor_, EPOLLIN | EPOLLOUT)) {
+            last_error_ = event_loop_.GetLastError();
+            return false;
+          }
+        }
+        output_buffer_.erase(0, output_offset_);
+        output_offset_ = 0;
+        return true;
+      }
+      last_error_ = "Failed to send the xadd command!";
+      return false;
+    }
+    output_offset_ += result;
+  }
+
+  output_buffer_.clear();
+  output_offset_ = 0;
+  if (is_waiting_for_writability_) {
+    is_waiting_for_writability_ = false;
+    if (!event_loop_.UpdateEvents(file_descriptor_, EPOLLIN)) {
+      last_error_ = event_loop_.GetLastError();
+      return false;
+    }
+  }
+  return true;
+}
+
+bool AsyncStreamWriter::ReadReplies() {
+  bool has_unexpected_reply = false;
+  bool is_successful_read = reply_reader_.ReadFrames(
+      [this, &has_unexpected_reply](const RespParser &parser) {
+        if (number_of_pending_commands_ == 0) {
+          has_unexpected_reply = true;
+          return;
+        }
+
+        const RespValue &reply = parser.Root();
+        StreamWriteResult result{!reply.IsError() && !reply.is_null,
+                                 reply.string, pending_tags_[pending_head_]};
+        pending_head_ = (pending_head_ + 1) % max_in_flight_;
+        --number_of_pending_commands_;
+        Complete(result);
+      });
+
+  if (!is_successful_read) {
+    last_error_ = reply_reader_.GetLastError();
+    return false;
+  }
+  if (has_unexpected_reply) {
+    last_error_ = "Received a reply that does not belong to any command!";
+    return false;
+  }
+  return true;
+}
+
+void AsyncStreamWriter::Fail(const std::string &error) {
+  if (HasFailed()) {
+    return;
+  }
+  last_error_ = error;
+  has_failed_.store(true, std::memory_order_release);
+  event_loop_.Unwatch(file_descriptor_);
+
+  while (number_of_pending_commands_ > 0) {
+    StreamWriteResult result{false, last_error_, pending_tags_[pending_head_]};
+    pending_head_ = (pending_head_ + 1) % max_in_flight_;
+    --number_of_pending_commands_;
+    Complete(result);
+  }
+  output_buffer_.clear();
+  output_offset_ = 0;
+  // Also completes the commands that are still queued.
+  TakeSubmittedCommands();
+}
+
+void AsyncStreamWriter::Complete(const StreamWriteResult &result) {
+  number_of_uncompleted_commands_.fetch_sub(1, std::memory_order_relaxed);
+  completion_handler_(result);
+}
@@ -1,237 +1,643 @@
+#include <algorithm>
 #include <arpa/inet.h>
 #include <assert.h>
+#include <charconv>
+#include <cstring>
+#include <chrono>
 #include <netdb.h>
 #include <optional>
 #include <sys/socket.h>
 #include <unistd.h>
 
-#include <hiredis/hiredis.h>
-
 #include <sstream>
 
+#include "../../../include/Concurrency/ChaseLevDeque.hpp"
 #include "../../../include/Consumer/ConsumerGroups/RedisBrokerConsumer.hpp"
 #include "../../../include/Consumer/JsonMessageProcessorImpl.hpp"
+#include "../../../include/Consumer/PipelinedStreamWriter.hpp"
 #include "../../../include/Consumer/RedisConsumerUtils/redis_consumer_utils.hpp"
+#include "../../../include/Consumer/ShardedSubscriber.hpp"
+#include "../../../include/Networking/IoUringLoop.hpp"
 
 class RedisBrokerConsumer::MessageProcessorImpl {
 public:
   MessageProcessorImpl()
       : message_processor_(std::make_shared<JsonMessageProcessorImpl>()) {}
 
-  std::optional<Message> ProcessMessage(const std::string &message) {
-    return message_processor_->ProcessMessage(message);
+  const std::shared_ptr<IMessageProcessor> &GetMessageProcessor() const {
+    return message_processor_;
   }
 
 private:
   std::shared_ptr<IMessageProcessor> message_processor_;
 };
 
+namespace {
+// The capacity of a worker's deque in work-stealing mode.
+constexpr std::size_t kWorkDequeCapacity = 1024;
+// The maximum number of received messages that a worker moves from its queue
+// to its deque at once. These are the messages that the other workers can
+// steal while the worker is busy.
+constexpr std::size_t kWorkTransferBatchSize = 256;
+// The initial capacity of a worker's XADD command, which is reused for every
+// processed message.
+constexpr std::size_t kCommandCapacity = 512;
+
+// The wall clock, which the publish times in the payloads are compared with.
+long long GetRealTimeInNanoseconds() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+             std::chrono::system_clock::now().time_since_epoch())
+      .count();
+}
+
+// The clock of the stages within the process, which does not jump when the
+// wall clock is adjusted.
+long long GetSteadyTimeInNanoseconds() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+// What a spilled message is stored with, in front of its channel and payload.
+struct SpilledMessageHeader {
+  ChannelId channel_id;
+  std::uint32_t channel_size;
+  long long receive_time_in_nanoseconds;
+  std::uint64_t journal_sequence;
+};
+
+// What a journaled message is stored with, in front of the name of its
+// subscription, its channel and its payload. The subscription is looked up
+// by its name on replay, as the ChannelIds can change with a restart.
+struct JournaledMessageHeader {
+  std::uint32_t subscription_name_size;
+  std::uint32_t channel_size;
+  bool is_pattern;
+};
+
+template <typename T> std::string_view GetBytes(const T &value) {
+  return std::string_view(reinterpret_cast<const char *>(&value),
+                          sizeof(value));
+}
+} // namespace
+
 class RedisBrokerConsumer::BrokerWorker {
 public:
-  BrokerWorker(std::shared_ptr<MessageProcessorImpl> message_processor_impl,
-               std::queue<std::string> &message_queue, std::mutex &queue_mutex,
-               std::condition_variable &cv,
-               const std::string &source_channel_name,
-               const std::string &processing_stream_name, bool verbose_outputs)
-      : id_{next_id_++}, message_processor_impl_(message_processor_impl),
-        message_queue_(message_queue), queue_mutex_(queue_mutex),
-        cv_(cv), source_channel_name_{source_channel_name},
-        processing_stream_name_{processing_stream_name},
+  BrokerWorker(const ChannelTable &channel_table,
+               MpmcRingBuffer<PooledMessage> &message_queue,
+               EventCount &message_queue_event_count, bool verbose_outputs,
+               std::size_t xadd_pipeline_depth,
+               const TimestampService &timestamp_service,
+               ThreadCounters &counters)
+      : id_{next_id_++}, channel_table_(channel_table),
+        message_queue_(message_queue),
+        message_queue_event_count_(message_queue_event_count),
+        next_peer_to_steal_from_{0}, writing_socket_file_descriptor_{-1},
         verbose_outputs_{verbose_outputs},
-        stop_(false), writing_socket_file_descriptor_{-1},
-        number_of_processed_messages_{0}, number_of_processing_errors_{0} {
+        xadd_pipeline_depth_{xadd_pipeline_depth},
+        timestamp_service_(timestamp_service), stop_(false),
+        counters_(counters) {
     worker_identifier_ = "[Broker Worker " + std::to_string(id_) + "]";
-    if (verbose_outputs_) {
-      if (!processing_stream_name_.empty()) {
-        std::cout << worker_identifier_
-                  << " Processing stream set to: " << processing_stream_name_
-                  << std::endl;
-      } else {
-        std::cout << worker_identifier_ << " No processing stream set!"
-                  << std::endl;
+    command_.reserve(kCommandCapacity);
+  }
+
+  // Gives the worker a queue of its own, filled only by EnqueueMessage(),
+  // instead of the broker's shared queue. Has to be called before Start().
+  void UseOwnMessageQueue(std::size_t capacity) {
+    own_message_queue_ =
+        std::make_unique<SpscRingBuffer<PooledMessage>>(capacity);
+  }
+
+  // Lets the worker steal messages from the other workers when it has none,
+  // and lets them steal from it. Has to be called after UseOwnMessageQueue()
+  // and before Start().
+  void EnableWorkStealing(
+      const std::vector<std::unique_ptr<BrokerWorker>> &workers) {
+    work_deque_ =
+        std::make_unique<ChaseLevDeque<WorkItem *>>(kWorkDequeCapacity);
+    // Every message in the deque has an item, so the worker never runs out
+    // of them.
+    work_items_ = std::make_unique<WorkItem[]>(kWorkDequeCapacity);
+    free_work_items_ =
+        std::make_unique<MpmcRingBuffer<WorkItem *>>(kWorkDequeCapacity);
+    for (std::size_t i = 0; i < kWorkDequeCapacity; ++i) {
+      work_items_[i].owner = this;
+      bool is_pushed = free_work_items_->TryPush(&work_items_[i]);
+      assert(is_pushed);
+      (void)is_pushed;
+    }
+    transfer_batch_.reserve(kWorkTransferBatchSize);
+    for (const auto &worker : workers) {
+      if (worker.get() != this) {
+        peers_.push_back(worker.get());
       }
     }
   }
 
+  // Hands a message to the worker's own queue, or drops it when the queue is
+  // full and the overload policy says so. Only the subscriber thread can call
+  // it.
+  void EnqueueMessage(PooledMessage &&message,
+                      OverloadHandler<PooledMessage> &overload_handler) {
+    if (overload_handler.Push(*own_message_queue_, std::move(message))) {
+      own_message_queue_event_count_.NotifyOne();
+    }
+  }
+
+  // Lets the worker take the messages that were spilled to the disk, once
+  // the shared queue is empty. Has to be called before Start().
+  void UseSpillQueue(SpillQueue &spill_queue,
+                     BufferPool &message_buffer_pool) {
+    spill_queue_ = &spill_queue;
+    message_buffer_pool_ = &message_buffer_pool;
+  }
+
+  // Lets the worker complete the journal records of the messages, once they
+  // are processed and their XADD is answered. Has to be called before
+  // Start().
+  void UseJournal(Journal &journal) {
+    journal_ = &journal;
+    // Every XADD in flight, and the one that is being submitted.
+    pending_journal_sequences_.resize(xadd_pipeline_depth_ + 1);
+  }
+
+  std::size_t GetOwnMessageQueueCapacity() const {
+    return own_message_queue_->GetCapacity();
+  }
+
   void Start() { thread_ = std::thread(&BrokerWorker::ProcessMessages, this); }
 
   void Stop() {
     stop_ = true;
+    GetMessageQueueEventCount().NotifyAll();
+    thread_.join();
     if (writing_socket_file_descriptor_ != -1) {
       close(writing_socket_file_descriptor_);
     }
-    cv_.notify_all();
-    thread_.join();
   }
 
   void SetWritingSocketFileDescriptor(int writing_socket_file_descriptor) {
     writing_socket_file_descriptor_ = writing_socket_file_descriptor;
+    stream_writer_ = std::make_unique<PipelinedStreamWriter>(
+        writing_socket_file_descriptor_, xadd_pipeline_depth_,
+        [this](const StreamWriteResult &result) {
+          OnStreamWriteCompleted(result);
+        });
   }
 
   void ReportError(const std::string &error_message) const {
-    std::cerr << worker_identifier_ << " " << error_message << std::endl;
+    LOG(LogLevel::Error, "{} {}", worker_identifier_, error_message);
   }
 
-  [[nodiscard]] bool
-  AddDataToStream(const std::string &resp_formatted_command) const {
-    ssize_t bytes_sent =
-        send(writing_socket_file_descriptor_, resp_formatted_command.c_str(),
-             resp_formatted_command.size(), 0);
-    if (bytes_sent < 0) {
-      ReportError("Failed to send the xadd command!");
-      return false;
+  void OnStreamWriteCompleted(const StreamWriteResult &result) {
+    // The replies arrive in the order in which the commands were submitted,
+    // and a failed XADD is not retried, so its message is complete too.
+    if (journal_) {
+      journal_->Complete(PopPendingJournalSequence());
     }
-
-    redisReader *reader = redisReaderCreate();
-    if (reader == nullptr) {
-      ReportError("Failed to create a Redis reader!");
-      return false;
+    if (result.is_success) {
+      // The command was tagged with the time it was submitted at.
+      stream_write_latencies_.Record(GetSteadyTimeInNanoseconds() -
+                                     static_cast<long long>(result.tag));
+      if (verbose_outputs_) {
+        LOG_SAMPLED(LogLevel::Debug, kLogSamplesPerSecond,
+                    "{} Successfully added the message to the stream for "
+                    "processed messages with id = {}",
+                    worker_identifier_, result.reply);
+      }
+      counters_.Add(CounterId::ProcessedMessages);
+    } else {
+      ReportError("Failed to add a message to the processing stream! " +
+                  std::string(result.reply));
+      counters_.Add(CounterId::ProcessingErrors);
     }
+  }
 
-    char buffer[1024] = {};
-    ssize_t bytes_read =
-        recv(writing_socket_file_descriptor_, buffer, sizeof(buffer), 0);
-    if (bytes_read < 0) {
-      ReportError("Failed to read from the server!");
-      redisReaderFree(reader);
-      return false;
+  // Waits for the replies to all of the XADD commands that were sent.
+  void FlushProcessedMessages() {
+    if (stream_writer_ && stream_writer_->GetNumberOfInFlightCommands() > 0 &&
+        !stream_writer_->Flush()) {
+      ReportError(stream_writer_->GetLastError());
     }
+  }
 
-    if (redisReaderFeed(reader, buffer, bytes_read) != REDIS_OK) {
-      ReportError("Failed to feed the Redis reader!");
-      redisReaderFree(reader);
-      return false;
-    }
+  void ProcessMessages() {
+    LOG(LogLevel::Info, "{} ready!", worker_identifier_);
+    PooledMessage message;
+    while (true) {
+      if (!TryDequeueMessage(message)) {
+        // Collect the outstanding XADD replies before going idle or stopping,
+        // so that every submitted message is counted.
+        FlushProcessedMessages();
+        if (stop_) {
+          break;
+        }
+        GetMessageQueueEventCount().Wait(
+            [this] { return HasQueuedMessages() || stop_; });
+        continue;
+      }
 
-    void *reply = nullptr;
-    int status = redisReaderGetReply(reader, &reply);
-    if (status != REDIS_OK) {
-      ReportError("Failed to get a Redis reply!");
-      redisReaderFree(reader);
-      return false;
-    }
+      receive_to_dequeue_latencies_.Record(
+          GetSteadyTimeInNanoseconds() - message.receive_time_in_nanoseconds);
+
+      auto processing_start_time = std::chrono::steady_clock::now();
+      const ChannelSubscription &subscription =
+          channel_table_.Get(message.channel_id);
+      // The processed message points into the received message's buffer, so
+      // nothing is copied or allocated until the buffer is released.
+      MessageView processed_message{};
+      bool is_processed = subscription.message_processor->ProcessMessageInPlace(
+          message.GetPayload(), processed_message, message_id_storage_);
+      processing_latencies_.Record(
+          std::chrono::duration_cast<std::chrono::nanoseconds>(
+              std::chrono::steady_clock::now() - processing_start_time)
+              .count());
+      if (is_processed) {
+        RecordPublishLatency(message, processed_message.publish_time);
+        processed_message.processor_id = id_;
+        processed_message.processing_date_time = timestamp_service_.Now();
+        processed_message.source_channel_name =
+            channel_table_.GetChannelName(message);
 
-    if (redisReply *r = (redisReply *)reply) {
-      if (r->type == REDIS_REPLY_STRING) {
         if (verbose_outputs_) {
-          std::cout << "Successfully wrote the data to Stream with id = "
-                    << r->str << std::endl;
+          LOG_SAMPLED(LogLevel::Debug, kLogSamplesPerSecond,
+                      "Post processing of message with id = ({}).\n"
+                      "Processed by {} at {}, received from channel ({}).",
+                      processed_message.message_id, worker_identifier_,
+                      processed_message.processing_date_time,
+                      processed_message.source_channel_name);
+        }
+
+        // The message is counted once Redis has replied to the XADD command.
+        if (!subscription.processing_stream.empty()) {
+          command_.clear();
+          AppendWriteMessageToStreamCommand(
+              command_, subscription.processing_stream, processed_message);
+          // The message stays in the journal until its XADD is answered.
+          if (journal_) {
+            PushPendingJournalSequence(message.journal_sequence);
+          }
+          // A rejected command has already been completed, and counted as a
+          // processing error, by OnStreamWriteCompleted().
+          if (!stream_writer_->Submit(command_,
+                                      GetSteadyTimeInNanoseconds())) {
+            ReportError(stream_writer_->GetLastError());
+          }
+        } else {
+          counters_.Add(CounterId::ProcessedMessages);
+          CompleteJournalRecord(message.journal_sequence);
         }
-        redisReaderFree(reader);
-        return true;
       } else {
-        ReportError("Unexpected response type");
-        redisReaderFree(reader);
-        return false;
+        counters_.Add(CounterId::ProcessingErrors);
+        CompleteJournalRecord(message.journal_sequence);
       }
-    } else {
-      redisReaderFree(reader);
-      return false;
+      message.buffer.Release();
+
+      if (verbose_outputs_) {
+        LOG_SAMPLED(LogLevel::Debug, kLogSamplesPerSecond,
+                    "{} Messages processed so far: {}", worker_identifier_,
+                    counters_.Get(CounterId::ProcessedMessages));
+        if (counters_.Get(CounterId::ProcessingErrors)) {
+          LOG_SAMPLED(LogLevel::Debug, kLogSamplesPerSecond,
+                      "{} Number of encountered processing errors: {}",
+                      worker_identifier_,
+                      counters_.Get(CounterId::ProcessingErrors));
+        }
+      }
+      counters_.Add(CounterId::BusyTimeInNanoseconds,
+                    std::chrono::duration_cast<std::chrono::nanoseconds>(
+                        std::chrono::steady_clock::now() -
+                        processing_start_time)
+                        .count());
     }
-    return true;
   }
 
-  void ProcessMessages() {
-    std::cout << worker_identifier_ << " ready!" << std::endl;
-    while (!stop_) {
-      std::string message;
-      // Consume a message from the shared queue
-      {
-        std::unique_lock<std::mutex> lock(queue_mutex_);
-        cv_.wait(lock, [this] { return !message_queue_.empty() || stop_; });
-
-        if (stop_ && message_queue_.empty()) {
-          break;
-        }
+  WorkerStatistics GetStatistics() const {
+    long long number_of_queued_messages = 0;
+    if (own_message_queue_) {
+      number_of_queued_messages += own_message_queue_->GetApproximateSize();
+    }
+    if (work_deque_) {
+      number_of_queued_messages += work_deque_->GetApproximateSize();
+    }
+    const CounterValues counters = counters_.Read();
+    return {id_,
+            counters.Get(CounterId::ProcessedMessages),
+            counters.Get(CounterId::StolenMessages),
+            counters.Get(CounterId::BusyTimeInNanoseconds),
+            counters.Get(CounterId::ProcessingErrors),
+            stream_writer_ ? static_cast<long long>(
+                                 stream_writer_->GetNumberOfInFlightCommands())
+                           : 0,
+            number_of_queued_messages};
+  }
+
+  LatencyStatistics GetLatencyStatistics() const {
+    return {publish_to_receive_latencies_.GetSnapshot(),
+            receive_to_dequeue_latencies_.GetSnapshot(),
+            processing_latencies_.GetSnapshot(),
+            stream_write_latencies_.GetSnapshot()};
+  }
+
+private:
+  // A message in the work-stealing deque, which only holds trivially copyable
+  // items. The items are preallocated per worker and returned to their owner
+  // by the worker that takes the message.
+  struct WorkItem {
+    PooledMessage message;
+    BrokerWorker *owner = nullptr;
+  };
+
+  // Records how long the message took from its publisher to the subscriber,
+  // when the processor found the time it was published at in the payload.
+  // That time comes from the publisher's wall clock, so the steady receive
+  // time is moved onto the wall clock for this stage only.
+  void RecordPublishLatency(const PooledMessage &message,
+                            std::string_view publish_time) {
+    if (publish_time.empty()) {
+      return;
+    }
+    long long publish_time_in_nanoseconds = 0;
+    auto [end, error] = std::from_chars(
+        publish_time.data(), publish_time.data() + publish_time.size(),
+        publish_time_in_nanoseconds);
+    if (error == std::errc()) {
+      const long long receive_time_in_nanoseconds =
+          GetRealTimeInNanoseconds() -
+          (GetSteadyTimeInNanoseconds() - message.receive_time_in_nanoseconds);
+      publish_to_receive_latencies_.Record(receive_time_in_nanoseconds -
+                                           publish_time_in_nanoseconds);
+    }
+  }
+
+  void CompleteJournalRecord(std::uint64_t journal_sequence) {
+    if (journal_) {
+      journal_->Complete(journal_sequence);
+    }
+  }
+
+  void PushPendingJournalSequence(std::uint64_t journal_sequence) {
+    pending_journal_sequences_[(pending_journal_head_ +
+                                number_of_pending_journal_sequences_) %
+                               pending_journal_sequences_.size()] =
+        journal_sequence;
+    ++number_of_pending_journal_sequences_;
+  }
+
+  std::uint64_t PopPendingJournalSequence() {
+    assert(number_of_pending_journal_sequences_ > 0);
+    const std::uint64_t journal_sequence =
+        pending_journal_sequences_[pending_journal_head_];
+    pending_journal_head_ =
+        (pending_journal_head_ + 1) % pending_journal_sequences_.size();
+    --number_of_pending_journal_sequences_;
+    return journal_sequence;
+  }
+
+  bool TryDequeueMessage(PooledMessage &message) {
+    if (work_deque_) {
+      return TryTakeWork(message);
+    }
+    if (own_message_queue_) {
+      return own_message_queue_->TryPop(message);
+    }
+    // The spilled messages are newer than the ones in the shared queue.
+    return message_queue_.TryPop(message) ||
+           (spill_queue_ && TryUnspillMessage(message));
+  }
+
+  // Copies the oldest spilled message back into a pooled buffer.
+  bool TryUnspillMessage(PooledMessage &message) {
+    return spill_queue_->TryPop([&](std::string_view record) {
+      SpilledMessageHeader header;
+      std::memcpy(&header, record.data(), sizeof(header));
+      record.remove_prefix(sizeof(header));
+      message.channel_id = header.channel_id;
+      message.channel_size = header.channel_size;
+      message.receive_time_in_nanoseconds =
+          header.receive_time_in_nanoseconds;
+      message.journal_sequence = header.journal_sequence;
+      message.buffer = message_buffer_pool_->Acquire(record.size());
+      record.copy(message.buffer.Data(), record.size());
+    });
+  }
 
-        message = message_queue_.front();
-        message_queue_.pop();
+  bool HasQueuedMessages() const {
+    if (!own_message_queue_) {
+      return !message_queue_.IsEmpty() ||
+             (spill_queue_ && !spill_queue_->IsEmpty());
+    }
+    if (!own_message_queue_->IsEmpty()) {
+      return true;
+    }
+    for (const BrokerWorker *peer : peers_) {
+      if (!peer->work_deque_->IsEmpty()) {
+        return true;
       }
+    }
+    return false;
+  }
 
-      auto processed_message_opt =
-          message_processor_impl_->ProcessMessage(message);
-      if (processed_message_opt) {
-        auto processed_message = processed_message_opt.value();
-        processed_message.processor_id = id_;
-        processed_message.processing_date_time = GetCurrentTime();
-        processed_message.source_channel_name = source_channel_name_;
-
-        std::cout << "Post processing of message with id = ("
-                  << processed_message.message_id << ")." << std::endl
-                  << "Processed by " << worker_identifier_ << " at "
-                  << processed_message.processing_date_time
-                  << ", received from channel ("
-                  << processed_message.source_channel_name << ")." << std::endl;
-
-        if (!processing_stream_name_.empty()) {
-          if (AddDataToStream(CreateWriteMessageToStreamCommand(
-                  processing_stream_name_, processed_message))) {
-            if (verbose_outputs_) {
-              std::cout << worker_identifier_
-                        << " Successfully added the message to the stream for "
-                           "processed messages - "
-                        << processing_stream_name_ << std::endl;
-            }
-            number_of_processed_messages_++;
-          } else {
-            number_of_processing_errors_++;
-          }
-        } else {
-          number_of_processed_messages_++;
-        }
-      } else {
-        number_of_processing_errors_++;
+  // Takes a message from the worker's own deque, refilling it from the
+  // worker's queue when it is empty, or steals one from another worker.
+  bool TryTakeWork(PooledMessage &message) {
+    WorkItem *work = nullptr;
+    if (!work_deque_->TryPop(work)) {
+      TransferReceivedMessages();
+      if (!work_deque_->TryPop(work) && !TryStealWork(work)) {
+        return false;
       }
+    }
+    message = std::move(work->message);
+    bool is_pushed = work->owner->free_work_items_->TryPush(std::move(work));
+    assert(is_pushed);
+    (void)is_pushed;
+    return true;
+  }
 
-      std::cout << worker_identifier_ << " Messages processed so far: "
-                << number_of_processed_messages_ << std::endl;
+  // Moves a batch of received messages to the empty deque.
+  void TransferReceivedMessages() {
+    WorkItem *work = nullptr;
+    while (transfer_batch_.size() < kWorkTransferBatchSize &&
+           free_work_items_->TryPop(work)) {
+      if (!own_message_queue_->TryPop(work->message)) {
+        bool is_pushed = free_work_items_->TryPush(std::move(work));
+        assert(is_pushed);
+        (void)is_pushed;
+        break;
+      }
+      transfer_batch_.push_back(work);
+    }
+    // The owner pops the newest item of its deque, so the batch is pushed in
+    // reverse to process it in the order in which it was received. Thieves
+    // take the most recently received messages of the batch.
+    for (auto it = transfer_batch_.rbegin(); it != transfer_batch_.rend();
+         ++it) {
+      bool is_pushed = work_deque_->TryPush(*it);
+      assert(is_pushed);
+      (void)is_pushed;
+    }
+    if (transfer_batch_.size() > 1) {
+      // Wake up the idle workers so they can take a share of the batch.
+      for (BrokerWorker *peer : peers_) {
+        peer->own_message_queue_event_count_.NotifyOne();
+      }
+    }
+    transfer_batch_.clear();
+  }
 
-      if (number_of_processing_errors_) {
-        std::cout << worker_identifier_
-                  << " Number of encountered processing errors: "
-                  << number_of_processing_errors_ << std::endl;
+  bool TryStealWork(WorkItem *&work) {
+    for (std::size_t i = 0; i < peers_.size(); ++i) {
+      BrokerWorker *peer = peers_[next_peer_to_steal_from_];
+      next_peer_to_steal_from_ = (next_peer_to_steal_from_ + 1) % peers_.size();
+      if (peer->work_deque_->TrySteal(work)) {
+        counters_.Add(CounterId::StolenMessages);
+        return true;
       }
     }
+    return false;
   }
 
-  long long GetNumberOfProcessedMessages() const {
-    return number_of_processed_messages_;
+  EventCount &GetMessageQueueEventCount() {
+    return own_message_queue_ ? own_message_queue_event_count_
+                              : message_queue_event_count_;
   }
 
-private:
   static int next_id_;
   int id_;
   std::string worker_identifier_;
 
-  std::shared_ptr<MessageProcessorImpl> message_processor_impl_;
-  std::queue<std::string> &message_queue_;
-  std::mutex &queue_mutex_;
-  std::condition_variable &cv_;
+  // Only read once the workers have been started.
+  const ChannelTable &channel_table_;
+  MpmcRingBuffer<PooledMessage> &message_queue_;
+  EventCount &message_queue_event_count_;
+  // Only used in key-affine and work-stealing mode.
+  std::unique_ptr<SpscRingBuffer<PooledMessage>> own_message_queue_;
+  // Only set when the messages can be spilled to the disk.
+  SpillQueue *spill_queue_ = nullptr;
+  BufferPool *message_buffer_pool_ = nullptr;
+  // Only set with a journal.
+  Journal *journal_ = nullptr;
+  // The journal records of the messages whose XADD awaits a reply, oldest
+  // first.
+  std::vector<std::uint64_t> pending_journal_sequences_;
+  std::size_t pending_journal_head_ = 0;
+  std::size_t number_of_pending_journal_sequences_ = 0;
+  EventCount own_message_queue_event_count_;
+  // Only used in work-stealing mode.
+  std::unique_ptr<ChaseLevDeque<WorkItem *>> work_deque_;
+  std::unique_ptr<WorkItem[]> work_items_;
+  std::unique_ptr<MpmcRingBuffer<WorkItem *>> free_work_items_;
+  std::vector<BrokerWorker *> peers_;
+  std::vector<WorkItem *> transfer_batch_;
+  std::size_t next_peer_to_steal_from_;
   std::thread thread_;
 
-  std::string source_channel_name_;
-  std::string processing_stream_name_;
-
   int writing_socket_file_descriptor_;
+  std::unique_ptr<PipelinedStreamWriter> stream_writer_;
+  // Reused for every processed message.
+  std::string command_;
+  std::string message_id_storage_;
 
   bool verbose_outputs_;
+  std::size_t xadd_pipeline_depth_;
+  TimestampService timestamp_service_;
 
-  bool stop_;
-  std::atomic<long long> number_of_processed_messages_;
-  std::atomic<long long> number_of_processing_errors_;
+  std::atomic<bool> stop_;
+  // Only added to by the worker's thread, on a cache line of their own.
+  ThreadCounters &counters_;
+
+  // Only recorded by the worker's thread.
+  LatencyHistogram publish_to_receive_latencies_;
+  LatencyHistogram receive_to_dequeue_latencies_;
+  LatencyHistogram processing_latencies_;
+  LatencyHistogram stream_write_latencies_;
 };
 
 int RedisBrokerConsumer::BrokerWorker::next_id_ = 1;
 
+namespace {
+// The smallest queue of a single worker in key-affine mode.
+constexpr std::size_t kMinimumWorkerQueueCapacity = 1024;
+// The size of the pooled buffers that the received messages are copied to.
+// Larger messages are allocated on their own.
+constexpr std::size_t kMessageBufferSize = 2048;
+
+// The capacity of a worker's own queue, in key-affine and work-stealing mode.
+std::size_t GetWorkerQueueCapacity(std::size_t queue_capacity,
+                                   int number_of_workers) {
+  return std::max(queue_capacity / std::max(number_of_workers, 1),
+                  kMinimumWorkerQueueCapacity);
+}
+
+// Enough buffers for every queue of the broker and its workers to be full.
+// The queues round their capacities up to a power of two, which is less than
+// twice the capacity.
+std::size_t GetMaximumNumberOfMessageBuffers(std::size_t queue_capacity,
+                                             int number_of_workers) {
+  number_of_workers = std::max(number_of_workers, 1);
+  const std::size_t number_of_buffers_per_worker =
+      2 * GetWorkerQueueCapacity(queue_capacity, number_of_workers) +
+      kWorkDequeCapacity + 1;
+  return 2 * queue_capacity + number_of_buffers_per_worker * number_of_workers;
+}
+} // namespace
+
 RedisBrokerConsumer::RedisBrokerConsumer(bool verbose_outputs,
-                                         int number_of_workers)
-    : redis_server_hostname_{}, redis_server_port_{0},
+                                         int number_of_workers,
+                                         const ConsumerOptions &options)
+    : verbose_outputs_{verbose_outputs},
+      number_of_workers_{number_of_workers}, options_(options),
+      redis_server_hostname_{}, redis_server_port_{0},
       subscription_socket_file_descriptor_{-1},
-      initial_connection_established_{false}, subsciption_channel_{},
+      initial_connection_established_{false}, channel_table_{},
       message_processor_impl_(std::make_shared<MessageProcessorImpl>()),
-      verbose_outputs_{verbose_outputs}, number_of_workers_{number_of_workers} {
+      message_buffer_pool_(
+          kMessageBufferSize,
+          GetMaximumNumberOfMessageBuffers(options.broker_queue_capacity,
+                                           number_of_workers)),
+      message_queue_(options.broker_queue_capacity),
+      overload_handler_(options.overload_policy,
+                        options.overload_sample_interval),
+      next_worker_{0},
+      subscriber_counters_(counters_.Register()) {
   if (number_of_workers_ < 1) {
-    number_of_workers = 1;
+    number_of_workers_ = 1;
+  }
+  if (options_.dispatch_mode == DispatchMode::KeyAffine) {
+    message_router_ = std::make_unique<MessageRouter>(options_.routing_key,
+                                                      number_of_workers_);
+  }
+  if (options_.sharded_pubsub) {
+    sharded_subscriber_ = std::make_unique<ShardedSubscriber>();
+  }
+  if (!options_.spill_directory.empty()) {
+    if (options_.dispatch_mode != DispatchMode::RoundRobin) {
+      LOG(LogLevel::Warning, "[RedisBrokerConsumer] The messages are only "
+                             "spilled to the disk in round-robin mode!");
+    } else {
+      spill_queue_ = std::make_unique<SpillQueue>(options_.spill_directory,
+                                                  options_.spill_segment_size,
+                                                  options_.spill_max_segments);
+      if (!spill_queue_->Open()) {
+        ReportError(spill_queue_->GetLastError());
+        exit(EXIT_FAILURE);
+      }
+    }
+  }
+  if (!options_.journal_directory.empty()) {
+    journal_ = std::make_unique<Journal>(
+        options_.journal_directory, options_.journal_segment_size,
+        std::chrono::milliseconds(
+            options_.journal_commit_interval_in_milliseconds),
+        options_.journal_commit_records);
+    if (!journal_->Open()) {
+      ReportError(journal_->GetLastError());
+      exit(EXIT_FAILURE);
+    }
+    // The dropped messages are not processed again after a restart either.
+    overload_handler_.SetDropHandler([this](const PooledMessage &message) {
+      journal_->Complete(message.journal_sequence);
+    });
   }
 }
 
@@ -271,20 +677,146 @@ void RedisBrokerConsumer::EstablishConnection(
   redis_server_port_ = redis_server_port;
 
   initial_connection_established_ = true;
-  std::cout << "[RedisBrokerConsumer] Connected to Redis server!" << std::endl;
+  LOG(LogLevel::Info, "[RedisBrokerConsumer] Connected to Redis server!");
+}
+
+void RedisBrokerConsumer::ProcessMessage(ChannelId channel_id,
+                                         std::string_view channel,
+                                         std::string_view message) {
+  // The message is copied out of the receive buffer once, into a pooled
+  // buffer that is moved to the worker and recycled once it is processed.
+  PooledMessage queued_message;
+  queued_message.channel_id = channel_id;
+  const ChannelSubscription &subscription = channel_table_.Get(channel_id);
+  if (!subscription.is_pattern) {
+    channel = {};
+  }
+  queued_message.channel_size = static_cast<std::uint32_t>(channel.size());
+  queued_message.receive_time_in_nanoseconds = GetSteadyTimeInNanoseconds();
+  subscriber_counters_.Add(CounterId::ReceivedMessages);
+  subscriber_counters_.Add(CounterId::ReceivedBytes, message.size());
+  // The message is journaled before it is queued, and the workers complete
+  // its record once it is processed.
+  if (journal_) {
+    const JournaledMessageHeader header{
+        static_cast<std::uint32_t>(subscription.name.size()),
+        queued_message.channel_size, subscription.is_pattern};
+    queued_message.journal_sequence = journal_->Append(
+        {GetBytes(header), subscription.name, channel, message});
+    if (queued_message.journal_sequence == 0) {
+      LOG_SAMPLED(LogLevel::Error, kLogSamplesPerSecond,
+                  "[RedisBrokerConsumer] Failed to journal a message! {}",
+                  journal_->GetLastError());
+    }
+  }
+  // Once messages were spilled to the disk, the following ones are spilled
+  // too, until the workers have drained them, so that they stay in order.
+  if (spill_queue_ && !spill_queue_->IsEmpty() &&
+      SpillMessage(queued_message, channel, message)) {
+    message_queue_event_count_.NotifyOne();
+    return;
+  }
+  queued_message.buffer =
+      message_buffer_pool_.Acquire(channel.size() + message.size());
+  channel.copy(queued_message.buffer.Data(), channel.size());
+  message.copy(queued_message.buffer.Data() + channel.size(), message.size());
+  // Key-affine distribution: the worker that owns the message's key gets it
+  // through its own single-producer / single-consumer queue.
+  if (message_router_) {
+    workers_[message_router_->SelectWorker(message)]->EnqueueMessage(
+        std::move(queued_message), overload_handler_);
+    return;
+  }
+  // Work-stealing distribution: the messages are dealt to the workers in
+  // turn and the idle workers steal from the ones that fall behind.
+  if (options_.dispatch_mode == DispatchMode::WorkStealing) {
+    workers_[next_worker_]->EnqueueMessage(std::move(queued_message),
+                                           overload_handler_);
+    next_worker_ = (next_worker_ + 1) % workers_.size();
+    return;
+  }
+
+  // Round-robin message distribution to the broker's workers. When the queue
+  // is full, the message is spilled to the disk, if it can be, or else the
+  // overload policy decides whether the subscriber waits for the workers to
+  // catch up or drops a message.
+  if (spill_queue_ && (message_queue_.TryPush(std::move(queued_message)) ||
+                       SpillMessage(queued_message, channel, message))) {
+    message_queue_event_count_.NotifyOne();
+    return;
+  }
+  if (overload_handler_.Push(message_queue_, std::move(queued_message))) {
+    message_queue_event_count_.NotifyOne();
+  }
+}
+
+bool RedisBrokerConsumer::SpillMessage(const PooledMessage &queued_message,
+                                       std::string_view channel,
+                                       std::string_view message) {
+  const SpilledMessageHeader header{
+      queued_message.channel_id, queued_message.channel_size,
+      queued_message.receive_time_in_nanoseconds,
+      queued_message.journal_sequence};
+  return spill_queue_->TryAppend({GetBytes(header), channel, message});
 }
 
-void RedisBrokerConsumer::ProcessMessage(const std::string &message) {
-  // Round-robin message distribution to the broker's workers
-  {
-    std::lock_guard<std::mutex> lock(queue_mutex_);
-    message_queue_.push(message);
+void RedisBrokerConsumer::ReplayJournal() {
+  const std::size_t number_of_recovered_messages =
+      journal_->GetNumberOfRecoveredRecords();
+  if (number_of_recovered_messages == 0) {
+    journal_->DiscardRecoveredRecords();
+    return;
+  }
+  LOG(LogLevel::Info,
+      "[RedisBrokerConsumer] Processing {} messages from the journal that "
+      "were not processed before the restart.",
+      number_of_recovered_messages);
+  long long number_of_unknown_subscriptions = 0;
+  bool is_replayed =
+      journal_->ReplayRecoveredRecords([&](std::string_view record) {
+        JournaledMessageHeader header;
+        if (record.size() < sizeof(header)) {
+          return;
+        }
+        std::memcpy(&header, record.data(), sizeof(header));
+        record.remove_prefix(sizeof(header));
+        if (record.size() <
+            std::size_t{header.subscription_name_size} + header.channel_size) {
+          return;
+        }
+        const std::string_view subscription_name =
+            record.substr(0, header.subscription_name_size);
+        record.remove_prefix(header.subscription_name_size);
+        const std::string_view channel = record.substr(0, header.channel_size);
+        record.remove_prefix(header.channel_size);
+        const ChannelId channel_id =
+            channel_table_.Find(subscription_name, header.is_pattern);
+        if (channel_id == kUnknownChannelId) {
+          ++number_of_unknown_subscriptions;
+          return;
+        }
+        ProcessMessage(channel_id, channel, record);
+      });
+  if (!is_replayed) {
+    ReportError(journal_->GetLastError());
+    exit(EXIT_FAILURE);
+  }
+  if (number_of_unknown_subscriptions > 0) {
+    LOG(LogLevel::Warning,
+        "[RedisBrokerConsumer] Skipped {} journaled messages of channels "
+        "that are no longer subscribed to.",
+        number_of_unknown_subscriptions);
   }
-  cv_.notify_one();
+  journal_->DiscardRecoveredRecords();
 }
 
 void RedisBrokerConsumer::SubscribeToChannel(
     const std::string &channel_name, const std::string &processing_stream) {
+  SubscribeToChannels({{channel_name, false, processing_stream}});
+}
+
+void RedisBrokerConsumer::SubscribeToChannels(
+    std::vector<ChannelSubscription> subscriptions) {
   if (!initial_connection_established_) {
     ReportError("Not connected to a Redis server! "
                 "Please, make sure that there is a running Redis server and "
@@ -292,96 +824,255 @@ void RedisBrokerConsumer::SubscribeToChannel(
     exit(EXIT_FAILURE);
   }
 
-  const std::string redis_channel_subscription_command =
-      CreateSubscriptionCommand(channel_name);
+  for (ChannelSubscription &subscription : subscriptions) {
+    if (!channel_table_.Add(std::move(subscription))) {
+      ReportError("Subscribed to the same channel or pattern twice!");
+      exit(EXIT_FAILURE);
+    }
+  }
+  channel_table_.SetDefaultMessageProcessor(
+      message_processor_impl_->GetMessageProcessor());
+
+  // The connection that the workers add the processed messages over.
+  std::string processing_hostname = redis_server_hostname_;
+  unsigned short processing_port = redis_server_port_;
+  if (sharded_subscriber_) {
+    SubscribeToShards(processing_hostname, processing_port);
+  } else {
+    const std::string redis_channel_subscription_command =
+        channel_table_.CreateSubscriptionCommands();
 
-  ssize_t bytes_sent = send(subscription_socket_file_descriptor_,
-                            redis_channel_subscription_command.c_str(),
-                            redis_channel_subscription_command.size(), 0);
-  if (bytes_sent < 0) {
-    ReportError("Failed to send the subscription command!");
-    close(subscription_socket_file_descriptor_);
-    exit(EXIT_FAILURE);
+    ssize_t bytes_sent = send(subscription_socket_file_descriptor_,
+                              redis_channel_subscription_command.c_str(),
+                              redis_channel_subscription_command.size(), 0);
+    if (bytes_sent !=
+        static_cast<ssize_t>(redis_channel_subscription_command.size())) {
+      ReportError("Failed to send the subscription command!");
+      close(subscription_socket_file_descriptor_);
+      exit(EXIT_FAILURE);
+    }
   }
 
-  subsciption_channel_ = channel_name;
   // If the subscription was successful, create the workers.
   for (int i = 0; i < number_of_workers_; ++i) {
     workers_.emplace_back(std::make_unique<BrokerWorker>(
-        message_processor_impl_, message_queue_, queue_mutex_, cv_,
-        subsciption_channel_, processing_stream, verbose_outputs_));
+        channel_table_, message_queue_, message_queue_event_count_,
+        verbose_outputs_, options_.xadd_pipeline_depth,
+        TimestampService(options_.timestamp_clock, options_.timestamp_format),
+        counters_.Register()));
+    if (options_.dispatch_mode != DispatchMode::RoundRobin) {
+      workers_.back()->UseOwnMessageQueue(GetWorkerQueueCapacity(
+          options_.broker_queue_capacity, number_of_workers_));
+    }
+    if (spill_queue_) {
+      workers_.back()->UseSpillQueue(*spill_queue_, message_buffer_pool_);
+    }
+    if (journal_) {
+      workers_.back()->UseJournal(*journal_);
+    }
     // If there's a processing stream, the broker consumer will try to establish
     // a connection to the Redis server and assign the socket to the worker. The
-    // worker's socket will be used to write to the processing stream.
-    if (!processing_stream.empty()) {
+    // worker's socket will be used to write to the processing streams.
+    if (channel_table_.HasProcessingStreams()) {
       int current_worker_socket_file_descriptor = -1;
-      EstablishConnection(redis_server_hostname_, redis_server_port_,
+      EstablishConnection(processing_hostname, processing_port,
                           current_worker_socket_file_descriptor);
       workers_.back()->SetWritingSocketFileDescriptor(
           current_worker_socket_file_descriptor);
     }
-    workers_.back()->Start();
   }
+  // The workers are started once all of them exist, as in work-stealing mode
+  // every worker can access the deques of the others.
+  if (options_.dispatch_mode == DispatchMode::WorkStealing) {
+    for (auto &worker : workers_) {
+      worker->EnableWorkStealing(workers_);
+    }
+  }
+  for (auto &worker : workers_) {
+    worker->Start();
+  }
+  // The messages of the previous run are processed before the new ones,
+  // which wait in the subscription connection in the meantime.
+  if (journal_) {
+    ReplayJournal();
+  }
+
+  // The parsed channel names and payloads are views into the reader's receive
+  // buffer, so no memory is allocated per received message. Every complete
+  // reply is handled before the next read.
+  auto handle_pubsub_message = [&](const PubSubMessage &pubsub_message) {
+    if (pubsub_message.kind == PubSubMessageKind::Subscribe) {
+      LOG(LogLevel::Info, "Subscribed to channel: {} ", pubsub_message.channel);
+    } else if (pubsub_message.kind == PubSubMessageKind::PatternSubscribe) {
+      LOG(LogLevel::Info, "Subscribed to pattern: {} ", pubsub_message.pattern);
+    } else if (pubsub_message.kind == PubSubMessageKind::ShardSubscribe) {
+      LOG(LogLevel::Info, "Subscribed to sharded channel: {} ",
+          pubsub_message.channel);
+    } else if (pubsub_message.kind == PubSubMessageKind::Message ||
+               pubsub_message.kind == PubSubMessageKind::PatternMessage ||
+               pubsub_message.kind == PubSubMessageKind::ShardMessage) {
+      if (verbose_outputs_) {
+        LOG_SAMPLED(LogLevel::Debug, kLogSamplesPerSecond,
+                    "Received message: {}", pubsub_message.payload);
+      }
+      // Sanity check: verify that the message was delivered for one of our
+      // subscriptions.
+      const ChannelId channel_id = channel_table_.Resolve(pubsub_message);
+      if (channel_id != kUnknownChannelId) {
+        ProcessMessage(channel_id, pubsub_message.channel,
+                       pubsub_message.payload);
+      }
+    }
+  };
+  PubSubMessage pubsub_message{};
+  auto handle_reply = [&](const RespParser &resp_parser) {
+    if (ParsePubSubMessage(resp_parser, pubsub_message)) {
+      handle_pubsub_message(pubsub_message);
+    }
+  };
 
-  redisReader *reader = redisReaderCreate();
-  if (reader == nullptr) {
-    ReportError("Failed to create a Redis reader!");
+  // The shards are read by a single event loop thread, so the messages are
+  // still handed to the workers by a single producer.
+  if (sharded_subscriber_) {
+    if (!sharded_subscriber_->Run(handle_pubsub_message)) {
+      ReportError(sharded_subscriber_->GetLastError());
+    }
     close(subscription_socket_file_descriptor_);
-    exit(EXIT_FAILURE);
+    return;
   }
 
-  char buffer[64] = {};
-  while (true) {
-    ssize_t bytes_read =
-        recv(subscription_socket_file_descriptor_, buffer, sizeof(buffer), 0);
-    if (bytes_read < 0) {
-      ReportError("Failed to read from the server!");
-      break;
+#ifdef HAS_IO_URING
+  // The workers keep their blocking connections. Only the subscription is
+  // read through the io_uring, without a system call per read.
+  if (options_.io_engine == IoEngine::IoUring) {
+    IoUringLoop io_uring_loop;
+    auto handle_data = [&](std::string_view data) {
+      if (data.empty()) {
+        ReportError(io_uring_loop.GetLastError());
+        io_uring_loop.Stop();
+      } else if (!subscription_reader_.ParseFrames(data, handle_reply)) {
+        ReportError(subscription_reader_.GetLastError());
+        io_uring_loop.Stop();
+      }
+    };
+    if (io_uring_loop.Initialize() &&
+        io_uring_loop.Receive(subscription_socket_file_descriptor_,
+                              handle_data)) {
+      if (!io_uring_loop.Run()) {
+        ReportError(io_uring_loop.GetLastError());
+      }
+      close(subscription_socket_file_descriptor_);
+      return;
     }
+    ReportError(io_uring_loop.GetLastError() +
+                " Falling back to blocking sockets.");
+  }
+#else
+  if (options_.io_engine == IoEngine::IoUring) {
+    ReportError("The client was built without io_uring support! Falling back "
+                "to blocking sockets.");
+  }
+#endif
 
-    if (redisReaderFeed(reader, buffer, bytes_read) != REDIS_OK) {
-      ReportError("Failed to feed the Redis reader!");
-      break;
+  subscription_reader_.SetFileDescriptor(subscription_socket_file_descriptor_);
+  while (subscription_reader_.ReadFrames(handle_reply)) {
+  }
+  ReportError(subscription_reader_.GetLastError());
+
+  close(subscription_socket_file_descriptor_);
+}
+
+void RedisBrokerConsumer::SubscribeToShards(std::string &processing_hostname,
+                                            unsigned short &processing_port) {
+  std::vector<std::string> channels;
+  std::string processing_stream;
+  for (ChannelId channel_id = 0;
+       channel_id < channel_table_.GetNumberOfSubscriptions(); ++channel_id) {
+    const ChannelSubscription &subscription = channel_table_.Get(channel_id);
+    if (subscription.is_pattern) {
+      ReportError("Sharded pub/sub does not support patterns! Pattern: " +
+                  subscription.name);
+      exit(EXIT_FAILURE);
+    }
+    channels.push_back(subscription.name);
+    if (subscription.processing_stream.empty()) {
+      continue;
     }
+    if (processing_stream.empty()) {
+      processing_stream = subscription.processing_stream;
+    } else if (GetHashSlot(subscription.processing_stream) !=
+               GetHashSlot(processing_stream)) {
+      ReportError("The processing streams " + processing_stream + " and " +
+                  subscription.processing_stream +
+                  " hash to different slots! Only the streams in the slot "
+                  "of the first one can be written to.");
+    }
+  }
 
-    void *reply = nullptr;
-    int status = redisReaderGetReply(reader, &reply);
-    if (status != REDIS_OK) {
-      ReportError("Failed to get a Redis reply!");
-      break;
+  if (!sharded_subscriber_->Subscribe(
+          {redis_server_hostname_, redis_server_port_}, channels)) {
+    ReportError(sharded_subscriber_->GetLastError());
+    close(subscription_socket_file_descriptor_);
+    exit(EXIT_FAILURE);
+  }
+  // In a cluster, a stream can only be written to on the node that owns its
+  // slot.
+  if (!processing_stream.empty()) {
+    const ClusterNode *processing_node =
+        sharded_subscriber_->GetTopology().GetNode(
+            GetHashSlot(processing_stream));
+    if (processing_node != nullptr) {
+      processing_hostname = processing_node->host;
+      processing_port = processing_node->port;
     }
+  }
+}
 
-    if (redisReply *r = (redisReply *)reply) {
-      if (r->type == REDIS_REPLY_ARRAY && r->elements == 3) {
-        if (!strcmp(r->element[0]->str, "subscribe")) {
-          std::cout << "Subscribed to channel: " << r->element[1]->str << " "
-                    << std::endl;
-        } else if (!strcmp(r->element[0]->str, "message")) {
-          if (verbose_outputs_) {
-            std::cout << "Received message: " << r->element[2]->str
-                      << std::endl;
-          }
-          // Sanity check: verify that the channel that sent the message was
-          // the one that we subscribed for.
+IngestStatistics RedisBrokerConsumer::GetIngestStatistics() const {
+  return sharded_subscriber_ ? sharded_subscriber_->GetStatistics()
+                             : subscription_reader_.GetStatistics();
+}
 
-          // assert(!strcmp(r->element[1]->str, channel_name.c_str()));
-          if (!strcmp(r->element[1]->str, channel_name.c_str())) {
-            ProcessMessage(r->element[2]->str);
-          }
-        }
-      }
-      // std::cout << std::endl;
-    }
+std::vector<WorkerStatistics>
+RedisBrokerConsumer::GetWorkerStatistics() const {
+  std::vector<WorkerStatistics> worker_statistics;
+  for (const auto &worker : workers_) {
+    worker_statistics.push_back(worker->GetStatistics());
   }
+  return worker_statistics;
+}
 
-  close(subscription_socket_file_descriptor_);
-  redisReaderFree(reader);
+long long RedisBrokerConsumer::GetNumberOfQueuedMessages() const {
+  return message_queue_.GetApproximateSize() +
+         (spill_queue_ ? spill_queue_->GetApproximateSize() : 0);
 }
 
-long long RedisBrokerConsumer::GetNumberOfProcessedMessages() const {
-  long long current_number_of_messages{0};
+QueueStatistics RedisBrokerConsumer::GetQueueStatistics() const {
+  // The workers' own queues all have the same capacity.
+  const long long capacity =
+      options_.dispatch_mode == DispatchMode::RoundRobin || workers_.empty()
+          ? message_queue_.GetCapacity()
+          : workers_.front()->GetOwnMessageQueueCapacity();
+  return {capacity, overload_handler_.GetHighWaterMark(),
+          overload_handler_.GetNumberOfDroppedMessages(),
+          spill_queue_ ? spill_queue_->GetNumberOfAppendedRecords() : 0,
+          spill_queue_ ? static_cast<long long>(
+                             spill_queue_->GetApproximateSize())
+                       : 0};
+}
+
+LatencyStatistics RedisBrokerConsumer::GetLatencyStatistics() const {
+  LatencyStatistics latency_statistics;
   for (const auto &worker : workers_) {
-    current_number_of_messages += worker->GetNumberOfProcessedMessages();
+    latency_statistics.Merge(worker->GetLatencyStatistics());
   }
-  return current_number_of_messages;
+  return latency_statistics;
+}
+
+long long RedisBrokerConsumer::GetNumberOfProcessedMessages() const {
+  return counters_.Read().Get(CounterId::ProcessedMessages);
+}
+
+CounterValues RedisBrokerConsumer::GetCounters() const {
+  return counters_.Read();
 }
\ No newline at end of file
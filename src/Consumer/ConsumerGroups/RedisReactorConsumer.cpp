@@ -0,0 +1,418 @@
+#include <arpa/inet.h>
+#include <assert.h>
+#include <chrono>
+#include <netdb.h>
+#include <optional>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "../../../include/Consumer/AsyncStreamWriter.hpp"
+#include "../../../include/Consumer/ConsumerGroups/RedisReactorConsumer.hpp"
+#include "../../../include/Consumer/JsonMessageProcessorImpl.hpp"
+#include "../../../include/Consumer/RedisConsumerUtils/redis_consumer_utils.hpp"
+
+namespace {
+// How long the destructor waits for events between the checks of the XADD
+// commands in flight.
+constexpr int kInFlightPollIntervalInMilliseconds = 1;
+} // namespace
+
+struct RedisReactorConsumer::Worker {
+  int id;
+  std::string identifier;
+  std::thread thread;
+  int writing_socket_file_descriptor = -1;
+  std::unique_ptr<AsyncStreamWriter> stream_writer;
+  TimestampService timestamp_service;
+
+  std::atomic<long long> number_of_processed_messages{0};
+  std::atomic<long long> number_of_processing_errors{0};
+  std::atomic<long long> busy_time_in_nanoseconds{0};
+};
+
+RedisReactorConsumer::RedisReactorConsumer(bool verbose_outputs,
+                                           int number_of_workers,
+                                           const ConsumerOptions &options)
+    : verbose_outputs_{verbose_outputs},
+      number_of_workers_{number_of_workers > 0 ? number_of_workers : 1},
+      options_(options), redis_server_hostname_{}, redis_server_port_{0},
+      subscription_socket_file_descriptor_{-1}, pubsub_message_{},
+      initial_connection_established_{false}, channel_table_{},
+      message_processor_(std::make_shared<JsonMessageProcessorImpl>()),
+      message_queue_(options.broker_queue_capacity), is_reading_paused_{false},
+      is_resume_posted_{false}, stop_{false} {
+  if (options_.number_of_reactor_threads < 1) {
+    options_.number_of_reactor_threads = 1;
+  }
+}
+
+RedisReactorConsumer::~RedisReactorConsumer() {
+  // The workers finish the queued messages while the loops are still running.
+  stop_ = true;
+  message_queue_event_count_.NotifyAll();
+  for (auto &worker : workers_) {
+    if (worker->thread.joinable()) {
+      worker->thread.join();
+    }
+  }
+  // Wait for the replies to the XADD commands in flight, so that every
+  // submitted message is counted. The first loop has already stopped with the
+  // subscription, so the writers that it serves are driven from here.
+  for (auto &worker : workers_) {
+    AsyncStreamWriter *stream_writer = worker->stream_writer.get();
+    while (stream_writer && stream_writer->GetNumberOfInFlightCommands() > 0 &&
+           !stream_writer->HasFailed()) {
+      if (event_loops_.size() > 1) {
+        std::this_thread::sleep_for(
+            std::chrono::milliseconds(kInFlightPollIntervalInMilliseconds));
+      } else if (!event_loops_[0]->RunOnce(
+                     kInFlightPollIntervalInMilliseconds)) {
+        ReportError(event_loops_[0]->GetLastError());
+        break;
+      }
+    }
+  }
+  for (auto &event_loop : event_loops_) {
+    event_loop->Stop();
+  }
+  for (auto &event_loop_thread : event_loop_threads_) {
+    event_loop_thread.join();
+  }
+  for (auto &worker : workers_) {
+    if (worker->writing_socket_file_descriptor != -1) {
+      close(worker->writing_socket_file_descriptor);
+    }
+  }
+}
+
+void RedisReactorConsumer::EstablishConnection(
+    const std::string &redis_server_hostname, unsigned short redis_server_port,
+    int &file_descriptor) const {
+  file_descriptor = socket(AF_INET, SOCK_STREAM, 0);
+  if (file_descriptor < 0) {
+    ReportError("Failed to create a socket!");
+    exit(EXIT_FAILURE);
+  }
+  sockaddr_in server_address;
+  server_address.sin_family = AF_INET;
+  server_address.sin_addr.s_addr = inet_addr(redis_server_hostname.c_str());
+  server_address.sin_port = htons(redis_server_port);
+
+  if (connect(file_descriptor, (struct sockaddr *)&server_address,
+              sizeof(server_address)) < 0) {
+    ReportError("Unable to connect to a Redis server!");
+    close(file_descriptor);
+    exit(EXIT_FAILURE);
+  }
+}
+
+void RedisReactorConsumer::EstablishConnection(
+    const std::string &redis_server_hostname,
+    unsigned short redis_server_port) {
+  EstablishConnection(redis_server_hostname, redis_server_port,
+                      subscription_socket_file_descriptor_);
+  redis_server_hostname_ = redis_server_hostname;
+  redis_server_port_ = redis_server_port;
+
+  initial_connection_established_ = true;
+  LOG(LogLevel::Info, "[RedisReactorConsumer] Connected to Redis server!");
+}
+
+void RedisReactorConsumer::SubscribeToChannel(
+    const std::string &channel_name, const std::string &processing_stream) {
+  SubscribeToChannels({{channel_name, false, processing_stream}});
+}
+
+void RedisReactorConsumer::SubscribeToChannels(
+    std::vector<ChannelSubscription> subscriptions) {
+  if (!initial_connection_established_) {
+    ReportError("Not connected to a Redis server! "
+                "Please, make sure that there is a running Redis server and "
+                "connect to it.");
+    exit(EXIT_FAILURE);
+  }
+
+  for (ChannelSubscription &subscription : subscriptions) {
+    if (!channel_table_.Add(std::move(subscription))) {
+      ReportError("Subscribed to the same channel or pattern twice!");
+      exit(EXIT_FAILURE);
+    }
+  }
+  channel_table_.SetDefaultMessageProcessor(message_processor_);
+
+  const std::string redis_channel_subscription_command =
+      channel_table_.CreateSubscriptionCommands();
+
+  ssize_t bytes_sent = send(subscription_socket_file_descriptor_,
+                            redis_channel_subscription_command.c_str(),
+                            redis_channel_subscription_command.size(), 0);
+  if (bytes_sent !=
+      static_cast<ssize_t>(redis_channel_subscription_command.size())) {
+    ReportError("Failed to send the subscription command!");
+    close(subscription_socket_file_descriptor_);
+    exit(EXIT_FAILURE);
+  }
+
+  for (std::size_t i = 0; i < options_.number_of_reactor_threads; ++i) {
+    event_loops_.emplace_back(std::make_unique<EventLoop>());
+    if (!event_loops_.back()->Initialize()) {
+      ReportError(event_loops_.back()->GetLastError());
+      exit(EXIT_FAILURE);
+    }
+  }
+
+  for (int i = 0; i < number_of_workers_; ++i) {
+    workers_.emplace_back(std::make_unique<Worker>());
+    Worker &worker = *workers_.back();
+    worker.id = i + 1;
+    worker.identifier = "[Reactor Worker " + std::to_string(worker.id) + "]";
+    worker.timestamp_service = TimestampService(options_.timestamp_clock,
+                                                options_.timestamp_format);
+    if (!channel_table_.HasProcessingStreams()) {
+      continue;
+    }
+
+    // The processing connections are kept off the subscription's loop when
+    // there are other loops.
+    EventLoop &event_loop =
+        event_loops_.size() == 1
+            ? *event_loops_[0]
+            : *event_loops_[1 + i % (event_loops_.size() - 1)];
+    EstablishConnection(redis_server_hostname_, redis_server_port_,
+                        worker.writing_socket_file_descriptor);
+    if (!MakeNonBlocking(worker.writing_socket_file_descriptor)) {
+      ReportError("Failed to make a processing connection non-blocking!");
+      exit(EXIT_FAILURE);
+    }
+    worker.stream_writer = std::make_unique<AsyncStreamWriter>(
+        event_loop, worker.writing_socket_file_descriptor,
+        options_.xadd_pipeline_depth,
+        [this, &worker](const StreamWriteResult &result) {
+          if (result.is_success) {
+            if (verbose_outputs_) {
+              LOG_SAMPLED(LogLevel::Debug, kLogSamplesPerSecond,
+                          "{} Successfully added the message to the stream "
+                          "for processed messages with id = {}",
+                          worker.identifier, result.reply);
+            }
+            worker.number_of_processed_messages++;
+          } else {
+            ReportError("Failed to add a message to the processing stream! " +
+                        std::string(result.reply));
+            worker.number_of_processing_errors++;
+          }
+        });
+    if (!worker.stream_writer->Start()) {
+      ReportError(worker.stream_writer->GetLastError());
+      exit(EXIT_FAILURE);
+    }
+  }
+
+  if (!MakeNonBlocking(subscription_socket_file_descriptor_)) {
+    ReportError("Failed to make the subscription connection non-blocking!");
+    exit(EXIT_FAILURE);
+  }
+  subscription_reader_.SetFileDescriptor(subscription_socket_file_descriptor_);
+  if (!event_loops_[0]->Watch(
+          subscription_socket_file_descriptor_, EPOLLIN,
+          [this](std::uint32_t events) { OnSubscriptionEvents(events); })) {
+    ReportError(event_loops_[0]->GetLastError());
+    exit(EXIT_FAILURE);
+  }
+
+  for (auto &worker : workers_) {
+    worker->thread = std::thread(&RedisReactorConsumer::ProcessMessages, this,
+                                 std::ref(*worker));
+  }
+  for (std::size_t i = 1; i < event_loops_.size(); ++i) {
+    event_loop_threads_.emplace_back(&EventLoop::Run, event_loops_[i].get());
+  }
+
+  event_loops_[0]->Run();
+  if (!event_loops_[0]->GetLastError().empty()) {
+    ReportError(event_loops_[0]->GetLastError());
+  }
+  close(subscription_socket_file_descriptor_);
+}
+
+void RedisReactorConsumer::OnSubscriptionEvents(std::uint32_t) {
+  if (!subscription_reader_.ReadFrames(
+          [this](const RespParser &resp_parser) {
+            HandleSubscriptionReply(resp_parser);
+          })) {
+    ReportError(subscription_reader_.GetLastError());
+    event_loops_[0]->Unwatch(subscription_socket_file_descriptor_);
+    event_loops_[0]->Stop();
+    return;
+  }
+  if (!message_backlog_.empty()) {
+    PauseReading();
+  }
+}
+
+void RedisReactorConsumer::HandleSubscriptionReply(
+    const RespParser &resp_parser) {
+  if (!ParsePubSubMessage(resp_parser, pubsub_message_)) {
+    return;
+  }
+  if (pubsub_message_.kind == PubSubMessageKind::Subscribe) {
+    LOG(LogLevel::Info, "Subscribed to channel: {} ", pubsub_message_.channel);
+  } else if (pubsub_message_.kind == PubSubMessageKind::PatternSubscribe) {
+    LOG(LogLevel::Info, "Subscribed to pattern: {} ", pubsub_message_.pattern);
+  } else if (pubsub_message_.kind == PubSubMessageKind::Message ||
+             pubsub_message_.kind == PubSubMessageKind::PatternMessage) {
+    if (verbose_outputs_) {
+      LOG_SAMPLED(LogLevel::Debug, kLogSamplesPerSecond,
+                  "Received message: {}", pubsub_message_.payload);
+    }
+    // Sanity check: verify that the message was delivered for one of our
+    // subscriptions.
+    const ChannelId channel_id = channel_table_.Resolve(pubsub_message_);
+    if (channel_id != kUnknownChannelId) {
+      QueueMessage(channel_id, pubsub_message_.channel,
+                   pubsub_message_.payload);
+    }
+  }
+}
+
+void RedisReactorConsumer::QueueMessage(ChannelId channel_id,
+                                        std::string_view channel,
+                                        std::string_view message) {
+  ReceivedMessage queued_message{channel_id, {}, std::string(message)};
+  if (channel_table_.Get(channel_id).is_pattern) {
+    queued_message.channel = channel;
+  }
+  // Keep the order of the messages: once there is a backlog, every message
+  // goes through it.
+  if (message_backlog_.empty() &&
+      message_queue_.TryPush(std::move(queued_message))) {
+    message_queue_event_count_.NotifyOne();
+    return;
+  }
+  message_backlog_.push_back(std::move(queued_message));
+}
+
+void RedisReactorConsumer::PauseReading() {
+  if (is_reading_paused_.load(std::memory_order_relaxed)) {
+    return;
+  }
+  if (!event_loops_[0]->UpdateEvents(subscription_socket_file_descriptor_,
+                                     0)) {
+    ReportError(event_loops_[0]->GetLastError());
+    return;
+  }
+  is_reading_paused_.store(true, std::memory_order_relaxed);
+  // The workers that emptied the queue before they saw the flag have not
+  // posted ResumeReading(), so the held back messages are moved right away.
+  // Pairs with the fence in ProcessMessages().
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  ResumeReading();
+}
+
+void RedisReactorConsumer::ResumeReading() {
+  is_resume_posted_.store(false, std::memory_order_release);
+  while (!message_backlog_.empty() &&
+         message_queue_.TryPush(std::move(message_backlog_.front()))) {
+    message_backlog_.pop_front();
+    message_queue_event_count_.NotifyOne();
+  }
+  // Otherwise the workers post another attempt once they take a message.
+  if (!message_backlog_.empty() ||
+      !is_reading_paused_.load(std::memory_order_relaxed)) {
+    return;
+  }
+  if (!event_loops_[0]->UpdateEvents(subscription_socket_file_descriptor_,
+                                     EPOLLIN)) {
+    ReportError(event_loops_[0]->GetLastError());
+    return;
+  }
+  is_reading_paused_.store(false, std::memory_order_release);
+}
+
+void RedisReactorConsumer::ProcessMessages(Worker &worker) {
+  LOG(LogLevel::Info, "{} ready!", worker.identifier);
+  ReceivedMessage message;
+  while (true) {
+    if (!message_queue_.TryPop(message)) {
+      if (stop_) {
+        break;
+      }
+      message_queue_event_count_.Wait(
+          [this] { return !message_queue_.IsEmpty() || stop_; });
+      continue;
+    }
+    // There is room in the queue again for the messages that were held back.
+    // Either this worker sees the flag or PauseReading() sees the room.
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (is_reading_paused_.load(std::memory_order_relaxed) &&
+        !is_resume_posted_.exchange(true, std::memory_order_acq_rel)) {
+      event_loops_[0]->Post([this]() { ResumeReading(); });
+    }
+
+    auto processing_start_time = std::chrono::steady_clock::now();
+    const ChannelSubscription &subscription =
+        channel_table_.Get(message.channel_id);
+    auto processed_message_opt =
+        subscription.message_processor->ProcessMessage(message.payload);
+    if (processed_message_opt) {
+      auto processed_message = processed_message_opt.value();
+      processed_message.processor_id = worker.id;
+      processed_message.processing_date_time =
+          worker.timestamp_service.Now();
+      processed_message.source_channel_name =
+          channel_table_.GetChannelName(message);
+
+      if (verbose_outputs_) {
+        LOG_SAMPLED(LogLevel::Debug, kLogSamplesPerSecond,
+                    "Post processing of message with id = ({}).\nProcessed "
+                    "by {} at {}, received from channel ({}).",
+                    processed_message.message_id, worker.identifier,
+                    processed_message.processing_date_time,
+                    processed_message.source_channel_name);
+      }
+
+      // The message is counted once Redis has replied to the XADD command.
+      if (!subscription.processing_stream.empty()) {
+        // A rejected command has already been completed, and counted as a
+        // processing error, by the writer's completion handler.
+        if (!worker.stream_writer->Submit(CreateWriteMessageToStreamCommand(
+                subscription.processing_stream, processed_message))) {
+          ReportError(worker.stream_writer->GetLastError());
+        }
+      } else {
+        worker.number_of_processed_messages++;
+      }
+    } else {
+      worker.number_of_processing_errors++;
+    }
+    worker.busy_time_in_nanoseconds +=
+        std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now() - processing_start_time)
+            .count();
+  }
+}
+
+long long RedisReactorConsumer::GetNumberOfProcessedMessages() const {
+  long long current_number_of_messages{0};
+  for (const auto &worker : workers_) {
+    current_number_of_messages += worker->number_of_processed_messages;
+  }
+  return current_number_of_messages;
+}
+
+std::vector<WorkerStatistics>
+RedisReactorConsumer::GetWorkerStatistics() const {
+  std::vector<WorkerStatistics> worker_statistics;
+  for (const auto &worker : workers_) {
+    // The workers share a single queue and do not steal messages.
+    worker_statistics.push_back(
+        {worker->id, worker->number_of_processed_messages, 0,
+         worker->busy_time_in_nanoseconds, worker->number_of_processing_errors,
+         worker->stream_writer ? static_cast<long long>(
+                                     worker->stream_writer
+                                         ->GetNumberOfInFlightCommands())
+                               : 0,
+         0});
+  }
+  return worker_statistics;
+}
@@ -0,0 +1,509 @@
+#include <arpa/inet.h>
+#include <chrono>
+#include <deque>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "../../../include/Concurrency/Backoff.hpp"
+#include "../../../include/Consumer/ConsumerGroups/RedisStreamConsumer.hpp"
+#include "../../../include/Consumer/JsonMessageProcessorImpl.hpp"
+#include "../../../include/Consumer/PipelinedStreamWriter.hpp"
+#include "../../../include/Consumer/RedisConsumerUtils/redis_consumer_utils.hpp"
+
+namespace {
+// The number of read entries that can wait for a worker.
+constexpr std::size_t kEntryQueueCapacity = 64 * 1024;
+// How often the size of the group's pending entries list is queried.
+constexpr std::chrono::seconds kPendingEntriesUpdateInterval{1};
+
+// The initial capacity of a worker's commands, which are reused.
+constexpr std::size_t kCommandCapacity = 4096;
+
+std::string CreateCommand(const std::vector<std::string> &arguments) {
+  std::string command;
+  RespWriter writer(command);
+  writer.AppendArrayHeader(arguments.size());
+  for (const std::string &argument : arguments) {
+    writer.AppendBulkString(argument);
+  }
+  return command;
+}
+} // namespace
+
+class RedisStreamConsumer::StreamWorker {
+public:
+  StreamWorker(const StreamGroupSubscription &subscription,
+               IMessageProcessor &message_processor,
+               MpmcRingBuffer<QueuedEntry> &entry_queue,
+               EventCount &entry_queue_event_count, bool verbose_outputs,
+               std::size_t xadd_pipeline_depth,
+               std::size_t acknowledgement_batch_size,
+               const TimestampService &timestamp_service)
+      : id_{next_id_++}, subscription_(subscription),
+        message_processor_(message_processor), entry_queue_(entry_queue),
+        entry_queue_event_count_(entry_queue_event_count),
+        verbose_outputs_{verbose_outputs},
+        xadd_pipeline_depth_{xadd_pipeline_depth},
+        acknowledgement_batch_size_{acknowledgement_batch_size},
+        timestamp_service_(timestamp_service),
+        writing_socket_file_descriptor_{-1}, stop_(false),
+        number_of_processed_messages_{0},
+        number_of_processing_errors_{0}, number_of_acknowledged_entries_{0},
+        busy_time_in_nanoseconds_{0} {
+    worker_identifier_ = "[Stream Worker " + std::to_string(id_) + "]";
+    acknowledgement_batch_.reserve(acknowledgement_batch_size_);
+    command_.reserve(kCommandCapacity);
+  }
+
+  void Start() { thread_ = std::thread(&StreamWorker::ProcessEntries, this); }
+
+  void Stop() {
+    stop_ = true;
+    entry_queue_event_count_.NotifyAll();
+    thread_.join();
+    if (writing_socket_file_descriptor_ != -1) {
+      close(writing_socket_file_descriptor_);
+    }
+  }
+
+  // The connection carries both the XADD and the XACK commands.
+  void SetWritingSocketFileDescriptor(int writing_socket_file_descriptor) {
+    writing_socket_file_descriptor_ = writing_socket_file_descriptor;
+    stream_writer_ = std::make_unique<PipelinedStreamWriter>(
+        writing_socket_file_descriptor_, xadd_pipeline_depth_,
+        [this](const StreamWriteResult &result) {
+          OnCommandCompleted(result);
+        });
+  }
+
+  void ReportError(const std::string &error_message) const {
+    LOG(LogLevel::Error, "{} {}", worker_identifier_, error_message);
+  }
+
+  long long GetNumberOfProcessedMessages() const {
+    return number_of_processed_messages_;
+  }
+
+  long long GetNumberOfAcknowledgedEntries() const {
+    return number_of_acknowledged_entries_;
+  }
+
+  WorkerStatistics GetStatistics() const {
+    return {id_,
+            number_of_processed_messages_,
+            0,
+            busy_time_in_nanoseconds_,
+            number_of_processing_errors_,
+            stream_writer_ ? static_cast<long long>(
+                                 stream_writer_->GetNumberOfInFlightCommands())
+                           : 0,
+            0};
+  }
+
+private:
+  // XADD commands are submitted with tag 0 and XACK commands with the
+  // number of acknowledged entries.
+  static constexpr std::uint64_t kAddToStreamTag = 0;
+
+  void ProcessEntries() {
+    LOG(LogLevel::Info, "{} ready!", worker_identifier_);
+    QueuedEntry entry;
+    while (true) {
+      if (!entry_queue_.TryPop(entry)) {
+        // Acknowledge everything that was processed before going idle or
+        // stopping.
+        FlushAcknowledgements();
+        if (stop_) {
+          break;
+        }
+        entry_queue_event_count_.Wait(
+            [this] { return !entry_queue_.IsEmpty() || stop_; });
+        continue;
+      }
+
+      auto processing_start_time = std::chrono::steady_clock::now();
+      ProcessEntry(entry);
+      if (acknowledgement_batch_.size() >= acknowledgement_batch_size_) {
+        SubmitAcknowledgements();
+      }
+      busy_time_in_nanoseconds_ +=
+          std::chrono::duration_cast<std::chrono::nanoseconds>(
+              std::chrono::steady_clock::now() - processing_start_time)
+              .count();
+    }
+    FlushAcknowledgements();
+  }
+
+  void ProcessEntry(QueuedEntry &entry) {
+    std::optional<Message> processed_message_opt;
+    if (entry.has_payload) {
+      processed_message_opt = message_processor_.ProcessMessage(entry.payload);
+    }
+    // Entries that cannot be processed would fail again when they are
+    // delivered again, so they are acknowledged as well.
+    if (!processed_message_opt) {
+      ReportError("Failed to process the stream entry " + entry.id + "!");
+      number_of_processing_errors_++;
+      acknowledgement_batch_.push_back(std::move(entry.id));
+      return;
+    }
+
+    Message &processed_message = processed_message_opt.value();
+    processed_message.processor_id = id_;
+    processed_message.processing_date_time = timestamp_service_.Now();
+    processed_message.source_channel_name = subscription_.stream;
+    if (verbose_outputs_) {
+      LOG_SAMPLED(LogLevel::Debug, kLogSamplesPerSecond,
+                  "{} Processed the stream entry {} with message id = ({}).",
+                  worker_identifier_, entry.id, processed_message.message_id);
+    }
+
+    if (subscription_.processing_stream.empty()) {
+      number_of_processed_messages_++;
+      acknowledgement_batch_.push_back(std::move(entry.id));
+      return;
+    }
+    // The entry is acknowledged once Redis has replied to the XADD command.
+    entries_awaiting_addition_.push_back(std::move(entry.id));
+    command_.clear();
+    AppendWriteMessageToStreamCommand(
+        command_, subscription_.processing_stream,
+        MessageView{processed_message.processor_id,
+                    processed_message.processing_date_time,
+                    processed_message.source_channel_name,
+                    processed_message.message_id});
+    if (!stream_writer_->Submit(command_, kAddToStreamTag)) {
+      ReportError(stream_writer_->GetLastError());
+    }
+  }
+
+  void OnCommandCompleted(const StreamWriteResult &result) {
+    if (result.tag != kAddToStreamTag) {
+      if (result.is_success) {
+        number_of_acknowledged_entries_ += result.tag;
+      } else {
+        ReportError("Failed to acknowledge " + std::to_string(result.tag) +
+                    " stream entries! " + std::string(result.reply));
+      }
+      return;
+    }
+
+    std::string entry_id = std::move(entries_awaiting_addition_.front());
+    entries_awaiting_addition_.pop_front();
+    // Entries that could not be added stay pending in the group.
+    if (!result.is_success) {
+      ReportError("Failed to add a message to the processing stream! " +
+                  std::string(result.reply));
+      number_of_processing_errors_++;
+      return;
+    }
+    number_of_processed_messages_++;
+    acknowledgement_batch_.push_back(std::move(entry_id));
+  }
+
+  void SubmitAcknowledgements() {
+    if (acknowledgement_batch_.empty()) {
+      return;
+    }
+    RespWriter writer(command_);
+    writer.Clear();
+    writer.AppendArrayHeader(acknowledgement_batch_.size() + 3);
+    writer.Append(kRespXack);
+    writer.AppendBulkString(subscription_.stream);
+    writer.AppendBulkString(subscription_.group);
+    for (const std::string &entry_id : acknowledgement_batch_) {
+      writer.AppendBulkString(entry_id);
+    }
+    const std::uint64_t number_of_entries = acknowledgement_batch_.size();
+    // Submit() may complete commands, which adds to the batch.
+    acknowledgement_batch_.clear();
+    if (!stream_writer_->Submit(command_, number_of_entries)) {
+      ReportError(stream_writer_->GetLastError());
+    }
+  }
+
+  // Waits for the outstanding XADD replies and acknowledges their entries.
+  void FlushAcknowledgements() {
+    if (stream_writer_->GetNumberOfInFlightCommands() > 0 &&
+        !stream_writer_->Flush()) {
+      ReportError(stream_writer_->GetLastError());
+    }
+    if (acknowledgement_batch_.empty()) {
+      return;
+    }
+    SubmitAcknowledgements();
+    if (!stream_writer_->Flush()) {
+      ReportError(stream_writer_->GetLastError());
+    }
+  }
+
+  static int next_id_;
+  int id_;
+  std::string worker_identifier_;
+
+  const StreamGroupSubscription &subscription_;
+  IMessageProcessor &message_processor_;
+  MpmcRingBuffer<QueuedEntry> &entry_queue_;
+  EventCount &entry_queue_event_count_;
+  std::thread thread_;
+
+  bool verbose_outputs_;
+  std::size_t xadd_pipeline_depth_;
+  std::size_t acknowledgement_batch_size_;
+  TimestampService timestamp_service_;
+
+  int writing_socket_file_descriptor_;
+  std::unique_ptr<PipelinedStreamWriter> stream_writer_;
+  // The ids of the entries whose XADD awaits a reply, in submission order.
+  std::deque<std::string> entries_awaiting_addition_;
+  std::vector<std::string> acknowledgement_batch_;
+  // The XADD or XACK command that is being submitted.
+  std::string command_;
+
+  std::atomic<bool> stop_;
+  std::atomic<long long> number_of_processed_messages_;
+  std::atomic<long long> number_of_processing_errors_;
+  std::atomic<long long> number_of_acknowledged_entries_;
+  std::atomic<long long> busy_time_in_nanoseconds_;
+};
+
+int RedisStreamConsumer::StreamWorker::next_id_ = 1;
+
+RedisStreamConsumer::RedisStreamConsumer(bool verbose_outputs,
+                                         int number_of_workers,
+                                         const ConsumerOptions &options)
+    : verbose_outputs_{verbose_outputs},
+      number_of_workers_{std::max(number_of_workers, 1)}, options_(options),
+      redis_server_hostname_{}, redis_server_port_{0},
+      reading_socket_file_descriptor_{-1},
+      initial_connection_established_{false},
+      message_processor_(std::make_shared<JsonMessageProcessorImpl>()),
+      entry_queue_(kEntryQueueCapacity), number_of_read_entries_{0},
+      number_of_pending_entries_{0} {}
+
+RedisStreamConsumer::~RedisStreamConsumer() {
+  for (auto &worker : workers_) {
+    worker->Stop();
+  }
+}
+
+void RedisStreamConsumer::EstablishConnection(
+    const std::string &redis_server_hostname, unsigned short redis_server_port,
+    int &file_descriptor) const {
+  file_descriptor = socket(AF_INET, SOCK_STREAM, 0);
+  if (file_descriptor < 0) {
+    ReportError("Failed to create a socket!");
+    exit(EXIT_FAILURE);
+  }
+  sockaddr_in server_address;
+  server_address.sin_family = AF_INET;
+  server_address.sin_addr.s_addr = inet_addr(redis_server_hostname.c_str());
+  server_address.sin_port = htons(redis_server_port);
+
+  if (connect(file_descriptor, (struct sockaddr *)&server_address,
+              sizeof(server_address)) < 0) {
+    ReportError("Unable to connect to a Redis server!");
+    close(file_descriptor);
+    exit(EXIT_FAILURE);
+  }
+}
+
+void RedisStreamConsumer::EstablishConnection(
+    const std::string &redis_server_hostname,
+    unsigned short redis_server_port) {
+  EstablishConnection(redis_server_hostname, redis_server_port,
+                      reading_socket_file_descriptor_);
+  reader_.SetFileDescriptor(reading_socket_file_descriptor_);
+  redis_server_hostname_ = redis_server_hostname;
+  redis_server_port_ = redis_server_port;
+
+  initial_connection_established_ = true;
+  LOG(LogLevel::Info, "[RedisStreamConsumer] Connected to Redis server!");
+}
+
+template <typename ReplyHandler>
+bool RedisStreamConsumer::Execute(const std::string &command,
+                                  ReplyHandler &&reply_handler) {
+  ssize_t bytes_sent = send(reading_socket_file_descriptor_, command.c_str(),
+                            command.size(), MSG_NOSIGNAL);
+  if (bytes_sent != static_cast<ssize_t>(command.size())) {
+    ReportError("Failed to send a command to the Redis server!");
+    return false;
+  }
+  bool is_replied = false;
+  while (!is_replied) {
+    if (!reader_.ReadFrames([&](const RespParser &reply) {
+          is_replied = true;
+          reply_handler(reply);
+        })) {
+      ReportError(reader_.GetLastError());
+      return false;
+    }
+  }
+  return true;
+}
+
+bool RedisStreamConsumer::CreateGroup() {
+  bool is_created = false;
+  const bool is_replied = Execute(
+      CreateCommand({"XGROUP", "CREATE", subscription_.stream,
+                     subscription_.group, "$", "MKSTREAM"}),
+      [&](const RespParser &reply) {
+        const RespValue &root = reply.Root();
+        // The group may have been created by another consumer already.
+        is_created = !root.IsError() ||
+                     root.string.substr(0, 9) == "BUSYGROUP";
+        if (!is_created) {
+          ReportError("Failed to create the consumer group! " +
+                      std::string(root.string));
+        }
+      });
+  return is_replied && is_created;
+}
+
+void RedisStreamConsumer::UpdatePendingEntries() {
+  (void)Execute(
+      CreateCommand({"XPENDING", subscription_.stream, subscription_.group}),
+      [this](const RespParser &reply) {
+        const RespValue *number_of_pending_entries =
+            reply.Child(reply.Root(), 0);
+        if (number_of_pending_entries != nullptr &&
+            number_of_pending_entries->type == RespType::Integer) {
+          number_of_pending_entries_ = number_of_pending_entries->integer;
+        }
+      });
+}
+
+void RedisStreamConsumer::ConsumeStream(StreamGroupSubscription subscription) {
+  if (!initial_connection_established_) {
+    ReportError("Not connected to a Redis server! "
+                "Please, make sure that there is a running Redis server and "
+                "connect to it.");
+    exit(EXIT_FAILURE);
+  }
+  subscription_ = std::move(subscription);
+  if (!CreateGroup()) {
+    close(reading_socket_file_descriptor_);
+    exit(EXIT_FAILURE);
+  }
+
+  for (int i = 0; i < number_of_workers_; ++i) {
+    workers_.emplace_back(std::make_unique<StreamWorker>(
+        subscription_, *message_processor_, entry_queue_,
+        entry_queue_event_count_, verbose_outputs_,
+        options_.xadd_pipeline_depth, options_.xreadgroup_count,
+        TimestampService(options_.timestamp_clock,
+                         options_.timestamp_format)));
+    int worker_socket_file_descriptor = -1;
+    EstablishConnection(redis_server_hostname_, redis_server_port_,
+                        worker_socket_file_descriptor);
+    workers_.back()->SetWritingSocketFileDescriptor(
+        worker_socket_file_descriptor);
+    workers_.back()->Start();
+  }
+  LOG(LogLevel::Info, "Reading stream {} as consumer {} of group {}",
+      subscription_.stream, subscription_.consumer, subscription_.group);
+
+  // The entries that were delivered to this consumer before, but not
+  // acknowledged, are read from id 0 on. Once there are none left, only new
+  // entries are read.
+  std::string next_entry_id = "0";
+  std::vector<std::string> read_arguments = {
+      "XREADGROUP",
+      "GROUP",
+      subscription_.group,
+      subscription_.consumer,
+      "COUNT",
+      std::to_string(options_.xreadgroup_count),
+      "BLOCK",
+      std::to_string(options_.xreadgroup_block_in_milliseconds),
+      "STREAMS",
+      subscription_.stream,
+      ">"};
+  const std::string read_new_entries_command = CreateCommand(read_arguments);
+  std::string read_history_command;
+
+  std::vector<StreamEntry> entries;
+  std::string reply_error;
+  auto handle_entries = [&](const RespParser &reply) {
+    if (reply.Root().IsError()) {
+      reply_error = std::string(reply.Root().string);
+      return;
+    }
+    if (!ParseStreamEntries(reply, subscription_.payload_field, entries)) {
+      reply_error = "Received a malformed XREADGROUP reply!";
+      return;
+    }
+    for (const StreamEntry &entry : entries) {
+      QueuedEntry queued_entry{std::string(entry.id),
+                               std::string(entry.payload), entry.has_payload};
+      // When the queue is full the reader waits for the workers to catch
+      // up, and the entries stay in the stream.
+      Backoff backoff;
+      while (!entry_queue_.TryPush(std::move(queued_entry))) {
+        backoff.Pause();
+      }
+      entry_queue_event_count_.NotifyOne();
+    }
+    number_of_read_entries_ += entries.size();
+    if (next_entry_id != ">") {
+      next_entry_id = entries.empty() ? ">" : std::string(entries.back().id);
+    }
+  };
+
+  auto last_pending_entries_update = std::chrono::steady_clock::now();
+  while (true) {
+    reply_error.clear();
+    const std::string *command = &read_new_entries_command;
+    if (next_entry_id != ">") {
+      read_arguments.back() = next_entry_id;
+      read_history_command = CreateCommand(read_arguments);
+      command = &read_history_command;
+    }
+    if (!Execute(*command, handle_entries)) {
+      break;
+    }
+    if (!reply_error.empty()) {
+      // The group was deleted while the consumer was running.
+      if (reply_error.substr(0, 7) == "NOGROUP" && CreateGroup()) {
+        continue;
+      }
+      ReportError("Failed to read the stream! " + reply_error);
+      break;
+    }
+    if (std::chrono::steady_clock::now() - last_pending_entries_update >=
+        kPendingEntriesUpdateInterval) {
+      UpdatePendingEntries();
+      last_pending_entries_update = std::chrono::steady_clock::now();
+    }
+  }
+  close(reading_socket_file_descriptor_);
+}
+
+long long RedisStreamConsumer::GetNumberOfProcessedMessages() const {
+  long long number_of_processed_messages = 0;
+  for (const auto &worker : workers_) {
+    number_of_processed_messages += worker->GetNumberOfProcessedMessages();
+  }
+  return number_of_processed_messages;
+}
+
+std::vector<WorkerStatistics>
+RedisStreamConsumer::GetWorkerStatistics() const {
+  std::vector<WorkerStatistics> worker_statistics;
+  for (const auto &worker : workers_) {
+    worker_statistics.push_back(worker->GetStatistics());
+  }
+  return worker_statistics;
+}
+
+std::optional<PendingEntryStatistics>
+RedisStreamConsumer::GetPendingEntryStatistics() const {
+  long long number_of_acknowledged_entries = 0;
+  for (const auto &worker : workers_) {
+    number_of_acknowledged_entries += worker->GetNumberOfAcknowledgedEntries();
+  }
+  return PendingEntryStatistics{
+      number_of_read_entries_ - number_of_acknowledged_entries,
+      number_of_pending_entries_, number_of_acknowledged_entries};
+}
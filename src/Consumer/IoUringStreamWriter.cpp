@@ -0,0 +1,140 @@
+#ifdef HAS_IO_URING
+#include "../../include/Consumer/IoUringStreamWriter.hpp"
+
+namespace {
+// Buffered commands are sent as soon as they exceed this size.
+constexpr std::size_t kMaximumBufferedOutput = 64 * 1024;
+} // namespace
+
+IoUringStreamWriter::IoUringStreamWriter(IoUringLoop &io_uring_loop,
+                                         int file_descriptor,
+                                         std::size_t max_in_flight,
+                                         CompletionHandler completion_handler)
+    : io_uring_loop_(io_uring_loop), file_descriptor_{file_descriptor},
+      max_in_flight_{max_in_flight > 0 ? max_in_flight : 1},
+      completion_handler_(std::move(completion_handler)), has_failed_{false},
+      output_buffer_{}, sending_buffer_{}, is_sending_{false},
+      pending_tags_(max_in_flight_), pending_head_{0},
+      number_of_pending_commands_{0},
+      reply_reader_(file_descriptor, RespReceiveBuffer::kMinimumReadSize),
+      last_error_{} {
+  output_buffer_.reserve(kMaximumBufferedOutput);
+  sending_buffer_.reserve(kMaximumBufferedOutput);
+}
+
+bool IoUringStreamWriter::Start() {
+  if (!io_uring_loop_.Receive(file_descriptor_, [this](std::string_view data) {
+        OnReceive(data);
+      })) {
+    last_error_ = io_uring_loop_.GetLastError();
+    return false;
+  }
+  return true;
+}
+
+bool IoUringStreamWriter::Submit(std::string_view resp_formatted_command,
+                                 std::uint64_t tag) {
+  while (!has_failed_ && number_of_pending_commands_ == max_in_flight_) {
+    if (!Flush()) {
+      break;
+    }
+    if (!io_uring_loop_.RunOnce()) {
+      Fail(io_uring_loop_.GetLastError());
+    }
+  }
+  if (has_failed_) {
+    completion_handler_({false, last_error_, tag});
+    return false;
+  }
+
+  output_buffer_.append(resp_formatted_command);
+  pending_tags_[(pending_head_ + number_of_pending_commands_) %
+                max_in_flight_] = tag;
+  ++number_of_pending_commands_;
+
+  if (output_buffer_.size() >= kMaximumBufferedOutput) {
+    return Flush();
+  }
+  return true;
+}
+
+bool IoUringStreamWriter::Flush() {
+  if (has_failed_) {
+    return false;
+  }
+  // The commands are sent once the current send has completed.
+  if (is_sending_ || output_buffer_.empty()) {
+    return true;
+  }
+
+  std::swap(output_buffer_, sending_buffer_);
+  output_buffer_.clear();
+  is_sending_ = true;
+  if (!io_uring_loop_.Send(
+          file_descriptor_, sending_buffer_,
+          [this](bool is_success) { OnSendCompleted(is_success); })) {
+    is_sending_ = false;
+    Fail(io_uring_loop_.GetLastError());
+    return false;
+  }
+  return true;
+}
+
+void IoUringStreamWriter::OnSendCompleted(bool is_success) {
+  is_sending_ = false;
+  if (!is_success) {
+    Fail(io_uring_loop_.GetLastError());
+    return;
+  }
+  // Send the commands that were submitted in the meantime.
+  (void)Flush();
+}
+
+void IoUringStreamWriter::OnReceive(std::string_view data) {
+  if (has_failed_) {
+    return;
+  }
+  if (data.empty()) {
+    Fail(io_uring_loop_.GetLastError());
+    return;
+  }
+
+  bool has_unexpected_reply = false;
+  bool is_valid_data = reply_reader_.ParseFrames(
+      data, [this, &has_unexpected_reply](const RespParser &parser) {
+        if (number_of_pending_commands_ == 0) {
+          has_unexpected_reply = true;
+          return;
+        }
+
+        const RespValue &reply = parser.Root();
+        StreamWriteResult result{!reply.IsError() && !reply.is_null,
+                                 reply.string, pending_tags_[pending_head_]};
+        pending_head_ = (pending_head_ + 1) % max_in_flight_;
+        --number_of_pending_commands_;
+        completion_handler_(result);
+      });
+
+  if (!is_valid_data) {
+    Fail(reply_reader_.GetLastError());
+  } else if (has_unexpected_reply) {
+    Fail("Received a reply that does not belong to any command!");
+  }
+}
+
+void IoUringStreamWriter::Fail(const std::string &error) {
+  if (has_failed_) {
+    return;
+  }
+  has_failed_ = true;
+  last_error_ = error;
+  while (number_of_pending_commands_ > 0) {
+    StreamWriteResult result{false, last_error_, pending_tags_[pending_head_]};
+    pending_head_ = (pending_head_ + 1) % max_in_flight_;
+    --number_of_pending_commands_;
+    completion_handler_(result);
+  }
+  // The sending buffer may still be in use by the kernel.
+  output_buffer_.clear();
+}
+#endif
@@ -1,22 +1,30 @@
 #include "../../include/Consumer/JsonMessageProcessorImpl.hpp"
-#include <iostream>
+#include <iterator>
+
+#include "../../include/Parsing/JsonFieldExtractor.hpp"
 
 std::optional<Message>
-JsonMessageProcessorImpl::ProcessMessage(const std::string &json) {
-  // Simple sanity check that there's a message_id in the json
-  if (json.find("message_id") == std::string::npos) {
+JsonMessageProcessorImpl::ProcessMessage(std::string_view json) {
+  auto message_id = ExtractJsonField(json, "message_id");
+  if (!message_id) {
     return {};
   }
+  Message processed_message{};
+  processed_message.message_id = std::string(*message_id);
+  return processed_message;
+}
 
-  auto end = json.find_last_of('\"');
-  if (end != std::string::npos) {
-    auto start = json.find_last_of('\"', end - 1);
-    if (start != std::string::npos) {
-      Message msg = {.message_id = json.substr(start + 1, end - start - 1)};
-      // std::cout << "Extracted:[" << msg.message_id << "]" << std::endl;
-      return msg;
-    }
+bool JsonMessageProcessorImpl::ProcessMessageInPlace(std::string_view json,
+                                                     MessageView &message,
+                                                     std::string &) {
+  static constexpr std::string_view kFieldNames[] = {"message_id",
+                                                     "publish_time_ns"};
+  std::optional<std::string_view> values[std::size(kFieldNames)];
+  if (!ExtractJsonFields(json, kFieldNames, values, std::size(kFieldNames)) ||
+      !values[0]) {
+    return false;
   }
-
-  return {};
-}
\ No newline at end of file
+  message.message_id = *values[0];
+  message.publish_time = values[1].value_or(std::string_view());
+  return true;
+}
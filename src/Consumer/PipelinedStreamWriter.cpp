@@ -0,0 +1,124 @@
+#include <cerrno>
+#include <sys/socket.h>
+
+#include "../../include/Consumer/PipelinedStreamWriter.hpp"
+
+namespace {
+// Buffered commands are sent as soon as they exceed this size.
+constexpr std::size_t kMaximumBufferedOutput = 64 * 1024;
+} // namespace
+
+PipelinedStreamWriter::PipelinedStreamWriter(
+    int file_descriptor, std::size_t max_in_flight,
+    CompletionHandler completion_handler)
+    : file_descriptor_{file_descriptor},
+      max_in_flight_{max_in_flight > 0 ? max_in_flight : 1},
+      completion_handler_(std::move(completion_handler)), output_buffer_{},
+      pending_tags_(max_in_flight_), pending_head_{0},
+      number_of_pending_commands_{0}, number_of_in_flight_commands_{0},
+      number_of_sends_{0},
+      reply_reader_(file_descriptor, RespReceiveBuffer::kMinimumReadSize),
+      last_error_{} {
+  output_buffer_.reserve(kMaximumBufferedOutput);
+}
+
+bool PipelinedStreamWriter::Submit(std::string_view resp_formatted_command,
+                                   std::uint64_t tag) {
+  while (number_of_pending_commands_ == max_in_flight_) {
+    if (!SendOutputBuffer() || !ReadReplies()) {
+      FailPendingCommands();
+      completion_handler_({false, last_error_, tag});
+      return false;
+    }
+  }
+
+  output_buffer_.append(resp_formatted_command);
+  pending_tags_[(pending_head_ + number_of_pending_commands_) %
+                max_in_flight_] = tag;
+  ++number_of_pending_commands_;
+  number_of_in_flight_commands_.store(number_of_pending_commands_,
+                                      std::memory_order_relaxed);
+
+  if (output_buffer_.size() >= kMaximumBufferedOutput) {
+    if (!SendOutputBuffer()) {
+      FailPendingCommands();
+      return false;
+    }
+  }
+  return true;
+}
+
+bool PipelinedStreamWriter::Flush() {
+  if (!SendOutputBuffer()) {
+    FailPendingCommands();
+    return false;
+  }
+  while (number_of_pending_commands_ > 0) {
+    if (!ReadReplies()) {
+      FailPendingCommands();
+      return false;
+    }
+  }
+  return true;
+}
+
+bool PipelinedStreamWriter::SendOutputBuffer() {
+  std::size_t bytes_sent = 0;
+  while (bytes_sent < output_buffer_.size()) {
+    ssize_t result = send(file_descriptor_, output_buffer_.data() + bytes_sent,
+                          output_buffer_.size() - bytes_sent, MSG_NOSIGNAL);
+    ++number_of_sends_;
+    if (result < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      last_error_ = "Failed to send the xadd command!";
+      output_buffer_.clear();
+      return false;
+    }
+    bytes_sent += result;
+  }
+  output_buffer_.clear();
+  return true;
+}
+
+bool PipelinedStreamWriter::ReadReplies() {
+  bool has_unexpected_reply = false;
+  bool is_successful_read = reply_reader_.ReadFrames(
+      [this, &has_unexpected_reply](const RespParser &parser) {
+        if (number_of_pending_commands_ == 0) {
+          has_unexpected_reply = true;
+          return;
+        }
+
+        const RespValue &reply = parser.Root();
+        StreamWriteResult result{!reply.IsError() && !reply.is_null,
+                                 reply.string, pending_tags_[pending_head_]};
+        pending_head_ = (pending_head_ + 1) % max_in_flight_;
+        --number_of_pending_commands_;
+        number_of_in_flight_commands_.store(number_of_pending_commands_,
+                                            std::memory_order_relaxed);
+        completion_handler_(result);
+      });
+
+  if (!is_successful_read) {
+    last_error_ = reply_reader_.GetLastError();
+    return false;
+  }
+  if (has_unexpected_reply) {
+    last_error_ = "Received a reply that does not belong to any command!";
+    return false;
+  }
+  return true;
+}
+
+void PipelinedStreamWriter::FailPendingCommands() {
+  while (number_of_pending_commands_ > 0) {
+    StreamWriteResult result{false, last_error_, pending_tags_[pending_head_]};
+    pending_head_ = (pending_head_ + 1) % max_in_flight_;
+    --number_of_pending_commands_;
+    completion_handler_(result);
+  }
+  number_of_in_flight_commands_.store(0, std::memory_order_relaxed);
+  output_buffer_.clear();
+}
@@ -6,11 +6,11 @@
 #include <sys/socket.h>
 #include <unistd.h>
 
-#include <hiredis/hiredis.h>
-
 #include <sstream>
 
+#include "../../include/Consumer/IoUringStreamWriter.hpp"
 #include "../../include/Consumer/JsonMessageProcessorImpl.hpp"
+#include "../../include/Consumer/PipelinedStreamWriter.hpp"
 #include "../../include/Consumer/RedisConsumer.hpp"
 #include "../../include/Consumer/RedisConsumerUtils/redis_consumer_utils.hpp"
 
@@ -19,26 +19,31 @@ int RedisConsumer::next_id_ = 1;
 class RedisConsumer::MessageProcessorImpl {
 public:
   MessageProcessorImpl()
-      : message_processor_(std::make_unique<JsonMessageProcessorImpl>()) {}
+      : message_processor_(std::make_shared<JsonMessageProcessorImpl>()) {}
 
-  std::optional<Message> ProcessMessage(const std::string &message) {
+  std::optional<Message> ProcessMessage(std::string_view message) {
     return message_processor_->ProcessMessage(message);
   }
 
+  const std::shared_ptr<IMessageProcessor> &GetMessageProcessor() const {
+    return message_processor_;
+  }
+
 private:
-  std::unique_ptr<IMessageProcessor> message_processor_;
+  std::shared_ptr<IMessageProcessor> message_processor_;
 };
 
-RedisConsumer::RedisConsumer(bool verbose_outputs)
-    : id_{next_id_++}, redis_server_hostname_{}, redis_server_port_{0},
+RedisConsumer::RedisConsumer(bool verbose_outputs,
+                             const ConsumerOptions &options)
+    : message_processor_impl_(std::make_unique<MessageProcessorImpl>()),
+      id_{next_id_++}, verbose_outputs_{verbose_outputs}, options_(options),
+      timestamp_service_(options.timestamp_clock, options.timestamp_format),
+      redis_server_hostname_{}, redis_server_port_{0},
       subscription_socket_file_descriptor_{-1},
       processing_socket_file_descriptor_{-1},
       initial_connection_established_{false},
-      write_connection_established_{false}, subsciption_channel_{},
-      processing_stream_{}, number_of_processed_messages_{0},
-      number_of_processing_errors_{0},
-      message_processor_impl_(std::make_unique<MessageProcessorImpl>()),
-      verbose_outputs_{verbose_outputs} {}
+      write_connection_established_{false}, channel_table_{},
+      number_of_processed_messages_{0}, number_of_processing_errors_{0} {}
 RedisConsumer::~RedisConsumer() = default;
 
 void RedisConsumer::EstablishConnection(
@@ -71,37 +76,35 @@ void RedisConsumer::EstablishConnection(
   redis_server_port_ = redis_server_port;
 
   initial_connection_established_ = true;
-  std::cout << "Connected to Redis server!" << std::endl;
+  LOG(LogLevel::Info, "Connected to Redis server!");
 }
 
-void RedisConsumer::ProcessMessage(const std::string &message) {
+void RedisConsumer::ProcessMessage(ChannelId channel_id,
+                                   std::string_view channel,
+                                   std::string_view message) {
+  const ChannelSubscription &subscription = channel_table_.Get(channel_id);
   std::optional<Message> processed_message_opt =
-      message_processor_impl_->ProcessMessage(message);
+      subscription.message_processor->ProcessMessage(message);
   if (processed_message_opt) {
     auto processed_message = processed_message_opt.value();
     processed_message.processor_id = id_;
-    processed_message.processing_date_time = GetCurrentTime();
-    processed_message.source_channel_name = subsciption_channel_;
-    std::cout << "Post processing of message with id = ("
-              << processed_message.message_id << ")." << std::endl
-              << "Processed by consumer with id = "
-              << processed_message.processor_id << " at "
-              << processed_message.processing_date_time
-              << ", received from channel ("
-              << processed_message.source_channel_name << ")." << std::endl;
-    // XADD
-    if (!processing_stream_.empty()) {
-      if (AddDataToStream(CreateWriteMessageToStreamCommand(processing_stream_,
-                                                            processed_message),
-                          true)) {
-        if (verbose_outputs_) {
-          std::cout << "Successfully added the message to the target stream "
-                       "for processed messages!"
-                    << std::endl;
-        }
-        number_of_processed_messages_++;
-      } else {
-        number_of_processing_errors_++;
+    processed_message.processing_date_time = timestamp_service_.Now();
+    processed_message.source_channel_name = channel;
+    if (verbose_outputs_) {
+      LOG_SAMPLED(LogLevel::Debug, kLogSamplesPerSecond,
+                  "Post processing of message with id = ({}).\nProcessed by "
+                  "consumer with id = {} at {}, received from channel ({}).",
+                  processed_message.message_id, processed_message.processor_id,
+                  processed_message.processing_date_time,
+                  processed_message.source_channel_name);
+    }
+    // XADD - the message is counted once Redis has replied to the command.
+    if (!subscription.processing_stream.empty()) {
+      // A rejected command has already been completed, and counted as a
+      // processing error, by OnStreamWriteCompleted().
+      if (!processing_writer_->Submit(CreateWriteMessageToStreamCommand(
+              subscription.processing_stream, processed_message))) {
+        ReportError(processing_writer_->GetLastError());
       }
     } else {
       number_of_processed_messages_++;
@@ -110,17 +113,42 @@ void RedisConsumer::ProcessMessage(const std::string &message) {
     number_of_processing_errors_++;
   }
 
-  std::cout << "Messages processed so far: " << number_of_processed_messages_
-            << std::endl;
+  if (verbose_outputs_) {
+    LOG_SAMPLED(LogLevel::Debug, kLogSamplesPerSecond,
+                "Messages processed so far: {}",
+                number_of_processed_messages_.load());
+
+    if (number_of_processing_errors_) {
+      LOG_SAMPLED(LogLevel::Debug, kLogSamplesPerSecond,
+                  "Number of encountered processing errors: {}",
+                  number_of_processing_errors_.load());
+    }
+  }
+}
 
-  if (number_of_processing_errors_) {
-    std::cout << "Number of encountered processing errors: "
-              << number_of_processing_errors_ << std::endl;
+void RedisConsumer::OnStreamWriteCompleted(const StreamWriteResult &result) {
+  if (result.is_success) {
+    if (verbose_outputs_) {
+      LOG_SAMPLED(LogLevel::Debug, kLogSamplesPerSecond,
+                  "Successfully added the message to the target stream for "
+                  "processed messages with id = {}",
+                  result.reply);
+    }
+    number_of_processed_messages_++;
+  } else {
+    ReportError("Failed to add a message to the processing stream! " +
+                std::string(result.reply));
+    number_of_processing_errors_++;
   }
 }
 
 void RedisConsumer::SubscribeToChannel(const std::string &channel_name,
                                        const std::string &processing_stream) {
+  SubscribeToChannels({{channel_name, false, processing_stream}});
+}
+
+void RedisConsumer::SubscribeToChannels(
+    std::vector<ChannelSubscription> subscriptions) {
   if (!initial_connection_established_) {
     ReportError("The client is not connected to a Redis server! "
                 "Please, make sure that there is a running Redis server and "
@@ -128,183 +156,187 @@ void RedisConsumer::SubscribeToChannel(const std::string &channel_name,
     exit(EXIT_FAILURE);
   }
 
+  for (ChannelSubscription &subscription : subscriptions) {
+    if (!channel_table_.Add(std::move(subscription))) {
+      ReportError("Subscribed to the same channel or pattern twice!");
+      exit(EXIT_FAILURE);
+    }
+  }
+  channel_table_.SetDefaultMessageProcessor(
+      message_processor_impl_->GetMessageProcessor());
+
   const std::string redis_channel_subscription_command =
-      CreateSubscriptionCommand(channel_name);
+      channel_table_.CreateSubscriptionCommands();
 
   ssize_t bytes_sent = send(subscription_socket_file_descriptor_,
                             redis_channel_subscription_command.c_str(),
                             redis_channel_subscription_command.size(), 0);
-  if (bytes_sent < 0) {
+  if (bytes_sent !=
+      static_cast<ssize_t>(redis_channel_subscription_command.size())) {
     ReportError("Failed to send the subscription command!");
     close(subscription_socket_file_descriptor_);
     exit(EXIT_FAILURE);
   }
 
-  subsciption_channel_ = channel_name;
-  if (!processing_stream.empty()) {
-    EstablishConnection(redis_server_hostname_, redis_server_port_,
-                        processing_socket_file_descriptor_);
-    write_connection_established_ = true;
-    processing_stream_ = processing_stream;
-    std::cout
-        << "Successfully established a connection for message processing!"
-        << std::endl
-        << "Processing stream set to: " << processing_stream_
-        << ". All successfully processed messages will be added to that stream!"
-        << std::endl;
-  }
-
-  redisReader *reader = redisReaderCreate();
-  if (reader == nullptr) {
-    ReportError("Failed to create a Redis reader!");
-    close(subscription_socket_file_descriptor_);
-    exit(EXIT_FAILURE);
-  }
-
-  char buffer[64] = {};
-  // int msg_idx{0};
-  while (true) {
-    ssize_t bytes_read =
-        recv(subscription_socket_file_descriptor_, buffer, sizeof(buffer), 0);
-    if (bytes_read < 0) {
-      ReportError("Failed to read from the server!");
-      break;
+  // The parsed channel names and payloads are views into the reader's receive
+  // buffer, so no memory is allocated per received message. Every complete
+  // reply is handled before the next read.
+  PubSubMessage pubsub_message{};
+  auto handle_reply = [&](const RespParser &resp_parser) {
+    if (!ParsePubSubMessage(resp_parser, pubsub_message)) {
+      return;
     }
-
-    if (redisReaderFeed(reader, buffer, bytes_read) != REDIS_OK) {
-      ReportError("Failed to feed the Redis reader!");
-      break;
-    }
-
-    void *reply = nullptr;
-    int status = redisReaderGetReply(reader, &reply);
-    if (status != REDIS_OK) {
-      ReportError("Failed to get a Redis reply!");
-      break;
+    if (pubsub_message.kind == PubSubMessageKind::Subscribe) {
+      LOG(LogLevel::Info, "Subscribed to channel: {} ", pubsub_message.channel);
+    } else if (pubsub_message.kind == PubSubMessageKind::PatternSubscribe) {
+      LOG(LogLevel::Info, "Subscribed to pattern: {} ", pubsub_message.pattern);
+    } else if (pubsub_message.kind == PubSubMessageKind::Message ||
+               pubsub_message.kind == PubSubMessageKind::PatternMessage) {
+      if (verbose_outputs_) {
+        LOG_SAMPLED(LogLevel::Debug, kLogSamplesPerSecond,
+                    "Received message: {}", pubsub_message.payload);
+      }
+      // Sanity check: verify that the message was delivered for one of our
+      // subscriptions.
+      const ChannelId channel_id = channel_table_.Resolve(pubsub_message);
+      if (channel_id != kUnknownChannelId) {
+        ProcessMessage(channel_id, pubsub_message.channel,
+                       pubsub_message.payload);
+      }
     }
-
-    if (redisReply *r = (redisReply *)reply) {
-      // std::cout << "Msg Id: " << msg_idx++ << " Msg type: " << r->type;
-      if (r->type == REDIS_REPLY_ARRAY && r->elements == 3) {
-        if (!strcmp(r->element[0]->str, "subscribe")) {
-          std::cout << "Subscribed to channel: " << r->element[1]->str << " "
-                    << std::endl;
-        } else if (!strcmp(r->element[0]->str, "message")) {
-          if (verbose_outputs_) {
-            std::cout << "Received message: " << r->element[2]->str
-                      << std::endl;
-          }
-          // Sanity check: verify that the channel that sent the message was the
-          // one that we subscribed for.
-
-          // assert(!strcmp(r->element[1]->str, channel_name.c_str()));
-          if (!strcmp(r->element[1]->str, channel_name.c_str())) {
-            ProcessMessage(r->element[2]->str);
-          }
-        }
+  };
+
+#ifdef HAS_IO_URING
+  // With io_uring, the received data is handed to the reader and the XADD
+  // commands of the handled messages are sent with the next wait for data,
+  // without any further system calls.
+  std::unique_ptr<IoUringLoop> io_uring_loop;
+  if (options_.io_engine == IoEngine::IoUring) {
+    io_uring_loop = std::make_unique<IoUringLoop>();
+    auto handle_data = [&](std::string_view data) {
+      if (data.empty()) {
+        ReportError(io_uring_loop->GetLastError());
+        io_uring_loop->Stop();
+        return;
+      }
+      if (!subscription_reader_.ParseFrames(data, handle_reply)) {
+        ReportError(subscription_reader_.GetLastError());
+        io_uring_loop->Stop();
+        return;
       }
-      // std::cout << std::endl;
+      if (processing_writer_ && !processing_writer_->Flush()) {
+        ReportError(processing_writer_->GetLastError());
+      }
+    };
+    if (!io_uring_loop->Initialize() ||
+        !io_uring_loop->Receive(subscription_socket_file_descriptor_,
+                                handle_data)) {
+      ReportError(io_uring_loop->GetLastError() +
+                  " Falling back to blocking sockets.");
+      io_uring_loop.reset();
     }
   }
-
-  close(subscription_socket_file_descriptor_);
-  redisReaderFree(reader);
-}
-
-bool RedisConsumer::AddDataToStream(const std::string &resp_formatted_command,
-                                    bool is_internal_call) const {
-  int handling_socket_file_descriptor{-1};
-  if (is_internal_call) {
-    assert(write_connection_established_);
-    handling_socket_file_descriptor = processing_socket_file_descriptor_;
-  } else {
-    EstablishConnection(redis_server_hostname_, redis_server_port_,
-                        handling_socket_file_descriptor);
+#else
+  if (options_.io_engine == IoEngine::IoUring) {
+    ReportError("The client was built without io_uring support! Falling back "
+                "to blocking sockets.");
   }
+#endif
 
-  ssize_t bytes_sent =
-      send(handling_socket_file_descriptor, resp_formatted_command.c_str(),
-           resp_formatted_command.size(), 0);
-  if (bytes_sent < 0) {
-    ReportError("Failed to send the xadd command!");
-    if (!is_internal_call) {
-      close(handling_socket_file_descriptor);
+  // A single connection carries the XADD commands of all of the streams.
+  if (channel_table_.HasProcessingStreams()) {
+    EstablishConnection(redis_server_hostname_, redis_server_port_,
+                        processing_socket_file_descriptor_);
+    write_connection_established_ = true;
+    auto on_stream_write_completed = [this](const StreamWriteResult &result) {
+      OnStreamWriteCompleted(result);
+    };
+#ifdef HAS_IO_URING
+    if (io_uring_loop) {
+      auto io_uring_writer = std::make_unique<IoUringStreamWriter>(
+          *io_uring_loop, processing_socket_file_descriptor_,
+          options_.xadd_pipeline_depth, on_stream_write_completed);
+      if (io_uring_writer->Start()) {
+        processing_writer_ = std::move(io_uring_writer);
+      } else {
+        ReportError(io_uring_writer->GetLastError() +
+                    " Falling back to blocking sends of the XADD commands.");
+      }
     }
-    return false;
-  }
-
-  redisReader *reader = redisReaderCreate();
-  if (reader == nullptr) {
-    ReportError("Failed to create a Redis reader!");
-    if (!is_internal_call) {
-      close(handling_socket_file_descriptor);
+#endif
+    if (!processing_writer_) {
+      processing_writer_ = std::make_unique<PipelinedStreamWriter>(
+          processing_socket_file_descriptor_, options_.xadd_pipeline_depth,
+          on_stream_write_completed);
     }
-    return false;
-  }
-
-  char buffer[1024] = {};
-  ssize_t bytes_read =
-      recv(handling_socket_file_descriptor, buffer, sizeof(buffer), 0);
-  if (bytes_read < 0) {
-    ReportError("Failed to read from the server!");
-    if (!is_internal_call) {
-      close(handling_socket_file_descriptor);
+    LOG(LogLevel::Info,
+        "Successfully established a connection for message processing!");
+    for (ChannelId channel_id = 0;
+         channel_id < channel_table_.GetNumberOfSubscriptions(); ++channel_id) {
+      const ChannelSubscription &subscription = channel_table_.Get(channel_id);
+      if (!subscription.processing_stream.empty()) {
+        LOG(LogLevel::Info,
+            "Processing stream of {} set to: {}. All successfully processed "
+            "messages will be added to that stream!",
+            subscription.name, subscription.processing_stream);
+      }
     }
-    redisReaderFree(reader);
-    return false;
   }
 
-  if (redisReaderFeed(reader, buffer, bytes_read) != REDIS_OK) {
-    ReportError("Failed to feed the Redis reader!");
-    if (!is_internal_call) {
-      close(handling_socket_file_descriptor);
+#ifdef HAS_IO_URING
+  if (io_uring_loop) {
+    if (!io_uring_loop->Run()) {
+      ReportError(io_uring_loop->GetLastError());
     }
-    redisReaderFree(reader);
-    return false;
+    // The writer must not outlive the loop.
+    processing_writer_.reset();
+    close(subscription_socket_file_descriptor_);
+    return;
   }
-
-  void *reply = nullptr;
-  int status = redisReaderGetReply(reader, &reply);
-  if (status != REDIS_OK) {
-    ReportError("Failed to get a Redis reply!");
-    if (!is_internal_call) {
-      close(handling_socket_file_descriptor);
+#endif
+
+  subscription_reader_.SetFileDescriptor(subscription_socket_file_descriptor_);
+  while (subscription_reader_.ReadFrames(handle_reply)) {
+    // Wait for the replies to the XADD commands of the handled messages
+    // before blocking on the subscription again, so the counters are exact.
+    if (processing_writer_ && !processing_writer_->Flush()) {
+      ReportError(processing_writer_->GetLastError());
     }
-    redisReaderFree(reader);
-    return false;
   }
+  ReportError(subscription_reader_.GetLastError());
 
-  if (redisReply *r = (redisReply *)reply) {
-    if (r->type == REDIS_REPLY_STRING) {
-      if (verbose_outputs_) {
-        std::cout << "Successfully wrote the data to Stream with id = "
-                  << r->str << std::endl;
-      }
-      if (!is_internal_call) {
-        close(handling_socket_file_descriptor);
-      }
-      redisReaderFree(reader);
-      return true;
-    } else {
-      ReportError("Unexpected response type");
-      if (!is_internal_call) {
-        close(handling_socket_file_descriptor);
-      }
-      redisReaderFree(reader);
-      return false;
-    }
-  } else {
-    if (!is_internal_call) {
-      close(handling_socket_file_descriptor);
-    }
-    redisReaderFree(reader);
-    return false;
-  }
+  close(subscription_socket_file_descriptor_);
+}
+
+bool RedisConsumer::AddDataToStream(
+    const std::string &resp_formatted_command) const {
+  int handling_socket_file_descriptor{-1};
+  EstablishConnection(redis_server_hostname_, redis_server_port_,
+                      handling_socket_file_descriptor);
+
+  bool is_successful_addition = false;
+  PipelinedStreamWriter stream_writer(
+      handling_socket_file_descriptor, 1,
+      [this, &is_successful_addition](const StreamWriteResult &result) {
+        is_successful_addition = result.is_success;
+        if (result.is_success) {
+          if (verbose_outputs_) {
+            LOG(LogLevel::Info,
+                "Successfully wrote the data to Stream with id = {}",
+                result.reply);
+          }
+        } else {
+          ReportError("Unexpected response: " + std::string(result.reply));
+        }
+      });
 
-  if (!is_internal_call) {
-    close(handling_socket_file_descriptor);
+  if (!stream_writer.Submit(resp_formatted_command) ||
+      !stream_writer.Flush()) {
+    ReportError(stream_writer.GetLastError());
   }
-  return true;
+
+  close(handling_socket_file_descriptor);
+  return is_successful_addition;
 }
 
 bool RedisConsumer::AddDataToStream(
@@ -316,9 +348,9 @@ bool RedisConsumer::AddDataToStream(
                      ? "Please, provide a stream_name (key)."
                      : "There are no values to be added to stream: \"" +
                            stream_name + "\"!"));
-    std::cout << "Sample usage:\r\n\tAddDataToStream(mystream, {\"John\", "
-                 "\"Smith\");\r\n\tWill result in: XADD mystream * John Smith"
-              << std::endl;
+    LOG(LogLevel::Info,
+        "Sample usage:\r\n\tAddDataToStream(mystream, {\"John\", "
+        "\"Smith\");\r\n\tWill result in: XADD mystream * John Smith");
     return false;
   }
 
@@ -326,11 +358,10 @@ bool RedisConsumer::AddDataToStream(
       CreateWriteMessageToStreamCommand(stream_name, values);
 
   if (verbose_outputs_) {
-    std::cout << "Redis_xadd_command:" << std::endl
-              << "<Start>" << std::endl
-              << redis_xadd_command << "<End>" << std::endl;
+    LOG(LogLevel::Info, "Redis_xadd_command:\n<Start>\n{}<End>",
+        redis_xadd_command);
   }
   assert(!redis_xadd_command.empty());
 
-  return AddDataToStream(redis_xadd_command, false);
+  return AddDataToStream(redis_xadd_command);
 }
\ No newline at end of file
@@ -0,0 +1,302 @@
+#include <algorithm>
+#include <arpa/inet.h>
+#include <cerrno>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "../../include/Consumer/RedisConsumerUtils/redis_consumer_utils.hpp"
+#include "../../include/Consumer/ShardedSubscriber.hpp"
+
+namespace {
+// Returns -1 when the node cannot be reached.
+int ConnectToNode(const ClusterNode &node) {
+  sockaddr_in server_address{};
+  server_address.sin_family = AF_INET;
+  server_address.sin_addr.s_addr = inet_addr(node.host.c_str());
+  server_address.sin_port = htons(node.port);
+  if (server_address.sin_addr.s_addr == INADDR_NONE) {
+    return -1;
+  }
+
+  int file_descriptor = socket(AF_INET, SOCK_STREAM, 0);
+  if (file_descriptor < 0) {
+    return -1;
+  }
+  if (connect(file_descriptor, (struct sockaddr *)&server_address,
+              sizeof(server_address)) < 0) {
+    close(file_descriptor);
+    return -1;
+  }
+  return file_descriptor;
+}
+
+bool SendCommand(int file_descriptor, const std::string &command) {
+  std::size_t bytes_sent = 0;
+  while (bytes_sent < command.size()) {
+    ssize_t result = send(file_descriptor, command.data() + bytes_sent,
+                          command.size() - bytes_sent, MSG_NOSIGNAL);
+    if (result < 0 && errno == EINTR) {
+      continue;
+    }
+    if (result <= 0) {
+      return false;
+    }
+    bytes_sent += result;
+  }
+  return true;
+}
+
+std::string ToString(const ClusterNode &node) {
+  return node.host + ":" + std::to_string(node.port);
+}
+} // namespace
+
+ShardedSubscriber::ShardedSubscriber()
+    : is_topology_outdated_{false}, is_failed_{false}, is_subscribed_{false},
+      number_of_reconnects_{0} {}
+
+ShardedSubscriber::~ShardedSubscriber() {
+  for (const auto &connection : connections_) {
+    close(connection->file_descriptor);
+  }
+}
+
+bool ShardedSubscriber::Subscribe(const ClusterNode &seed_node,
+                                  const std::vector<std::string> &channels) {
+  seed_node_ = seed_node;
+  if (!event_loop_.Initialize()) {
+    last_error_ = event_loop_.GetLastError();
+    return false;
+  }
+  for (const std::string &channel : channels) {
+    channels_by_slot_[GetHashSlot(channel)].push_back(channel);
+  }
+  if (!RefreshTopology(nullptr)) {
+    return false;
+  }
+  for (const auto &[slot, slot_channels] : channels_by_slot_) {
+    if (!SubscribeToSlot(slot)) {
+      return false;
+    }
+  }
+  is_subscribed_ = true;
+  return true;
+}
+
+bool ShardedSubscriber::Run(MessageHandler message_handler) {
+  message_handler_ = std::move(message_handler);
+  event_loop_.Run();
+  return !is_failed_;
+}
+
+void ShardedSubscriber::Stop() { event_loop_.Stop(); }
+
+IngestStatistics ShardedSubscriber::GetStatistics() const {
+  IngestStatistics statistics{};
+  statistics.number_of_reconnects =
+      number_of_reconnects_.load(std::memory_order_relaxed);
+  std::lock_guard<std::mutex> lock(connections_mutex_);
+  for (const auto &connection : connections_) {
+    IngestStatistics connection_statistics = connection->reader.GetStatistics();
+    statistics.number_of_reads += connection_statistics.number_of_reads;
+    statistics.number_of_frames += connection_statistics.number_of_frames;
+    statistics.number_of_bytes += connection_statistics.number_of_bytes;
+    statistics.max_frames_per_read =
+        std::max(statistics.max_frames_per_read,
+                 connection_statistics.max_frames_per_read);
+    statistics.number_of_reconnects +=
+        connection_statistics.number_of_reconnects;
+  }
+  return statistics;
+}
+
+bool ShardedSubscriber::RefreshTopology(const ClusterNode *preferred_node) {
+  std::vector<ClusterNode> nodes;
+  if (preferred_node != nullptr) {
+    nodes.push_back(*preferred_node);
+  }
+  for (const ClusterNode &node : topology_.GetNodes()) {
+    nodes.push_back(node);
+  }
+  nodes.push_back(seed_node_);
+
+  const std::string command = "*2\r\n$7\r\nCLUSTER\r\n$5\r\nSLOTS\r\n";
+  last_error_ = "Failed to load the slots from any node of the cluster!";
+  for (const ClusterNode &node : nodes) {
+    int file_descriptor = ConnectToNode(node);
+    if (file_descriptor < 0) {
+      continue;
+    }
+    bool is_replied = false;
+    bool is_updated = false;
+    auto handle_reply = [&](const RespParser &reply) {
+      is_replied = true;
+      is_updated = topology_.Update(reply, node);
+    };
+    RespReader reader(file_descriptor);
+    if (SendCommand(file_descriptor, command)) {
+      while (!is_replied && reader.ReadFrames(handle_reply)) {
+      }
+    }
+    close(file_descriptor);
+    if (is_updated) {
+      return true;
+    }
+    if (is_replied) {
+      last_error_ = topology_.GetLastError();
+    }
+  }
+  return false;
+}
+
+bool ShardedSubscriber::SubscribeToSlot(std::uint16_t slot) {
+  const ClusterNode *node = topology_.GetNode(slot);
+  if (node == nullptr) {
+    last_error_ = "No node of the cluster serves the hash slot " +
+                  std::to_string(slot) + "!";
+    return false;
+  }
+  Connection *connection = GetConnection(*node);
+  if (connection == nullptr) {
+    return false;
+  }
+  if (!SendCommand(connection->file_descriptor,
+                   CreateShardedSubscriptionCommand(channels_by_slot_[slot]))) {
+    last_error_ = "Failed to send the subscription command to " +
+                  ToString(connection->node) + "!";
+    return false;
+  }
+  return true;
+}
+
+ShardedSubscriber::Connection *
+ShardedSubscriber::GetConnection(const ClusterNode &node) {
+  for (const auto &connection : connections_) {
+    if (connection->node == node) {
+      return connection.get();
+    }
+  }
+
+  int file_descriptor = ConnectToNode(node);
+  if (file_descriptor < 0) {
+    last_error_ = "Unable to connect to the cluster node " + ToString(node) +
+                  "!";
+    return nullptr;
+  }
+  if (is_subscribed_) {
+    number_of_reconnects_.fetch_add(1, std::memory_order_relaxed);
+  }
+  auto connection = std::make_unique<Connection>(node, file_descriptor);
+  Connection *new_connection = connection.get();
+  // The socket stays blocking: the loop is level-triggered and every event
+  // is handled with a single read.
+  if (!event_loop_.Watch(file_descriptor, EPOLLIN,
+                         [this, new_connection](std::uint32_t) {
+                           OnReadable(*new_connection);
+                         })) {
+    last_error_ = event_loop_.GetLastError();
+    close(file_descriptor);
+    return nullptr;
+  }
+  std::lock_guard<std::mutex> lock(connections_mutex_);
+  connections_.push_back(std::move(connection));
+  return new_connection;
+}
+
+void ShardedSubscriber::CloseConnection(const Connection &connection) {
+  event_loop_.Unwatch(connection.file_descriptor);
+  close(connection.file_descriptor);
+  std::lock_guard<std::mutex> lock(connections_mutex_);
+  connections_.erase(
+      std::find_if(connections_.begin(), connections_.end(),
+                   [&connection](const std::unique_ptr<Connection> &open) {
+                     return open.get() == &connection;
+                   }));
+}
+
+void ShardedSubscriber::OnReadable(Connection &connection) {
+  const bool is_open =
+      connection.reader.ReadFrames([&](const RespParser &reply) {
+        OnReply(connection, reply);
+      });
+  const ClusterNode node = connection.node;
+  if (!is_open) {
+    ReportError(ToString(node) + ": " + connection.reader.GetLastError());
+    // The node may have failed over to one of its replicas.
+    for (const auto &[slot, slot_channels] : channels_by_slot_) {
+      const ClusterNode *owner = topology_.GetNode(slot);
+      if (owner != nullptr && *owner == node) {
+        moved_slots_.push_back(slot);
+      }
+    }
+    is_topology_outdated_ = true;
+    CloseConnection(connection);
+  }
+  ResubscribeMovedSlots(node);
+}
+
+void ShardedSubscriber::OnReply(const Connection &connection,
+                                const RespParser &reply) {
+  const RespValue &root = reply.Root();
+  if (root.IsError()) {
+    std::uint16_t slot = 0;
+    ClusterNode node;
+    if (ParseMovedError(root.string, slot, node)) {
+      if (node.host.empty()) {
+        node.host = connection.node.host;
+      }
+      topology_.SetNode(slot, node);
+      moved_slots_.push_back(slot);
+    } else {
+      // e.g. TRYAGAIN or CLUSTERDOWN while the cluster is being resharded.
+      ReportError(ToString(connection.node) + ": " + std::string(root.string));
+    }
+    return;
+  }
+
+  PubSubMessage pubsub_message{};
+  if (!ParsePubSubMessage(reply, pubsub_message)) {
+    return;
+  }
+  if (pubsub_message.kind == PubSubMessageKind::ShardUnsubscribe) {
+    // The subscriber never unsubscribes, so the slot of the channel has
+    // moved to another node.
+    const std::uint16_t slot = GetHashSlot(pubsub_message.channel);
+    if (channels_by_slot_.count(slot) != 0) {
+      moved_slots_.push_back(slot);
+      is_topology_outdated_ = true;
+    }
+  } else if (pubsub_message.kind == PubSubMessageKind::ShardSubscribe ||
+             pubsub_message.kind == PubSubMessageKind::ShardMessage) {
+    message_handler_(pubsub_message);
+  }
+}
+
+void ShardedSubscriber::ResubscribeMovedSlots(
+    const ClusterNode &reporting_node) {
+  if (moved_slots_.empty()) {
+    return;
+  }
+  // The node that gave up the slots knows their new owners.
+  if (is_topology_outdated_ && !RefreshTopology(&reporting_node)) {
+    ReportError(last_error_);
+    is_failed_ = true;
+    event_loop_.Stop();
+    return;
+  }
+  is_topology_outdated_ = false;
+
+  std::vector<std::uint16_t> moved_slots;
+  moved_slots.swap(moved_slots_);
+  std::sort(moved_slots.begin(), moved_slots.end());
+  moved_slots.erase(std::unique(moved_slots.begin(), moved_slots.end()),
+                    moved_slots.end());
+  for (std::uint16_t slot : moved_slots) {
+    if (!SubscribeToSlot(slot)) {
+      ReportError(last_error_);
+      is_failed_ = true;
+      event_loop_.Stop();
+      return;
+    }
+  }
+}
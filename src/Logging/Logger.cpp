@@ -0,0 +1,202 @@
+#include "../../include/Logging/Logger.hpp"
+
+#include <algorithm>
+#include <charconv>
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+#include <iostream>
+
+namespace {
+std::atomic<std::uint64_t> next_logger_id{1};
+
+long long GetTimeInNanoseconds() {
+  timespec now;
+  clock_gettime(CLOCK_REALTIME, &now);
+  return now.tv_sec * 1'000'000'000LL + now.tv_nsec;
+}
+} // namespace
+
+// The ring buffer of a thread. The logger keeps it alive after the thread has
+// exited, until its last records have been formatted.
+struct Logger::ThreadBuffer {
+  explicit ThreadBuffer(std::size_t capacity)
+      : records{capacity}, is_abandoned{false} {}
+
+  SpscRingBuffer<LogRecord> records;
+  std::atomic<bool> is_abandoned;
+};
+
+namespace {
+// The buffer that the current thread logs to, which is abandoned when the
+// thread exits or starts to log to another logger.
+struct ThreadBufferHandle {
+  ~ThreadBufferHandle() { Abandon(); }
+
+  void Abandon() {
+    if (buffer != nullptr) {
+      buffer->is_abandoned.store(true, std::memory_order_release);
+      buffer.reset();
+    }
+  }
+
+  std::shared_ptr<Logger::ThreadBuffer> buffer;
+  std::uint64_t logger_id = 0;
+};
+
+thread_local ThreadBufferHandle thread_buffer_handle;
+} // namespace
+
+void Logger::WriteToStandardStreams(LogLevel level, std::string_view text) {
+  std::ostream &stream = level >= LogLevel::Warning ? std::cerr : std::cout;
+  stream.write(text.data(), text.size());
+  stream.flush();
+}
+
+Logger::Logger(LogSink sink, std::size_t records_per_thread,
+               std::chrono::milliseconds poll_interval)
+    : id_{next_logger_id.fetch_add(1)}, sink_{std::move(sink)},
+      records_per_thread_{records_per_thread}, poll_interval_{poll_interval},
+      minimum_level_{LogLevel::Info}, number_of_reported_dropped_records_{0},
+      number_of_dropped_records_{0}, stop_{false} {
+  background_thread_ = std::thread(&Logger::RunBackgroundThread, this);
+}
+
+Logger::~Logger() {
+  {
+    std::lock_guard<std::mutex> lock(stop_mutex_);
+    stop_ = true;
+  }
+  stop_condition_.notify_one();
+  background_thread_.join();
+  Drain();
+}
+
+Logger &Logger::Get() {
+  static Logger *logger = [] {
+    auto *process_logger = new Logger();
+    std::atexit([] { Get().Flush(); });
+    return process_logger;
+  }();
+  return *logger;
+}
+
+void Logger::Flush() { Drain(); }
+
+Logger::ThreadBuffer &Logger::GetThreadBuffer() {
+  if (thread_buffer_handle.logger_id != id_) {
+    thread_buffer_handle.Abandon();
+    auto buffer = std::make_shared<ThreadBuffer>(records_per_thread_);
+    {
+      std::lock_guard<std::mutex> lock(thread_buffers_mutex_);
+      thread_buffers_.push_back(buffer);
+    }
+    thread_buffer_handle.buffer = std::move(buffer);
+    thread_buffer_handle.logger_id = id_;
+  }
+  return *thread_buffer_handle.buffer;
+}
+
+void Logger::Enqueue(LogRecord &&record) {
+  record.time_in_nanoseconds = GetTimeInNanoseconds();
+  if (!GetThreadBuffer().records.TryPush(std::move(record))) {
+    delete[] record.allocated_text;
+    number_of_dropped_records_.fetch_add(1, std::memory_order_relaxed);
+  }
+}
+
+void Logger::FormatRecord(const LogRecord &record) {
+  line_.clear();
+  const char *text = record.GetText();
+  std::size_t argument_index = 0;
+  for (const char *format = record.format; *format != '\0'; ++format) {
+    if (format[0] != '{' || format[1] != '}' ||
+        argument_index == record.number_of_arguments) {
+      line_ += *format;
+      continue;
+    }
+    ++format;
+    const LogArgument &argument = record.arguments[argument_index++];
+    char digits[32];
+    switch (argument.type) {
+    case LogArgument::Type::Integer:
+      line_.append(digits, std::to_chars(digits, digits + sizeof(digits),
+                                         argument.integer)
+                               .ptr);
+      break;
+    case LogArgument::Type::UnsignedInteger:
+      line_.append(digits, std::to_chars(digits, digits + sizeof(digits),
+                                         argument.unsigned_integer)
+                               .ptr);
+      break;
+    case LogArgument::Type::Double:
+      line_.append(digits, std::snprintf(digits, sizeof(digits), "%g",
+                                         argument.floating_point));
+      break;
+    case LogArgument::Type::Text:
+      line_.append(text + argument.text.offset, argument.text.size);
+      break;
+    }
+  }
+  if (record.number_of_suppressed_records > 0) {
+    line_ += " (";
+    line_ += std::to_string(record.number_of_suppressed_records);
+    line_ += " similar records were suppressed)";
+  }
+  if (record.ends_line) {
+    line_ += '\n';
+  }
+}
+
+void Logger::Drain() {
+  std::lock_guard<std::mutex> drain_lock(drain_mutex_);
+  {
+    std::lock_guard<std::mutex> lock(thread_buffers_mutex_);
+    for (auto buffer = thread_buffers_.begin();
+         buffer != thread_buffers_.end();) {
+      // A buffer that was abandoned before it was drained holds all of the
+      // records that it will ever have.
+      const bool is_abandoned =
+          (*buffer)->is_abandoned.load(std::memory_order_acquire);
+      LogRecord record;
+      while ((*buffer)->records.TryPop(record)) {
+        pending_records_.push_back(record);
+      }
+      buffer = is_abandoned ? thread_buffers_.erase(buffer) : buffer + 1;
+    }
+  }
+
+  // The records of every thread are already in order, and stay in order.
+  std::stable_sort(pending_records_.begin(), pending_records_.end(),
+                   [](const LogRecord &left, const LogRecord &right) {
+                     return left.time_in_nanoseconds <
+                            right.time_in_nanoseconds;
+                   });
+  for (const LogRecord &record : pending_records_) {
+    FormatRecord(record);
+    delete[] record.allocated_text;
+    sink_(record.level, line_);
+  }
+  pending_records_.clear();
+
+  const long long number_of_dropped_records =
+      number_of_dropped_records_.load(std::memory_order_relaxed);
+  if (number_of_dropped_records != number_of_reported_dropped_records_) {
+    line_ = "[Logger] " +
+            std::to_string(number_of_dropped_records -
+                           number_of_reported_dropped_records_) +
+            " log records were dropped because a buffer was full\n";
+    number_of_reported_dropped_records_ = number_of_dropped_records;
+    sink_(LogLevel::Warning, line_);
+  }
+}
+
+void Logger::RunBackgroundThread() {
+  std::unique_lock<std::mutex> lock(stop_mutex_);
+  while (!stop_) {
+    lock.unlock();
+    Drain();
+    lock.lock();
+    stop_condition_.wait_for(lock, poll_interval_, [this] { return stop_; });
+  }
+}
@@ -0,0 +1,414 @@
+#include <arpa/inet.h>
+#include <cerrno>
+#include <cstdio>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "../../include/Monitoring/MetricsExporter.hpp"
+
+namespace {
+// Requests that do not fit are answered with an error.
+constexpr std::size_t kMaximumRequestSize = 8 * 1024;
+// The histograms are exported with a bucket per power of two nanoseconds,
+// from 1.024 microseconds to 17.2 seconds.
+constexpr int kSmallestBucketBits = 10;
+constexpr int kLargestBucketBits = 34;
+
+constexpr const char *kMetricPrefix = "redis_client_";
+
+std::string CreateResponse(const char *status, const char *content_type,
+                           const std::string &body) {
+  return std::string("HTTP/1.1 ") + status +
+         "\r\nContent-Type: " + content_type +
+         "\r\nContent-Length: " + std::to_string(body.size()) +
+         "\r\nConnection: close\r\n\r\n" + body;
+}
+
+class MetricsWriter {
+public:
+  explicit MetricsWriter(std::string &output) : output_(output) {}
+
+  void AddFamily(const char *name, const char *type, const char *help) {
+    output_ += "# HELP ";
+    output_ += kMetricPrefix;
+    output_ += name;
+    output_ += ' ';
+    output_ += help;
+    output_ += "\n# TYPE ";
+    output_ += kMetricPrefix;
+    output_ += name;
+    output_ += ' ';
+    output_ += type;
+    output_ += '\n';
+  }
+
+  // labels are written as they are, e.g. consumer="0",worker="1".
+  void AddSample(const char *name, const char *suffix,
+                 const std::string &labels, long long value) {
+    AddSampleName(name, suffix, labels);
+    output_ += std::to_string(value);
+    output_ += '\n';
+  }
+
+private:
+  void AddSampleName(const char *name, const char *suffix,
+                     const std::string &labels) {
+    output_ += kMetricPrefix;
+    output_ += name;
+    output_ += suffix;
+    if (!labels.empty()) {
+      output_ += '{';
+      output_ += labels;
+      output_ += '}';
+    }
+    output_ += ' ';
+  }
+
+  std::string &output_;
+};
+
+std::string ConsumerLabel(std::size_t consumer_index) {
+  return "consumer=\"" + std::to_string(consumer_index) + "\"";
+}
+
+std::string WorkerLabels(std::size_t consumer_index, int worker_id) {
+  return ConsumerLabel(consumer_index) + ",worker=\"" +
+         std::to_string(worker_id) + "\"";
+}
+
+// Exports the snapshot as the cumulative buckets of an OpenMetrics histogram
+// in seconds. The snapshot does not keep the sum of its values, so the
+// histogram only has buckets and a count.
+void AddLatencyHistogram(MetricsWriter &writer, const std::string &labels,
+                         const LatencySnapshot &latencies) {
+  for (int bits = kSmallestBucketBits; bits <= kLargestBucketBits; ++bits) {
+    const std::uint64_t upper_bound = std::uint64_t{1} << bits;
+    char bucket_labels[32];
+    std::snprintf(bucket_labels, sizeof(bucket_labels), ",le=\"%.9g\"",
+                  upper_bound / 1e9);
+    writer.AddSample(
+        "latency_seconds", "_bucket", labels + bucket_labels,
+        static_cast<long long>(latencies.GetCountBelow(upper_bound)));
+  }
+  const long long count = static_cast<long long>(latencies.GetTotalCount());
+  writer.AddSample("latency_seconds", "_bucket", labels + ",le=\"+Inf\"",
+                   count);
+  writer.AddSample("latency_seconds", "_count", labels, count);
+}
+} // namespace
+
+MetricsExporter::MetricsExporter(std::vector<IObservableConsumer *> consumers)
+    : consumers_(std::move(consumers)), listening_socket_file_descriptor_{-1},
+      port_{0} {}
+
+MetricsExporter::~MetricsExporter() {
+  Stop();
+  for (const auto &[file_descriptor, connection] : connections_) {
+    close(file_descriptor);
+  }
+  if (listening_socket_file_descriptor_ != -1) {
+    close(listening_socket_file_descriptor_);
+  }
+}
+
+bool MetricsExporter::Start(unsigned short port) {
+  if (!event_loop_.Initialize()) {
+    last_error_ = event_loop_.GetLastError();
+    return false;
+  }
+  listening_socket_file_descriptor_ =
+      socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+  if (listening_socket_file_descriptor_ < 0) {
+    last_error_ = "Failed to create a socket!";
+    return false;
+  }
+  int reuse_address = 1;
+  setsockopt(listening_socket_file_descriptor_, SOL_SOCKET, SO_REUSEADDR,
+             &reuse_address, sizeof(reuse_address));
+
+  sockaddr_in address{};
+  address.sin_family = AF_INET;
+  address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  address.sin_port = htons(port);
+  socklen_t address_length = sizeof(address);
+  if (bind(listening_socket_file_descriptor_,
+           reinterpret_cast<sockaddr *>(&address), sizeof(address)) < 0 ||
+      listen(listening_socket_file_descriptor_, SOMAXCONN) < 0 ||
+      getsockname(listening_socket_file_descriptor_,
+                  reinterpret_cast<sockaddr *>(&address),
+                  &address_length) < 0) {
+    last_error_ = "Failed to listen on port " + std::to_string(port) + "!";
+    return false;
+  }
+  port_ = ntohs(address.sin_port);
+
+  if (!event_loop_.Watch(listening_socket_file_descriptor_, EPOLLIN,
+                         [this](std::uint32_t) { OnAcceptable(); })) {
+    last_error_ = event_loop_.GetLastError();
+    return false;
+  }
+  thread_ = std::thread(&EventLoop::Run, &event_loop_);
+  return true;
+}
+
+void MetricsExporter::Stop() {
+  if (thread_.joinable()) {
+    event_loop_.Stop();
+    thread_.join();
+  }
+}
+
+void MetricsExporter::OnAcceptable() {
+  while (true) {
+    int file_descriptor =
+        accept4(listening_socket_file_descriptor_, nullptr, nullptr,
+                SOCK_NONBLOCK | SOCK_CLOEXEC);
+    if (file_descriptor < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      if (errno != EAGAIN && errno != EWOULDBLOCK) {
+        ReportError("Failed to accept a connection!");
+      }
+      return;
+    }
+    if (!event_loop_.Watch(file_descriptor, EPOLLIN,
+                           [this, file_descriptor](std::uint32_t events) {
+                             if (events & EPOLLOUT) {
+                               OnWritable(file_descriptor);
+                             } else {
+                               OnReadable(file_descriptor);
+                             }
+                           })) {
+      ReportError(event_loop_.GetLastError());
+      close(file_descriptor);
+      continue;
+    }
+    connections_[file_descriptor] = std::make_unique<Connection>();
+  }
+}
+
+void MetricsExporter::OnReadable(int file_descriptor) {
+  Connection &connection = *connections_[file_descriptor];
+  char buffer[1024];
+  ssize_t bytes_received = recv(file_descriptor, buffer, sizeof(buffer), 0);
+  if (bytes_received < 0 && (errno == EAGAIN || errno == EINTR)) {
+    return;
+  }
+  if (bytes_received <= 0) {
+    CloseConnection(file_descriptor);
+    return;
+  }
+  connection.request.append(buffer, bytes_received);
+
+  const std::size_t end_of_headers = connection.request.find("\r\n\r\n");
+  if (end_of_headers == std::string::npos) {
+    if (connection.request.size() > kMaximumRequestSize) {
+      connection.response = CreateResponse(
+          "431 Request Header Fields Too Large", "text/plain", "");
+      SendResponse(file_descriptor);
+    }
+    return;
+  }
+
+  const std::string_view request_line =
+      std::string_view(connection.request)
+          .substr(0, connection.request.find("\r\n"));
+  if (request_line.rfind("GET /metrics ", 0) == 0) {
+    connection.response = CreateResponse(
+        "200 OK",
+        "application/openmetrics-text; version=1.0.0; charset=utf-8",
+        RenderMetrics());
+  } else {
+    connection.response =
+        CreateResponse("404 Not Found", "text/plain", "Not found\n");
+  }
+  SendResponse(file_descriptor);
+}
+
+void MetricsExporter::OnWritable(int file_descriptor) {
+  SendResponse(file_descriptor);
+}
+
+void MetricsExporter::SendResponse(int file_descriptor) {
+  Connection &connection = *connections_[file_descriptor];
+  while (connection.bytes_sent < connection.response.size()) {
+    ssize_t result =
+        send(file_descriptor, connection.response.data() + connection.bytes_sent,
+             connection.response.size() - connection.bytes_sent, MSG_NOSIGNAL);
+    if (result < 0 && errno == EINTR) {
+      continue;
+    }
+    if (result < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+      // The rest is sent once the socket is writable again.
+      if (!event_loop_.UpdateEvents(file_descriptor, EPOLLOUT)) {
+        ReportError(event_loop_.GetLastError());
+        CloseConnection(file_descriptor);
+      }
+      return;
+    }
+    if (result < 0) {
+      CloseConnection(file_descriptor);
+      return;
+    }
+    connection.bytes_sent += result;
+  }
+  CloseConnection(file_descriptor);
+}
+
+void MetricsExporter::CloseConnection(int file_descriptor) {
+  event_loop_.Unwatch(file_descriptor);
+  close(file_descriptor);
+  connections_.erase(file_descriptor);
+}
+
+std::string MetricsExporter::RenderMetrics() const {
+  std::string output;
+  MetricsWriter writer(output);
+
+  writer.AddFamily("processed_messages", "counter",
+                   "Messages processed by a consumer.");
+  for (std::size_t i = 0; i < consumers_.size(); ++i) {
+    writer.AddSample("processed_messages", "_total", ConsumerLabel(i),
+                     consumers_[i]->GetNumberOfProcessedMessages());
+  }
+
+  std::vector<std::vector<WorkerStatistics>> worker_statistics;
+  for (IObservableConsumer *consumer : consumers_) {
+    worker_statistics.push_back(consumer->GetWorkerStatistics());
+  }
+  writer.AddFamily("processing_errors", "counter",
+                   "Messages that a consumer failed to process.");
+  for (std::size_t i = 0; i < consumers_.size(); ++i) {
+    long long number_of_processing_errors = 0;
+    for (const WorkerStatistics &statistics : worker_statistics[i]) {
+      number_of_processing_errors += statistics.number_of_processing_errors;
+    }
+    writer.AddSample("processing_errors", "_total", ConsumerLabel(i),
+                     number_of_processing_errors);
+  }
+  writer.AddFamily("worker_processed_messages", "counter",
+                   "Messages processed by a worker.");
+  for (std::size_t i = 0; i < consumers_.size(); ++i) {
+    for (const WorkerStatistics &statistics : worker_statistics[i]) {
+      writer.AddSample("worker_processed_messages", "_total",
+                       WorkerLabels(i, statistics.worker_id),
+                       statistics.number_of_processed_messages);
+    }
+  }
+  writer.AddFamily("worker_processing_errors", "counter",
+                   "Messages that a worker failed to process.");
+  for (std::size_t i = 0; i < consumers_.size(); ++i) {
+    for (const WorkerStatistics &statistics : worker_statistics[i]) {
+      writer.AddSample("worker_processing_errors", "_total",
+                       WorkerLabels(i, statistics.worker_id),
+                       statistics.number_of_processing_errors);
+    }
+  }
+  writer.AddFamily("worker_stream_writes_in_flight", "gauge",
+                   "XADD commands of a worker that await a reply.");
+  for (std::size_t i = 0; i < consumers_.size(); ++i) {
+    for (const WorkerStatistics &statistics : worker_statistics[i]) {
+      writer.AddSample("worker_stream_writes_in_flight", "",
+                       WorkerLabels(i, statistics.worker_id),
+                       statistics.number_of_in_flight_stream_writes);
+    }
+  }
+  writer.AddFamily("worker_queued_messages", "gauge",
+                   "Messages in the own queue of a worker.");
+  for (std::size_t i = 0; i < consumers_.size(); ++i) {
+    for (const WorkerStatistics &statistics : worker_statistics[i]) {
+      writer.AddSample("worker_queued_messages", "",
+                       WorkerLabels(i, statistics.worker_id),
+                       statistics.number_of_queued_messages);
+    }
+  }
+  writer.AddFamily("queued_messages", "gauge",
+                   "Received messages that wait for any of the workers.");
+  for (std::size_t i = 0; i < consumers_.size(); ++i) {
+    writer.AddSample("queued_messages", "", ConsumerLabel(i),
+                     consumers_[i]->GetNumberOfQueuedMessages());
+  }
+
+  std::vector<QueueStatistics> queue_statistics;
+  for (IObservableConsumer *consumer : consumers_) {
+    queue_statistics.push_back(consumer->GetQueueStatistics());
+  }
+  writer.AddFamily("dropped_messages", "counter",
+                   "Received messages dropped because their queue was full.");
+  for (std::size_t i = 0; i < consumers_.size(); ++i) {
+    writer.AddSample("dropped_messages", "_total", ConsumerLabel(i),
+                     queue_statistics[i].number_of_dropped_messages);
+  }
+  writer.AddFamily("spilled_messages", "counter",
+                   "Received messages spilled to the disk.");
+  for (std::size_t i = 0; i < consumers_.size(); ++i) {
+    writer.AddSample("spilled_messages", "_total", ConsumerLabel(i),
+                     queue_statistics[i].number_of_spilled_messages);
+  }
+  writer.AddFamily("messages_on_disk", "gauge",
+                   "Spilled messages that wait on the disk for the workers.");
+  for (std::size_t i = 0; i < consumers_.size(); ++i) {
+    writer.AddSample("messages_on_disk", "", ConsumerLabel(i),
+                     queue_statistics[i].number_of_messages_on_disk);
+  }
+  writer.AddFamily("queue_high_water_mark", "gauge",
+                   "The most messages that a queue held so far.");
+  for (std::size_t i = 0; i < consumers_.size(); ++i) {
+    writer.AddSample("queue_high_water_mark", "", ConsumerLabel(i),
+                     queue_statistics[i].high_water_mark);
+  }
+  writer.AddFamily("queue_capacity", "gauge",
+                   "The number of messages that a queue can hold.");
+  for (std::size_t i = 0; i < consumers_.size(); ++i) {
+    writer.AddSample("queue_capacity", "", ConsumerLabel(i),
+                     queue_statistics[i].capacity);
+  }
+
+  std::vector<IngestStatistics> ingest_statistics;
+  for (IObservableConsumer *consumer : consumers_) {
+    ingest_statistics.push_back(consumer->GetIngestStatistics());
+  }
+  writer.AddFamily("received_bytes", "counter",
+                   "Bytes read from the subscription connections.");
+  for (std::size_t i = 0; i < consumers_.size(); ++i) {
+    writer.AddSample("received_bytes", "_total", ConsumerLabel(i),
+                     ingest_statistics[i].number_of_bytes);
+  }
+  writer.AddFamily("reads", "counter",
+                   "Reads from the subscription connections.");
+  for (std::size_t i = 0; i < consumers_.size(); ++i) {
+    writer.AddSample("reads", "_total", ConsumerLabel(i),
+                     ingest_statistics[i].number_of_reads);
+  }
+  writer.AddFamily("reconnects", "counter",
+                   "Subscription connections opened again after the "
+                   "subscription was established.");
+  for (std::size_t i = 0; i < consumers_.size(); ++i) {
+    writer.AddSample("reconnects", "_total", ConsumerLabel(i),
+                     ingest_statistics[i].number_of_reconnects);
+  }
+
+  writer.AddFamily("latency_seconds", "histogram",
+                   "Latencies of the stages that a message goes through.");
+  for (std::size_t i = 0; i < consumers_.size(); ++i) {
+    const LatencyStatistics latency_statistics =
+        consumers_[i]->GetLatencyStatistics();
+    const std::pair<const char *, const LatencySnapshot *> stages[] = {
+        {"publish_to_receive", &latency_statistics.publish_to_receive},
+        {"receive_to_dequeue", &latency_statistics.receive_to_dequeue},
+        {"processing", &latency_statistics.processing},
+        {"stream_write_round_trip",
+         &latency_statistics.stream_write_round_trip}};
+    for (const auto &[stage, latencies] : stages) {
+      if (latencies->GetTotalCount() > 0) {
+        AddLatencyHistogram(writer,
+                            ConsumerLabel(i) + ",stage=\"" + stage + "\"",
+                            *latencies);
+      }
+    }
+  }
+
+  output += "# EOF\n";
+  return output;
+}
@@ -0,0 +1,172 @@
+#include <array>
+#include <charconv>
+
+#include "../../include/Networking/ClusterTopology.hpp"
+
+namespace {
+// The table of the bitwise CRC16 with the XMODEM polynomial 0x1021.
+constexpr std::array<std::uint16_t, 256> CreateCrc16Table() {
+  std::array<std::uint16_t, 256> table{};
+  for (std::uint16_t byte = 0; byte < 256; ++byte) {
+    std::uint16_t crc = static_cast<std::uint16_t>(byte << 8);
+    for (int bit = 0; bit < 8; ++bit) {
+      crc = static_cast<std::uint16_t>((crc & 0x8000) ? (crc << 1) ^ 0x1021
+                                                      : crc << 1);
+    }
+    table[byte] = crc;
+  }
+  return table;
+}
+
+constexpr std::array<std::uint16_t, 256> kCrc16Table = CreateCrc16Table();
+
+std::uint16_t Crc16(std::string_view data) {
+  std::uint16_t crc = 0;
+  for (unsigned char character : data) {
+    crc = static_cast<std::uint16_t>(
+        (crc << 8) ^ kCrc16Table[((crc >> 8) ^ character) & 0xFF]);
+  }
+  return crc;
+}
+
+bool ParsePort(std::string_view text, unsigned short &port) {
+  const char *end = text.data() + text.size();
+  auto [position, error] = std::from_chars(text.data(), end, port);
+  return error == std::errc{} && position == end && port != 0;
+}
+} // namespace
+
+std::uint16_t GetHashSlot(std::string_view key) {
+  const std::size_t tag_start = key.find('{');
+  if (tag_start != std::string_view::npos) {
+    const std::size_t tag_end = key.find('}', tag_start + 1);
+    if (tag_end != std::string_view::npos && tag_end > tag_start + 1) {
+      key = key.substr(tag_start + 1, tag_end - tag_start - 1);
+    }
+  }
+  return Crc16(key) % kNumberOfHashSlots;
+}
+
+bool ParseMovedError(std::string_view error, std::uint16_t &slot,
+                     ClusterNode &node) {
+  constexpr std::string_view kMovedPrefix = "MOVED ";
+  if (error.substr(0, kMovedPrefix.size()) != kMovedPrefix) {
+    return false;
+  }
+  error.remove_prefix(kMovedPrefix.size());
+
+  const std::size_t space = error.find(' ');
+  const std::size_t colon = error.rfind(':');
+  if (space == std::string_view::npos || colon == std::string_view::npos ||
+      colon < space) {
+    return false;
+  }
+  const std::string_view slot_text = error.substr(0, space);
+  auto [position, parse_error] = std::from_chars(
+      slot_text.data(), slot_text.data() + slot_text.size(), slot);
+  if (parse_error != std::errc{} ||
+      position != slot_text.data() + slot_text.size() ||
+      slot >= kNumberOfHashSlots) {
+    return false;
+  }
+  node.host = std::string(error.substr(space + 1, colon - space - 1));
+  return ParsePort(error.substr(colon + 1), node.port);
+}
+
+ClusterTopology::ClusterTopology()
+    : slot_owners_(kNumberOfHashSlots, kUnknownNode) {}
+
+bool ClusterTopology::Update(const RespParser &cluster_slots_reply,
+                             const ClusterNode &queried_node) {
+  const RespValue &root = cluster_slots_reply.Root();
+  if (root.IsError()) {
+    last_error_ = "CLUSTER SLOTS failed! " + std::string(root.string);
+    return false;
+  }
+  if (root.type != RespType::Array) {
+    last_error_ = "Unexpected reply to CLUSTER SLOTS!";
+    return false;
+  }
+
+  // Every entry is [first slot, last slot, master, replicas...], and every
+  // node is [host, port, id, ...].
+  std::vector<std::uint16_t> slot_owners(kNumberOfHashSlots, kUnknownNode);
+  std::vector<ClusterNode> nodes;
+  const RespValue *entry = &root + 1;
+  for (std::size_t i = 0; i < root.number_of_elements;
+       ++i, entry += entry->subtree_size) {
+    const RespValue *first_slot = cluster_slots_reply.Child(*entry, 0);
+    const RespValue *last_slot = cluster_slots_reply.Child(*entry, 1);
+    const RespValue *master = cluster_slots_reply.Child(*entry, 2);
+    const RespValue *host =
+        master ? cluster_slots_reply.Child(*master, 0) : nullptr;
+    const RespValue *port =
+        master ? cluster_slots_reply.Child(*master, 1) : nullptr;
+    if (!host || !port || first_slot->type != RespType::Integer ||
+        last_slot->type != RespType::Integer ||
+        port->type != RespType::Integer || first_slot->integer < 0 ||
+        first_slot->integer > last_slot->integer ||
+        last_slot->integer >= kNumberOfHashSlots) {
+      last_error_ = "Malformed CLUSTER SLOTS entry!";
+      return false;
+    }
+
+    ClusterNode node{std::string(host->string),
+                     static_cast<unsigned short>(port->integer)};
+    // Nodes that do not know their endpoint report an empty host or "?".
+    if (host->is_null || node.host.empty() || node.host == "?") {
+      node.host = queried_node.host;
+    }
+    std::uint16_t node_index = 0;
+    while (node_index < nodes.size() && nodes[node_index] != node) {
+      ++node_index;
+    }
+    if (node_index == nodes.size()) {
+      nodes.push_back(std::move(node));
+    }
+    for (long long slot = first_slot->integer; slot <= last_slot->integer;
+         ++slot) {
+      slot_owners[slot] = node_index;
+    }
+  }
+
+  slot_owners_ = std::move(slot_owners);
+  nodes_ = std::move(nodes);
+  return true;
+}
+
+const ClusterNode *ClusterTopology::GetNode(std::uint16_t slot) const {
+  const std::uint16_t node_index = slot_owners_[slot];
+  return node_index == kUnknownNode ? nullptr : &nodes_[node_index];
+}
+
+void ClusterTopology::SetNode(std::uint16_t slot, const ClusterNode &node) {
+  slot_owners_[slot] = AddNode(node);
+}
+
+std::vector<ClusterNode> ClusterTopology::GetNodes() const {
+  std::vector<bool> is_owner(nodes_.size(), false);
+  for (std::uint16_t node_index : slot_owners_) {
+    if (node_index != kUnknownNode) {
+      is_owner[node_index] = true;
+    }
+  }
+  std::vector<ClusterNode> nodes;
+  for (std::size_t i = 0; i < nodes_.size(); ++i) {
+    if (is_owner[i]) {
+      nodes.push_back(nodes_[i]);
+    }
+  }
+  return nodes;
+}
+
+std::uint16_t ClusterTopology::AddNode(const ClusterNode &node) {
+  for (std::uint16_t node_index = 0; node_index < nodes_.size();
+       ++node_index) {
+    if (nodes_[node_index] == node) {
+      return node_index;
+    }
+  }
+  nodes_.push_back(node);
+  return static_cast<std::uint16_t>(nodes_.size() - 1);
+}
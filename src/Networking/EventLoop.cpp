@@ -0,0 +1,161 @@
+#include <cerrno>
+#include <fcntl.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+#include "../../include/Networking/EventLoop.hpp"
+
+namespace {
+// The maximum number of events handled per epoll_wait().
+constexpr int kMaximumEventsPerWait = 64;
+} // namespace
+
+bool MakeNonBlocking(int file_descriptor) {
+  int flags = fcntl(file_descriptor, F_GETFL, 0);
+  return flags >= 0 &&
+         fcntl(file_descriptor, F_SETFL, flags | O_NONBLOCK) == 0;
+}
+
+EventLoop::EventLoop()
+    : epoll_file_descriptor_{-1}, wake_up_file_descriptor_{-1}, stop_{false} {}
+
+EventLoop::~EventLoop() {
+  if (wake_up_file_descriptor_ != -1) {
+    close(wake_up_file_descriptor_);
+  }
+  if (epoll_file_descriptor_ != -1) {
+    close(epoll_file_descriptor_);
+  }
+}
+
+bool EventLoop::Initialize() {
+  epoll_file_descriptor_ = epoll_create1(EPOLL_CLOEXEC);
+  if (epoll_file_descriptor_ < 0) {
+    last_error_ = "Failed to create an epoll instance!";
+    return false;
+  }
+  wake_up_file_descriptor_ = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+  if (wake_up_file_descriptor_ < 0) {
+    last_error_ = "Failed to create an eventfd!";
+    return false;
+  }
+  return Watch(wake_up_file_descriptor_, EPOLLIN, [this](std::uint32_t) {
+    std::uint64_t number_of_wake_ups;
+    while (read(wake_up_file_descriptor_, &number_of_wake_ups,
+                sizeof(number_of_wake_ups)) > 0) {
+    }
+  });
+}
+
+bool EventLoop::Watch(int file_descriptor, std::uint32_t events,
+                      EventHandler handler) {
+  auto watcher = std::make_unique<Watcher>(
+      Watcher{file_descriptor, std::move(handler), true});
+  epoll_event event{};
+  event.events = events;
+  event.data.ptr = watcher.get();
+  if (epoll_ctl(epoll_file_descriptor_, EPOLL_CTL_ADD, file_descriptor,
+                &event) < 0) {
+    last_error_ = "Failed to watch a file descriptor!";
+    return false;
+  }
+  watchers_[file_descriptor] = std::move(watcher);
+  return true;
+}
+
+bool EventLoop::UpdateEvents(int file_descriptor, std::uint32_t events) {
+  auto it = watchers_.find(file_descriptor);
+  if (it == watchers_.end()) {
+    last_error_ = "The file descriptor is not watched!";
+    return false;
+  }
+  epoll_event event{};
+  event.events = events;
+  event.data.ptr = it->second.get();
+  if (epoll_ctl(epoll_file_descriptor_, EPOLL_CTL_MOD, file_descriptor,
+                &event) < 0) {
+    last_error_ = "Failed to update the watched events!";
+    return false;
+  }
+  return true;
+}
+
+void EventLoop::Unwatch(int file_descriptor) {
+  auto it = watchers_.find(file_descriptor);
+  if (it == watchers_.end()) {
+    return;
+  }
+  epoll_ctl(epoll_file_descriptor_, EPOLL_CTL_DEL, file_descriptor, nullptr);
+  it->second->is_active = false;
+  removed_watchers_.push_back(std::move(it->second));
+  watchers_.erase(it);
+}
+
+void EventLoop::Post(Task task) {
+  bool is_first_task;
+  {
+    std::lock_guard<std::mutex> lock(posted_tasks_mutex_);
+    is_first_task = posted_tasks_.empty();
+    posted_tasks_.push_back(std::move(task));
+  }
+  // The loop runs every posted task once woken up, so only the first task
+  // since the last run has to wake it up.
+  if (is_first_task) {
+    WakeUp();
+  }
+}
+
+void EventLoop::Run() {
+  while (!stop_.load(std::memory_order_acquire)) {
+    if (!RunOnce(-1)) {
+      break;
+    }
+  }
+}
+
+bool EventLoop::RunOnce(int timeout_in_milliseconds) {
+  epoll_event events[kMaximumEventsPerWait];
+  int number_of_events = epoll_wait(epoll_file_descriptor_, events,
+                                    kMaximumEventsPerWait,
+                                    timeout_in_milliseconds);
+  if (number_of_events < 0) {
+    if (errno == EINTR) {
+      return true;
+    }
+    last_error_ = "Failed to wait for events!";
+    return false;
+  }
+
+  for (int i = 0; i < number_of_events; ++i) {
+    Watcher *watcher = static_cast<Watcher *>(events[i].data.ptr);
+    if (watcher->is_active) {
+      watcher->handler(events[i].events);
+    }
+  }
+  removed_watchers_.clear();
+  RunPostedTasks();
+  return true;
+}
+
+void EventLoop::Stop() {
+  stop_.store(true, std::memory_order_release);
+  WakeUp();
+}
+
+void EventLoop::WakeUp() {
+  std::uint64_t one = 1;
+  ssize_t result = write(wake_up_file_descriptor_, &one, sizeof(one));
+  (void)result;
+}
+
+void EventLoop::RunPostedTasks() {
+  {
+    std::lock_guard<std::mutex> lock(posted_tasks_mutex_);
+    running_tasks_.swap(posted_tasks_);
+  }
+  for (Task &task : running_tasks_) {
+    task();
+  }
+  running_tasks_.clear();
+  removed_watchers_.clear();
+}
@@ -0,0 +1,285 @@
+#ifdef HAS_IO_URING
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include "../../include/Networking/IoUring.hpp"
+
+IoUring::IoUring()
+    : file_descriptor_{-1}, submission_ring_{MAP_FAILED},
+      submission_ring_size_{0}, completion_ring_{MAP_FAILED},
+      completion_ring_size_{0}, submission_entries_{nullptr},
+      submission_entries_size_{0}, submission_head_{nullptr},
+      submission_tail_{nullptr}, submission_ring_mask_{0},
+      submission_ring_entries_{0}, local_submission_tail_{0},
+      number_of_unsubmitted_entries_{0}, completion_head_{nullptr},
+      completion_tail_{nullptr}, completion_ring_mask_{0},
+      completion_entries_{nullptr}, number_of_system_calls_{0},
+      last_error_{} {}
+
+IoUring::~IoUring() { Close(); }
+
+bool IoUring::Initialize(unsigned number_of_entries) {
+  io_uring_params parameters{};
+  file_descriptor_ = static_cast<int>(
+      syscall(__NR_io_uring_setup, number_of_entries, &parameters));
+  if (file_descriptor_ < 0) {
+    last_error_ = std::string("Failed to set up an io_uring instance! ") +
+                  strerror(errno);
+    return false;
+  }
+
+  submission_ring_size_ =
+      parameters.sq_off.array + parameters.sq_entries * sizeof(unsigned);
+  completion_ring_size_ =
+      parameters.cq_off.cqes + parameters.cq_entries * sizeof(io_uring_cqe);
+  const bool is_single_mapping = parameters.features & IORING_FEAT_SINGLE_MMAP;
+  if (is_single_mapping) {
+    submission_ring_size_ = completion_ring_size_ =
+        std::max(submission_ring_size_, completion_ring_size_);
+  }
+
+  submission_ring_ =
+      mmap(nullptr, submission_ring_size_, PROT_READ | PROT_WRITE,
+           MAP_SHARED | MAP_POPULATE, file_descriptor_, IORING_OFF_SQ_RING);
+  if (submission_ring_ == MAP_FAILED) {
+    last_error_ = "Failed to map the submission queue!";
+    Close();
+    return false;
+  }
+  if (is_single_mapping) {
+    completion_ring_ = submission_ring_;
+  } else {
+    completion_ring_ =
+        mmap(nullptr, completion_ring_size_, PROT_READ | PROT_WRITE,
+             MAP_SHARED | MAP_POPULATE, file_descriptor_, IORING_OFF_CQ_RING);
+    if (completion_ring_ == MAP_FAILED) {
+      last_error_ = "Failed to map the completion queue!";
+      Close();
+      return false;
+    }
+  }
+  submission_entries_size_ = parameters.sq_entries * sizeof(io_uring_sqe);
+  void *submission_entries =
+      mmap(nullptr, submission_entries_size_, PROT_READ | PROT_WRITE,
+           MAP_SHARED | MAP_POPULATE, file_descriptor_, IORING_OFF_SQES);
+  if (submission_entries == MAP_FAILED) {
+    last_error_ = "Failed to map the submission queue entries!";
+    Close();
+    return false;
+  }
+  submission_entries_ = static_cast<io_uring_sqe *>(submission_entries);
+
+  char *submission_ring = static_cast<char *>(submission_ring_);
+  submission_head_ =
+      reinterpret_cast<unsigned *>(submission_ring + parameters.sq_off.head);
+  submission_tail_ =
+      reinterpret_cast<unsigned *>(submission_ring + parameters.sq_off.tail);
+  submission_ring_mask_ = *reinterpret_cast<unsigned *>(
+      submission_ring + parameters.sq_off.ring_mask);
+  submission_ring_entries_ = *reinterpret_cast<unsigned *>(
+      submission_ring + parameters.sq_off.ring_entries);
+  local_submission_tail_ = *submission_tail_;
+  // Entry i of the queue always uses submission entry i.
+  unsigned *submission_array =
+      reinterpret_cast<unsigned *>(submission_ring + parameters.sq_off.array);
+  for (unsigned i = 0; i < submission_ring_entries_; ++i) {
+    submission_array[i] = i;
+  }
+
+  char *completion_ring = static_cast<char *>(completion_ring_);
+  completion_head_ =
+      reinterpret_cast<unsigned *>(completion_ring + parameters.cq_off.head);
+  completion_tail_ =
+      reinterpret_cast<unsigned *>(completion_ring + parameters.cq_off.tail);
+  completion_ring_mask_ = *reinterpret_cast<unsigned *>(
+      completion_ring + parameters.cq_off.ring_mask);
+  completion_entries_ = reinterpret_cast<io_uring_cqe *>(
+      completion_ring + parameters.cq_off.cqes);
+  return true;
+}
+
+void IoUring::Close() {
+  if (submission_entries_ != nullptr) {
+    munmap(submission_entries_, submission_entries_size_);
+    submission_entries_ = nullptr;
+  }
+  if (completion_ring_ != MAP_FAILED && completion_ring_ != submission_ring_) {
+    munmap(completion_ring_, completion_ring_size_);
+  }
+  completion_ring_ = MAP_FAILED;
+  if (submission_ring_ != MAP_FAILED) {
+    munmap(submission_ring_, submission_ring_size_);
+    submission_ring_ = MAP_FAILED;
+  }
+  if (file_descriptor_ != -1) {
+    close(file_descriptor_);
+    file_descriptor_ = -1;
+  }
+}
+
+io_uring_sqe *IoUring::GetSubmissionEntry() {
+  if (local_submission_tail_ -
+          __atomic_load_n(submission_head_, __ATOMIC_ACQUIRE) >=
+      submission_ring_entries_) {
+    if (!SubmitAndWait(0) ||
+        local_submission_tail_ -
+                __atomic_load_n(submission_head_, __ATOMIC_ACQUIRE) >=
+            submission_ring_entries_) {
+      return nullptr;
+    }
+  }
+
+  io_uring_sqe *entry =
+      &submission_entries_[local_submission_tail_ & submission_ring_mask_];
+  memset(entry, 0, sizeof(io_uring_sqe));
+  ++local_submission_tail_;
+  ++number_of_unsubmitted_entries_;
+  return entry;
+}
+
+bool IoUring::SubmitAndWait(unsigned minimum_number_of_completions) {
+  __atomic_store_n(submission_tail_, local_submission_tail_,
+                   __ATOMIC_RELEASE);
+  const unsigned flags =
+      minimum_number_of_completions > 0 ? IORING_ENTER_GETEVENTS : 0;
+
+  while (true) {
+    ++number_of_system_calls_;
+    int result = static_cast<int>(syscall(
+        __NR_io_uring_enter, file_descriptor_, number_of_unsubmitted_entries_,
+        minimum_number_of_completions, flags, nullptr, 0));
+    if (result >= 0) {
+      number_of_unsubmitted_entries_ -= result;
+      return true;
+    }
+    if (errno == EINTR) {
+      continue;
+    }
+    // The completion queue is full. The entries are submitted again once
+    // the completions have been handled.
+    if (errno == EBUSY || errno == EAGAIN) {
+      return true;
+    }
+    last_error_ =
+        std::string("Failed to submit to the io_uring! ") + strerror(errno);
+    return false;
+  }
+}
+
+bool IoUring::RegisterBufferRing(void *ring_address,
+                                 std::uint16_t number_of_entries,
+                                 std::uint16_t group_id) {
+  io_uring_buf_reg registration{};
+  registration.ring_addr = reinterpret_cast<std::uint64_t>(ring_address);
+  registration.ring_entries = number_of_entries;
+  registration.bgid = group_id;
+  ++number_of_system_calls_;
+  if (syscall(__NR_io_uring_register, file_descriptor_,
+              IORING_REGISTER_PBUF_RING, &registration, 1) < 0) {
+    last_error_ = std::string("Failed to register a ring of buffers! ") +
+                  strerror(errno);
+    return false;
+  }
+  return true;
+}
+
+void IoUring::UnregisterBufferRing(std::uint16_t group_id) {
+  io_uring_buf_reg registration{};
+  registration.bgid = group_id;
+  ++number_of_system_calls_;
+  syscall(__NR_io_uring_register, file_descriptor_,
+          IORING_UNREGISTER_PBUF_RING, &registration, 1);
+}
+
+ProvidedBuffers::ProvidedBuffers()
+    : io_uring_{nullptr}, ring_{nullptr}, ring_size_{0}, buffers_{nullptr},
+      buffers_size_{0}, buffer_size_{0}, number_of_buffers_{0}, group_id_{0},
+      tail_{0} {}
+
+ProvidedBuffers::~ProvidedBuffers() {
+  if (buffers_ != nullptr) {
+    munmap(buffers_, buffers_size_);
+  }
+  if (ring_ != nullptr) {
+    munmap(ring_, ring_size_);
+  }
+}
+
+bool ProvidedBuffers::Initialize(IoUring &io_uring, std::uint16_t group_id,
+                                 std::uint16_t number_of_buffers,
+                                 std::size_t buffer_size, bool use_ring) {
+  io_uring_ = &io_uring;
+  buffers_size_ = number_of_buffers * buffer_size;
+  void *buffers = mmap(nullptr, buffers_size_, PROT_READ | PROT_WRITE,
+                       MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (buffers == MAP_FAILED) {
+    return false;
+  }
+  buffers_ = static_cast<char *>(buffers);
+  buffer_size_ = buffer_size;
+  number_of_buffers_ = number_of_buffers;
+  group_id_ = group_id;
+
+  if (!use_ring) {
+    return Provide(0, number_of_buffers);
+  }
+
+  ring_size_ = number_of_buffers * sizeof(io_uring_buf);
+  void *ring = mmap(nullptr, ring_size_, PROT_READ | PROT_WRITE,
+                    MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (ring == MAP_FAILED) {
+    return false;
+  }
+  ring_ = static_cast<io_uring_buf_ring *>(ring);
+  if (!io_uring.RegisterBufferRing(ring_, number_of_buffers, group_id)) {
+    return false;
+  }
+  for (std::uint16_t buffer_id = 0; buffer_id < number_of_buffers;
+       ++buffer_id) {
+    AddToRing(buffer_id, buffer_id);
+  }
+  tail_ += number_of_buffers;
+  __atomic_store_n(&ring_->tail, tail_, __ATOMIC_RELEASE);
+  return true;
+}
+
+bool ProvidedBuffers::Recycle(std::uint16_t buffer_id) {
+  if (ring_ == nullptr) {
+    return Provide(buffer_id, 1);
+  }
+  AddToRing(buffer_id, 0);
+  ++tail_;
+  __atomic_store_n(&ring_->tail, tail_, __ATOMIC_RELEASE);
+  return true;
+}
+
+void ProvidedBuffers::AddToRing(std::uint16_t buffer_id,
+                                std::uint16_t offset) {
+  io_uring_buf &buffer =
+      ring_->bufs[(tail_ + offset) & (number_of_buffers_ - 1)];
+  buffer.addr = reinterpret_cast<std::uint64_t>(GetBuffer(buffer_id));
+  buffer.len = static_cast<std::uint32_t>(buffer_size_);
+  buffer.bid = buffer_id;
+}
+
+bool ProvidedBuffers::Provide(std::uint16_t first_buffer_id,
+                              std::uint16_t number_of_buffers) {
+  io_uring_sqe *entry = io_uring_->GetSubmissionEntry();
+  if (entry == nullptr) {
+    return false;
+  }
+  entry->opcode = IORING_OP_PROVIDE_BUFFERS;
+  entry->fd = number_of_buffers;
+  entry->addr = reinterpret_cast<std::uint64_t>(GetBuffer(first_buffer_id));
+  entry->len = static_cast<std::uint32_t>(buffer_size_);
+  entry->off = first_buffer_id;
+  entry->buf_group = group_id_;
+  // Only failures are reported, with a user data of 0.
+  entry->flags = IOSQE_CQE_SKIP_SUCCESS;
+  return true;
+}
+#endif
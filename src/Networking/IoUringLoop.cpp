@@ -0,0 +1,248 @@
+#ifdef HAS_IO_URING
+#include <cerrno>
+#include <cstring>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "../../include/Networking/IoUringLoop.hpp"
+
+IoUringLoop::IoUringLoop()
+    : number_of_buffers_per_socket_{kDefaultNumberOfBuffers},
+      buffer_size_{kDefaultBufferSize}, uses_buffer_rings_{false},
+      stop_{false} {}
+
+IoUringLoop::~IoUringLoop() {
+  // The kernel must not receive into the buffers after they were freed.
+  io_uring_.Close();
+}
+
+bool IoUringLoop::Initialize(unsigned number_of_entries,
+                             std::uint16_t number_of_buffers_per_socket,
+                             std::size_t buffer_size) {
+  if (!io_uring_.Initialize(number_of_entries)) {
+    last_error_ = io_uring_.GetLastError();
+    return false;
+  }
+  number_of_buffers_per_socket_ = number_of_buffers_per_socket;
+  buffer_size_ = buffer_size;
+  uses_buffer_rings_ = IsBufferRingUsable();
+  return true;
+}
+
+bool IoUringLoop::Receive(int file_descriptor, ReceiveHandler handler) {
+  auto receiver = std::make_unique<Receiver>();
+  receiver->kind = OperationKind::Receive;
+  receiver->file_descriptor = file_descriptor;
+  receiver->handler = std::move(handler);
+  receiver->is_dispatching = false;
+  receiver->is_closed = false;
+  // Every socket has its own group of buffers, so a socket whose data is
+  // waiting to be handled cannot starve the others.
+  if (!receiver->buffers.Initialize(
+          io_uring_, static_cast<std::uint16_t>(receivers_.size()),
+          number_of_buffers_per_socket_, buffer_size_, uses_buffer_rings_)) {
+    last_error_ = io_uring_.GetLastError();
+    return false;
+  }
+  if (!ArmReceive(*receiver)) {
+    return false;
+  }
+  receivers_[file_descriptor] = std::move(receiver);
+  return true;
+}
+
+bool IoUringLoop::Send(int file_descriptor, std::string_view data,
+                       SendHandler handler) {
+  if (free_send_operations_.empty()) {
+    send_operations_.push_back(std::make_unique<SendOperation>());
+    send_operations_.back()->kind = OperationKind::Send;
+    free_send_operations_.push_back(send_operations_.back().get());
+  }
+  SendOperation *send_operation = free_send_operations_.back();
+  free_send_operations_.pop_back();
+  send_operation->file_descriptor = file_descriptor;
+  send_operation->data = data;
+  send_operation->offset = 0;
+  send_operation->handler = std::move(handler);
+
+  if (!SubmitSend(*send_operation)) {
+    send_operation->handler = nullptr;
+    free_send_operations_.push_back(send_operation);
+    return false;
+  }
+  return true;
+}
+
+bool IoUringLoop::RunOnce() {
+  if (!io_uring_.SubmitAndWait(1)) {
+    last_error_ = io_uring_.GetLastError();
+    return false;
+  }
+  io_uring_.ForEachCompletion([this](const IoUringCompletion &completion) {
+    OnCompletion(completion);
+  });
+  return true;
+}
+
+bool IoUringLoop::Run() {
+  stop_ = false;
+  while (!stop_) {
+    if (!RunOnce()) {
+      return false;
+    }
+  }
+  return true;
+}
+
+bool IoUringLoop::IsBufferRingUsable() {
+  // Socket groups are numbered from 0, so this one never clashes.
+  constexpr std::uint16_t kProbeGroupId = 0xFFFF;
+  int socket_pair[2];
+  if (socketpair(AF_UNIX, SOCK_STREAM, 0, socket_pair) != 0) {
+    return false;
+  }
+
+  bool is_usable = false;
+  ProvidedBuffers buffers;
+  if (buffers.Initialize(io_uring_, kProbeGroupId, 1, 1, true) &&
+      write(socket_pair[1], "x", 1) == 1) {
+    io_uring_sqe *entry = io_uring_.GetSubmissionEntry();
+    if (entry != nullptr) {
+      entry->opcode = IORING_OP_RECV;
+      entry->fd = socket_pair[0];
+      entry->flags = IOSQE_BUFFER_SELECT;
+      entry->buf_group = kProbeGroupId;
+      if (io_uring_.SubmitAndWait(1)) {
+        io_uring_.ForEachCompletion(
+            [&is_usable](const IoUringCompletion &completion) {
+              is_usable = completion.result == 1;
+            });
+      }
+    }
+    io_uring_.UnregisterBufferRing(kProbeGroupId);
+  }
+  close(socket_pair[0]);
+  close(socket_pair[1]);
+  return is_usable;
+}
+
+bool IoUringLoop::ArmReceive(Receiver &receiver) {
+  io_uring_sqe *entry = io_uring_.GetSubmissionEntry();
+  if (entry == nullptr) {
+    last_error_ = "The io_uring submission queue is full!";
+    return false;
+  }
+  entry->opcode = IORING_OP_RECV;
+  entry->fd = receiver.file_descriptor;
+  entry->ioprio = IORING_RECV_MULTISHOT;
+  entry->flags = IOSQE_BUFFER_SELECT;
+  entry->buf_group = receiver.buffers.GetGroupId();
+  entry->user_data = reinterpret_cast<std::uint64_t>(
+      static_cast<Operation *>(&receiver));
+  return true;
+}
+
+bool IoUringLoop::SubmitSend(SendOperation &send_operation) {
+  io_uring_sqe *entry = io_uring_.GetSubmissionEntry();
+  if (entry == nullptr) {
+    last_error_ = "The io_uring submission queue is full!";
+    return false;
+  }
+  entry->opcode = IORING_OP_SEND;
+  entry->fd = send_operation.file_descriptor;
+  entry->addr = reinterpret_cast<std::uint64_t>(send_operation.data.data() +
+                                                send_operation.offset);
+  entry->len = static_cast<std::uint32_t>(send_operation.data.size() -
+                                          send_operation.offset);
+  entry->msg_flags = MSG_NOSIGNAL;
+  entry->user_data = reinterpret_cast<std::uint64_t>(
+      static_cast<Operation *>(&send_operation));
+  return true;
+}
+
+void IoUringLoop::OnCompletion(const IoUringCompletion &completion) {
+  // Buffers that could not be provided. The receive runs out of buffers
+  // and reports it.
+  if (completion.user_data == 0) {
+    return;
+  }
+  Operation *operation = reinterpret_cast<Operation *>(completion.user_data);
+  if (operation->kind == OperationKind::Send) {
+    OnSendCompletion(*static_cast<SendOperation *>(operation),
+                     completion.result);
+    return;
+  }
+
+  Receiver &receiver = *static_cast<Receiver *>(operation);
+  receiver.received_chunks.push_back(
+      {completion.result,
+       static_cast<std::uint16_t>(completion.flags >> IORING_CQE_BUFFER_SHIFT),
+       (completion.flags & IORING_CQE_F_BUFFER) != 0,
+       (completion.flags & IORING_CQE_F_MORE) != 0});
+  DispatchReceivedChunks(receiver);
+}
+
+void IoUringLoop::OnSendCompletion(SendOperation &send_operation,
+                                   std::int32_t result) {
+  if (result == -EINTR || result == -EAGAIN) {
+    result = 0;
+  } else if (result < 0) {
+    last_error_ = std::string("Failed to send to the server! ") +
+                  strerror(-result);
+  }
+
+  if (result >= 0) {
+    send_operation.offset += result;
+    // A short send: the rest is sent by another operation.
+    if (send_operation.offset < send_operation.data.size() &&
+        SubmitSend(send_operation)) {
+      return;
+    }
+  }
+
+  const bool is_success =
+      send_operation.offset == send_operation.data.size();
+  SendHandler handler = std::move(send_operation.handler);
+  send_operation.handler = nullptr;
+  free_send_operations_.push_back(&send_operation);
+  handler(is_success);
+}
+
+void IoUringLoop::DispatchReceivedChunks(Receiver &receiver) {
+  if (receiver.is_dispatching) {
+    return;
+  }
+
+  receiver.is_dispatching = true;
+  while (!receiver.received_chunks.empty() && !receiver.is_closed) {
+    ReceivedChunk chunk = receiver.received_chunks.front();
+    receiver.received_chunks.pop_front();
+
+    if (chunk.has_buffer) {
+      if (chunk.result > 0) {
+        receiver.handler(std::string_view(
+            receiver.buffers.GetBuffer(chunk.buffer_id), chunk.result));
+      }
+      if (!receiver.buffers.Recycle(chunk.buffer_id)) {
+        last_error_ = "The io_uring submission queue is full!";
+      }
+    }
+
+    // The receive stops when the socket runs out of buffers. It is armed
+    // again, as the handled buffers have just been recycled.
+    if (chunk.result == 0 ||
+        (chunk.result < 0 && chunk.result != -ENOBUFS)) {
+      last_error_ = chunk.result == 0
+                        ? "The server has closed the connection!"
+                        : std::string("Failed to receive from the server! ") +
+                              strerror(-chunk.result);
+      receiver.is_closed = true;
+      receiver.handler({});
+    } else if (!chunk.is_armed && !ArmReceive(receiver)) {
+      receiver.is_closed = true;
+      receiver.handler({});
+    }
+  }
+  receiver.is_dispatching = false;
+}
+#endif
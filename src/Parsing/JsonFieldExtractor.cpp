@@ -0,0 +1,22 @@
+#include "../../include/Parsing/JsonFieldExtractor.hpp"
+#include "../../include/Parsing/JsonScanner.hpp"
+
+namespace {
+const JsonScanner &GetScanner() {
+  static const JsonScanner scanner;
+  return scanner;
+}
+} // namespace
+
+std::optional<std::string_view> ExtractJsonField(std::string_view json,
+                                                 std::string_view field_name) {
+  return GetScanner().ExtractField(json, field_name);
+}
+
+bool ExtractJsonFields(std::string_view json,
+                       const std::string_view *field_names,
+                       std::optional<std::string_view> *values,
+                       std::size_t number_of_fields) {
+  return GetScanner().ExtractFields(json, field_names, values,
+                                    number_of_fields);
+}
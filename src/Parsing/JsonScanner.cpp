@@ -0,0 +1,185 @@
+#include "../../include/Parsing/JsonScanner.hpp"
+
+#if defined(__x86_64__) || defined(__i386__)
+#define JSON_SCANNER_HAS_X86_KERNELS
+#include <immintrin.h>
+#endif
+
+namespace {
+constexpr std::size_t kBlockSize = JsonScanner::kBlockSize;
+
+JsonBlockMasks ClassifyBlockScalar(const char *block) {
+  JsonBlockMasks masks{0, 0, 0};
+  for (std::size_t i = 0; i < kBlockSize; ++i) {
+    const std::uint64_t bit = std::uint64_t{1} << i;
+    switch (block[i]) {
+    case '"':
+      masks.quotes |= bit;
+      break;
+    case '\\':
+      masks.backslashes |= bit;
+      break;
+    case '{':
+    case '}':
+    case '[':
+    case ']':
+    case ':':
+    case ',':
+      masks.structurals |= bit;
+      break;
+    default:
+      break;
+    }
+  }
+  return masks;
+}
+
+#ifdef JSON_SCANNER_HAS_X86_KERNELS
+// Matches the structural characters with a single PCMPESTRM per 16 bytes.
+__attribute__((target("sse4.2"))) JsonBlockMasks
+ClassifyBlockSse42(const char *block) {
+  const __m128i quote = _mm_set1_epi8('"');
+  const __m128i backslash = _mm_set1_epi8('\\');
+  const __m128i structural_characters =
+      _mm_setr_epi8('{', '}', '[', ']', ':', ',', 0, 0, 0, 0, 0, 0, 0, 0, 0, 0);
+  constexpr int kNumberOfStructuralCharacters = 6;
+
+  JsonBlockMasks masks{0, 0, 0};
+  for (std::size_t offset = 0; offset < kBlockSize; offset += 16) {
+    const __m128i chunk =
+        _mm_loadu_si128(reinterpret_cast<const __m128i *>(block + offset));
+    const std::uint64_t quotes = static_cast<std::uint32_t>(
+        _mm_movemask_epi8(_mm_cmpeq_epi8(chunk, quote)));
+    const std::uint64_t backslashes = static_cast<std::uint32_t>(
+        _mm_movemask_epi8(_mm_cmpeq_epi8(chunk, backslash)));
+    const std::uint64_t structurals =
+        static_cast<std::uint32_t>(_mm_cvtsi128_si32(_mm_cmpestrm(
+            structural_characters, kNumberOfStructuralCharacters, chunk, 16,
+            _SIDD_UBYTE_OPS | _SIDD_CMP_EQUAL_ANY | _SIDD_BIT_MASK))) &
+        0xFFFF;
+    masks.quotes |= quotes << offset;
+    masks.backslashes |= backslashes << offset;
+    masks.structurals |= structurals << offset;
+  }
+  return masks;
+}
+
+// Setting the 0x20 bit turns [ and ] into { and }, so the six structural
+// characters take four comparisons.
+__attribute__((target("avx2"))) JsonBlockMasks
+ClassifyBlockAvx2(const char *block) {
+  const __m256i quote = _mm256_set1_epi8('"');
+  const __m256i backslash = _mm256_set1_epi8('\\');
+  const __m256i lowercase_bit = _mm256_set1_epi8(0x20);
+  const __m256i opening_brace = _mm256_set1_epi8('{');
+  const __m256i closing_brace = _mm256_set1_epi8('}');
+  const __m256i colon = _mm256_set1_epi8(':');
+  const __m256i comma = _mm256_set1_epi8(',');
+
+  JsonBlockMasks masks{0, 0, 0};
+  for (std::size_t offset = 0; offset < kBlockSize; offset += 32) {
+    const __m256i chunk =
+        _mm256_loadu_si256(reinterpret_cast<const __m256i *>(block + offset));
+    const __m256i folded_chunk = _mm256_or_si256(chunk, lowercase_bit);
+    const __m256i structurals = _mm256_or_si256(
+        _mm256_or_si256(_mm256_cmpeq_epi8(folded_chunk, opening_brace),
+                        _mm256_cmpeq_epi8(folded_chunk, closing_brace)),
+        _mm256_or_si256(_mm256_cmpeq_epi8(chunk, colon),
+                        _mm256_cmpeq_epi8(chunk, comma)));
+    masks.quotes |= std::uint64_t{static_cast<std::uint32_t>(
+                        _mm256_movemask_epi8(_mm256_cmpeq_epi8(chunk, quote)))}
+                    << offset;
+    masks.backslashes |=
+        std::uint64_t{static_cast<std::uint32_t>(
+            _mm256_movemask_epi8(_mm256_cmpeq_epi8(chunk, backslash)))}
+        << offset;
+    masks.structurals |=
+        std::uint64_t{
+            static_cast<std::uint32_t>(_mm256_movemask_epi8(structurals))}
+        << offset;
+  }
+  return masks;
+}
+#endif
+} // namespace
+
+bool IsJsonScannerKernelSupported(JsonScannerKernel kernel) {
+  switch (kernel) {
+  case JsonScannerKernel::Scalar:
+    return true;
+#ifdef JSON_SCANNER_HAS_X86_KERNELS
+  case JsonScannerKernel::Sse42:
+    return __builtin_cpu_supports("sse4.2");
+  case JsonScannerKernel::Avx2:
+    return __builtin_cpu_supports("avx2");
+#endif
+  default:
+    return false;
+  }
+}
+
+JsonScannerKernel GetBestJsonScannerKernel() {
+  static const JsonScannerKernel best_kernel = [] {
+    for (JsonScannerKernel kernel :
+         {JsonScannerKernel::Avx2, JsonScannerKernel::Sse42}) {
+      if (IsJsonScannerKernelSupported(kernel)) {
+        return kernel;
+      }
+    }
+    return JsonScannerKernel::Scalar;
+  }();
+  return best_kernel;
+}
+
+const char *GetJsonScannerKernelName(JsonScannerKernel kernel) {
+  switch (kernel) {
+  case JsonScannerKernel::Sse42:
+    return "SSE4.2";
+  case JsonScannerKernel::Avx2:
+    return "AVX2";
+  default:
+    return "scalar";
+  }
+}
+
+JsonScanner::JsonScanner(JsonScannerKernel kernel)
+    : kernel_{JsonScannerKernel::Scalar},
+      classify_block_{ClassifyBlockScalar} {
+  if (!IsJsonScannerKernelSupported(kernel)) {
+    return;
+  }
+  kernel_ = kernel;
+#ifdef JSON_SCANNER_HAS_X86_KERNELS
+  if (kernel == JsonScannerKernel::Sse42) {
+    classify_block_ = ClassifyBlockSse42;
+  } else if (kernel == JsonScannerKernel::Avx2) {
+    classify_block_ = ClassifyBlockAvx2;
+  }
+#endif
+}
+
+bool JsonScanner::ExtractFields(std::string_view json,
+                                const std::string_view *field_names,
+                                std::optional<std::string_view> *values,
+                                std::size_t number_of_fields) const {
+  for (std::size_t i = 0; i < number_of_fields; ++i) {
+    values[i].reset();
+  }
+  std::size_t number_of_found_fields = 0;
+  const bool is_valid = ForEachField(
+      json, [&](std::string_view key, std::string_view value) {
+        for (std::size_t i = 0; i < number_of_fields; ++i) {
+          if (!values[i] && field_names[i] == key) {
+            values[i] = value;
+            ++number_of_found_fields;
+          }
+        }
+        return number_of_found_fields < number_of_fields;
+      });
+  if (!is_valid) {
+    for (std::size_t i = 0; i < number_of_fields; ++i) {
+      values[i].reset();
+    }
+  }
+  return is_valid;
+}
@@ -0,0 +1,360 @@
+#include <cstring>
+
+#include "../../include/Parsing/RespParser.hpp"
+
+namespace {
+// Same limits as the Redis server's protocol parser.
+constexpr long long kMaximumBulkLength = 512LL * 1024 * 1024;
+constexpr long long kMaximumAggregateLength = 1LL << 32;
+constexpr std::size_t kMaximumNestingDepth = 64;
+
+bool ParseInteger(const char *begin, const char *end, long long &value) {
+  if (begin == end) {
+    return false;
+  }
+
+  bool is_negative = false;
+  if (*begin == '-' || *begin == '+') {
+    is_negative = *begin == '-';
+    if (++begin == end) {
+      return false;
+    }
+  }
+
+  unsigned long long magnitude = 0;
+  for (; begin != end; ++begin) {
+    if (*begin < '0' || *begin > '9') {
+      return false;
+    }
+    unsigned long long digit = *begin - '0';
+    if (magnitude > (9223372036854775808ULL - digit) / 10) {
+      return false;
+    }
+    magnitude = magnitude * 10 + digit;
+  }
+
+  if (!is_negative && magnitude > 9223372036854775807ULL) {
+    return false;
+  }
+  value = is_negative ? static_cast<long long>(0 - magnitude)
+                      : static_cast<long long>(magnitude);
+  return true;
+}
+
+bool EqualsIgnoringCase(std::string_view lhs, const char *rhs) {
+  std::size_t rhs_length = strlen(rhs);
+  if (lhs.size() != rhs_length) {
+    return false;
+  }
+  for (std::size_t i = 0; i < rhs_length; ++i) {
+    if ((lhs[i] | 0x20) != rhs[i]) {
+      return false;
+    }
+  }
+  return true;
+}
+} // namespace
+
+RespParser::RespParser() : bytes_needed_{0}, last_error_{""} {
+  nodes_.reserve(16);
+  pending_aggregates_.reserve(kMaximumNestingDepth);
+}
+
+bool RespParser::CompleteValue() {
+  while (!pending_aggregates_.empty()) {
+    PendingAggregate &parent = pending_aggregates_.back();
+    if (--parent.remaining_elements != 0) {
+      return false;
+    }
+
+    bool is_attribute = parent.is_attribute;
+    nodes_[parent.node_index].subtree_size =
+        nodes_.size() - parent.node_index;
+    if (is_attribute) {
+      nodes_.resize(parent.node_index);
+    }
+    pending_aggregates_.pop_back();
+    // An attribute decorates the value that follows it, so it does not count
+    // as an element of the enclosing aggregate.
+    if (is_attribute) {
+      return false;
+    }
+  }
+  return true;
+}
+
+RespParseStatus RespParser::Parse(const char *data, std::size_t length,
+                                  std::size_t &bytes_consumed) {
+  nodes_.clear();
+  pending_aggregates_.clear();
+  bytes_needed_ = 0;
+
+  const char *position = data;
+  const char *const end = data + length;
+
+  while (true) {
+    if (position == end) {
+      return RespParseStatus::Incomplete;
+    }
+
+    const char type = *position;
+    const char *line_begin = position + 1;
+    const char *line_end = static_cast<const char *>(
+        memchr(line_begin, '\r', end - line_begin));
+    if (line_end == nullptr || line_end + 1 == end) {
+      return RespParseStatus::Incomplete;
+    }
+    if (line_end[1] != '\n') {
+      return Fail("Missing line feed after carriage return");
+    }
+    position = line_end + 2;
+
+    RespValue value{};
+    value.type = static_cast<RespType>(type);
+    value.subtree_size = 1;
+
+    long long aggregate_length = 0;
+    bool is_attribute = false;
+
+    switch (type) {
+    case '+':
+    case '-':
+    case '(':
+    case ',':
+      value.string = std::string_view(line_begin, line_end - line_begin);
+      break;
+    case ':':
+      value.string = std::string_view(line_begin, line_end - line_begin);
+      if (!ParseInteger(line_begin, line_end, value.integer)) {
+        return Fail("Invalid integer");
+      }
+      break;
+    case '#':
+      if (line_end - line_begin != 1 ||
+          (*line_begin != 't' && *line_begin != 'f')) {
+        return Fail("Invalid boolean");
+      }
+      value.integer = *line_begin == 't';
+      break;
+    case '_':
+      if (line_end != line_begin) {
+        return Fail("Invalid null");
+      }
+      value.is_null = true;
+      break;
+    case '$':
+    case '!':
+    case '=': {
+      long long bulk_length = 0;
+      if (!ParseInteger(line_begin, line_end, bulk_length) ||
+          bulk_length < -1 || bulk_length > kMaximumBulkLength) {
+        return Fail("Invalid bulk length");
+      }
+      if (bulk_length == -1) {
+        value.is_null = true;
+        break;
+      }
+      if (end - position < bulk_length + 2) {
+        bytes_needed_ = (position - data) + bulk_length + 2;
+        return RespParseStatus::Incomplete;
+      }
+      if (position[bulk_length] != '\r' || position[bulk_length + 1] != '\n') {
+        return Fail("Bulk string is not terminated by CRLF");
+      }
+      value.string = std::string_view(position, bulk_length);
+      // Verbatim strings are prefixed with a three letter format and a colon.
+      if (type == '=') {
+        if (bulk_length < 4 || position[3] != ':') {
+          return Fail("Invalid verbatim string");
+        }
+        value.string.remove_prefix(4);
+      }
+      position += bulk_length + 2;
+      break;
+    }
+    case '*':
+    case '~':
+    case '>':
+    case '%':
+    case '|':
+      if (!ParseInteger(line_begin, line_end, aggregate_length) ||
+          aggregate_length < -1 || aggregate_length > kMaximumAggregateLength) {
+        return Fail("Invalid aggregate length");
+      }
+      if (aggregate_length == -1) {
+        value.is_null = true;
+        aggregate_length = 0;
+        break;
+      }
+      if (type == '%' || type == '|') {
+        aggregate_length *= 2;
+      }
+      is_attribute = type == '|';
+      if (is_attribute) {
+        value.type = RespType::Map;
+      }
+      value.integer = aggregate_length;
+      value.number_of_elements = aggregate_length;
+      break;
+    default:
+      return Fail("Unknown RESP type");
+    }
+
+    nodes_.push_back(value);
+
+    if (aggregate_length > 0) {
+      if (pending_aggregates_.size() == kMaximumNestingDepth) {
+        return Fail("Maximum nesting depth exceeded");
+      }
+      pending_aggregates_.push_back(
+          {nodes_.size() - 1, static_cast<std::size_t>(aggregate_length),
+           is_attribute});
+      continue;
+    }
+
+    if (is_attribute) {
+      // An empty attribute carries no information.
+      nodes_.pop_back();
+      continue;
+    }
+
+    if (CompleteValue()) {
+      bytes_consumed = position - data;
+      return RespParseStatus::Complete;
+    }
+  }
+}
+
+const RespValue *RespParser::Child(const RespValue &aggregate,
+                                   std::size_t index) const {
+  if (!aggregate.IsAggregate() || index >= aggregate.number_of_elements) {
+    return nullptr;
+  }
+
+  const RespValue *child = &aggregate + 1;
+  while (index--) {
+    child += child->subtree_size;
+  }
+  return child;
+}
+
+bool ParsePubSubMessage(const RespParser &parser,
+                        PubSubMessage &pubsub_message) {
+  const RespValue &root = parser.Root();
+  if ((root.type != RespType::Array && root.type != RespType::Push) ||
+      root.number_of_elements < 3) {
+    return false;
+  }
+
+  // Every element of a pub/sub reply is a scalar, so the children are stored
+  // next to each other.
+  for (std::size_t i = 1; i <= root.number_of_elements; ++i) {
+    if ((&root)[i].subtree_size != 1) {
+      return false;
+    }
+  }
+
+  const RespValue *elements = &root + 1;
+  if (!elements[0].IsString()) {
+    return false;
+  }
+
+  const std::string_view kind = elements[0].string;
+  pubsub_message = PubSubMessage{};
+  if (root.number_of_elements == 4 && EqualsIgnoringCase(kind, "pmessage")) {
+    pubsub_message.kind = PubSubMessageKind::PatternMessage;
+    pubsub_message.pattern = elements[1].string;
+    pubsub_message.channel = elements[2].string;
+    pubsub_message.payload = elements[3].string;
+    return true;
+  }
+
+  if (root.number_of_elements != 3) {
+    return false;
+  }
+
+  const bool is_message = EqualsIgnoringCase(kind, "message");
+  if (is_message || EqualsIgnoringCase(kind, "smessage")) {
+    pubsub_message.kind = is_message ? PubSubMessageKind::Message
+                                     : PubSubMessageKind::ShardMessage;
+    pubsub_message.channel = elements[1].string;
+    pubsub_message.payload = elements[2].string;
+    return true;
+  }
+
+  if (EqualsIgnoringCase(kind, "subscribe")) {
+    pubsub_message.kind = PubSubMessageKind::Subscribe;
+  } else if (EqualsIgnoringCase(kind, "unsubscribe")) {
+    pubsub_message.kind = PubSubMessageKind::Unsubscribe;
+  } else if (EqualsIgnoringCase(kind, "psubscribe")) {
+    pubsub_message.kind = PubSubMessageKind::PatternSubscribe;
+  } else if (EqualsIgnoringCase(kind, "punsubscribe")) {
+    pubsub_message.kind = PubSubMessageKind::PatternUnsubscribe;
+  } else if (EqualsIgnoringCase(kind, "ssubscribe")) {
+    pubsub_message.kind = PubSubMessageKind::ShardSubscribe;
+  } else if (EqualsIgnoringCase(kind, "sunsubscribe")) {
+    pubsub_message.kind = PubSubMessageKind::ShardUnsubscribe;
+  } else {
+    return false;
+  }
+
+  if (pubsub_message.kind == PubSubMessageKind::PatternSubscribe ||
+      pubsub_message.kind == PubSubMessageKind::PatternUnsubscribe) {
+    pubsub_message.pattern = elements[1].string;
+  } else {
+    pubsub_message.channel = elements[1].string;
+  }
+  pubsub_message.number_of_subscriptions = elements[2].integer;
+  return true;
+}
+
+bool ParseStreamEntries(const RespParser &parser,
+                        std::string_view payload_field,
+                        std::vector<StreamEntry> &entries) {
+  entries.clear();
+  const RespValue &root = parser.Root();
+  if (root.is_null) {
+    return true;
+  }
+  // [[stream, entries]] in RESP2 and {stream: entries} in RESP3.
+  const RespValue *stream_entries = nullptr;
+  if (root.type == RespType::Map) {
+    stream_entries = parser.Child(root, 1);
+  } else if (root.type == RespType::Array) {
+    const RespValue *stream = parser.Child(root, 0);
+    stream_entries = stream ? parser.Child(*stream, 1) : nullptr;
+  }
+  if (stream_entries == nullptr || !stream_entries->IsAggregate()) {
+    return false;
+  }
+
+  // Every entry is [id, [field, value, ...]].
+  const RespValue *entry = stream_entries + 1;
+  for (std::size_t i = 0; i < stream_entries->number_of_elements;
+       ++i, entry += entry->subtree_size) {
+    const RespValue *id = parser.Child(*entry, 0);
+    const RespValue *fields = parser.Child(*entry, 1);
+    if (id == nullptr || !id->IsString() || fields == nullptr) {
+      return false;
+    }
+    // The fields of a deleted entry are null. The others are scalars, so
+    // they are stored next to each other.
+    if (fields->IsAggregate() &&
+        fields->subtree_size != fields->number_of_elements + 1) {
+      return false;
+    }
+    StreamEntry stream_entry{id->string, {}, false};
+    for (std::size_t j = 0; fields->IsAggregate() &&
+                            j + 1 < fields->number_of_elements;
+         j += 2) {
+      const RespValue &field = fields[1 + j];
+      if (field.string == payload_field) {
+        stream_entry.payload = fields[2 + j].string;
+        stream_entry.has_payload = true;
+        break;
+      }
+    }
+    entries.push_back(stream_entry);
+  }
+  return true;
+}
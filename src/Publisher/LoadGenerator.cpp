@@ -0,0 +1,489 @@
+#include "../../include/Publisher/LoadGenerator.hpp"
+
+#include <arpa/inet.h>
+#include <charconv>
+#include <cstring>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <thread>
+#include <unistd.h>
+
+#include "../../include/Concurrency/Backoff.hpp"
+#include "../../include/Parsing/RespWriter.hpp"
+
+namespace {
+inline constexpr auto kRespXread = EncodeRespBulkString("XREAD");
+inline constexpr auto kRespXrevrange = EncodeRespBulkString("XREVRANGE");
+inline constexpr auto kRespCount = EncodeRespBulkString("COUNT");
+inline constexpr auto kRespBlock = EncodeRespBulkString("BLOCK");
+inline constexpr auto kRespStreams = EncodeRespBulkString("STREAMS");
+
+// The most processed messages that a single XREAD returns, and how long it
+// waits for them, which bounds how late the reader notices the end of a run.
+constexpr long long kStreamReadCount = 1024;
+constexpr long long kStreamReadTimeoutInMilliseconds = 100;
+// The field of the processed stream's entries that holds the message_id.
+constexpr std::string_view kMessageIdField = "Message_id";
+// Waits for the next scheduled message that are shorter than this are spun
+// away, since a sleep can overshoot by about as much.
+constexpr std::int64_t kMinimumSleepTimeInNanoseconds = 100'000;
+
+std::int64_t GetSteadyTimeInNanoseconds() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+// The clock of the publish_time_ns fields, which the consumers compare with
+// their own.
+std::int64_t GetSystemTimeInNanoseconds() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+             std::chrono::system_clock::now().time_since_epoch())
+      .count();
+}
+
+template <typename Integer>
+void AppendInteger(std::string &text, Integer value) {
+  char digits[24];
+  const auto result = std::to_chars(digits, digits + sizeof(digits), value);
+  text.append(digits, result.ptr - digits);
+}
+
+// Parses an integer from the position on, which has to be followed by the
+// separator or, without one, end the text.
+template <typename Integer>
+bool ParseInteger(const char *&position, const char *end, char separator,
+                  Integer &value) {
+  const auto result = std::from_chars(position, end, value);
+  if (result.ec != std::errc()) {
+    return false;
+  }
+  position = result.ptr;
+  if (separator == '\0') {
+    return position == end;
+  }
+  if (position == end || *position != separator) {
+    return false;
+  }
+  ++position;
+  return true;
+}
+
+int ConnectToServer(const std::string &hostname, unsigned short port,
+                    std::string &error) {
+  const int file_descriptor = socket(AF_INET, SOCK_STREAM, 0);
+  if (file_descriptor < 0) {
+    error = std::string("Failed to create a socket! ") + strerror(errno);
+    return -1;
+  }
+  sockaddr_in server_address{};
+  server_address.sin_family = AF_INET;
+  server_address.sin_addr.s_addr = inet_addr(hostname.c_str());
+  server_address.sin_port = htons(port);
+  if (connect(file_descriptor, reinterpret_cast<sockaddr *>(&server_address),
+              sizeof(server_address)) < 0) {
+    error = "Unable to connect to the Redis server at " + hostname + ":" +
+            std::to_string(port) + "! " + strerror(errno);
+    close(file_descriptor);
+    return -1;
+  }
+  // The last commands of a batch must not wait for the replies to the
+  // previous ones, which would add to the measured latencies.
+  const int enabled = 1;
+  setsockopt(file_descriptor, IPPROTO_TCP, TCP_NODELAY, &enabled,
+             sizeof(enabled));
+  return file_descriptor;
+}
+
+// Reads from the blocking connection until a whole reply arrived and hands
+// it to reply_handler. Returns false when the connection failed.
+template <typename ReplyHandler>
+bool ReadReply(RespReader &reader, ReplyHandler &&reply_handler) {
+  bool has_reply = false;
+  while (!has_reply) {
+    if (!reader.ReadFrames([&](const RespParser &parser) {
+          reply_handler(parser);
+          has_reply = true;
+        })) {
+      return false;
+    }
+  }
+  return true;
+}
+} // namespace
+
+void AppendLoadMessageId(std::string &message_id, const LoadMessageId &id) {
+  AppendInteger(message_id, id.run_id);
+  message_id += '-';
+  AppendInteger(message_id, id.sequence);
+  message_id += '-';
+  AppendInteger(message_id, id.intended_publish_time_ns);
+  message_id += '-';
+  AppendInteger(message_id, id.publish_time_ns);
+}
+
+bool ParseLoadMessageId(std::string_view message_id, LoadMessageId &id) {
+  const char *position = message_id.data();
+  const char *end = position + message_id.size();
+  return ParseInteger(position, end, '-', id.run_id) &&
+         ParseInteger(position, end, '-', id.sequence) &&
+         ParseInteger(position, end, '-', id.intended_publish_time_ns) &&
+         ParseInteger(position, end, '\0', id.publish_time_ns);
+}
+
+void FormatLoadMessage(std::string &payload, const LoadMessageId &id,
+                       std::size_t size) {
+  constexpr std::string_view kEnd = "\"}";
+  payload.assign("{\"message_id\":\"");
+  AppendLoadMessageId(payload, id);
+  payload += "\",\"sequence\":";
+  AppendInteger(payload, id.sequence);
+  payload += ",\"publish_time_ns\":";
+  AppendInteger(payload, id.publish_time_ns);
+  payload += ",\"padding\":\"";
+  if (payload.size() + kEnd.size() < size) {
+    payload.append(size - payload.size() - kEnd.size(), 'x');
+  }
+  payload += kEnd;
+}
+
+std::vector<SequenceGap>
+SequenceTracker::GetGaps(std::uint64_t last_sequence) const {
+  std::vector<SequenceGap> gaps;
+  for (std::uint64_t sequence = 1; sequence <= last_sequence; ++sequence) {
+    if (Contains(sequence)) {
+      continue;
+    }
+    if (!gaps.empty() && gaps.back().last + 1 == sequence) {
+      gaps.back().last = sequence;
+    } else {
+      gaps.push_back({sequence, sequence});
+    }
+  }
+  return gaps;
+}
+
+LoadGenerator::LoadGenerator(LoadGeneratorOptions options)
+    : options_(std::move(options)),
+      // Tells the messages of this run apart from those of earlier ones
+      // that are still on their way.
+      run_id_(static_cast<std::uint64_t>(GetSystemTimeInNanoseconds())),
+      random_engine_(options_.seed),
+      payload_size_distribution_(
+          options_.minimum_payload_size,
+          std::max(options_.minimum_payload_size,
+                   options_.maximum_payload_size)),
+      publish_file_descriptor_{-1}, stream_file_descriptor_{-1},
+      last_stream_id_{"0-0"}, start_time_ns_{0}, start_system_time_ns_{0},
+      next_sequence_{1}, maximum_schedule_lag_ns_{0},
+      number_of_published_messages_{0}, number_of_replies_{0},
+      is_publishing_done_{false}, publishing_end_time_ns_{0},
+      number_of_publish_errors_{0}, number_of_unsubscribed_messages_{0},
+      results_{} {}
+
+LoadGenerator::~LoadGenerator() {
+  if (publish_file_descriptor_ >= 0) {
+    close(publish_file_descriptor_);
+  }
+  if (stream_file_descriptor_ >= 0) {
+    close(stream_file_descriptor_);
+  }
+}
+
+bool LoadGenerator::Connect() {
+  publish_file_descriptor_ =
+      ConnectToServer(options_.redis_server_hostname,
+                      options_.redis_server_port, last_error_);
+  if (publish_file_descriptor_ < 0) {
+    return false;
+  }
+  publish_reader_.SetFileDescriptor(publish_file_descriptor_);
+  if (options_.processed_stream.empty()) {
+    return true;
+  }
+  stream_file_descriptor_ =
+      ConnectToServer(options_.redis_server_hostname,
+                      options_.redis_server_port, last_error_);
+  if (stream_file_descriptor_ < 0) {
+    return false;
+  }
+  stream_reader_.SetFileDescriptor(stream_file_descriptor_);
+  return ReadLastStreamId();
+}
+
+bool LoadGenerator::ReadLastStreamId() {
+  RespWriter writer(stream_command_);
+  writer.Clear();
+  writer.AppendArrayHeader(6);
+  writer.Append(kRespXrevrange);
+  writer.AppendBulkString(options_.processed_stream);
+  writer.AppendBulkString("+");
+  writer.AppendBulkString("-");
+  writer.Append(kRespCount);
+  writer.AppendBulkString(1LL);
+  if (!writer.WriteTo(stream_file_descriptor_)) {
+    last_error_ = std::string("Failed to send XREVRANGE! ") + strerror(errno);
+    return false;
+  }
+  bool is_valid = false;
+  if (!ReadReply(stream_reader_, [&](const RespParser &parser) {
+        // [[id, [field, value, ...]]], or [] for an empty stream.
+        const RespValue &reply = parser.Root();
+        if (reply.type != RespType::Array) {
+          return;
+        }
+        is_valid = true;
+        const RespValue *entry = parser.Child(reply, 0);
+        const RespValue *id = entry ? parser.Child(*entry, 0) : nullptr;
+        if (id != nullptr && id->IsString()) {
+          last_stream_id_.assign(id->string);
+        }
+      })) {
+    last_error_ = stream_reader_.GetLastError();
+    return false;
+  }
+  if (!is_valid) {
+    last_error_ = "Unexpected reply to XREVRANGE " + options_.processed_stream;
+    return false;
+  }
+  return true;
+}
+
+bool LoadGenerator::Run() {
+  start_time_ns_ = GetSteadyTimeInNanoseconds();
+  start_system_time_ns_ = GetSystemTimeInNanoseconds();
+  std::thread reply_thread(&LoadGenerator::ReadPublishReplies, this);
+  std::thread stream_thread;
+  if (stream_file_descriptor_ >= 0) {
+    stream_thread = std::thread(&LoadGenerator::ReadProcessedStream, this);
+  }
+
+  const bool is_published = options_.mode == LoadMode::OpenLoop
+                                ? RunOpenLoop()
+                                : RunClosedLoop();
+  const std::int64_t end_time_ns = GetSteadyTimeInNanoseconds();
+  publishing_end_time_ns_.store(end_time_ns, std::memory_order_relaxed);
+  is_publishing_done_.store(true, std::memory_order_release);
+
+  // Waits for the replies to the PUBLISH commands, after which the reply
+  // thread is woken up by shutting the connection down.
+  const std::int64_t drain_deadline_ns =
+      end_time_ns +
+      std::chrono::duration_cast<std::chrono::nanoseconds>(
+          options_.drain_timeout)
+          .count();
+  while (is_published &&
+         number_of_replies_.load(std::memory_order_acquire) <
+             number_of_published_messages_.load(std::memory_order_relaxed) &&
+         GetSteadyTimeInNanoseconds() < drain_deadline_ns) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+  shutdown(publish_file_descriptor_, SHUT_RDWR);
+  reply_thread.join();
+  if (stream_thread.joinable()) {
+    stream_thread.join();
+  }
+
+  const long long number_of_published_messages =
+      number_of_published_messages_.load(std::memory_order_relaxed);
+  results_.number_of_published_messages = number_of_published_messages;
+  results_.publishing_time_in_seconds = (end_time_ns - start_time_ns_) / 1e9;
+  results_.number_of_publish_errors = number_of_publish_errors_;
+  results_.number_of_unsubscribed_messages = number_of_unsubscribed_messages_;
+  results_.maximum_schedule_lag_ns = maximum_schedule_lag_ns_;
+  results_.number_of_processed_messages =
+      sequence_tracker_.GetNumberOfReceived();
+  results_.number_of_duplicates = sequence_tracker_.GetNumberOfDuplicates();
+  results_.number_of_reordered = sequence_tracker_.GetNumberOfReordered();
+  if (stream_file_descriptor_ >= 0) {
+    results_.gaps = sequence_tracker_.GetGaps(number_of_published_messages);
+  }
+  results_.latencies = latencies_.GetSnapshot();
+  results_.uncorrected_latencies = uncorrected_latencies_.GetSnapshot();
+
+  if (!is_published) {
+    return false;
+  }
+  if (!stream_error_.empty()) {
+    last_error_ = stream_error_;
+    return false;
+  }
+  return true;
+}
+
+bool LoadGenerator::RunOpenLoop() {
+  const double rate = options_.messages_per_second;
+  const std::uint64_t number_of_messages = std::max<std::uint64_t>(
+      std::llround(rate *
+                   std::chrono::duration<double>(options_.duration).count()),
+      1);
+  Backoff backoff;
+  while (next_sequence_ <= number_of_messages) {
+    const std::int64_t elapsed_time_ns =
+        GetSteadyTimeInNanoseconds() - start_time_ns_;
+    const std::int64_t next_publish_offset =
+        GetIntendedPublishOffset(rate, next_sequence_);
+    if (elapsed_time_ns < next_publish_offset) {
+      const std::int64_t wait_time_ns = next_publish_offset - elapsed_time_ns;
+      if (wait_time_ns > kMinimumSleepTimeInNanoseconds) {
+        std::this_thread::sleep_for(std::chrono::nanoseconds(
+            wait_time_ns - kMinimumSleepTimeInNanoseconds / 2));
+      } else {
+        backoff.Pause();
+      }
+      continue;
+    }
+    backoff.Reset();
+
+    // Every message that is due goes out at once, up to the pipeline depth.
+    // The ones that are late keep their scheduled time, so the latency that
+    // they are measured with includes the time that they were held up.
+    maximum_schedule_lag_ns_ =
+        std::max(maximum_schedule_lag_ns_,
+                 elapsed_time_ns - next_publish_offset);
+    const std::uint64_t number_of_due_messages = std::min(
+        GetNumberOfDueMessages(rate, elapsed_time_ns), number_of_messages);
+    if (!Publish(std::min<std::uint64_t>(
+            number_of_due_messages - next_sequence_ + 1,
+            options_.pipeline_depth))) {
+      return false;
+    }
+  }
+  return true;
+}
+
+bool LoadGenerator::RunClosedLoop() {
+  const std::int64_t end_time_ns =
+      start_time_ns_ + std::chrono::duration_cast<std::chrono::nanoseconds>(
+                           options_.duration)
+                           .count();
+  const long long pipeline_depth =
+      static_cast<long long>(std::max<std::size_t>(options_.pipeline_depth, 1));
+  Backoff backoff;
+  while (GetSteadyTimeInNanoseconds() < end_time_ns) {
+    const long long number_of_pending_replies =
+        static_cast<long long>(next_sequence_ - 1) -
+        number_of_replies_.load(std::memory_order_acquire);
+    if (number_of_pending_replies >= pipeline_depth) {
+      backoff.Pause();
+      continue;
+    }
+    backoff.Reset();
+    if (!Publish(pipeline_depth - number_of_pending_replies)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+bool LoadGenerator::Publish(std::uint64_t number_of_messages) {
+  RespWriter writer(command_);
+  writer.Clear();
+  const std::int64_t publish_time_ns = GetSystemTimeInNanoseconds();
+  for (std::uint64_t i = 0; i < number_of_messages; ++i) {
+    const std::uint64_t sequence = next_sequence_++;
+    // In closed loop, a message is meant to be published when the previous
+    // one was answered, which is when it is published.
+    const std::int64_t intended_publish_time_ns =
+        options_.mode == LoadMode::OpenLoop
+            ? start_system_time_ns_ +
+                  GetIntendedPublishOffset(options_.messages_per_second,
+                                           sequence)
+            : publish_time_ns;
+    FormatLoadMessage(
+        payload_,
+        {run_id_, sequence, intended_publish_time_ns, publish_time_ns},
+        payload_size_distribution_(random_engine_));
+    writer.AppendArrayHeader(3);
+    writer.Append(kRespPublish);
+    writer.AppendBulkString(options_.channel);
+    writer.AppendBulkString(payload_);
+  }
+  if (!writer.WriteTo(publish_file_descriptor_)) {
+    last_error_ = std::string("Failed to send PUBLISH! ") + strerror(errno);
+    return false;
+  }
+  number_of_published_messages_.store(
+      static_cast<long long>(next_sequence_ - 1), std::memory_order_release);
+  return true;
+}
+
+void LoadGenerator::ReadPublishReplies() {
+  // Reads until Run() shuts the connection down.
+  while (publish_reader_.ReadFrames([this](const RespParser &parser) {
+    const RespValue &reply = parser.Root();
+    if (reply.IsError()) {
+      ++number_of_publish_errors_;
+    } else if (reply.type == RespType::Integer && reply.integer == 0) {
+      ++number_of_unsubscribed_messages_;
+    }
+    number_of_replies_.store(
+        number_of_replies_.load(std::memory_order_relaxed) + 1,
+        std::memory_order_release);
+  })) {
+  }
+}
+
+void LoadGenerator::ReadProcessedStream() {
+  const std::int64_t drain_timeout_ns =
+      std::chrono::duration_cast<std::chrono::nanoseconds>(
+          options_.drain_timeout)
+          .count();
+  std::vector<StreamEntry> entries;
+  RespWriter writer(stream_command_);
+  while (true) {
+    // Stops once every published message was processed, or the consumers
+    // had the drain timeout to catch up; the rest are lost.
+    if (is_publishing_done_.load(std::memory_order_acquire) &&
+        (sequence_tracker_.GetNumberOfReceived() >=
+             number_of_published_messages_.load(std::memory_order_relaxed) ||
+         GetSteadyTimeInNanoseconds() >=
+             publishing_end_time_ns_.load(std::memory_order_relaxed) +
+                 drain_timeout_ns)) {
+      return;
+    }
+
+    writer.Clear();
+    writer.AppendArrayHeader(8);
+    writer.Append(kRespXread);
+    writer.Append(kRespCount);
+    writer.AppendBulkString(kStreamReadCount);
+    writer.Append(kRespBlock);
+    writer.AppendBulkString(kStreamReadTimeoutInMilliseconds);
+    writer.Append(kRespStreams);
+    writer.AppendBulkString(options_.processed_stream);
+    writer.AppendBulkString(last_stream_id_);
+    if (!writer.WriteTo(stream_file_descriptor_)) {
+      stream_error_ = std::string("Failed to send XREAD! ") + strerror(errno);
+      return;
+    }
+    if (!ReadReply(stream_reader_, [this, &entries](const RespParser &parser) {
+          const std::int64_t receive_time_ns = GetSystemTimeInNanoseconds();
+          if (!ParseStreamEntries(parser, kMessageIdField, entries)) {
+            stream_error_ = "Unexpected reply to XREAD " +
+                            options_.processed_stream;
+            return;
+          }
+          for (const StreamEntry &entry : entries) {
+            last_stream_id_.assign(entry.id);
+            LoadMessageId id;
+            if (!entry.has_payload || !ParseLoadMessageId(entry.payload, id) ||
+                id.run_id != run_id_) {
+              continue;
+            }
+            if (sequence_tracker_.Record(id.sequence)) {
+              latencies_.Record(receive_time_ns - id.intended_publish_time_ns);
+              uncorrected_latencies_.Record(receive_time_ns -
+                                            id.publish_time_ns);
+            }
+          }
+        })) {
+      stream_error_ = stream_reader_.GetLastError();
+      return;
+    }
+    if (!stream_error_.empty()) {
+      return;
+    }
+  }
+}
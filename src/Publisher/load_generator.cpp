@@ -0,0 +1,205 @@
+#include <getopt.h>
+#include <iomanip>
+#include <iostream>
+#include <string>
+
+#include "../../include/Publisher/LoadGenerator.hpp"
+
+namespace {
+// The most gaps that are listed, of the lost messages.
+constexpr std::size_t kMaximumNumberOfPrintedGaps = 10;
+
+void PrintHelp() {
+  std::cout
+      << "NAME"
+         "\n\tload_generator - publishes messages to a Redis channel and "
+         "measures how long the consumers take to process them"
+         "\nSYNOPSIS:"
+         "\n\tload_generator [OPTION]..."
+         "\nDESCRIPTION:"
+         "\n\t-H, --host\tthe address of the Redis server (127.0.0.1)"
+         "\n\t-p, --port\tthe port of the Redis server (6379)"
+         "\n\t-c, --channel\tthe channel to publish to (messages:published)"
+         "\n\t-s, --stream\tthe stream of the processed messages, or - to "
+         "only publish (messages:processed)"
+         "\n\t-r, --rate\tmessages per second, in open loop (100000)"
+         "\n\t-C, --closed\tkeep the pipeline full instead of publishing at "
+         "a fixed rate"
+         "\n\t-P, --pipeline\tthe PUBLISH commands in flight in closed loop, "
+         "or sent at once in open loop (64)"
+         "\n\t-d, --duration\tseconds to publish for (10)"
+         "\n\t-m, --min-size\tthe smallest payload in bytes (128)"
+         "\n\t-M, --max-size\tthe largest payload in bytes (512)"
+         "\n\t-w, --wait\tseconds to wait for the processed messages (5)"
+         "\n\t-h, --help\tdisplay this help and exit"
+         "\nEXAMPLES:"
+         "\n\tload_generator --rate 200000 --duration 30"
+         "\tPublish 200000 messages per second for 30 seconds."
+         "\n\tload_generator --closed --pipeline 256"
+         "\tPublish as fast as the server answers."
+      << std::endl;
+}
+
+void PrintLatencies(const char *name, const LatencySnapshot &latencies) {
+  if (latencies.GetTotalCount() == 0) {
+    return;
+  }
+  auto in_microseconds = [](std::uint64_t nanoseconds) {
+    return nanoseconds / 1000.0;
+  };
+  std::cout << name << " (us): p50 " << std::fixed << std::setprecision(1)
+            << in_microseconds(latencies.GetValueAtPercentile(50)) << ", p90 "
+            << in_microseconds(latencies.GetValueAtPercentile(90)) << ", p99 "
+            << in_microseconds(latencies.GetValueAtPercentile(99))
+            << ", p99.9 "
+            << in_microseconds(latencies.GetValueAtPercentile(99.9))
+            << ", p99.99 "
+            << in_microseconds(latencies.GetValueAtPercentile(99.99))
+            << ", max " << in_microseconds(latencies.GetMaximum())
+            << std::defaultfloat << std::endl;
+}
+
+void PrintResults(const LoadGeneratorOptions &options,
+                  const LoadResults &results) {
+  std::cout << "Published " << results.number_of_published_messages
+            << " messages in " << std::fixed << std::setprecision(3)
+            << results.publishing_time_in_seconds << " seconds ("
+            << std::setprecision(0)
+            << (results.publishing_time_in_seconds > 0
+                    ? results.number_of_published_messages /
+                          results.publishing_time_in_seconds
+                    : 0)
+            << " messages/sec)" << std::defaultfloat << std::endl;
+  if (options.mode == LoadMode::OpenLoop) {
+    std::cout << "Fell behind the schedule by " << std::fixed
+              << std::setprecision(1)
+              << results.maximum_schedule_lag_ns / 1000.0 << " us at most"
+              << std::defaultfloat << std::endl;
+  }
+  if (results.number_of_publish_errors > 0) {
+    std::cout << results.number_of_publish_errors
+              << " PUBLISH commands failed" << std::endl;
+  }
+  if (results.number_of_unsubscribed_messages > 0) {
+    std::cout << results.number_of_unsubscribed_messages
+              << " messages reached no subscriber" << std::endl;
+  }
+  if (options.processed_stream.empty()) {
+    return;
+  }
+
+  long long number_of_lost_messages = 0;
+  for (const SequenceGap &gap : results.gaps) {
+    number_of_lost_messages += gap.last - gap.first + 1;
+  }
+  std::cout << "Processed " << results.number_of_processed_messages
+            << " messages, " << number_of_lost_messages << " lost in "
+            << results.gaps.size() << " gaps, "
+            << results.number_of_duplicates << " duplicates, "
+            << results.number_of_reordered << " out of order" << std::endl;
+  for (std::size_t i = 0;
+       i < std::min(results.gaps.size(), kMaximumNumberOfPrintedGaps); ++i) {
+    std::cout << "  Lost the messages " << results.gaps[i].first << " to "
+              << results.gaps[i].last << std::endl;
+  }
+  PrintLatencies(options.mode == LoadMode::OpenLoop
+                     ? "Latency from the scheduled publish time"
+                     : "Latency",
+                 results.latencies);
+  if (options.mode == LoadMode::OpenLoop) {
+    PrintLatencies("Latency from the actual publish time (uncorrected)",
+                   results.uncorrected_latencies);
+  }
+}
+} // namespace
+
+int main(int argc, char *argv[]) {
+  LoadGeneratorOptions options;
+  static struct option long_options[] = {
+      {"host", required_argument, nullptr, 'H'},
+      {"port", required_argument, nullptr, 'p'},
+      {"channel", required_argument, nullptr, 'c'},
+      {"stream", required_argument, nullptr, 's'},
+      {"rate", required_argument, nullptr, 'r'},
+      {"closed", no_argument, nullptr, 'C'},
+      {"pipeline", required_argument, nullptr, 'P'},
+      {"duration", required_argument, nullptr, 'd'},
+      {"min-size", required_argument, nullptr, 'm'},
+      {"max-size", required_argument, nullptr, 'M'},
+      {"wait", required_argument, nullptr, 'w'},
+      {"help", no_argument, nullptr, 'h'},
+      {nullptr, 0, nullptr, 0}};
+
+  int opt;
+  try {
+    while ((opt = getopt_long(argc, argv, "H:p:c:s:r:CP:d:m:M:w:h",
+                              long_options, nullptr)) != -1) {
+      switch (opt) {
+      case 'H':
+        options.redis_server_hostname = optarg;
+        break;
+      case 'p':
+        options.redis_server_port =
+            static_cast<unsigned short>(std::stoi(optarg));
+        break;
+      case 'c':
+        options.channel = optarg;
+        break;
+      case 's':
+        options.processed_stream = std::string(optarg) == "-" ? "" : optarg;
+        break;
+      case 'r':
+        options.messages_per_second = std::stod(optarg);
+        break;
+      case 'C':
+        options.mode = LoadMode::ClosedLoop;
+        break;
+      case 'P':
+        options.pipeline_depth = std::stoul(optarg);
+        break;
+      case 'd':
+        options.duration = std::chrono::milliseconds(
+            static_cast<long long>(std::stod(optarg) * 1000));
+        break;
+      case 'm':
+        options.minimum_payload_size = std::stoul(optarg);
+        break;
+      case 'M':
+        options.maximum_payload_size = std::stoul(optarg);
+        break;
+      case 'w':
+        options.drain_timeout = std::chrono::milliseconds(
+            static_cast<long long>(std::stod(optarg) * 1000));
+        break;
+      case 'h':
+        PrintHelp();
+        return 0;
+      default:
+        PrintHelp();
+        return 1;
+      }
+    }
+  } catch (const std::exception &) {
+    std::cerr << "Invalid argument of -" << static_cast<char>(opt) << ": "
+              << (optarg ? optarg : "") << std::endl;
+    return 1;
+  }
+  if (options.messages_per_second <= 0 || options.pipeline_depth == 0) {
+    std::cerr << "The rate and the pipeline depth have to be positive!"
+              << std::endl;
+    return 1;
+  }
+
+  LoadGenerator load_generator(options);
+  if (!load_generator.Connect()) {
+    std::cerr << load_generator.GetLastError() << std::endl;
+    return 1;
+  }
+  const bool is_successful = load_generator.Run();
+  PrintResults(options, load_generator.GetResults());
+  if (!is_successful) {
+    std::cerr << load_generator.GetLastError() << std::endl;
+    return 1;
+  }
+  return 0;
+}
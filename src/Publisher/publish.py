@@ -23,7 +23,7 @@ def publisher():
             p = connection.pipeline()
 
             for _ in range(batch_size):
-                p.publish("messages:published", f'{{"message_id": "{str(uuid.uuid4())}"}}')
+                p.publish("messages:published", f'{{"message_id": "{str(uuid.uuid4())}", "publish_time_ns": {time.time_ns()}}}')
 
             p.execute()
             total_messages += batch_size
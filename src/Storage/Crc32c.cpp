@@ -0,0 +1,141 @@
+#include "../../include/Storage/Crc32c.hpp"
+#include <array>
+#include <cstring>
+
+#if defined(__x86_64__)
+#include <nmmintrin.h>
+#endif
+
+namespace {
+// The reversed Castagnoli polynomial.
+constexpr std::uint32_t kPolynomial = 0x82F63B78;
+// The hardware checksum runs three streams of this many bytes at once, as the
+// crc32 instruction can start every cycle but takes three to finish.
+constexpr std::size_t kStreamSize = 256;
+
+std::array<std::uint32_t, 256> CreateTable() {
+  std::array<std::uint32_t, 256> table{};
+  for (std::uint32_t i = 0; i < 256; ++i) {
+    std::uint32_t crc = i;
+    for (int bit = 0; bit < 8; ++bit) {
+      crc = (crc >> 1) ^ ((crc & 1) ? kPolynomial : 0);
+    }
+    table[i] = crc;
+  }
+  return table;
+}
+
+std::uint32_t SoftwareCrc32c(std::uint32_t crc, const unsigned char *data,
+                             std::size_t size) {
+  static const std::array<std::uint32_t, 256> kTable = CreateTable();
+  for (std::size_t i = 0; i < size; ++i) {
+    crc = (crc >> 8) ^ kTable[(crc ^ data[i]) & 0xFF];
+  }
+  return crc;
+}
+
+#if defined(__x86_64__)
+// What kStreamSize zero bytes turn a checksum into, one table per byte of the
+// checksum. The checksum is linear, so the checksum of a stream that follows
+// another one is the shifted checksum of the first one, xor the checksum of
+// the second one started from 0.
+std::array<std::array<std::uint32_t, 256>, 4> CreateShiftTables() {
+  static const unsigned char kZeros[kStreamSize] = {};
+  std::array<std::array<std::uint32_t, 256>, 4> tables{};
+  for (std::size_t byte = 0; byte < tables.size(); ++byte) {
+    for (std::uint32_t value = 0; value < 256; ++value) {
+      tables[byte][value] =
+          SoftwareCrc32c(value << (8 * byte), kZeros, kStreamSize);
+    }
+  }
+  return tables;
+}
+
+std::uint64_t ShiftOverStream(std::uint64_t crc) {
+  static const std::array<std::array<std::uint32_t, 256>, 4> kTables =
+      CreateShiftTables();
+  return kTables[0][crc & 0xFF] ^ kTables[1][(crc >> 8) & 0xFF] ^
+         kTables[2][(crc >> 16) & 0xFF] ^ kTables[3][(crc >> 24) & 0xFF];
+}
+
+// Copies the bytes to copy as well, unless it is null, so they are only read
+// once.
+__attribute__((target("sse4.2"))) std::uint32_t
+HardwareCrc32c(std::uint32_t crc, const unsigned char *data, std::size_t size,
+               unsigned char *copy) {
+  std::uint64_t crc64 = crc;
+  for (; size >= 3 * kStreamSize; size -= 3 * kStreamSize) {
+    std::uint64_t second_crc = 0;
+    std::uint64_t third_crc = 0;
+    for (std::size_t i = 0; i < kStreamSize; i += sizeof(std::uint64_t)) {
+      std::uint64_t values[3];
+      std::memcpy(&values[0], data + i, sizeof(std::uint64_t));
+      std::memcpy(&values[1], data + kStreamSize + i, sizeof(std::uint64_t));
+      std::memcpy(&values[2], data + 2 * kStreamSize + i,
+                  sizeof(std::uint64_t));
+      crc64 = _mm_crc32_u64(crc64, values[0]);
+      second_crc = _mm_crc32_u64(second_crc, values[1]);
+      third_crc = _mm_crc32_u64(third_crc, values[2]);
+      if (copy != nullptr) {
+        std::memcpy(copy + i, &values[0], sizeof(std::uint64_t));
+        std::memcpy(copy + kStreamSize + i, &values[1], sizeof(std::uint64_t));
+        std::memcpy(copy + 2 * kStreamSize + i, &values[2],
+                    sizeof(std::uint64_t));
+      }
+    }
+    crc64 = ShiftOverStream(crc64) ^ second_crc;
+    crc64 = ShiftOverStream(crc64) ^ third_crc;
+    data += 3 * kStreamSize;
+    if (copy != nullptr) {
+      copy += 3 * kStreamSize;
+    }
+  }
+  for (; size >= sizeof(std::uint64_t); size -= sizeof(std::uint64_t)) {
+    std::uint64_t value;
+    std::memcpy(&value, data, sizeof(value));
+    crc64 = _mm_crc32_u64(crc64, value);
+    data += sizeof(value);
+    if (copy != nullptr) {
+      std::memcpy(copy, &value, sizeof(value));
+      copy += sizeof(value);
+    }
+  }
+  crc = static_cast<std::uint32_t>(crc64);
+  for (; size > 0; --size) {
+    if (copy != nullptr) {
+      *copy++ = *data;
+    }
+    crc = _mm_crc32_u8(crc, *data++);
+  }
+  return crc;
+}
+
+bool HasSse42() {
+  static const bool kHasSse42 = __builtin_cpu_supports("sse4.2");
+  return kHasSse42;
+}
+#endif
+} // namespace
+
+std::uint32_t Crc32c(const void *data, std::size_t size, std::uint32_t crc) {
+  const unsigned char *bytes = static_cast<const unsigned char *>(data);
+  crc = ~crc;
+#if defined(__x86_64__)
+  if (HasSse42()) {
+    return ~HardwareCrc32c(crc, bytes, size, nullptr);
+  }
+#endif
+  return ~SoftwareCrc32c(crc, bytes, size);
+}
+
+std::uint32_t Crc32cCopy(void *destination, const void *source,
+                         std::size_t size, std::uint32_t crc) {
+#if defined(__x86_64__)
+  if (HasSse42()) {
+    return ~HardwareCrc32c(~crc, static_cast<const unsigned char *>(source),
+                           size, static_cast<unsigned char *>(destination));
+  }
+#endif
+  std::memcpy(destination, source, size);
+  return Crc32c(destination, size, crc);
+}
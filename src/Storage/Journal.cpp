@@ -0,0 +1,536 @@
+#include "../../include/Storage/Journal.hpp"
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <utility>
+
+#include "../../include/Concurrency/Backoff.hpp"
+#include "../../include/Storage/Crc32c.hpp"
+
+namespace {
+constexpr const char *kSegmentPrefix = "journal-";
+constexpr const char *kSegmentSuffix = ".log";
+constexpr const char *kCheckpointFileName = "journal.checkpoint";
+
+std::uint32_t GetChecksum(std::uint32_t size, std::uint64_t sequence,
+                          std::initializer_list<std::string_view> parts) {
+  std::uint32_t checksum = Crc32c(&size, sizeof(size));
+  checksum = Crc32c(&sequence, sizeof(sequence), checksum);
+  for (std::string_view part : parts) {
+    checksum = Crc32c(part.data(), part.size(), checksum);
+  }
+  return checksum;
+}
+
+// The segments are named after their number. They are prepared ahead of
+// time, so the order of the numbers is not always the order of the records.
+std::string GetSegmentName(std::uint64_t segment_number) {
+  char name[64];
+  std::snprintf(name, sizeof(name), "%s%020llu%s", kSegmentPrefix,
+                static_cast<unsigned long long>(segment_number),
+                kSegmentSuffix);
+  return name;
+}
+
+bool ParseSegmentName(const std::string &name, std::uint64_t &segment_number) {
+  const std::size_t prefix_size = std::strlen(kSegmentPrefix);
+  const std::size_t suffix_size = std::strlen(kSegmentSuffix);
+  if (name.size() <= prefix_size + suffix_size ||
+      name.compare(0, prefix_size, kSegmentPrefix) != 0 ||
+      name.compare(name.size() - suffix_size, suffix_size, kSegmentSuffix) !=
+          0) {
+    return false;
+  }
+  segment_number = std::strtoull(name.c_str() + prefix_size, nullptr, 10);
+  return true;
+}
+} // namespace
+
+Journal::Journal(std::string directory, std::size_t segment_size,
+                 std::chrono::milliseconds commit_interval,
+                 std::size_t records_per_commit)
+    : directory_(std::move(directory)), segment_size_{segment_size},
+      commit_interval_{commit_interval},
+      records_per_commit_{std::max<std::size_t>(records_per_commit, 1)},
+      number_of_recovered_records_{0}, recovered_checkpoint_{0},
+      next_segment_number_{1}, write_segment_{nullptr}, first_sequence_{1}, next_sequence_{1},
+      records_since_commit_request_{0},
+      completed_(std::make_unique<std::atomic<std::uint8_t>[]>(
+          kMaximumNumberOfPendingRecords)),
+      low_water_mark_{0}, checkpoint_file_descriptor_{-1},
+      checkpointed_sequence_{0}, has_recovered_records_{false},
+      is_commit_requested_{false}, stop_{false},
+      number_of_appended_records_{0}, number_of_commits_{0} {
+  for (std::size_t i = 0; i < kMaximumNumberOfPendingRecords; ++i) {
+    completed_[i].store(0, std::memory_order_relaxed);
+  }
+}
+
+Journal::~Journal() {
+  if (committer_thread_.joinable()) {
+    {
+      std::lock_guard<std::mutex> lock(committer_mutex_);
+      stop_ = true;
+    }
+    committer_condition_.notify_one();
+    committer_thread_.join();
+    Commit();
+  }
+  if (prepared_segment_) {
+    unlink(prepared_segment_->path.c_str());
+  }
+  if (checkpoint_file_descriptor_ != -1) {
+    close(checkpoint_file_descriptor_);
+  }
+}
+
+bool Journal::Open() {
+  if (!ReadCheckpoint()) {
+    return false;
+  }
+  DIR *directory = opendir(directory_.c_str());
+  if (directory == nullptr) {
+    last_error_ = "Failed to open the journal directory " + directory_ +
+                  ": " + std::strerror(errno);
+    return false;
+  }
+  std::vector<std::string> paths;
+  while (const dirent *entry = readdir(directory)) {
+    std::uint64_t segment_number = 0;
+    if (ParseSegmentName(entry->d_name, segment_number)) {
+      paths.push_back(directory_ + "/" + entry->d_name);
+      next_segment_number_ = std::max(next_segment_number_, segment_number + 1);
+    }
+  }
+  closedir(directory);
+
+  // The segments are replayed in the order of their first records.
+  std::vector<std::pair<std::uint64_t, std::string>> segments;
+  std::uint64_t last_sequence = recovered_checkpoint_;
+  for (std::string &path : paths) {
+    std::uint64_t segment_first_sequence = 0;
+    std::uint64_t segment_last_sequence = 0;
+    std::size_t number_of_records = 0;
+    if (!ReadSegment(path, recovered_checkpoint_, {}, segment_first_sequence,
+                     segment_last_sequence, number_of_records)) {
+      return false;
+    }
+    number_of_recovered_records_ += number_of_records;
+    last_sequence = std::max(last_sequence, segment_last_sequence);
+    segments.emplace_back(segment_first_sequence, std::move(path));
+  }
+  std::sort(segments.begin(), segments.end());
+  for (auto &[segment_first_sequence, path] : segments) {
+    recovered_segment_paths_.push_back(std::move(path));
+  }
+  has_recovered_records_ = number_of_recovered_records_ > 0;
+  checkpointed_sequence_ = recovered_checkpoint_;
+
+  // The records of this run follow the ones of the previous runs, which are
+  // all below the low-water mark until they are replayed.
+  first_sequence_ = last_sequence + 1;
+  next_sequence_ = first_sequence_;
+  low_water_mark_.store(last_sequence, std::memory_order_relaxed);
+  if (!StartSegment()) {
+    return false;
+  }
+  committer_thread_ = std::thread(&Journal::RunCommitter, this);
+  return true;
+}
+
+bool Journal::ReadCheckpoint() {
+  const std::string path = directory_ + "/" + kCheckpointFileName;
+  checkpoint_file_descriptor_ =
+      open(path.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0600);
+  if (checkpoint_file_descriptor_ < 0) {
+    last_error_ = "Failed to open " + path + ": " + std::strerror(errno);
+    return false;
+  }
+  // A missing or torn checkpoint recovers every record that is left.
+  std::uint64_t sequence = 0;
+  std::uint32_t checksum = 0;
+  char data[sizeof(sequence) + sizeof(checksum)];
+  if (pread(checkpoint_file_descriptor_, data, sizeof(data), 0) ==
+      static_cast<ssize_t>(sizeof(data))) {
+    std::memcpy(&sequence, data, sizeof(sequence));
+    std::memcpy(&checksum, data + sizeof(sequence), sizeof(checksum));
+    if (Crc32c(&sequence, sizeof(sequence)) == checksum) {
+      recovered_checkpoint_ = sequence;
+    }
+  }
+  return true;
+}
+
+bool Journal::WriteCheckpoint(std::uint64_t sequence) {
+  const std::uint32_t checksum = Crc32c(&sequence, sizeof(sequence));
+  char data[sizeof(sequence) + sizeof(checksum)];
+  std::memcpy(data, &sequence, sizeof(sequence));
+  std::memcpy(data + sizeof(sequence), &checksum, sizeof(checksum));
+  if (pwrite(checkpoint_file_descriptor_, data, sizeof(data), 0) !=
+          static_cast<ssize_t>(sizeof(data)) ||
+      fdatasync(checkpoint_file_descriptor_) != 0) {
+    ReportError(std::string("Failed to write the checkpoint: ") +
+                std::strerror(errno));
+    return false;
+  }
+  return true;
+}
+
+bool Journal::ReadSegment(
+    const std::string &path, std::uint64_t after_sequence,
+    const std::function<void(std::string_view)> &read_record,
+    std::uint64_t &first_sequence, std::uint64_t &last_sequence,
+    std::size_t &number_of_records) {
+  const int file_descriptor = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+  struct stat file_status;
+  if (file_descriptor < 0 || fstat(file_descriptor, &file_status) != 0) {
+    last_error_ = "Failed to open " + path + ": " + std::strerror(errno);
+    if (file_descriptor >= 0) {
+      close(file_descriptor);
+    }
+    return false;
+  }
+  std::string data(static_cast<std::size_t>(file_status.st_size), '\0');
+  std::size_t size = 0;
+  while (size < data.size()) {
+    const ssize_t bytes_read =
+        read(file_descriptor, data.data() + size, data.size() - size);
+    if (bytes_read < 0 && errno == EINTR) {
+      continue;
+    }
+    if (bytes_read <= 0) {
+      break;
+    }
+    size += static_cast<std::size_t>(bytes_read);
+  }
+  close(file_descriptor);
+
+  // The records end at the first one that was not written completely before
+  // the crash, or was not flushed, or was corrupted since.
+  std::size_t position = 0;
+  std::uint64_t previous_sequence = 0;
+  while (size - position >= sizeof(RecordHeader)) {
+    RecordHeader header;
+    std::memcpy(&header, data.data() + position, sizeof(header));
+    if (header.size < sizeof(RecordHeader) || header.size > size - position ||
+        header.sequence <= previous_sequence) {
+      break;
+    }
+    const std::string_view payload(data.data() + position + sizeof(header),
+                                   header.size - sizeof(header));
+    if (GetChecksum(header.size, header.sequence, {payload}) !=
+        header.checksum) {
+      break;
+    }
+    if (header.sequence > after_sequence) {
+      ++number_of_records;
+      if (read_record) {
+        read_record(payload);
+      }
+    }
+    if (first_sequence == 0) {
+      first_sequence = header.sequence;
+    }
+    last_sequence = header.sequence;
+    previous_sequence = header.sequence;
+    position += header.size;
+  }
+  return true;
+}
+
+bool Journal::ReplayRecoveredRecords(
+    const std::function<void(std::string_view)> &replay_record) {
+  // Without recovered records, the committer deletes the old segments.
+  if (number_of_recovered_records_ == 0) {
+    return true;
+  }
+  for (const std::string &path : recovered_segment_paths_) {
+    std::uint64_t first_sequence = 0;
+    std::uint64_t last_sequence = 0;
+    std::size_t number_of_records = 0;
+    if (!ReadSegment(path, recovered_checkpoint_, replay_record,
+                     first_sequence, last_sequence, number_of_records)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+void Journal::DiscardRecoveredRecords() {
+  {
+    std::lock_guard<std::mutex> commit_lock(commit_mutex_);
+    has_recovered_records_ = false;
+    number_of_recovered_records_ = 0;
+  }
+  Commit();
+}
+
+std::uint64_t Journal::Append(std::initializer_list<std::string_view> parts) {
+  std::size_t size = sizeof(RecordHeader);
+  for (std::string_view part : parts) {
+    size += part.size();
+  }
+  if (write_segment_ == nullptr || size > segment_size_) {
+    last_error_ = "The record does not fit into a journal segment!";
+    return 0;
+  }
+  const std::uint64_t sequence = next_sequence_;
+  if (sequence - low_water_mark_.load(std::memory_order_acquire) >
+      kMaximumNumberOfPendingRecords) {
+    // The completion flag of the sequence number is still in use.
+    RequestCommit();
+    Backoff backoff;
+    while (sequence - low_water_mark_.load(std::memory_order_acquire) >
+           kMaximumNumberOfPendingRecords) {
+      backoff.Pause();
+    }
+  }
+  std::size_t write_position =
+      write_segment_->write_position.load(std::memory_order_relaxed);
+  if (write_position + size > segment_size_) {
+    if (!StartSegment()) {
+      return 0;
+    }
+    write_position = 0;
+  }
+
+  // The payload is checksummed while it is copied, so it is read only once.
+  RecordHeader header{static_cast<std::uint32_t>(size), 0, sequence};
+  header.checksum = Crc32c(&header.size, sizeof(header.size));
+  header.checksum =
+      Crc32c(&header.sequence, sizeof(header.sequence), header.checksum);
+  char *data = write_segment_->file.GetData() + write_position;
+  char *payload = data + sizeof(header);
+  for (std::string_view part : parts) {
+    header.checksum =
+        Crc32cCopy(payload, part.data(), part.size(), header.checksum);
+    payload += part.size();
+  }
+  std::memcpy(data, &header, sizeof(header));
+  // Publishes the record to the committer.
+  write_segment_->last_sequence.store(sequence, std::memory_order_relaxed);
+  write_segment_->write_position.store(write_position + size,
+                                       std::memory_order_release);
+  ++next_sequence_;
+  number_of_appended_records_.store(
+      number_of_appended_records_.load(std::memory_order_relaxed) + 1,
+      std::memory_order_relaxed);
+  if (++records_since_commit_request_ == records_per_commit_) {
+    records_since_commit_request_ = 0;
+    RequestCommit();
+  }
+  return sequence;
+}
+
+std::unique_ptr<Journal::Segment> Journal::CreateSegment(std::string &error) {
+  auto segment = std::make_unique<Segment>();
+  {
+    std::lock_guard<std::mutex> lock(segments_mutex_);
+    segment->path = directory_ + "/" + GetSegmentName(next_segment_number_++);
+  }
+  if (!segment->file.Create(segment->path, segment_size_)) {
+    error = segment->file.GetLastError();
+    return nullptr;
+  }
+  return segment;
+}
+
+void Journal::PrepareSegment() {
+  {
+    std::lock_guard<std::mutex> lock(segments_mutex_);
+    if (prepared_segment_) {
+      return;
+    }
+  }
+  std::string error;
+  std::unique_ptr<Segment> segment = CreateSegment(error);
+  if (!segment) {
+    ReportError(error);
+    return;
+  }
+  PopulateSegment(*segment, 0);
+  std::lock_guard<std::mutex> lock(segments_mutex_);
+  prepared_segment_ = std::move(segment);
+}
+
+void Journal::PopulateSegment(Segment &segment, std::size_t write_position) {
+  const std::size_t populated_position =
+      std::min(write_position + kPopulatedSize, segment_size_);
+  if (populated_position > segment.populated_position) {
+    segment.file.Populate(segment.populated_position,
+                          populated_position - segment.populated_position);
+    segment.populated_position = populated_position;
+  }
+}
+
+void Journal::PrepareAppends() {
+  std::lock_guard<std::mutex> commit_lock(commit_mutex_);
+  Segment *write_segment = nullptr;
+  {
+    std::lock_guard<std::mutex> lock(segments_mutex_);
+    if (!segments_.empty()) {
+      write_segment = segments_.back().get();
+    }
+  }
+  // The pages are faulted in ahead of the producer, instead of by its first
+  // write to every page, once less than half of kPopulatedSize is left.
+  if (write_segment != nullptr) {
+    const std::size_t write_position =
+        write_segment->write_position.load(std::memory_order_relaxed);
+    if (write_position + kPopulatedSize / 2 >
+        write_segment->populated_position) {
+      PopulateSegment(*write_segment, write_position);
+    }
+  }
+  PrepareSegment();
+}
+
+bool Journal::StartSegment() {
+  std::unique_ptr<Segment> segment;
+  {
+    std::lock_guard<std::mutex> lock(segments_mutex_);
+    segment = std::move(prepared_segment_);
+  }
+  if (!segment) {
+    segment = CreateSegment(last_error_);
+    if (!segment) {
+      return false;
+    }
+  }
+  Segment *previous_segment = write_segment_;
+  write_segment_ = segment.get();
+  {
+    std::lock_guard<std::mutex> lock(segments_mutex_);
+    segments_.push_back(std::move(segment));
+  }
+  // The committer deletes a sealed segment once its records are complete.
+  if (previous_segment != nullptr) {
+    previous_segment->is_sealed.store(true, std::memory_order_release);
+  }
+  return true;
+}
+
+void Journal::SyncDirectory() const {
+  const int file_descriptor =
+      open(directory_.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+  if (file_descriptor < 0 || fsync(file_descriptor) != 0) {
+    ReportError("Failed to sync the journal directory " + directory_ + ": " +
+                std::strerror(errno));
+  }
+  if (file_descriptor >= 0) {
+    close(file_descriptor);
+  }
+}
+
+void Journal::Commit() {
+  std::lock_guard<std::mutex> commit_lock(commit_mutex_);
+  segments_to_sync_.clear();
+  {
+    std::lock_guard<std::mutex> lock(segments_mutex_);
+    for (const auto &segment : segments_) {
+      segments_to_sync_.push_back(segment.get());
+    }
+  }
+  bool has_new_segments = false;
+  bool has_synced_records = false;
+  for (Segment *segment : segments_to_sync_) {
+    const std::size_t write_position =
+        segment->write_position.load(std::memory_order_acquire);
+    if (write_position == segment->synced_position) {
+      continue;
+    }
+    has_new_segments = has_new_segments || segment->synced_position == 0;
+    if (fdatasync(segment->file.GetFileDescriptor()) != 0) {
+      ReportError("Failed to sync " + segment->path + ": " +
+                  std::strerror(errno));
+      return;
+    }
+    segment->synced_position = write_position;
+    has_synced_records = true;
+  }
+  if (has_new_segments) {
+    SyncDirectory();
+  }
+  if (has_synced_records) {
+    number_of_commits_.fetch_add(1, std::memory_order_relaxed);
+  }
+  // The completion flags are cleared for the sequence numbers that come
+  // around the ring next.
+  std::uint64_t low_water_mark = low_water_mark_.load(std::memory_order_relaxed);
+  while (completed_[(low_water_mark + 1) & kCompletionMask].load(
+      std::memory_order_acquire)) {
+    completed_[(low_water_mark + 1) & kCompletionMask].store(
+        0, std::memory_order_relaxed);
+    ++low_water_mark;
+  }
+  low_water_mark_.store(low_water_mark, std::memory_order_release);
+
+  if (has_recovered_records_) {
+    return;
+  }
+  if (low_water_mark > checkpointed_sequence_) {
+    if (!WriteCheckpoint(low_water_mark)) {
+      return;
+    }
+    checkpointed_sequence_ = low_water_mark;
+  }
+  // Only the segments below the checkpoint can be deleted, as the next run
+  // would recover their records otherwise.
+  for (const std::string &path : recovered_segment_paths_) {
+    unlink(path.c_str());
+  }
+  recovered_segment_paths_.clear();
+  while (true) {
+    std::unique_ptr<Segment> segment;
+    {
+      std::lock_guard<std::mutex> lock(segments_mutex_);
+      if (segments_.empty()) {
+        break;
+      }
+      // The last sequence number of a sealed segment is final.
+      const Segment &oldest_segment = *segments_.front();
+      if (!oldest_segment.is_sealed.load(std::memory_order_acquire) ||
+          oldest_segment.last_sequence.load(std::memory_order_relaxed) >
+              checkpointed_sequence_) {
+        break;
+      }
+      segment = std::move(segments_.front());
+      segments_.pop_front();
+    }
+    unlink(segment->path.c_str());
+  }
+}
+
+long long Journal::GetNumberOfPendingRecords() const {
+  const long long number_of_complete_records = static_cast<long long>(
+      low_water_mark_.load(std::memory_order_relaxed) - (first_sequence_ - 1));
+  return GetNumberOfAppendedRecords() - number_of_complete_records;
+}
+
+void Journal::RequestCommit() {
+  {
+    std::lock_guard<std::mutex> lock(committer_mutex_);
+    is_commit_requested_ = true;
+  }
+  committer_condition_.notify_one();
+}
+
+void Journal::RunCommitter() {
+  std::unique_lock<std::mutex> lock(committer_mutex_);
+  while (!stop_) {
+    committer_condition_.wait_for(lock, commit_interval_, [this] {
+      return is_commit_requested_ || stop_;
+    });
+    is_commit_requested_ = false;
+    lock.unlock();
+    Commit();
+    PrepareAppends();
+    lock.lock();
+  }
+}
@@ -0,0 +1,84 @@
+#include "../../include/Storage/MappedFile.hpp"
+#include <algorithm>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#include <vector>
+
+#ifndef MADV_POPULATE_WRITE
+#define MADV_POPULATE_WRITE 23
+#endif
+
+MappedFile::~MappedFile() { Close(); }
+
+bool MappedFile::CreateTemporary(const std::string &directory,
+                                 std::size_t size) {
+  Close();
+  std::string path_template = directory + "/redis_client.XXXXXX";
+  std::vector<char> path(path_template.begin(), path_template.end());
+  path.push_back('\0');
+  file_descriptor_ = mkostemp(path.data(), O_CLOEXEC);
+  if (file_descriptor_ < 0) {
+    last_error_ = "Failed to create a file in " + directory + ": " +
+                  std::strerror(errno);
+    return false;
+  }
+  unlink(path.data());
+  return Map(size);
+}
+
+bool MappedFile::Create(const std::string &path, std::size_t size) {
+  Close();
+  file_descriptor_ =
+      open(path.c_str(), O_RDWR | O_CREAT | O_EXCL | O_CLOEXEC, 0600);
+  if (file_descriptor_ < 0) {
+    last_error_ = "Failed to create " + path + ": " + std::strerror(errno);
+    return false;
+  }
+  return Map(size);
+}
+
+bool MappedFile::Map(std::size_t size) {
+  if (ftruncate(file_descriptor_, static_cast<off_t>(size)) != 0) {
+    last_error_ = std::string("Failed to resize a file: ") +
+                  std::strerror(errno);
+    Close();
+    return false;
+  }
+  void *data = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED,
+                    file_descriptor_, 0);
+  if (data == MAP_FAILED) {
+    last_error_ = std::string("Failed to map a file: ") + std::strerror(errno);
+    Close();
+    return false;
+  }
+  // The files are written and read front to back.
+  madvise(data, size, MADV_SEQUENTIAL);
+  data_ = static_cast<char *>(data);
+  size_ = size;
+  return true;
+}
+
+void MappedFile::Populate(std::size_t offset, std::size_t size) const {
+  const std::size_t page_size = static_cast<std::size_t>(sysconf(_SC_PAGESIZE));
+  const std::size_t begin = offset / page_size * page_size;
+  const std::size_t end = std::min(offset + size, size_);
+  if (data_ != nullptr && begin < end) {
+    madvise(data_ + begin, end - begin, MADV_POPULATE_WRITE);
+  }
+}
+
+void MappedFile::Close() {
+  if (data_ != nullptr) {
+    munmap(data_, size_);
+    data_ = nullptr;
+    size_ = 0;
+  }
+  if (file_descriptor_ != -1) {
+    close(file_descriptor_);
+    file_descriptor_ = -1;
+  }
+}
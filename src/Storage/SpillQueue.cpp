@@ -0,0 +1,116 @@
+#include "../../include/Storage/SpillQueue.hpp"
+#include <algorithm>
+
+SpillQueue::SpillQueue(std::string directory, std::size_t segment_size,
+                       std::size_t maximum_number_of_segments)
+    : directory_(std::move(directory)), segment_size_{segment_size},
+      maximum_number_of_segments_{
+          std::max<std::size_t>(maximum_number_of_segments, 1)},
+      write_segment_{nullptr}, number_of_appended_records_{0},
+      number_of_popped_records_{0}, number_of_created_segments_{0} {}
+
+bool SpillQueue::Open() { return StartSegment(); }
+
+bool SpillQueue::TryAppend(std::initializer_list<std::string_view> parts) {
+  std::size_t record_size = 0;
+  for (std::string_view part : parts) {
+    record_size += part.size();
+  }
+  const std::size_t size = sizeof(RecordSize) + record_size;
+  if (write_segment_ == nullptr || size > segment_size_) {
+    return false;
+  }
+  std::size_t write_position =
+      write_segment_->write_position.load(std::memory_order_relaxed);
+  if (write_position + size > segment_size_) {
+    if (!StartSegment()) {
+      return false;
+    }
+    write_position = 0;
+  }
+  char *data = write_segment_->file.GetData() + write_position;
+  const RecordSize stored_record_size = static_cast<RecordSize>(record_size);
+  std::memcpy(data, &stored_record_size, sizeof(stored_record_size));
+  data += sizeof(RecordSize);
+  for (std::string_view part : parts) {
+    std::memcpy(data, part.data(), part.size());
+    data += part.size();
+  }
+  // Publishes the record to the consumers.
+  write_segment_->write_position.store(write_position + size,
+                                       std::memory_order_release);
+  number_of_appended_records_.store(
+      number_of_appended_records_.load(std::memory_order_relaxed) + 1,
+      std::memory_order_release);
+  return true;
+}
+
+bool SpillQueue::StartSegment() {
+  std::unique_ptr<Segment> segment;
+  {
+    std::lock_guard<std::mutex> lock(segments_mutex_);
+    if (segments_.size() == maximum_number_of_segments_) {
+      return false;
+    }
+    segment = std::move(spare_segment_);
+  }
+  if (!segment) {
+    segment = std::make_unique<Segment>();
+    if (!segment->file.CreateTemporary(directory_, segment_size_)) {
+      last_error_ = segment->file.GetLastError();
+      return false;
+    }
+    number_of_created_segments_.fetch_add(1, std::memory_order_relaxed);
+  }
+  Segment *previous_segment = write_segment_;
+  write_segment_ = segment.get();
+  {
+    std::lock_guard<std::mutex> lock(segments_mutex_);
+    segments_.push_back(std::move(segment));
+  }
+  // The consumers move on to the next segment once they have read every
+  // record of a sealed one.
+  if (previous_segment != nullptr) {
+    previous_segment->is_sealed.store(true, std::memory_order_release);
+  }
+  return true;
+}
+
+bool SpillQueue::TryReadRecord(std::string_view &record) {
+  while (true) {
+    Segment *segment;
+    {
+      std::lock_guard<std::mutex> lock(segments_mutex_);
+      if (segments_.empty()) {
+        return false;
+      }
+      segment = segments_.front().get();
+    }
+    // The write position is read after the seal, so it is final when the
+    // segment is sealed.
+    const bool is_sealed = segment->is_sealed.load(std::memory_order_acquire);
+    const std::size_t write_position =
+        segment->write_position.load(std::memory_order_acquire);
+    if (segment->read_position < write_position) {
+      const char *data = segment->file.GetData() + segment->read_position;
+      RecordSize record_size;
+      std::memcpy(&record_size, data, sizeof(record_size));
+      record = std::string_view(data + sizeof(RecordSize), record_size);
+      segment->read_position += sizeof(RecordSize) + record_size;
+      return true;
+    }
+    if (!is_sealed) {
+      return false;
+    }
+    // The segment is drained, and kept as the spare when there is none.
+    std::lock_guard<std::mutex> lock(segments_mutex_);
+    std::unique_ptr<Segment> drained_segment = std::move(segments_.front());
+    segments_.pop_front();
+    if (!spare_segment_) {
+      drained_segment->write_position.store(0, std::memory_order_relaxed);
+      drained_segment->is_sealed.store(false, std::memory_order_relaxed);
+      drained_segment->read_position = 0;
+      spare_segment_ = std::move(drained_segment);
+    }
+  }
+}
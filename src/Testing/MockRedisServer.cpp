@@ -0,0 +1,971 @@
+#include "../../include/Testing/MockRedisServer.hpp"
+
+#include <algorithm>
+#include <arpa/inet.h>
+#include <cctype>
+#include <cerrno>
+#include <charconv>
+#include <cstring>
+#include <fnmatch.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "../../include/Parsing/RespParser.hpp"
+#include "../../include/Parsing/RespWriter.hpp"
+
+namespace {
+// How much a connection reads at once without slow reads.
+constexpr std::size_t kReadSize = 64 * 1024;
+// StreamFrames() repeats the frames in a buffer of about this size, to send
+// them with few system calls.
+constexpr std::size_t kStreamingBufferSize = 256 * 1024;
+
+constexpr std::string_view kOk = "+OK\r\n";
+constexpr std::string_view kNullArray = "*-1\r\n";
+
+bool EqualsIgnoringCase(std::string_view text, std::string_view upper_case) {
+  return text.size() == upper_case.size() &&
+         std::equal(text.begin(), text.end(), upper_case.begin(),
+                    [](char character, char upper_case_character) {
+                      return std::toupper(static_cast<unsigned char>(
+                                 character)) == upper_case_character;
+                    });
+}
+
+void AppendError(std::string &output, std::string_view error) {
+  output += '-';
+  output += error;
+  output += "\r\n";
+}
+
+void AppendInteger(std::string &output, long long value) {
+  char digits[24];
+  const auto result = std::to_chars(digits, digits + sizeof(digits), value);
+  output += ':';
+  output.append(digits, result.ptr - digits);
+  output += "\r\n";
+}
+
+void AppendWrongNumberOfArguments(std::string &output,
+                                  std::string_view command) {
+  AppendError(output, "ERR wrong number of arguments for '" +
+                          std::string(command) + "' command");
+}
+
+template <typename Integer>
+bool ParseInteger(std::string_view text, Integer &value) {
+  const auto result =
+      std::from_chars(text.data(), text.data() + text.size(), value);
+  return result.ec == std::errc() && result.ptr == text.data() + text.size();
+}
+
+std::int64_t GetTimeInMilliseconds() {
+  return std::chrono::duration_cast<std::chrono::milliseconds>(
+             std::chrono::system_clock::now().time_since_epoch())
+      .count();
+}
+} // namespace
+
+MockRedisServer::MockRedisServer()
+    : listening_socket_file_descriptor_{-1}, port_{0}, is_stopping_{false},
+      stores_stream_entries_{true}, reply_delay_in_microseconds_{0},
+      maximum_write_size_{0}, write_pause_in_microseconds_{0},
+      maximum_read_size_{0}, read_pause_in_microseconds_{0},
+      commands_until_disconnect_{0}, number_of_commands_{0} {}
+
+MockRedisServer::~MockRedisServer() { Stop(); }
+
+bool MockRedisServer::Start(unsigned short port) {
+  listening_socket_file_descriptor_ = socket(AF_INET, SOCK_STREAM, 0);
+  if (listening_socket_file_descriptor_ < 0) {
+    last_error_ = std::string("Failed to create a socket! ") + strerror(errno);
+    return false;
+  }
+  const int enabled = 1;
+  setsockopt(listening_socket_file_descriptor_, SOL_SOCKET, SO_REUSEADDR,
+             &enabled, sizeof(enabled));
+  sockaddr_in address{};
+  address.sin_family = AF_INET;
+  address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  address.sin_port = htons(port);
+  socklen_t address_length = sizeof(address);
+  if (bind(listening_socket_file_descriptor_,
+           reinterpret_cast<sockaddr *>(&address), sizeof(address)) < 0 ||
+      listen(listening_socket_file_descriptor_, 64) < 0 ||
+      getsockname(listening_socket_file_descriptor_,
+                  reinterpret_cast<sockaddr *>(&address),
+                  &address_length) < 0) {
+    last_error_ = "Failed to listen on port " + std::to_string(port) + "! " +
+                  strerror(errno);
+    close(listening_socket_file_descriptor_);
+    listening_socket_file_descriptor_ = -1;
+    return false;
+  }
+  port_ = ntohs(address.sin_port);
+  is_stopping_.store(false, std::memory_order_relaxed);
+  accepting_thread_ = std::thread(&MockRedisServer::AcceptConnections, this);
+  return true;
+}
+
+void MockRedisServer::Stop() {
+  if (listening_socket_file_descriptor_ < 0) {
+    return;
+  }
+  is_stopping_.store(true, std::memory_order_relaxed);
+  shutdown(listening_socket_file_descriptor_, SHUT_RDWR);
+  close(listening_socket_file_descriptor_);
+  listening_socket_file_descriptor_ = -1;
+  accepting_thread_.join();
+
+  // No connection is added anymore, so they can be joined without the lock,
+  // which their threads take on their way out.
+  DisconnectAll();
+  for (auto &connection : connections_) {
+    connection->thread.join();
+    close(connection->file_descriptor);
+  }
+  std::lock_guard<std::mutex> lock(mutex_);
+  channels_.clear();
+  patterns_.clear();
+  connections_.clear();
+}
+
+void MockRedisServer::SetReplyDelay(std::chrono::microseconds delay) {
+  reply_delay_in_microseconds_.store(delay.count(), std::memory_order_relaxed);
+}
+
+void MockRedisServer::SetPartialWrites(std::size_t maximum_write_size,
+                                       std::chrono::microseconds pause) {
+  maximum_write_size_.store(maximum_write_size, std::memory_order_relaxed);
+  write_pause_in_microseconds_.store(pause.count(), std::memory_order_relaxed);
+}
+
+void MockRedisServer::SetSlowReads(std::size_t maximum_read_size,
+                                   std::chrono::microseconds pause) {
+  maximum_read_size_.store(maximum_read_size, std::memory_order_relaxed);
+  read_pause_in_microseconds_.store(pause.count(), std::memory_order_relaxed);
+}
+
+void MockRedisServer::DisconnectAfterCommands(long long number_of_commands) {
+  commands_until_disconnect_.store(number_of_commands,
+                                   std::memory_order_relaxed);
+}
+
+void MockRedisServer::DisconnectAll() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  for (auto &connection : connections_) {
+    CloseConnection(*connection);
+  }
+  condition_.notify_all();
+}
+
+void MockRedisServer::CloseConnection(Connection &connection) {
+  // The descriptor is only closed by Stop(), so it is not reused while
+  // other threads may still send to it.
+  connection.is_closed.store(true, std::memory_order_relaxed);
+  shutdown(connection.file_descriptor, SHUT_RDWR);
+}
+
+void MockRedisServer::AcceptConnections() {
+  while (true) {
+    const int file_descriptor =
+        accept(listening_socket_file_descriptor_, nullptr, nullptr);
+    if (file_descriptor < 0) {
+      if (errno == EINTR || errno == ECONNABORTED) {
+        continue;
+      }
+      return;
+    }
+    const int enabled = 1;
+    setsockopt(file_descriptor, IPPROTO_TCP, TCP_NODELAY, &enabled,
+               sizeof(enabled));
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto connection = std::make_unique<Connection>();
+    connection->file_descriptor = file_descriptor;
+    connection->thread =
+        std::thread(&MockRedisServer::ServeConnection, this,
+                    std::ref(*connection));
+    connections_.push_back(std::move(connection));
+  }
+}
+
+void MockRedisServer::ServeConnection(Connection &connection) {
+  RespParser parser;
+  std::string input;
+  std::string output;
+  std::vector<std::string_view> arguments;
+  bool is_connected = true;
+  while (is_connected) {
+    const long long read_pause =
+        read_pause_in_microseconds_.load(std::memory_order_relaxed);
+    if (read_pause > 0) {
+      std::this_thread::sleep_for(std::chrono::microseconds(read_pause));
+    }
+    const std::size_t maximum_read_size =
+        maximum_read_size_.load(std::memory_order_relaxed);
+    const std::size_t read_size =
+        maximum_read_size > 0 ? maximum_read_size : kReadSize;
+    const std::size_t input_size = input.size();
+    input.resize(input_size + read_size);
+    const ssize_t bytes_read =
+        recv(connection.file_descriptor, &input[input_size], read_size, 0);
+    if (bytes_read <= 0) {
+      if (bytes_read < 0 && errno == EINTR) {
+        input.resize(input_size);
+        continue;
+      }
+      break;
+    }
+    input.resize(input_size + bytes_read);
+
+    // The commands of a read are answered with a single write.
+    std::size_t position = 0;
+    while (position < input.size()) {
+      std::size_t bytes_consumed = 0;
+      const RespParseStatus status = parser.Parse(
+          input.data() + position, input.size() - position, bytes_consumed);
+      if (status == RespParseStatus::Incomplete) {
+        break;
+      }
+      const RespValue &command = parser.Root();
+      if (status == RespParseStatus::Error || command.type != RespType::Array ||
+          command.number_of_elements == 0 ||
+          command.subtree_size != command.number_of_elements + 1) {
+        AppendError(output, "ERR Protocol error");
+        is_connected = false;
+        break;
+      }
+      arguments.clear();
+      for (std::size_t i = 1; i <= command.number_of_elements; ++i) {
+        arguments.push_back((&command)[i].string);
+      }
+      position += bytes_consumed;
+      number_of_commands_.fetch_add(1, std::memory_order_relaxed);
+
+      long long commands_until_disconnect =
+          commands_until_disconnect_.load(std::memory_order_relaxed);
+      while (commands_until_disconnect > 0 &&
+             !commands_until_disconnect_.compare_exchange_weak(
+                 commands_until_disconnect, commands_until_disconnect - 1,
+                 std::memory_order_relaxed)) {
+      }
+      if (commands_until_disconnect == 1) {
+        is_connected = false;
+        break;
+      }
+      ExecuteCommand(connection, arguments, output);
+    }
+    input.erase(0, position);
+    if (!output.empty()) {
+      if (!Send(connection, output)) {
+        is_connected = false;
+      }
+      output.clear();
+    }
+  }
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  CloseConnection(connection);
+  for (auto *subscriptions : {&channels_, &patterns_}) {
+    for (auto it = subscriptions->begin(); it != subscriptions->end();) {
+      auto &subscribers = it->second;
+      subscribers.erase(
+          std::remove(subscribers.begin(), subscribers.end(), &connection),
+          subscribers.end());
+      it = subscribers.empty() ? subscriptions->erase(it) : std::next(it);
+    }
+  }
+  condition_.notify_all();
+}
+
+void MockRedisServer::ExecuteCommand(
+    Connection &connection, const std::vector<std::string_view> &arguments,
+    std::string &output) {
+  const std::string_view name = arguments[0];
+  if (EqualsIgnoringCase(name, "PING")) {
+    if (arguments.size() > 1) {
+      RespWriter(output).AppendBulkString(arguments[1]);
+    } else {
+      output += "+PONG\r\n";
+    }
+  } else if (EqualsIgnoringCase(name, "SUBSCRIBE")) {
+    Subscribe(connection, arguments, false, output);
+  } else if (EqualsIgnoringCase(name, "PSUBSCRIBE")) {
+    Subscribe(connection, arguments, true, output);
+  } else if (EqualsIgnoringCase(name, "PUBLISH")) {
+    if (arguments.size() != 3) {
+      AppendWrongNumberOfArguments(output, "publish");
+      return;
+    }
+    AppendInteger(output, Publish(arguments[1], arguments[2]));
+  } else if (EqualsIgnoringCase(name, "PUBSUB")) {
+    if (arguments.size() < 2 || !EqualsIgnoringCase(arguments[1], "NUMSUB")) {
+      AppendError(output, "ERR Only PUBSUB NUMSUB is supported");
+      return;
+    }
+    RespWriter writer(output);
+    writer.AppendArrayHeader(2 * (arguments.size() - 2));
+    for (std::size_t i = 2; i < arguments.size(); ++i) {
+      writer.AppendBulkString(arguments[i]);
+      std::lock_guard<std::mutex> lock(mutex_);
+      auto it = channels_.find(std::string(arguments[i]));
+      AppendInteger(output, it != channels_.end() ? it->second.size() : 0);
+    }
+  } else if (EqualsIgnoringCase(name, "XADD")) {
+    AddStreamEntry(arguments, output);
+  } else if (EqualsIgnoringCase(name, "XLEN")) {
+    if (arguments.size() != 2) {
+      AppendWrongNumberOfArguments(output, "xlen");
+      return;
+    }
+    AppendInteger(output, GetStreamLength(std::string(arguments[1])));
+  } else if (EqualsIgnoringCase(name, "XGROUP")) {
+    CreateConsumerGroup(arguments, output);
+  } else if (EqualsIgnoringCase(name, "XREAD")) {
+    ReadStreams(connection, arguments, false, output);
+  } else if (EqualsIgnoringCase(name, "XREADGROUP")) {
+    ReadStreams(connection, arguments, true, output);
+  } else if (EqualsIgnoringCase(name, "XACK")) {
+    AcknowledgeStreamEntries(arguments, output);
+  } else {
+    AppendError(output, "ERR unknown command '" + std::string(name) + "'");
+  }
+}
+
+void MockRedisServer::Subscribe(Connection &connection,
+                                const std::vector<std::string_view> &arguments,
+                                bool is_pattern, std::string &output) {
+  if (arguments.size() < 2) {
+    AppendWrongNumberOfArguments(output,
+                                 is_pattern ? "psubscribe" : "subscribe");
+    return;
+  }
+  RespWriter writer(output);
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto &subscriptions = is_pattern ? patterns_ : channels_;
+  for (std::size_t i = 1; i < arguments.size(); ++i) {
+    auto &subscribers = subscriptions[std::string(arguments[i])];
+    if (std::find(subscribers.begin(), subscribers.end(), &connection) ==
+        subscribers.end()) {
+      subscribers.push_back(&connection);
+      ++connection.number_of_subscriptions;
+    }
+    writer.AppendArrayHeader(3);
+    writer.AppendBulkString(is_pattern ? "psubscribe" : "subscribe");
+    writer.AppendBulkString(arguments[i]);
+    AppendInteger(output, connection.number_of_subscriptions);
+  }
+  condition_.notify_all();
+}
+
+long long MockRedisServer::Publish(std::string_view channel,
+                                   std::string_view message) {
+  // The frames are built under the lock and sent without it, so a slow
+  // subscriber does not hold up the other connections.
+  std::vector<std::pair<Connection *, std::string>> deliveries;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (auto it = channels_.find(std::string(channel)); it != channels_.end()) {
+      std::string frame;
+      AppendMessageFrame(frame, channel, message);
+      for (Connection *subscriber : it->second) {
+        deliveries.emplace_back(subscriber, frame);
+      }
+    }
+    const std::string channel_name(channel);
+    for (const auto &[pattern, subscribers] : patterns_) {
+      if (fnmatch(pattern.c_str(), channel_name.c_str(), 0) != 0) {
+        continue;
+      }
+      std::string frame;
+      AppendPatternMessageFrame(frame, pattern, channel, message);
+      for (Connection *subscriber : subscribers) {
+        deliveries.emplace_back(subscriber, frame);
+      }
+    }
+  }
+  for (auto &[subscriber, frame] : deliveries) {
+    Send(*subscriber, frame);
+  }
+  return static_cast<long long>(deliveries.size());
+}
+
+std::size_t
+MockRedisServer::GetNumberOfSubscribers(const std::string &subscription) const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  std::size_t number_of_subscribers = 0;
+  for (const auto *subscriptions : {&channels_, &patterns_}) {
+    if (auto it = subscriptions->find(subscription);
+        it != subscriptions->end()) {
+      number_of_subscribers += it->second.size();
+    }
+  }
+  return number_of_subscribers;
+}
+
+bool MockRedisServer::WaitForSubscribers(const std::string &subscription,
+                                         std::size_t number_of_subscribers,
+                                         std::chrono::milliseconds timeout) {
+  std::unique_lock<std::mutex> lock(mutex_);
+  return condition_.wait_for(lock, timeout, [&] {
+    std::size_t number_of_current_subscribers = 0;
+    for (const auto *subscriptions : {&channels_, &patterns_}) {
+      if (auto it = subscriptions->find(subscription);
+          it != subscriptions->end()) {
+        number_of_current_subscribers += it->second.size();
+      }
+    }
+    return number_of_current_subscribers >= number_of_subscribers;
+  });
+}
+
+void MockRedisServer::AppendMessageFrame(std::string &frames,
+                                         std::string_view channel,
+                                         std::string_view message) {
+  RespWriter writer(frames);
+  writer.AppendArrayHeader(3);
+  writer.AppendBulkString("message");
+  writer.AppendBulkString(channel);
+  writer.AppendBulkString(message);
+}
+
+void MockRedisServer::AppendPatternMessageFrame(std::string &frames,
+                                                std::string_view pattern,
+                                                std::string_view channel,
+                                                std::string_view message) {
+  RespWriter writer(frames);
+  writer.AppendArrayHeader(4);
+  writer.AppendBulkString("pmessage");
+  writer.AppendBulkString(pattern);
+  writer.AppendBulkString(channel);
+  writer.AppendBulkString(message);
+}
+
+bool MockRedisServer::StreamFrames(const std::string &subscription,
+                                   std::string_view frames,
+                                   std::size_t repetitions) {
+  std::vector<Connection *> subscribers;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (const auto *subscriptions : {&channels_, &patterns_}) {
+      if (auto it = subscriptions->find(subscription);
+          it != subscriptions->end()) {
+        subscribers.insert(subscribers.end(), it->second.begin(),
+                           it->second.end());
+      }
+    }
+  }
+  if (subscribers.empty() || frames.empty()) {
+    return false;
+  }
+
+  // Small frames are repeated in a larger buffer, which is sent as a whole
+  // as often as it fits, and the rest of the repetitions after it.
+  const std::size_t repetitions_per_buffer = std::min(
+      std::max<std::size_t>(kStreamingBufferSize / frames.size(), 1),
+      std::max<std::size_t>(repetitions, 1));
+  std::string buffer;
+  buffer.reserve(repetitions_per_buffer * frames.size());
+  for (std::size_t i = 0; i < repetitions_per_buffer; ++i) {
+    buffer += frames;
+  }
+  for (Connection *subscriber : subscribers) {
+    for (std::size_t i = 0; i + repetitions_per_buffer <= repetitions;
+         i += repetitions_per_buffer) {
+      if (!SendAll(*subscriber, buffer, 0, std::chrono::microseconds(0))) {
+        return false;
+      }
+    }
+    for (std::size_t i = 0; i < repetitions % repetitions_per_buffer; ++i) {
+      if (!SendAll(*subscriber, frames, 0, std::chrono::microseconds(0))) {
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
+void MockRedisServer::SetStoresStreamEntries(bool stores_stream_entries) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  stores_stream_entries_ = stores_stream_entries;
+}
+
+void MockRedisServer::AddStreamEntry(
+    const std::vector<std::string_view> &arguments, std::string &output) {
+  // XADD key [NOMKSTREAM] [MAXLEN [=|~] threshold] <* | id> field value ...
+  std::size_t i = 2;
+  bool creates_stream = true;
+  std::size_t maximum_length = 0;
+  if (i < arguments.size() && EqualsIgnoringCase(arguments[i], "NOMKSTREAM")) {
+    creates_stream = false;
+    ++i;
+  }
+  if (i < arguments.size() && EqualsIgnoringCase(arguments[i], "MAXLEN")) {
+    ++i;
+    if (i < arguments.size() && (arguments[i] == "=" || arguments[i] == "~")) {
+      ++i;
+    }
+    if (i >= arguments.size() || !ParseInteger(arguments[i], maximum_length)) {
+      AppendError(output, "ERR value is not an integer or out of range");
+      return;
+    }
+    ++i;
+  }
+  if (i >= arguments.size() || (arguments.size() - i - 1) % 2 != 0 ||
+      arguments.size() - i - 1 == 0) {
+    AppendWrongNumberOfArguments(output, "xadd");
+    return;
+  }
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto it = streams_.find(std::string(arguments[1]));
+  if (it == streams_.end()) {
+    if (!creates_stream) {
+      output += "$-1\r\n";
+      return;
+    }
+    it = streams_.emplace(std::string(arguments[1]), Stream{}).first;
+  }
+  Stream &stream = it->second;
+
+  StreamId id{};
+  if (arguments[i] == "*") {
+    const std::uint64_t now = GetTimeInMilliseconds();
+    id = now > stream.last_id.milliseconds
+             ? StreamId{now, 0}
+             : StreamId{stream.last_id.milliseconds,
+                        stream.last_id.sequence + 1};
+  } else {
+    const std::string_view text = arguments[i];
+    const std::size_t separator = text.find('-');
+    if (!ParseInteger(text.substr(0, separator), id.milliseconds) ||
+        (separator != std::string_view::npos &&
+         !ParseInteger(text.substr(separator + 1), id.sequence))) {
+      AppendError(output, "ERR Invalid stream ID specified as stream command "
+                          "argument");
+      return;
+    }
+    if (!(stream.last_id < id)) {
+      AppendError(output, "ERR The ID specified in XADD is equal or smaller "
+                          "than the target stream top item");
+      return;
+    }
+  }
+  stream.last_id = id;
+  ++stream.length;
+  if (stores_stream_entries_) {
+    stream.entries.push_back(
+        {id, std::vector<std::string>(arguments.begin() + i + 1,
+                                      arguments.end())});
+  }
+  if (maximum_length > 0 && stream.length > maximum_length) {
+    const std::size_t number_of_trimmed = stream.length - maximum_length;
+    stream.entries.erase(
+        stream.entries.begin(),
+        stream.entries.begin() +
+            std::min(number_of_trimmed, stream.entries.size()));
+    stream.length = maximum_length;
+  }
+  RespWriter(output).AppendBulkString(std::to_string(id.milliseconds) + "-" +
+                                      std::to_string(id.sequence));
+  condition_.notify_all();
+}
+
+std::size_t MockRedisServer::GetStreamLength(const std::string &stream) const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto it = streams_.find(stream);
+  return it != streams_.end() ? it->second.length : 0;
+}
+
+bool MockRedisServer::WaitForStreamLength(const std::string &stream,
+                                          std::size_t length,
+                                          std::chrono::milliseconds timeout) {
+  std::unique_lock<std::mutex> lock(mutex_);
+  return condition_.wait_for(lock, timeout, [&] {
+    auto it = streams_.find(stream);
+    return it != streams_.end() && it->second.length >= length;
+  });
+}
+
+std::vector<std::vector<std::string>>
+MockRedisServer::GetStreamEntries(const std::string &stream) const {
+  std::vector<std::vector<std::string>> entries;
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (auto it = streams_.find(stream); it != streams_.end()) {
+    for (const StreamEntry &entry : it->second.entries) {
+      entries.push_back(entry.fields);
+    }
+  }
+  return entries;
+}
+
+std::size_t
+MockRedisServer::GetNumberOfPendingEntries(const std::string &stream,
+                                           const std::string &group) const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto it = streams_.find(stream);
+  if (it == streams_.end()) {
+    return 0;
+  }
+  auto group_it = it->second.groups.find(group);
+  return group_it != it->second.groups.end()
+             ? group_it->second.pending_entries.size()
+             : 0;
+}
+
+std::size_t MockRedisServer::GetNumberOfConnections() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return std::count_if(connections_.begin(), connections_.end(),
+                       [](const std::unique_ptr<Connection> &connection) {
+                         return !connection->is_closed.load(
+                             std::memory_order_relaxed);
+                       });
+}
+
+void MockRedisServer::CreateConsumerGroup(
+    const std::vector<std::string_view> &arguments, std::string &output) {
+  // XGROUP CREATE key group <id | $> [MKSTREAM]
+  if (arguments.size() < 2 || !EqualsIgnoringCase(arguments[1], "CREATE")) {
+    AppendError(output, "ERR Only XGROUP CREATE is supported");
+    return;
+  }
+  if (arguments.size() != 5 && arguments.size() != 6) {
+    AppendWrongNumberOfArguments(output, "xgroup|create");
+    return;
+  }
+  const bool creates_stream =
+      arguments.size() == 6 && EqualsIgnoringCase(arguments[5], "MKSTREAM");
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto it = streams_.find(std::string(arguments[2]));
+  if (it == streams_.end()) {
+    if (!creates_stream) {
+      AppendError(output, "ERR The XGROUP subcommand requires the key to "
+                          "exist. Note that for CREATE you may want to use "
+                          "the MKSTREAM option to create an empty stream "
+                          "automatically.");
+      return;
+    }
+    it = streams_.emplace(std::string(arguments[2]), Stream{}).first;
+  }
+  Stream &stream = it->second;
+  if (stream.groups.count(std::string(arguments[3])) != 0) {
+    AppendError(output, "BUSYGROUP Consumer Group name already exists");
+    return;
+  }
+  StreamId last_delivered_id{0, 0};
+  if (arguments[4] == "$") {
+    last_delivered_id = stream.last_id;
+  } else if (!ParseInteger(arguments[4].substr(0, arguments[4].find('-')),
+                           last_delivered_id.milliseconds)) {
+    AppendError(output, "ERR Invalid stream ID specified as stream command "
+                        "argument");
+    return;
+  }
+  stream.groups[std::string(arguments[3])].last_delivered_id =
+      last_delivered_id;
+  output += kOk;
+}
+
+void MockRedisServer::ReadStreams(
+    Connection &connection, const std::vector<std::string_view> &arguments,
+    bool is_group_read, std::string &output) {
+  // XREAD [COUNT count] [BLOCK milliseconds] STREAMS key ... id ...
+  // XREADGROUP GROUP group consumer [COUNT count] [BLOCK milliseconds]
+  //   [NOACK] STREAMS key ... id ...
+  std::string group_name;
+  std::string consumer_name;
+  std::size_t i = 1;
+  if (is_group_read) {
+    if (arguments.size() < 4 || !EqualsIgnoringCase(arguments[1], "GROUP")) {
+      AppendError(output, "ERR syntax error");
+      return;
+    }
+    group_name = arguments[2];
+    consumer_name = arguments[3];
+    i = 4;
+  }
+  std::size_t count = 0;
+  long long block_time_in_milliseconds = -1;
+  bool is_acknowledged = false;
+  for (; i < arguments.size(); ++i) {
+    if (EqualsIgnoringCase(arguments[i], "COUNT") && i + 1 < arguments.size()) {
+      if (!ParseInteger(arguments[++i], count)) {
+        AppendError(output, "ERR value is not an integer or out of range");
+        return;
+      }
+    } else if (EqualsIgnoringCase(arguments[i], "BLOCK") &&
+               i + 1 < arguments.size()) {
+      if (!ParseInteger(arguments[++i], block_time_in_milliseconds) ||
+          block_time_in_milliseconds < 0) {
+        AppendError(output, "ERR timeout is not an integer or out of range");
+        return;
+      }
+    } else if (is_group_read && EqualsIgnoringCase(arguments[i], "NOACK")) {
+      is_acknowledged = true;
+    } else if (EqualsIgnoringCase(arguments[i], "STREAMS")) {
+      ++i;
+      break;
+    } else {
+      AppendError(output, "ERR syntax error");
+      return;
+    }
+  }
+  const std::size_t number_of_keys = (arguments.size() - i) / 2;
+  if (number_of_keys == 0 || (arguments.size() - i) % 2 != 0) {
+    AppendError(output, "ERR Unbalanced 'xread' list of streams: for each "
+                        "stream key an ID or '$' must be specified.");
+    return;
+  }
+
+  struct StreamRead {
+    std::string key;
+    // Whether the group's new entries are read, with the ID '>'.
+    bool is_new_entries_read;
+    StreamId after_id;
+  };
+  std::vector<StreamRead> reads;
+  std::unique_lock<std::mutex> lock(mutex_);
+  for (std::size_t k = 0; k < number_of_keys; ++k) {
+    StreamRead read{std::string(arguments[i + k]), false, {0, 0}};
+    const std::string_view id = arguments[i + number_of_keys + k];
+    auto it = streams_.find(read.key);
+    if (is_group_read &&
+        (it == streams_.end() || it->second.groups.count(group_name) == 0)) {
+      AppendError(output, "NOGROUP No such key '" + read.key +
+                              "' or consumer group '" + group_name +
+                              "' in XREADGROUP with GROUP option");
+      return;
+    }
+    if (is_group_read && id == ">") {
+      read.is_new_entries_read = true;
+    } else if (!is_group_read && id == "$") {
+      read.after_id = it != streams_.end() ? it->second.last_id : StreamId{};
+    } else {
+      const std::size_t separator = id.find('-');
+      if (!ParseInteger(id.substr(0, separator), read.after_id.milliseconds) ||
+          (separator != std::string_view::npos &&
+           !ParseInteger(id.substr(separator + 1), read.after_id.sequence))) {
+        AppendError(output, "ERR Invalid stream ID specified as stream "
+                            "command argument");
+        return;
+      }
+    }
+    reads.push_back(std::move(read));
+  }
+
+  // The first stored entry after the ID, in a stream whose entries are
+  // ordered by their IDs.
+  auto find_entries_after = [](const Stream &stream, const StreamId &id) {
+    return std::upper_bound(stream.entries.begin(), stream.entries.end(), id,
+                            [](const StreamId &id, const StreamEntry &entry) {
+                              return id < entry.id;
+                            });
+  };
+  auto has_new_entries = [&] {
+    for (const StreamRead &read : reads) {
+      auto it = streams_.find(read.key);
+      if (it == streams_.end()) {
+        continue;
+      }
+      const StreamId after_id =
+          read.is_new_entries_read
+              ? it->second.groups[group_name].last_delivered_id
+              : read.after_id;
+      if (find_entries_after(it->second, after_id) !=
+          it->second.entries.end()) {
+        return true;
+      }
+    }
+    return false;
+  };
+
+  // A read of the group's pending entries never blocks.
+  const bool reads_new_entries =
+      !is_group_read || std::all_of(reads.begin(), reads.end(),
+                                    [](const StreamRead &read) {
+                                      return read.is_new_entries_read;
+                                    });
+  if (block_time_in_milliseconds >= 0 && reads_new_entries &&
+      !has_new_entries()) {
+    // The replies to the commands before this one are not held back.
+    lock.unlock();
+    if (!output.empty()) {
+      Send(connection, output);
+      output.clear();
+    }
+    lock.lock();
+    auto can_return = [&] {
+      return is_stopping_.load(std::memory_order_relaxed) ||
+             connection.is_closed.load(std::memory_order_relaxed) ||
+             has_new_entries();
+    };
+    if (block_time_in_milliseconds == 0) {
+      condition_.wait(lock, can_return);
+    } else {
+      condition_.wait_for(
+          lock, std::chrono::milliseconds(block_time_in_milliseconds),
+          can_return);
+    }
+    // Like Redis, a read that was cut short is never answered.
+    if (is_stopping_.load(std::memory_order_relaxed) ||
+        connection.is_closed.load(std::memory_order_relaxed)) {
+      return;
+    }
+  }
+
+  // [[key, [[id, [field, value, ...]], ...]], ...] for the streams with
+  // entries, or a null array without any.
+  std::string reply;
+  RespWriter writer(reply);
+  std::size_t number_of_streams_with_entries = 0;
+  for (const StreamRead &read : reads) {
+    auto it = streams_.find(read.key);
+    if (it == streams_.end()) {
+      continue;
+    }
+    Stream &stream = it->second;
+    std::vector<const StreamEntry *> entries;
+    if (!is_group_read || read.is_new_entries_read) {
+      ConsumerGroup *group =
+          is_group_read ? &stream.groups[group_name] : nullptr;
+      for (auto entry = find_entries_after(
+               stream, group ? group->last_delivered_id : read.after_id);
+           entry != stream.entries.end() &&
+           (count == 0 || entries.size() < count);
+           ++entry) {
+        entries.push_back(&*entry);
+        if (group != nullptr) {
+          group->last_delivered_id = entry->id;
+          if (!is_acknowledged) {
+            group->pending_entries[entry->id] = consumer_name;
+          }
+        }
+      }
+    } else {
+      // The history of the entries that were delivered to the consumer.
+      for (const auto &[id, consumer] :
+           stream.groups[group_name].pending_entries) {
+        if (consumer != consumer_name || !(read.after_id < id)) {
+          continue;
+        }
+        if (count != 0 && entries.size() >= count) {
+          break;
+        }
+        auto entry = std::lower_bound(
+            stream.entries.begin(), stream.entries.end(), id,
+            [](const StreamEntry &entry, const StreamId &id) {
+              return entry.id < id;
+            });
+        if (entry != stream.entries.end() && !(id < entry->id)) {
+          entries.push_back(&*entry);
+        }
+      }
+      // Redis answers a history read with every stream, even without
+      // entries.
+      if (entries.empty()) {
+        writer.AppendArrayHeader(2);
+        writer.AppendBulkString(read.key);
+        writer.AppendArrayHeader(0);
+        ++number_of_streams_with_entries;
+        continue;
+      }
+    }
+    if (entries.empty()) {
+      continue;
+    }
+    ++number_of_streams_with_entries;
+    writer.AppendArrayHeader(2);
+    writer.AppendBulkString(read.key);
+    writer.AppendArrayHeader(entries.size());
+    for (const StreamEntry *entry : entries) {
+      writer.AppendArrayHeader(2);
+      writer.AppendBulkString(std::to_string(entry->id.milliseconds) + "-" +
+                              std::to_string(entry->id.sequence));
+      writer.AppendArrayHeader(entry->fields.size());
+      for (const std::string &field : entry->fields) {
+        writer.AppendBulkString(field);
+      }
+    }
+  }
+  if (number_of_streams_with_entries == 0) {
+    output += kNullArray;
+    return;
+  }
+  RespWriter(output).AppendArrayHeader(number_of_streams_with_entries);
+  output += reply;
+}
+
+void MockRedisServer::AcknowledgeStreamEntries(
+    const std::vector<std::string_view> &arguments, std::string &output) {
+  // XACK key group id ...
+  if (arguments.size() < 4) {
+    AppendWrongNumberOfArguments(output, "xack");
+    return;
+  }
+  long long number_of_acknowledged = 0;
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto it = streams_.find(std::string(arguments[1]));
+  if (it != streams_.end()) {
+    auto group = it->second.groups.find(std::string(arguments[2]));
+    for (std::size_t i = 3;
+         group != it->second.groups.end() && i < arguments.size(); ++i) {
+      const std::string_view id = arguments[i];
+      const std::size_t separator = id.find('-');
+      StreamId stream_id{0, 0};
+      if (!ParseInteger(id.substr(0, separator), stream_id.milliseconds) ||
+          (separator != std::string_view::npos &&
+           !ParseInteger(id.substr(separator + 1), stream_id.sequence))) {
+        AppendError(output, "ERR Invalid stream ID specified as stream "
+                            "command argument");
+        return;
+      }
+      number_of_acknowledged +=
+          group->second.pending_entries.erase(stream_id);
+    }
+  }
+  AppendInteger(output, number_of_acknowledged);
+}
+
+bool MockRedisServer::Send(Connection &connection, std::string_view data) {
+  const long long reply_delay =
+      reply_delay_in_microseconds_.load(std::memory_order_relaxed);
+  if (reply_delay > 0) {
+    std::this_thread::sleep_for(std::chrono::microseconds(reply_delay));
+  }
+  return SendAll(connection, data,
+                 maximum_write_size_.load(std::memory_order_relaxed),
+                 std::chrono::microseconds(write_pause_in_microseconds_.load(
+                     std::memory_order_relaxed)));
+}
+
+bool MockRedisServer::SendAll(Connection &connection, std::string_view data,
+                              std::size_t maximum_write_size,
+                              std::chrono::microseconds pause) {
+  std::lock_guard<std::mutex> lock(connection.write_mutex);
+  std::size_t bytes_sent = 0;
+  while (bytes_sent < data.size()) {
+    if (connection.is_closed.load(std::memory_order_relaxed)) {
+      return false;
+    }
+    std::size_t write_size = data.size() - bytes_sent;
+    if (maximum_write_size > 0) {
+      write_size = std::min(write_size, maximum_write_size);
+      if (bytes_sent > 0 && pause.count() > 0) {
+        std::this_thread::sleep_for(pause);
+      }
+    }
+    const ssize_t result = send(connection.file_descriptor,
+                                data.data() + bytes_sent, write_size,
+                                MSG_NOSIGNAL);
+    if (result < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      return false;
+    }
+    bytes_sent += result;
+  }
+  return true;
+}
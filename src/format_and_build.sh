@@ -27,7 +27,6 @@ echo Building...
 /usr/bin/clang++-11 \
     -std=c++17 \
     $CXXFLAGS \
-    -L/usr/local/lib -lhiredis \
      **/*.cpp \
     -o $OUTPUT_DIR/simple_redis_client
 
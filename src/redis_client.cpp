@@ -1,16 +1,18 @@
 #include <assert.h>
-#include <hiredis/hiredis.h>
 #include <optional>
 #include <thread>
 #include <unordered_map>
 
 #include "../include/Consumer/ConsumerGroups/RedisBrokerConsumer.hpp"
+#include "../include/Consumer/ConsumerGroups/RedisReactorConsumer.hpp"
+#include "../include/Consumer/ConsumerGroups/RedisStreamConsumer.hpp"
 #include "../include/Consumer/RedisConsumer.hpp"
 
 #include "../include/Parsing/config_parser.hpp"
 #include "../include/Parsing/input_parser.hpp"
 #include "../include/common.hpp"
 
+#include "../include/Monitoring/MetricsExporter.hpp"
 #include "../include/Monitoring/ProcessedMessagesMonitor.hpp"
 
 using namespace std;
@@ -39,6 +41,23 @@ void PrintHelp() {
   }
 }
 
+// Serves the consumers' statistics when a metrics port is configured.
+void StartMetricsExporter(
+    MetricsExporter &metrics_exporter,
+    const std::unordered_map<std::string, std::string> &config) {
+  auto it = config.find(CFG_KEY_METRICS_PORT);
+  if (it == config.end() || atoi(it->second.c_str()) == 0) {
+    return;
+  }
+  if (!metrics_exporter.Start(atoi(it->second.c_str()))) {
+    LOG(LogLevel::Error, "[MetricsExporter] {}",
+        metrics_exporter.GetLastError());
+    return;
+  }
+  LOG(LogLevel::Info, "Serving the metrics at http://127.0.0.1:{}/metrics",
+      metrics_exporter.GetPort());
+}
+
 int main(int argc, char *argv[]) {
   std::unordered_map<std::string, std::string> config;
   bool verbose_outputs = true;
@@ -127,10 +146,69 @@ int main(int argc, char *argv[]) {
     return EXIT_FAILURE;
   }
 
-  // When the group size is 1, use the RedisConsumer class, which will subscribe
-  // and process the messages itself
-  if (atoi(config[CFG_KEY_GROUP_SIZE].c_str()) == 1) {
-    RedisConsumer redis_consumer(verbose_outputs);
+  // The per-message events are logged at level Debug, sampled per second.
+  Logger::Get().SetMinimumLevel(verbose_outputs ? LogLevel::Debug
+                                                : LogLevel::Info);
+
+  ConsumerOptions consumer_options = CreateConsumerOptions(config);
+  // In stream mode the messages are read from a stream by a consumer group
+  // member, and processed by group size workers.
+  if (consumer_options.ingest_mode == IngestMode::Stream) {
+    RedisStreamConsumer redis_stream_consumer(
+        verbose_outputs, atoi(config[CFG_KEY_GROUP_SIZE].c_str()),
+        consumer_options);
+    redis_stream_consumer.EstablishConnection(
+        config[CFG_KEY_HOST], atoi(config[CFG_KEY_PORT].c_str()));
+
+    std::thread consumption_thread([&redis_stream_consumer, &config]() {
+      redis_stream_consumer.ConsumeStream(
+          CreateStreamGroupSubscription(config));
+    });
+
+    std::vector<IObservableConsumer *> consumers = {&redis_stream_consumer};
+    ProcessedMessagesMonitor processed_messages_monitor(
+        consumers, atoi(config[CFG_KEY_MONITORING_INTERVAL].c_str()));
+    std::thread monitoring_thread(&ProcessedMessagesMonitor::StartMonitoring,
+                                  &processed_messages_monitor);
+    MetricsExporter metrics_exporter(consumers);
+    StartMetricsExporter(metrics_exporter, config);
+
+    consumption_thread.join();
+    monitoring_thread.join();
+    return EXIT_SUCCESS;
+  }
+
+  // The epoll engine drives all of the connections from event loops and
+  // processes the messages on a pool of group size workers. Sharded pub/sub
+  // is only read by the broker, which multiplexes the shards itself.
+  if (consumer_options.io_engine == IoEngine::Epoll &&
+      !consumer_options.sharded_pubsub) {
+    RedisReactorConsumer redis_reactor_consumer(
+        verbose_outputs, atoi(config[CFG_KEY_GROUP_SIZE].c_str()),
+        consumer_options);
+    redis_reactor_consumer.EstablishConnection(
+        config[CFG_KEY_HOST], atoi(config[CFG_KEY_PORT].c_str()));
+
+    std::thread subscription_thread([&redis_reactor_consumer, &config]() {
+      redis_reactor_consumer.SubscribeToChannels(
+          CreateChannelSubscriptions(config));
+    });
+
+    std::vector<IObservableConsumer *> consumers = {&redis_reactor_consumer};
+    ProcessedMessagesMonitor processed_messages_monitor(
+        consumers, atoi(config[CFG_KEY_MONITORING_INTERVAL].c_str()));
+    std::thread monitoring_thread(&ProcessedMessagesMonitor::StartMonitoring,
+                                  &processed_messages_monitor);
+    MetricsExporter metrics_exporter(consumers);
+    StartMetricsExporter(metrics_exporter, config);
+
+    subscription_thread.join();
+    monitoring_thread.join();
+  } else if (atoi(config[CFG_KEY_GROUP_SIZE].c_str()) == 1 &&
+             !consumer_options.sharded_pubsub) {
+    // When the group size is 1, use the RedisConsumer class, which will
+    // subscribe and process the messages itself
+    RedisConsumer redis_consumer(verbose_outputs, consumer_options);
     redis_consumer.EstablishConnection(config[CFG_KEY_HOST],
                                        atoi(config[CFG_KEY_PORT].c_str()));
     // Subscribe without posting the processed messages to a stream
@@ -145,8 +223,7 @@ int main(int argc, char *argv[]) {
     //     "testing_stream", {"John", "Smith", "Jane", "Smith"});
 
     std::thread subscription_thread([&redis_consumer, &config]() {
-      redis_consumer.SubscribeToChannel(config[CFG_KEY_SUB_CHANNEL],
-                                        config[CFG_KEY_PROC_STREAM]);
+      redis_consumer.SubscribeToChannels(CreateChannelSubscriptions(config));
     });
 
     std::vector<IObservableConsumer *> consumers = {&redis_consumer};
@@ -154,18 +231,21 @@ int main(int argc, char *argv[]) {
         consumers, atoi(config[CFG_KEY_MONITORING_INTERVAL].c_str()));
     std::thread monitoring_thread(&ProcessedMessagesMonitor::StartMonitoring,
                                   &processed_messages_monitor);
+    MetricsExporter metrics_exporter(consumers);
+    StartMetricsExporter(metrics_exporter, config);
 
     subscription_thread.join();
     monitoring_thread.join();
   } else {
     RedisBrokerConsumer redis_broker_consumer(
-        verbose_outputs, atoi(config[CFG_KEY_GROUP_SIZE].c_str()));
+        verbose_outputs, atoi(config[CFG_KEY_GROUP_SIZE].c_str()),
+        consumer_options);
     redis_broker_consumer.EstablishConnection(
         config[CFG_KEY_HOST], atoi(config[CFG_KEY_PORT].c_str()));
 
     std::thread subscription_thread([&redis_broker_consumer, &config]() {
-      redis_broker_consumer.SubscribeToChannel(config[CFG_KEY_SUB_CHANNEL],
-                                               config[CFG_KEY_PROC_STREAM]);
+      redis_broker_consumer.SubscribeToChannels(
+          CreateChannelSubscriptions(config));
     });
 
     std::vector<IObservableConsumer *> consumers = {&redis_broker_consumer};
@@ -173,6 +253,8 @@ int main(int argc, char *argv[]) {
         consumers, atoi(config[CFG_KEY_MONITORING_INTERVAL].c_str()));
     std::thread monitoring_thread(&ProcessedMessagesMonitor::StartMonitoring,
                                   &processed_messages_monitor);
+    MetricsExporter metrics_exporter(consumers);
+    StartMetricsExporter(metrics_exporter, config);
 
     subscription_thread.join();
     monitoring_thread.join();
@@ -0,0 +1,456 @@
+#include "../include/Concurrency/BufferPool.hpp"
+#include "../include/Consumer/ConsumerGroups/RedisBrokerConsumer.hpp"
+#include "../include/Parsing/RespReader.hpp"
+#include <arpa/inet.h>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <dirent.h>
+#include <gtest/gtest.h>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <string>
+#include <sys/socket.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+namespace {
+std::atomic<long long> number_of_allocations{0};
+} // namespace
+
+// Every allocation of the process is counted, so the test can tell whether
+// the broker allocates memory per message.
+void *operator new(std::size_t size) {
+  number_of_allocations.fetch_add(1, std::memory_order_relaxed);
+  if (void *memory = std::malloc(size == 0 ? 1 : size)) {
+    return memory;
+  }
+  throw std::bad_alloc();
+}
+
+void *operator new[](std::size_t size) { return operator new(size); }
+
+void operator delete(void *memory) noexcept { std::free(memory); }
+
+void operator delete[](void *memory) noexcept { std::free(memory); }
+
+void operator delete(void *memory, std::size_t) noexcept {
+  std::free(memory);
+}
+
+void operator delete[](void *memory, std::size_t) noexcept {
+  std::free(memory);
+}
+
+namespace {
+constexpr int kNumberOfWorkers = 2;
+// The messages are sent in rounds, and every round waits for the previous one
+// to be processed, so the warm-up reaches the steady state of the
+// measurement. The warm-up rounds are sent at once, so the buffer pool grows
+// to more buffers than a single round keeps in use.
+constexpr int kMessagesPerRound = 500;
+constexpr int kNumberOfWarmUpRounds = 4;
+constexpr int kNumberOfMeasuredRounds = 8;
+// A worker that is preempted while it recycles a buffer hides the free
+// buffers behind it in the pool's queue. When that leaves the queue looking
+// empty, the pool allocates a slab rather than waiting for the worker, so the
+// steady state allocates now and then, but not per message.
+constexpr long long kMaximumNumberOfOccasionalAllocations = 8;
+
+// Waits up to a few seconds for the condition to become true.
+template <typename Condition> bool WaitFor(Condition &&condition) {
+  auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+  while (!condition()) {
+    if (std::chrono::steady_clock::now() > deadline) {
+      return false;
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+  return true;
+}
+
+std::string ToBulkString(const std::string &string) {
+  return "$" + std::to_string(string.size()) + "\r\n" + string + "\r\n";
+}
+
+// A round of messages, alternating between a channel and a pattern
+// subscription.
+std::string CreateRound(int round) {
+  std::string round_data;
+  for (int i = 0; i < kMessagesPerRound; ++i) {
+    const std::string payload = R"({"message_id": "id-)" +
+                                std::to_string(round * kMessagesPerRound + i) +
+                                R"(", "text": "lorem ipsum"})";
+    if (i % 2 == 0) {
+      round_data += "*3\r\n" + ToBulkString("message") +
+                    ToBulkString("orders") + ToBulkString(payload);
+    } else {
+      round_data += "*4\r\n" + ToBulkString("pmessage") +
+                    ToBulkString("events.*") + ToBulkString("events.new") +
+                    ToBulkString(payload);
+    }
+  }
+  return round_data;
+}
+
+/*
+An in-process Redis server for a broker consumer. The first connection is the
+subscription, which is sent the messages of Publish(). Every other connection
+is a worker's processing connection, whose XADD commands are answered with a
+stream id. Answering does not allocate memory once the connection is set up.
+*/
+class FakeRedisServer {
+public:
+  FakeRedisServer()
+      : subscription_file_descriptor_{-1}, number_of_connections_{0} {
+    listening_file_descriptor_ = socket(AF_INET, SOCK_STREAM, 0);
+    sockaddr_in address{};
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    socklen_t address_length = sizeof(address);
+    EXPECT_EQ(bind(listening_file_descriptor_, (sockaddr *)&address,
+                   sizeof(address)),
+              0);
+    EXPECT_EQ(listen(listening_file_descriptor_, 16), 0);
+    getsockname(listening_file_descriptor_, (sockaddr *)&address,
+                &address_length);
+    port_ = ntohs(address.sin_port);
+    accepting_thread_ =
+        std::thread(&FakeRedisServer::AcceptConnections, this);
+  }
+
+  ~FakeRedisServer() {
+    shutdown(listening_file_descriptor_, SHUT_RDWR);
+    close(listening_file_descriptor_);
+    accepting_thread_.join();
+    for (auto &connection_thread : connection_threads_) {
+      connection_thread.join();
+    }
+    for (int file_descriptor : file_descriptors_) {
+      close(file_descriptor);
+    }
+  }
+
+  unsigned short GetPort() const { return port_; }
+
+  // Waits for the subscription and the processing connections.
+  bool WaitForConnections(int number_of_connections) {
+    return WaitFor([this, number_of_connections] {
+      return number_of_connections_ == number_of_connections;
+    });
+  }
+
+  // Closes the subscription, which makes the consumer return.
+  void CloseSubscription() {
+    shutdown(subscription_file_descriptor_, SHUT_RDWR);
+  }
+
+  void Publish(const std::string &data) {
+    std::size_t bytes_sent = 0;
+    while (bytes_sent < data.size()) {
+      ssize_t result = send(subscription_file_descriptor_,
+                            data.data() + bytes_sent, data.size() - bytes_sent,
+                            MSG_NOSIGNAL);
+      ASSERT_GT(result, 0);
+      bytes_sent += result;
+    }
+  }
+
+private:
+  void AcceptConnections() {
+    while (true) {
+      int file_descriptor =
+          accept(listening_file_descriptor_, nullptr, nullptr);
+      if (file_descriptor < 0) {
+        return;
+      }
+      file_descriptors_.push_back(file_descriptor);
+      if (subscription_file_descriptor_ == -1) {
+        subscription_file_descriptor_ = file_descriptor;
+      } else {
+        connection_threads_.emplace_back(&FakeRedisServer::AnswerCommands,
+                                         file_descriptor);
+      }
+      ++number_of_connections_;
+    }
+  }
+
+  static void AnswerCommands(int file_descriptor) {
+    static constexpr std::string_view kReply = "$3\r\n1-0\r\n";
+    RespReader reader(file_descriptor);
+    while (reader.ReadFrames([file_descriptor](const RespParser &) {
+      send(file_descriptor, kReply.data(), kReply.size(), MSG_NOSIGNAL);
+    })) {
+    }
+  }
+
+  int listening_file_descriptor_;
+  unsigned short port_;
+  std::atomic<int> subscription_file_descriptor_;
+  std::atomic<int> number_of_connections_;
+  std::thread accepting_thread_;
+  // Only used by the accepting thread until it has been joined.
+  std::vector<std::thread> connection_threads_;
+  std::vector<int> file_descriptors_;
+};
+
+// Receives messages through a broker consumer that adds them to a processing
+// stream, and returns the number of allocations while the consumer is warm.
+// The consumer's queue statistics are stored in queue_statistics.
+long long CountSteadyStateAllocations(const ConsumerOptions &options,
+                                      QueueStatistics &queue_statistics) {
+  std::vector<std::string> rounds;
+  for (int round = 0; round < kNumberOfWarmUpRounds + kNumberOfMeasuredRounds;
+       ++round) {
+    rounds.push_back(CreateRound(round));
+  }
+
+  FakeRedisServer server;
+  auto consumer = std::make_unique<RedisBrokerConsumer>(
+      false, kNumberOfWorkers, options);
+  consumer->EstablishConnection("127.0.0.1", server.GetPort());
+  std::thread subscription_thread([&consumer] {
+    consumer->SubscribeToChannels(
+        {{"orders", false, "processed"}, {"events.*", true, "processed"}});
+  });
+  // The workers have been created once all of them are connected.
+  EXPECT_TRUE(server.WaitForConnections(1 + kNumberOfWorkers));
+
+  long long number_of_sent_messages = 0;
+  auto publish_rounds = [&](const std::string &rounds_data,
+                            int number_of_rounds) {
+    server.Publish(rounds_data);
+    number_of_sent_messages += number_of_rounds * kMessagesPerRound;
+    EXPECT_TRUE(WaitFor([&] {
+      return consumer->GetNumberOfProcessedMessages() ==
+             number_of_sent_messages;
+    }));
+  };
+
+  std::string warm_up_rounds;
+  for (int round = 0; round < kNumberOfWarmUpRounds; ++round) {
+    warm_up_rounds += rounds[round];
+  }
+  publish_rounds(warm_up_rounds, kNumberOfWarmUpRounds);
+  const long long allocations_before =
+      number_of_allocations.load(std::memory_order_relaxed);
+  for (std::size_t round = kNumberOfWarmUpRounds; round < rounds.size();
+       ++round) {
+    publish_rounds(rounds[round], 1);
+  }
+  const long long allocations_after =
+      number_of_allocations.load(std::memory_order_relaxed);
+
+  server.CloseSubscription();
+  subscription_thread.join();
+  queue_statistics = consumer->GetQueueStatistics();
+  consumer.reset();
+  return allocations_after - allocations_before;
+}
+
+// A new directory for a journal, which is removed with its files.
+class TemporaryDirectory {
+public:
+  TemporaryDirectory() {
+    char path[] = "/tmp/broker_journal.XXXXXX";
+    if (mkdtemp(path) != nullptr) {
+      path_ = path;
+    }
+  }
+
+  ~TemporaryDirectory() {
+    if (DIR *directory = opendir(path_.c_str())) {
+      while (const dirent *entry = readdir(directory)) {
+        if (entry->d_name[0] != '.') {
+          unlink((path_ + "/" + entry->d_name).c_str());
+        }
+      }
+      closedir(directory);
+    }
+    rmdir(path_.c_str());
+  }
+
+  const std::string &GetPath() const { return path_; }
+
+private:
+  std::string path_;
+};
+
+long long CountSteadyStateAllocations(DispatchMode dispatch_mode) {
+  ConsumerOptions options;
+  options.dispatch_mode = dispatch_mode;
+  QueueStatistics queue_statistics;
+  return CountSteadyStateAllocations(options, queue_statistics);
+}
+} // namespace
+
+TEST(BufferPoolTest, RecyclesItsBuffers) {
+  BufferPool pool(64, 128);
+  PooledBuffer buffer = pool.Acquire(10);
+  char *data = buffer.Data();
+  EXPECT_EQ(buffer.Size(), 10u);
+  EXPECT_EQ(pool.GetNumberOfSlabs(), 1u);
+
+  PooledBuffer moved_buffer = std::move(buffer);
+  EXPECT_EQ(buffer.Data(), nullptr);
+  EXPECT_EQ(moved_buffer.Data(), data);
+  moved_buffer.Release();
+
+  std::vector<PooledBuffer> buffers;
+  for (std::size_t i = 0; i < 2 * BufferPool::kBuffersPerSlab; ++i) {
+    buffers.push_back(pool.Acquire(64));
+  }
+  EXPECT_EQ(pool.GetNumberOfSlabs(), 2u);
+  EXPECT_EQ(pool.GetNumberOfUnpooledBuffers(), 0);
+}
+
+TEST(BufferPoolTest, AllocatesTheBuffersThatItCannotProvide) {
+  BufferPool pool(64, 1);
+  PooledBuffer large_buffer = pool.Acquire(65);
+  EXPECT_EQ(large_buffer.Size(), 65u);
+  EXPECT_EQ(pool.GetNumberOfUnpooledBuffers(), 1);
+
+  std::vector<PooledBuffer> buffers;
+  for (std::size_t i = 0; i <= BufferPool::kBuffersPerSlab; ++i) {
+    buffers.push_back(pool.Acquire(64));
+  }
+  EXPECT_EQ(pool.GetNumberOfSlabs(), 1u);
+  EXPECT_EQ(pool.GetNumberOfUnpooledBuffers(), 2);
+}
+
+TEST(BrokerAllocationsTest, RoundRobinDoesNotAllocatePerMessage) {
+  EXPECT_LE(CountSteadyStateAllocations(DispatchMode::RoundRobin),
+            kMaximumNumberOfOccasionalAllocations);
+}
+
+TEST(BrokerAllocationsTest, KeyAffineDoesNotAllocatePerMessage) {
+  EXPECT_LE(CountSteadyStateAllocations(DispatchMode::KeyAffine),
+            kMaximumNumberOfOccasionalAllocations);
+}
+
+TEST(BrokerAllocationsTest, WorkStealingDoesNotAllocatePerMessage) {
+  EXPECT_LE(CountSteadyStateAllocations(DispatchMode::WorkStealing),
+            kMaximumNumberOfOccasionalAllocations);
+}
+
+TEST(BrokerAllocationsTest, SpillsTheMessagesThatDoNotFitWithoutAllocating) {
+  ConsumerOptions options;
+  // Far fewer than a round of messages fit into the queue.
+  options.broker_queue_capacity = 16;
+  options.spill_directory = "/tmp";
+  options.spill_segment_size = 1024 * 1024;
+  QueueStatistics queue_statistics;
+  EXPECT_LE(CountSteadyStateAllocations(options, queue_statistics),
+            kMaximumNumberOfOccasionalAllocations);
+  EXPECT_GT(queue_statistics.number_of_spilled_messages, 0);
+  EXPECT_EQ(queue_statistics.number_of_messages_on_disk, 0);
+  EXPECT_EQ(queue_statistics.number_of_dropped_messages, 0);
+}
+
+TEST(BrokerAllocationsTest, JournalsTheMessagesWithoutAllocating) {
+  TemporaryDirectory journal_directory;
+  ASSERT_FALSE(journal_directory.GetPath().empty());
+  ConsumerOptions options;
+  options.journal_directory = journal_directory.GetPath();
+  options.journal_segment_size = 1024 * 1024;
+  QueueStatistics queue_statistics;
+  EXPECT_LE(CountSteadyStateAllocations(options, queue_statistics),
+            kMaximumNumberOfOccasionalAllocations);
+
+  // Every message was answered, so none is left to process after a
+  // restart.
+  Journal journal(journal_directory.GetPath(), 1024 * 1024,
+                  std::chrono::milliseconds(5), 1000);
+  ASSERT_TRUE(journal.Open()) << journal.GetLastError();
+  EXPECT_EQ(journal.GetNumberOfRecoveredRecords(), 0u);
+}
+
+TEST(BrokerJournalTest, ProcessesTheJournaledMessagesAfterARestart) {
+  TemporaryDirectory journal_directory;
+  ASSERT_FALSE(journal_directory.GetPath().empty());
+  // The records of a broker that crashed before any of its messages were
+  // processed, in the layout of the broker's journal records.
+  struct JournaledMessageHeader {
+    std::uint32_t subscription_name_size;
+    std::uint32_t channel_size;
+    bool is_pattern;
+  };
+  constexpr int kNumberOfJournaledMessages = 100;
+  {
+    Journal journal(journal_directory.GetPath(), 1024 * 1024,
+                    std::chrono::milliseconds(5), 1000);
+    ASSERT_TRUE(journal.Open()) << journal.GetLastError();
+    auto append = [&journal](const std::string &subscription_name,
+                             const std::string &channel, bool is_pattern,
+                             const std::string &payload) {
+      const JournaledMessageHeader header{
+          static_cast<std::uint32_t>(subscription_name.size()),
+          static_cast<std::uint32_t>(channel.size()), is_pattern};
+      ASSERT_NE(journal.Append({std::string_view(reinterpret_cast<const char *>(
+                                                     &header),
+                                                 sizeof(header)),
+                                subscription_name, channel, payload}),
+                0u);
+    };
+    for (int i = 0; i < kNumberOfJournaledMessages; ++i) {
+      const std::string payload =
+          R"({"message_id": "id-)" + std::to_string(i) + R"("})";
+      if (i % 2 == 0) {
+        append("orders", "", false, payload);
+      } else {
+        append("events.*", "events.new", true, payload);
+      }
+    }
+    // The broker is no longer subscribed to this channel after the restart.
+    append("payments", "", false, R"({"message_id": "id-x"})");
+  }
+
+  FakeRedisServer server;
+  ConsumerOptions options;
+  options.journal_directory = journal_directory.GetPath();
+  auto consumer =
+      std::make_unique<RedisBrokerConsumer>(false, kNumberOfWorkers, options);
+  consumer->EstablishConnection("127.0.0.1", server.GetPort());
+  std::thread subscription_thread([&consumer] {
+    consumer->SubscribeToChannels(
+        {{"orders", false, "processed"}, {"events.*", true, "processed"}});
+  });
+  EXPECT_TRUE(server.WaitForConnections(1 + kNumberOfWorkers));
+  EXPECT_TRUE(WaitFor([&] {
+    return consumer->GetNumberOfProcessedMessages() ==
+           kNumberOfJournaledMessages;
+  }));
+  server.CloseSubscription();
+  subscription_thread.join();
+  consumer.reset();
+
+  Journal journal(journal_directory.GetPath(), 1024 * 1024,
+                  std::chrono::milliseconds(5), 1000);
+  ASSERT_TRUE(journal.Open()) << journal.GetLastError();
+  EXPECT_EQ(journal.GetNumberOfRecoveredRecords(), 0u);
+}
+
+TEST(BrokerDispatchTest, StartsOneWorkerWhenNoneIsRequested) {
+  for (DispatchMode dispatch_mode :
+       {DispatchMode::KeyAffine, DispatchMode::WorkStealing}) {
+    FakeRedisServer server;
+    ConsumerOptions options;
+    options.dispatch_mode = dispatch_mode;
+    auto consumer = std::make_unique<RedisBrokerConsumer>(false, 0, options);
+    consumer->EstablishConnection("127.0.0.1", server.GetPort());
+    std::thread subscription_thread([&consumer] {
+      consumer->SubscribeToChannels(
+          {{"orders", false, "processed"}, {"events.*", true, "processed"}});
+    });
+    EXPECT_TRUE(server.WaitForConnections(1 + 1));
+    server.Publish(CreateRound(0));
+    EXPECT_TRUE(WaitFor([&] {
+      return consumer->GetNumberOfProcessedMessages() == kMessagesPerRound;
+    }));
+    server.CloseSubscription();
+    subscription_thread.join();
+    consumer.reset();
+  }
+}
@@ -0,0 +1,112 @@
+#include "../include/Consumer/ChannelTable.hpp"
+#include <gtest/gtest.h>
+#include <memory>
+#include <string>
+
+namespace {
+class FixedMessageProcessor : public IMessageProcessor {
+public:
+  explicit FixedMessageProcessor(std::string message_id)
+      : message_id_(std::move(message_id)) {}
+
+  std::optional<Message> ProcessMessage(std::string_view) override {
+    Message message{};
+    message.message_id = message_id_;
+    return message;
+  }
+
+private:
+  std::string message_id_;
+};
+} // namespace
+
+TEST(ChannelTableTest, InternsSubscriptionsInOrder) {
+  ChannelTable channel_table;
+  ASSERT_TRUE(channel_table.Add({"orders", false, "orders:processed"}));
+  ASSERT_TRUE(channel_table.Add({"orders:*", true}));
+  // A channel and a pattern may have the same name.
+  ASSERT_TRUE(channel_table.Add({"orders:*", false}));
+  EXPECT_FALSE(channel_table.Add({"orders", false}));
+  EXPECT_FALSE(channel_table.Add({"orders:*", true}));
+
+  EXPECT_EQ(channel_table.GetNumberOfSubscriptions(), 3);
+  EXPECT_EQ(channel_table.Find("orders", false), 0);
+  EXPECT_EQ(channel_table.Find("orders:*", true), 1);
+  EXPECT_EQ(channel_table.Find("orders:*", false), 2);
+  EXPECT_EQ(channel_table.Find("orders", true), kUnknownChannelId);
+  EXPECT_EQ(channel_table.Find("payments", false), kUnknownChannelId);
+  EXPECT_EQ(channel_table.Get(0).processing_stream, "orders:processed");
+  EXPECT_TRUE(channel_table.HasProcessingStreams());
+}
+
+TEST(ChannelTableTest, FindsHundredsOfChannels) {
+  constexpr int kNumberOfChannels = 1000;
+  ChannelTable channel_table;
+  EXPECT_EQ(channel_table.Find("channel:0", false), kUnknownChannelId);
+  for (int i = 0; i < kNumberOfChannels; ++i) {
+    const bool is_pattern = i % 2 == 1;
+    ASSERT_TRUE(channel_table.Add({"channel:" + std::to_string(i),
+                                   is_pattern}));
+  }
+  for (int i = 0; i < kNumberOfChannels; ++i) {
+    const std::string name = "channel:" + std::to_string(i);
+    const bool is_pattern = i % 2 == 1;
+    EXPECT_EQ(channel_table.Find(name, is_pattern), i);
+    EXPECT_EQ(channel_table.Find(name, !is_pattern), kUnknownChannelId);
+  }
+  EXPECT_EQ(channel_table.Find("channel:" + std::to_string(kNumberOfChannels),
+                               false),
+            kUnknownChannelId);
+  EXPECT_FALSE(channel_table.HasProcessingStreams());
+}
+
+TEST(ChannelTableTest, ResolvesMessagesByChannelOrPattern) {
+  ChannelTable channel_table;
+  ASSERT_TRUE(channel_table.Add({"orders", false}));
+  ASSERT_TRUE(channel_table.Add({"events:*", true}));
+
+  PubSubMessage message{PubSubMessageKind::Message, {}, "orders", "{}", 0};
+  EXPECT_EQ(channel_table.Resolve(message), 0);
+  message.channel = "events:login";
+  EXPECT_EQ(channel_table.Resolve(message), kUnknownChannelId);
+
+  // Pattern messages are resolved by the pattern that they matched.
+  PubSubMessage pattern_message{PubSubMessageKind::PatternMessage, "events:*",
+                                "events:login", "{}", 0};
+  ChannelId channel_id = channel_table.Resolve(pattern_message);
+  EXPECT_EQ(channel_id, 1);
+
+  ReceivedMessage received_message{channel_id, "events:login", "{}"};
+  EXPECT_EQ(channel_table.GetChannelName(received_message), "events:login");
+  received_message = {0, {}, "{}"};
+  EXPECT_EQ(channel_table.GetChannelName(received_message), "orders");
+}
+
+TEST(ChannelTableTest, CreatesASingleCommandPerKindOfSubscription) {
+  ChannelTable channel_table;
+  ASSERT_TRUE(channel_table.Add({"a", false}));
+  EXPECT_EQ(channel_table.CreateSubscriptionCommands(),
+            "*2\r\n$9\r\nSUBSCRIBE\r\n$1\r\na\r\n");
+
+  ASSERT_TRUE(channel_table.Add({"b*", true}));
+  ASSERT_TRUE(channel_table.Add({"cc", false}));
+  EXPECT_EQ(channel_table.CreateSubscriptionCommands(),
+            "*3\r\n$9\r\nSUBSCRIBE\r\n$1\r\na\r\n$2\r\ncc\r\n"
+            "*2\r\n$10\r\nPSUBSCRIBE\r\n$2\r\nb*\r\n");
+}
+
+TEST(ChannelTableTest, KeepsTheProcessorsOfTheSubscriptions) {
+  ChannelTable channel_table;
+  ASSERT_TRUE(channel_table.Add(
+      {"a", false, "", std::make_shared<FixedMessageProcessor>("own")}));
+  ASSERT_TRUE(channel_table.Add({"b", false}));
+  channel_table.SetDefaultMessageProcessor(
+      std::make_shared<FixedMessageProcessor>("default"));
+
+  EXPECT_EQ(channel_table.Get(0).message_processor->ProcessMessage("{}")
+                ->message_id,
+            "own");
+  EXPECT_EQ(channel_table.Get(1).message_processor->ProcessMessage("{}")
+                ->message_id,
+            "default");
+}
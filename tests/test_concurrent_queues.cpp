@@ -0,0 +1,206 @@
+#include "../include/Concurrency/ChaseLevDeque.hpp"
+#include "../include/Concurrency/EventCount.hpp"
+#include "../include/Concurrency/MpmcRingBuffer.hpp"
+#include "../include/Concurrency/SpscRingBuffer.hpp"
+#include <gtest/gtest.h>
+#include <string>
+#include <thread>
+#include <vector>
+
+TEST(MpmcRingBufferTest, RoundsTheCapacityUpToAPowerOfTwo) {
+  MpmcRingBuffer<int> ring(1000);
+  EXPECT_EQ(ring.GetCapacity(), 1024);
+}
+
+TEST(MpmcRingBufferTest, IsFirstInFirstOutAndBounded) {
+  MpmcRingBuffer<std::string> ring(4);
+  for (int i = 0; i < 4; ++i) {
+    ASSERT_TRUE(ring.TryPush(std::to_string(i)));
+  }
+
+  std::string rejected = "rejected";
+  EXPECT_FALSE(ring.TryPush(std::move(rejected)));
+  // A failed push leaves the value untouched.
+  EXPECT_EQ(rejected, "rejected");
+  EXPECT_EQ(ring.GetApproximateSize(), 4);
+
+  std::string value;
+  for (int i = 0; i < 4; ++i) {
+    ASSERT_TRUE(ring.TryPop(value));
+    EXPECT_EQ(value, std::to_string(i));
+  }
+  EXPECT_FALSE(ring.TryPop(value));
+  EXPECT_TRUE(ring.IsEmpty());
+}
+
+TEST(MpmcRingBufferTest, DeliversEveryValueExactlyOnceAcrossThreads) {
+  constexpr int kNumberOfProducers = 4;
+  constexpr int kNumberOfConsumers = 4;
+  constexpr int kValuesPerProducer = 50000;
+  MpmcRingBuffer<int> ring(256);
+  EventCount event_count;
+  std::atomic<int> number_of_finished_producers{0};
+  std::vector<std::atomic<int>> deliveries(kNumberOfProducers *
+                                           kValuesPerProducer);
+
+  std::vector<std::thread> threads;
+  for (int producer = 0; producer < kNumberOfProducers; ++producer) {
+    threads.emplace_back([&, producer]() {
+      for (int i = 0; i < kValuesPerProducer; ++i) {
+        int value = producer * kValuesPerProducer + i;
+        Backoff backoff;
+        while (!ring.TryPush(std::move(value))) {
+          backoff.Pause();
+        }
+        event_count.NotifyOne();
+      }
+      ++number_of_finished_producers;
+      event_count.NotifyAll();
+    });
+  }
+  for (int consumer = 0; consumer < kNumberOfConsumers; ++consumer) {
+    threads.emplace_back([&]() {
+      int value;
+      while (true) {
+        if (ring.TryPop(value)) {
+          deliveries[value]++;
+          continue;
+        }
+        if (number_of_finished_producers == kNumberOfProducers) {
+          if (!ring.TryPop(value)) {
+            break;
+          }
+          deliveries[value]++;
+          continue;
+        }
+        event_count.Wait([&] {
+          return !ring.IsEmpty() ||
+                 number_of_finished_producers == kNumberOfProducers;
+        });
+      }
+    });
+  }
+  for (auto &thread : threads) {
+    thread.join();
+  }
+
+  for (auto &number_of_deliveries : deliveries) {
+    ASSERT_EQ(number_of_deliveries, 1);
+  }
+}
+
+TEST(SpscRingBufferTest, IsFirstInFirstOutAndBounded) {
+  SpscRingBuffer<std::string> ring(3);
+  EXPECT_EQ(ring.GetCapacity(), 4);
+  for (int i = 0; i < 4; ++i) {
+    ASSERT_TRUE(ring.TryPush(std::to_string(i)));
+  }
+
+  std::string rejected = "rejected";
+  EXPECT_FALSE(ring.TryPush(std::move(rejected)));
+  EXPECT_EQ(rejected, "rejected");
+
+  std::string value;
+  for (int i = 0; i < 4; ++i) {
+    ASSERT_TRUE(ring.TryPop(value));
+    EXPECT_EQ(value, std::to_string(i));
+  }
+  EXPECT_FALSE(ring.TryPop(value));
+  EXPECT_TRUE(ring.IsEmpty());
+}
+
+TEST(SpscRingBufferTest, PreservesTheOrderAcrossThreads) {
+  constexpr int kNumberOfValues = 200000;
+  SpscRingBuffer<int> ring(64);
+
+  std::thread producer([&ring]() {
+    for (int i = 0; i < kNumberOfValues; ++i) {
+      int value = i;
+      Backoff backoff;
+      while (!ring.TryPush(std::move(value))) {
+        backoff.Pause();
+      }
+    }
+  });
+
+  int expected_value = 0;
+  int value;
+  Backoff backoff;
+  while (expected_value < kNumberOfValues) {
+    if (!ring.TryPop(value)) {
+      backoff.Pause();
+      continue;
+    }
+    ASSERT_EQ(value, expected_value);
+    ++expected_value;
+  }
+  producer.join();
+  EXPECT_TRUE(ring.IsEmpty());
+}
+
+TEST(ChaseLevDequeTest, OwnerPopsNewestAndThievesStealOldest) {
+  ChaseLevDeque<int> deque(4);
+  for (int i = 0; i < 4; ++i) {
+    ASSERT_TRUE(deque.TryPush(i));
+  }
+  EXPECT_FALSE(deque.TryPush(4));
+
+  int value;
+  ASSERT_TRUE(deque.TrySteal(value));
+  EXPECT_EQ(value, 0);
+  ASSERT_TRUE(deque.TryPop(value));
+  EXPECT_EQ(value, 3);
+  ASSERT_TRUE(deque.TrySteal(value));
+  EXPECT_EQ(value, 1);
+  ASSERT_TRUE(deque.TryPop(value));
+  EXPECT_EQ(value, 2);
+  EXPECT_FALSE(deque.TryPop(value));
+  EXPECT_FALSE(deque.TrySteal(value));
+  EXPECT_TRUE(deque.IsEmpty());
+}
+
+TEST(ChaseLevDequeTest, DeliversEveryItemExactlyOnceToOwnerAndThieves) {
+  constexpr int kNumberOfThieves = 3;
+  constexpr int kNumberOfValues = 200000;
+  ChaseLevDeque<int> deque(64);
+  std::atomic<bool> is_owner_done{false};
+  std::vector<std::atomic<int>> deliveries(kNumberOfValues);
+
+  std::vector<std::thread> thieves;
+  for (int thief = 0; thief < kNumberOfThieves; ++thief) {
+    thieves.emplace_back([&]() {
+      int value;
+      while (!is_owner_done || !deque.IsEmpty()) {
+        if (deque.TrySteal(value)) {
+          deliveries[value]++;
+        }
+      }
+    });
+  }
+
+  int value;
+  for (int i = 0; i < kNumberOfValues; ++i) {
+    while (!deque.TryPush(i)) {
+      if (deque.TryPop(value)) {
+        deliveries[value]++;
+      }
+    }
+    // Keep some of the items to race the thieves for the last one.
+    if (i % 3 == 0 && deque.TryPop(value)) {
+      deliveries[value]++;
+    }
+  }
+  while (!deque.IsEmpty()) {
+    if (deque.TryPop(value)) {
+      deliveries[value]++;
+    }
+  }
+  is_owner_done = true;
+  for (auto &thief : thieves) {
+    thief.join();
+  }
+
+  for (auto &number_of_deliveries : deliveries) {
+    ASSERT_EQ(number_of_deliveries, 1);
+  }
+}
@@ -0,0 +1,130 @@
+#include "../include/Monitoring/CounterHistory.hpp"
+#include "../include/Monitoring/CounterSet.hpp"
+#include <atomic>
+#include <cstdint>
+#include <gtest/gtest.h>
+#include <thread>
+#include <vector>
+
+TEST(CounterSetTest, KeepsTheCountersOfEveryThreadOnTheirOwnCacheLine) {
+  CounterSet counter_set;
+  ThreadCounters &first = counter_set.Register();
+  ThreadCounters &second = counter_set.Register();
+  EXPECT_EQ(reinterpret_cast<std::uintptr_t>(&first) % kCacheLineSize, 0u);
+  EXPECT_EQ(reinterpret_cast<std::uintptr_t>(&second) % kCacheLineSize, 0u);
+  EXPECT_NE(&first, &second);
+}
+
+TEST(CounterSetTest, SumsTheCountersOfEveryThread) {
+  CounterSet counter_set;
+  ThreadCounters &first = counter_set.Register();
+  ThreadCounters &second = counter_set.Register();
+  first.Add(CounterId::ProcessedMessages);
+  first.Add(CounterId::ReceivedBytes, 100);
+  second.Add(CounterId::ProcessedMessages, 2);
+  second.Add(CounterId::ProcessingErrors);
+
+  CounterValues counters = counter_set.Read();
+  EXPECT_EQ(counters.Get(CounterId::ProcessedMessages), 3);
+  EXPECT_EQ(counters.Get(CounterId::ReceivedBytes), 100);
+  EXPECT_EQ(counters.Get(CounterId::ProcessingErrors), 1);
+  EXPECT_EQ(counters.Get(CounterId::StolenMessages), 0);
+  EXPECT_EQ(first.Get(CounterId::ProcessedMessages), 1);
+}
+
+TEST(CounterSetTest, ReadsWhileTheThreadsCount) {
+  constexpr int kNumberOfThreads = 4;
+  constexpr long long kNumberOfAdditions = 200000;
+  CounterSet counter_set;
+  std::vector<ThreadCounters *> thread_counters;
+  for (int i = 0; i < kNumberOfThreads; ++i) {
+    thread_counters.push_back(&counter_set.Register());
+  }
+  std::atomic<bool> is_done{false};
+  std::thread reader([&]() {
+    long long last_count = 0;
+    while (!is_done.load()) {
+      long long count =
+          counter_set.Read().Get(CounterId::ProcessedMessages);
+      // Every thread's counter only grows, and so does their sum.
+      EXPECT_GE(count, last_count);
+      last_count = count;
+    }
+  });
+  std::vector<std::thread> threads;
+  for (ThreadCounters *counters : thread_counters) {
+    threads.emplace_back([counters]() {
+      for (long long i = 0; i < kNumberOfAdditions; ++i) {
+        counters->Add(CounterId::ProcessedMessages);
+      }
+    });
+  }
+  for (std::thread &thread : threads) {
+    thread.join();
+  }
+  is_done = true;
+  reader.join();
+  EXPECT_EQ(counter_set.Read().Get(CounterId::ProcessedMessages),
+            kNumberOfThreads * kNumberOfAdditions);
+}
+
+namespace {
+CounterSnapshot MakeSnapshot(long long time_in_nanoseconds,
+                             long long processed_messages,
+                             long long processing_errors,
+                             long long received_bytes) {
+  CounterSnapshot snapshot{time_in_nanoseconds, {}};
+  snapshot.counters.Set(CounterId::ProcessedMessages, processed_messages);
+  snapshot.counters.Set(CounterId::ProcessingErrors, processing_errors);
+  snapshot.counters.Set(CounterId::ReceivedBytes, received_bytes);
+  return snapshot;
+}
+} // namespace
+
+TEST(CounterSetTest, DividesByTheTimeThatReallyPassed) {
+  CounterRates rates = CounterHistory::GetCounterRates(
+      MakeSnapshot(1'000'000'000, 100, 0, 1000),
+      MakeSnapshot(3'500'000'000, 600, 5, 6000));
+  EXPECT_DOUBLE_EQ(rates.window_in_seconds, 2.5);
+  EXPECT_DOUBLE_EQ(rates.messages_per_second, 200);
+  EXPECT_DOUBLE_EQ(rates.errors_per_second, 2);
+  EXPECT_DOUBLE_EQ(rates.bytes_per_second, 2000);
+}
+
+TEST(CounterSetTest, ComputesTheRatesOverTheRequestedWindow) {
+  CounterHistory history(8);
+  EXPECT_FALSE(history.GetRates(1'000'000'000).has_value());
+  history.Add(MakeSnapshot(0, 0, 0, 0));
+  EXPECT_FALSE(history.GetRates(1'000'000'000).has_value());
+  // One snapshot a second, one of them late, with 100 messages a second.
+  history.Add(MakeSnapshot(1'000'000'000, 100, 0, 0));
+  history.Add(MakeSnapshot(2'000'000'000, 200, 0, 0));
+  history.Add(MakeSnapshot(3'200'000'000, 320, 0, 0));
+  history.Add(MakeSnapshot(4'200'000'000, 420, 0, 0));
+
+  std::optional<CounterRates> rates = history.GetRates(1'000'000'000);
+  ASSERT_TRUE(rates.has_value());
+  EXPECT_DOUBLE_EQ(rates->window_in_seconds, 1);
+  EXPECT_DOUBLE_EQ(rates->messages_per_second, 100);
+
+  rates = history.GetRates(2'000'000'000);
+  ASSERT_TRUE(rates.has_value());
+  EXPECT_DOUBLE_EQ(rates->window_in_seconds, 2.2);
+  EXPECT_DOUBLE_EQ(rates->messages_per_second, 100);
+
+  // Longer windows than the history fall back to its oldest snapshot.
+  rates = history.GetRates(60'000'000'000);
+  ASSERT_TRUE(rates.has_value());
+  EXPECT_DOUBLE_EQ(rates->window_in_seconds, 4.2);
+}
+
+TEST(CounterSetTest, DropsTheOldestSnapshots) {
+  CounterHistory history(2);
+  history.Add(MakeSnapshot(0, 0, 0, 0));
+  history.Add(MakeSnapshot(1'000'000'000, 10, 0, 0));
+  history.Add(MakeSnapshot(2'000'000'000, 30, 0, 0));
+  std::optional<CounterRates> rates = history.GetRates(60'000'000'000);
+  ASSERT_TRUE(rates.has_value());
+  EXPECT_DOUBLE_EQ(rates->window_in_seconds, 1);
+  EXPECT_DOUBLE_EQ(rates->messages_per_second, 20);
+}
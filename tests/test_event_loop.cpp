@@ -0,0 +1,213 @@
+#include "../include/Consumer/AsyncStreamWriter.hpp"
+#include "../include/Networking/EventLoop.hpp"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <gtest/gtest.h>
+#include <string>
+#include <sys/socket.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+// Waits up to a few seconds for the condition to become true.
+template <typename Condition> bool WaitFor(Condition &&condition) {
+  auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+  while (!condition()) {
+    if (std::chrono::steady_clock::now() > deadline) {
+      return false;
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+  return true;
+}
+
+TEST(EventLoopTest, RunsTasksPostedFromOtherThreads) {
+  EventLoop event_loop;
+  ASSERT_TRUE(event_loop.Initialize());
+  std::thread loop_thread(&EventLoop::Run, &event_loop);
+
+  std::atomic<int> number_of_tasks{0};
+  std::vector<std::thread> posters;
+  for (int i = 0; i < 4; ++i) {
+    posters.emplace_back([&]() {
+      for (int j = 0; j < 1000; ++j) {
+        event_loop.Post([&]() { number_of_tasks++; });
+      }
+    });
+  }
+  for (auto &poster : posters) {
+    poster.join();
+  }
+
+  EXPECT_TRUE(WaitFor([&] { return number_of_tasks == 4000; }));
+  event_loop.Stop();
+  loop_thread.join();
+}
+
+TEST(EventLoopTest, RunsPostedTasksOnceAfterBeingStopped) {
+  EventLoop event_loop;
+  ASSERT_TRUE(event_loop.Initialize());
+  event_loop.Stop();
+  event_loop.Run();
+
+  int number_of_tasks = 0;
+  event_loop.Post([&]() { number_of_tasks++; });
+  ASSERT_TRUE(event_loop.RunOnce(0));
+  EXPECT_EQ(number_of_tasks, 1);
+  // Without events, the wait times out.
+  ASSERT_TRUE(event_loop.RunOnce(1));
+  EXPECT_EQ(number_of_tasks, 1);
+}
+
+TEST(EventLoopTest, DispatchesReadinessUntilUnwatched) {
+  int socket_pair[2];
+  ASSERT_EQ(socketpair(AF_UNIX, SOCK_STREAM, 0, socket_pair), 0);
+  ASSERT_TRUE(MakeNonBlocking(socket_pair[0]));
+
+  EventLoop event_loop;
+  ASSERT_TRUE(event_loop.Initialize());
+  std::string received;
+  ASSERT_TRUE(event_loop.Watch(socket_pair[0], EPOLLIN, [&](std::uint32_t) {
+    char buffer[64];
+    ssize_t bytes_read = read(socket_pair[0], buffer, sizeof(buffer));
+    if (bytes_read > 0) {
+      received.append(buffer, bytes_read);
+    }
+    if (received == "ping") {
+      event_loop.Unwatch(socket_pair[0]);
+      event_loop.Stop();
+    }
+  }));
+
+  ASSERT_EQ(write(socket_pair[1], "pi", 2), 2);
+  std::thread writer([&]() {
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    ASSERT_EQ(write(socket_pair[1], "ng", 2), 2);
+  });
+  event_loop.Run();
+  writer.join();
+  EXPECT_EQ(received, "ping");
+
+  close(socket_pair[0]);
+  close(socket_pair[1]);
+}
+
+// Answers number_of_commands commands in order, like Redis answers XADD.
+void AnswerCommands(int file_descriptor, int number_of_commands,
+                    int &max_commands_before_a_reply) {
+  RespReader reader(file_descriptor);
+  int number_of_answered_commands = 0;
+  while (number_of_answered_commands < number_of_commands) {
+    std::string replies;
+    int commands_in_this_read = 0;
+    ASSERT_TRUE(reader.ReadFrames([&](const RespParser &) {
+      std::string id = std::to_string(number_of_answered_commands +
+                                      commands_in_this_read++) +
+                       "-0";
+      replies += "$" + std::to_string(id.size()) + "\r\n" + id + "\r\n";
+    }));
+    max_commands_before_a_reply =
+        std::max(max_commands_before_a_reply, commands_in_this_read);
+    number_of_answered_commands += commands_in_this_read;
+    ASSERT_EQ(write(file_descriptor, replies.data(), replies.size()),
+              static_cast<ssize_t>(replies.size()));
+  }
+}
+
+TEST(AsyncStreamWriterTest, CompletesCommandsFromManyThreadsInOrder) {
+  int socket_pair[2];
+  ASSERT_EQ(socketpair(AF_UNIX, SOCK_STREAM, 0, socket_pair), 0);
+  ASSERT_TRUE(MakeNonBlocking(socket_pair[0]));
+
+  constexpr int kNumberOfSubmitters = 4;
+  constexpr int kCommandsPerSubmitter = 250;
+  constexpr std::size_t kMaxInFlight = 8;
+  int max_commands_before_a_reply = 0;
+  std::thread server(AnswerCommands, socket_pair[1],
+                     kNumberOfSubmitters * kCommandsPerSubmitter,
+                     std::ref(max_commands_before_a_reply));
+
+  EventLoop event_loop;
+  ASSERT_TRUE(event_loop.Initialize());
+  // Only used on the loop thread.
+  std::vector<std::vector<std::uint64_t>> completed_tags(kNumberOfSubmitters);
+  std::atomic<int> number_of_completions{0};
+  AsyncStreamWriter writer(
+      event_loop, socket_pair[0], kMaxInFlight,
+      [&](const StreamWriteResult &result) {
+        EXPECT_TRUE(result.is_success);
+        completed_tags[result.tag / kCommandsPerSubmitter].push_back(
+            result.tag);
+        number_of_completions++;
+      });
+  ASSERT_TRUE(writer.Start());
+  std::thread loop_thread(&EventLoop::Run, &event_loop);
+
+  std::vector<std::thread> submitters;
+  for (int submitter = 0; submitter < kNumberOfSubmitters; ++submitter) {
+    submitters.emplace_back([&writer, submitter]() {
+      for (int i = 0; i < kCommandsPerSubmitter; ++i) {
+        ASSERT_TRUE(writer.Submit("*2\r\n$4\r\nPING\r\n$1\r\nx\r\n",
+                                  submitter * kCommandsPerSubmitter + i));
+      }
+    });
+  }
+  for (auto &submitter : submitters) {
+    submitter.join();
+  }
+
+  EXPECT_TRUE(WaitFor([&] {
+    return number_of_completions == kNumberOfSubmitters * kCommandsPerSubmitter;
+  }));
+  event_loop.Stop();
+  loop_thread.join();
+  server.join();
+
+  // The commands of every submitter were completed in submission order.
+  for (int submitter = 0; submitter < kNumberOfSubmitters; ++submitter) {
+    ASSERT_EQ(completed_tags[submitter].size(), kCommandsPerSubmitter);
+    for (int i = 0; i < kCommandsPerSubmitter; ++i) {
+      EXPECT_EQ(completed_tags[submitter][i],
+                submitter * kCommandsPerSubmitter + i);
+    }
+  }
+  EXPECT_LE(max_commands_before_a_reply, kMaxInFlight);
+  EXPECT_EQ(writer.GetNumberOfInFlightCommands(), 0);
+
+  close(socket_pair[0]);
+  close(socket_pair[1]);
+}
+
+TEST(AsyncStreamWriterTest, FailsEveryCommandOnceTheServerCloses) {
+  int socket_pair[2];
+  ASSERT_EQ(socketpair(AF_UNIX, SOCK_STREAM, 0, socket_pair), 0);
+  ASSERT_TRUE(MakeNonBlocking(socket_pair[0]));
+
+  EventLoop event_loop;
+  ASSERT_TRUE(event_loop.Initialize());
+  std::atomic<int> number_of_failures{0};
+  AsyncStreamWriter writer(event_loop, socket_pair[0], 4,
+                           [&](const StreamWriteResult &result) {
+                             EXPECT_FALSE(result.is_success);
+                             number_of_failures++;
+                           });
+  ASSERT_TRUE(writer.Start());
+  std::thread loop_thread(&EventLoop::Run, &event_loop);
+
+  for (int i = 0; i < 6; ++i) {
+    ASSERT_TRUE(writer.Submit("*1\r\n$4\r\nPING\r\n", i));
+  }
+  close(socket_pair[1]);
+
+  EXPECT_TRUE(WaitFor([&] { return writer.HasFailed(); }));
+  EXPECT_TRUE(WaitFor([&] { return number_of_failures == 6; }));
+  // Commands submitted after the failure are completed right away.
+  EXPECT_FALSE(writer.Submit("*1\r\n$4\r\nPING\r\n", 6));
+  EXPECT_EQ(number_of_failures, 7);
+  EXPECT_EQ(writer.GetNumberOfInFlightCommands(), 0);
+
+  event_loop.Stop();
+  loop_thread.join();
+  close(socket_pair[0]);
+}
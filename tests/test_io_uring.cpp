@@ -0,0 +1,193 @@
+#include "../include/Consumer/IoUringStreamWriter.hpp"
+#include "../include/Networking/IoUringLoop.hpp"
+#include <algorithm>
+#include <gtest/gtest.h>
+#include <string>
+#include <sys/socket.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+// The tests are skipped on kernels without io_uring, where the consumers fall
+// back to blocking sockets.
+
+TEST(IoUringLoopTest, ReceivesAndSendsUntilTheConnectionIsClosed) {
+  int socket_pair[2];
+  ASSERT_EQ(socketpair(AF_UNIX, SOCK_STREAM, 0, socket_pair), 0);
+
+  IoUringLoop io_uring_loop;
+  if (!io_uring_loop.Initialize()) {
+    GTEST_SKIP() << io_uring_loop.GetLastError();
+  }
+  std::string received;
+  bool is_closed = false;
+  if (!io_uring_loop.Receive(socket_pair[0], [&](std::string_view data) {
+        if (data.empty()) {
+          is_closed = true;
+          io_uring_loop.Stop();
+        }
+        received.append(data);
+      })) {
+    GTEST_SKIP() << io_uring_loop.GetLastError();
+  }
+
+  const std::string request = "ping";
+  bool is_sent = false;
+  ASSERT_TRUE(io_uring_loop.Send(
+      socket_pair[0], request, [&](bool is_success) { is_sent = is_success; }));
+
+  std::thread peer([&]() {
+    char buffer[4];
+    ASSERT_EQ(read(socket_pair[1], buffer, sizeof(buffer)), 4);
+    EXPECT_EQ(std::string(buffer, 4), "ping");
+    for (int i = 0; i < 100; ++i) {
+      ASSERT_EQ(write(socket_pair[1], "pong", 4), 4);
+    }
+    close(socket_pair[1]);
+  });
+  ASSERT_TRUE(io_uring_loop.Run());
+  peer.join();
+
+  EXPECT_TRUE(is_sent);
+  EXPECT_TRUE(is_closed);
+  EXPECT_EQ(received.size(), 400);
+  EXPECT_EQ(received.substr(0, 8), "pongpong");
+  close(socket_pair[0]);
+}
+
+TEST(IoUringLoopTest, KeepsReceivingWhenTheBuffersRunOut) {
+  int socket_pair[2];
+  ASSERT_EQ(socketpair(AF_UNIX, SOCK_STREAM, 0, socket_pair), 0);
+
+  // Two buffers of 16 bytes, so the multishot receive runs out of buffers
+  // and has to be armed again.
+  IoUringLoop io_uring_loop;
+  if (!io_uring_loop.Initialize(8, 2, 16)) {
+    GTEST_SKIP() << io_uring_loop.GetLastError();
+  }
+  std::string received;
+  if (!io_uring_loop.Receive(socket_pair[0], [&](std::string_view data) {
+        received.append(data);
+        if (data.empty()) {
+          io_uring_loop.Stop();
+        }
+      })) {
+    GTEST_SKIP() << io_uring_loop.GetLastError();
+  }
+
+  std::string sent;
+  for (int i = 0; i < 1000; ++i) {
+    sent += std::to_string(i) + ",";
+  }
+  ASSERT_EQ(write(socket_pair[1], sent.data(), sent.size()),
+            static_cast<ssize_t>(sent.size()));
+  close(socket_pair[1]);
+  ASSERT_TRUE(io_uring_loop.Run());
+
+  EXPECT_EQ(received, sent);
+  close(socket_pair[0]);
+}
+
+// Answers number_of_commands commands in order, like Redis answers XADD.
+void AnswerCommands(int file_descriptor, int number_of_commands,
+                    int &max_commands_before_a_reply) {
+  RespReader reader(file_descriptor);
+  int number_of_answered_commands = 0;
+  while (number_of_answered_commands < number_of_commands) {
+    std::string replies;
+    int commands_in_this_read = 0;
+    ASSERT_TRUE(reader.ReadFrames([&](const RespParser &) {
+      std::string id = std::to_string(number_of_answered_commands +
+                                      commands_in_this_read++) +
+                       "-0";
+      replies += "$" + std::to_string(id.size()) + "\r\n" + id + "\r\n";
+    }));
+    max_commands_before_a_reply =
+        std::max(max_commands_before_a_reply, commands_in_this_read);
+    number_of_answered_commands += commands_in_this_read;
+    ASSERT_EQ(write(file_descriptor, replies.data(), replies.size()),
+              static_cast<ssize_t>(replies.size()));
+  }
+}
+
+TEST(IoUringStreamWriterTest, CompletesCommandsInOrderWithinTheWindow) {
+  int socket_pair[2];
+  ASSERT_EQ(socketpair(AF_UNIX, SOCK_STREAM, 0, socket_pair), 0);
+
+  IoUringLoop io_uring_loop;
+  if (!io_uring_loop.Initialize()) {
+    GTEST_SKIP() << io_uring_loop.GetLastError();
+  }
+
+  constexpr int kNumberOfCommands = 1000;
+  constexpr std::size_t kMaxInFlight = 8;
+  std::vector<std::uint64_t> completed_tags;
+  std::vector<std::string> completed_ids;
+  IoUringStreamWriter writer(io_uring_loop, socket_pair[0], kMaxInFlight,
+                             [&](const StreamWriteResult &result) {
+                               EXPECT_TRUE(result.is_success);
+                               completed_tags.push_back(result.tag);
+                               completed_ids.emplace_back(result.reply);
+                             });
+  if (!writer.Start()) {
+    GTEST_SKIP() << writer.GetLastError();
+  }
+
+  int max_commands_before_a_reply = 0;
+  std::thread server(AnswerCommands, socket_pair[1], kNumberOfCommands,
+                     std::ref(max_commands_before_a_reply));
+  for (int i = 0; i < kNumberOfCommands; ++i) {
+    ASSERT_TRUE(writer.Submit("*2\r\n$4\r\nPING\r\n$1\r\nx\r\n", i));
+  }
+  ASSERT_TRUE(writer.Flush());
+  while (writer.GetNumberOfInFlightCommands() > 0) {
+    ASSERT_TRUE(io_uring_loop.RunOnce());
+  }
+  server.join();
+
+  ASSERT_EQ(completed_tags.size(), kNumberOfCommands);
+  for (int i = 0; i < kNumberOfCommands; ++i) {
+    EXPECT_EQ(completed_tags[i], i);
+    EXPECT_EQ(completed_ids[i], std::to_string(i) + "-0");
+  }
+  EXPECT_LE(max_commands_before_a_reply, kMaxInFlight);
+  EXPECT_FALSE(writer.HasFailed());
+
+  close(socket_pair[0]);
+  close(socket_pair[1]);
+}
+
+TEST(IoUringStreamWriterTest, FailsEveryCommandOnceTheServerCloses) {
+  int socket_pair[2];
+  ASSERT_EQ(socketpair(AF_UNIX, SOCK_STREAM, 0, socket_pair), 0);
+
+  IoUringLoop io_uring_loop;
+  if (!io_uring_loop.Initialize()) {
+    GTEST_SKIP() << io_uring_loop.GetLastError();
+  }
+  int number_of_failures = 0;
+  IoUringStreamWriter writer(io_uring_loop, socket_pair[0], 4,
+                             [&](const StreamWriteResult &result) {
+                               EXPECT_FALSE(result.is_success);
+                               number_of_failures++;
+                             });
+  if (!writer.Start()) {
+    GTEST_SKIP() << writer.GetLastError();
+  }
+
+  for (int i = 0; i < 4; ++i) {
+    ASSERT_TRUE(writer.Submit("*1\r\n$4\r\nPING\r\n", i));
+  }
+  ASSERT_TRUE(writer.Flush());
+  close(socket_pair[1]);
+  while (!writer.HasFailed()) {
+    ASSERT_TRUE(io_uring_loop.RunOnce());
+  }
+
+  EXPECT_EQ(number_of_failures, 4);
+  EXPECT_EQ(writer.GetNumberOfInFlightCommands(), 0);
+  // Commands submitted after the failure are completed right away.
+  EXPECT_FALSE(writer.Submit("*1\r\n$4\r\nPING\r\n", 4));
+  EXPECT_EQ(number_of_failures, 5);
+  close(socket_pair[0]);
+}
@@ -0,0 +1,286 @@
+#include "../include/Storage/Crc32c.hpp"
+#include "../include/Storage/Journal.hpp"
+#include <cstdlib>
+#include <dirent.h>
+#include <fcntl.h>
+#include <gtest/gtest.h>
+#include <string>
+#include <unistd.h>
+#include <vector>
+
+namespace {
+using namespace std::chrono_literals;
+
+// A new, empty directory for the journal of a test, which is removed with
+// its files at the end of the test.
+class JournalDirectory {
+public:
+  JournalDirectory() {
+    const char *temporary_directory = std::getenv("TMPDIR");
+    std::string path_template =
+        std::string(temporary_directory != nullptr ? temporary_directory
+                                                   : "/tmp") +
+        "/journal_test.XXXXXX";
+    std::vector<char> path(path_template.begin(), path_template.end());
+    path.push_back('\0');
+    if (mkdtemp(path.data()) != nullptr) {
+      path_ = path.data();
+    }
+  }
+
+  ~JournalDirectory() {
+    for (const std::string &name : GetFileNames()) {
+      unlink((path_ + "/" + name).c_str());
+    }
+    rmdir(path_.c_str());
+  }
+
+  const std::string &GetPath() const { return path_; }
+
+  std::vector<std::string> GetFileNames() const {
+    std::vector<std::string> names;
+    if (DIR *directory = opendir(path_.c_str())) {
+      while (const dirent *entry = readdir(directory)) {
+        if (entry->d_name[0] != '.') {
+          names.push_back(entry->d_name);
+        }
+      }
+      closedir(directory);
+    }
+    return names;
+  }
+
+  std::size_t GetNumberOfSegments() const {
+    std::size_t number_of_segments = 0;
+    for (const std::string &name : GetFileNames()) {
+      number_of_segments += name.rfind("journal-", 0) == 0;
+    }
+    return number_of_segments;
+  }
+
+private:
+  std::string path_;
+};
+
+std::string MakeRecord(int number) {
+  return "record " + std::to_string(number) +
+         std::string(static_cast<std::size_t>(number % 50), 'x');
+}
+
+std::vector<std::string> ReplayRecords(Journal &journal) {
+  std::vector<std::string> records;
+  EXPECT_TRUE(journal.ReplayRecoveredRecords(
+      [&records](std::string_view record) { records.emplace_back(record); }))
+      << journal.GetLastError();
+  return records;
+}
+} // namespace
+
+TEST(JournalTest, ComputesTheCrc32cCheckValue) {
+  EXPECT_EQ(Crc32c("123456789", 9), 0xE3069283u);
+  EXPECT_EQ(Crc32c("", 0), 0u);
+  // The checksum can be computed in pieces.
+  EXPECT_EQ(Crc32c("6789", 4, Crc32c("12345", 5)), 0xE3069283u);
+  const std::string long_text(1000, 'a');
+  EXPECT_EQ(Crc32c(long_text.data() + 3, 997, Crc32c(long_text.data(), 3)),
+            Crc32c(long_text.data(), long_text.size()));
+}
+
+TEST(JournalTest, ComputesTheCrc32cOfLongDataWhileCopyingIt) {
+  // Long enough for the interleaved streams of the hardware checksum, and
+  // for the bytes that are left over.
+  std::string text(3 * 256 * 3 + 13, '\0');
+  for (std::size_t i = 0; i < text.size(); ++i) {
+    text[i] = static_cast<char>(i * 131 + i / 7);
+  }
+  // The checksum a bit at a time.
+  std::uint32_t expected_crc = 0xFFFFFFFF;
+  for (char character : text) {
+    expected_crc ^= static_cast<unsigned char>(character);
+    for (int bit = 0; bit < 8; ++bit) {
+      expected_crc =
+          (expected_crc >> 1) ^ ((expected_crc & 1) ? 0x82F63B78 : 0);
+    }
+  }
+  expected_crc = ~expected_crc;
+  EXPECT_EQ(Crc32c(text.data(), text.size()), expected_crc);
+
+  std::string copy(text.size(), '\0');
+  EXPECT_EQ(Crc32cCopy(copy.data() + 5, text.data() + 5, text.size() - 5,
+                       Crc32c(text.data(), 5)),
+            expected_crc);
+  EXPECT_EQ(copy.substr(5), text.substr(5));
+}
+
+TEST(JournalTest, RecoversTheRecordsThatWereNotCompleted) {
+  JournalDirectory directory;
+  ASSERT_FALSE(directory.GetPath().empty());
+  {
+    Journal journal(directory.GetPath(), 4096, 1000ms, 1000);
+    ASSERT_TRUE(journal.Open()) << journal.GetLastError();
+    EXPECT_EQ(journal.GetNumberOfRecoveredRecords(), 0u);
+    for (int i = 0; i < 200; ++i) {
+      const std::uint64_t sequence = journal.Append({"h:", MakeRecord(i)});
+      ASSERT_EQ(sequence, static_cast<std::uint64_t>(i + 1));
+      // Every record but every tenth one is complete.
+      if (i % 10 != 0) {
+        journal.Complete(sequence);
+      }
+    }
+    EXPECT_GT(directory.GetNumberOfSegments(), 1u);
+  }
+
+  Journal journal(directory.GetPath(), 4096, 1000ms, 1000);
+  ASSERT_TRUE(journal.Open()) << journal.GetLastError();
+  // The records from the first incomplete one on are recovered, including
+  // the complete ones in between.
+  EXPECT_EQ(journal.GetNumberOfRecoveredRecords(), 200u);
+  std::vector<std::string> records = ReplayRecords(journal);
+  ASSERT_EQ(records.size(), 200u);
+  for (int i = 0; i < 200; ++i) {
+    EXPECT_EQ(records[i], "h:" + MakeRecord(i));
+  }
+  // The records of this run follow the recovered ones.
+  EXPECT_EQ(journal.Append({"new"}), 201u);
+}
+
+TEST(JournalTest, DoesNotRecoverTheRecordsBelowTheCheckpoint) {
+  JournalDirectory directory;
+  ASSERT_FALSE(directory.GetPath().empty());
+  {
+    Journal journal(directory.GetPath(), 4096, 1000ms, 1000);
+    ASSERT_TRUE(journal.Open()) << journal.GetLastError();
+    for (int i = 0; i < 300; ++i) {
+      const std::uint64_t sequence = journal.Append({MakeRecord(i)});
+      if (i < 250) {
+        journal.Complete(sequence);
+      }
+    }
+    journal.Commit();
+    EXPECT_EQ(journal.GetNumberOfPendingRecords(), 50);
+    EXPECT_GE(journal.GetNumberOfCommits(), 1);
+  }
+
+  Journal journal(directory.GetPath(), 4096, 1000ms, 1000);
+  ASSERT_TRUE(journal.Open()) << journal.GetLastError();
+  std::vector<std::string> records = ReplayRecords(journal);
+  ASSERT_EQ(records.size(), 50u);
+  EXPECT_EQ(records.front(), MakeRecord(250));
+  EXPECT_EQ(records.back(), MakeRecord(299));
+}
+
+TEST(JournalTest, DeletesTheSegmentsOfCompleteRecords) {
+  JournalDirectory directory;
+  ASSERT_FALSE(directory.GetPath().empty());
+  Journal journal(directory.GetPath(), 4096, 1000ms, 1000);
+  ASSERT_TRUE(journal.Open()) << journal.GetLastError();
+  std::vector<std::uint64_t> sequences;
+  for (int i = 0; i < 500; ++i) {
+    sequences.push_back(journal.Append({MakeRecord(i)}));
+  }
+  // Complete records out of order: the low-water mark stops at the first
+  // incomplete one.
+  for (std::size_t i = 1; i < sequences.size(); ++i) {
+    journal.Complete(sequences[i]);
+  }
+  journal.Commit();
+  EXPECT_EQ(journal.GetNumberOfPendingRecords(), 500);
+  EXPECT_GT(directory.GetNumberOfSegments(), 3u);
+
+  journal.Complete(sequences[0]);
+  journal.Commit();
+  EXPECT_EQ(journal.GetNumberOfPendingRecords(), 0);
+  // Only the segment that is still written to is left, and the one that the
+  // committer may have prepared for the records that follow.
+  EXPECT_GE(directory.GetNumberOfSegments(), 1u);
+  EXPECT_LE(directory.GetNumberOfSegments(), 2u);
+}
+
+TEST(JournalTest, StopsRecoveringAtATornOrCorruptRecord) {
+  JournalDirectory directory;
+  ASSERT_FALSE(directory.GetPath().empty());
+  {
+    Journal journal(directory.GetPath(), 1 << 20, 1000ms, 1000);
+    ASSERT_TRUE(journal.Open()) << journal.GetLastError();
+    for (int i = 0; i < 10; ++i) {
+      ASSERT_NE(journal.Append({MakeRecord(i)}), 0u);
+    }
+  }
+  std::string segment_path;
+  for (const std::string &name : directory.GetFileNames()) {
+    if (name.rfind("journal-", 0) == 0) {
+      segment_path = directory.GetPath() + "/" + name;
+    }
+  }
+  ASSERT_FALSE(segment_path.empty());
+
+  // Flips a byte in the payload of the sixth record, as a crash in the
+  // middle of writing it back would leave it.
+  std::size_t offset = 0;
+  for (int i = 0; i < 5; ++i) {
+    offset += 16 + MakeRecord(i).size();
+  }
+  const int file_descriptor = open(segment_path.c_str(), O_RDWR);
+  ASSERT_GE(file_descriptor, 0);
+  char byte;
+  ASSERT_EQ(pread(file_descriptor, &byte, 1, offset + 16), 1);
+  byte ^= 0x20;
+  ASSERT_EQ(pwrite(file_descriptor, &byte, 1, offset + 16), 1);
+  close(file_descriptor);
+
+  Journal journal(directory.GetPath(), 1 << 20, 1000ms, 1000);
+  ASSERT_TRUE(journal.Open()) << journal.GetLastError();
+  std::vector<std::string> records = ReplayRecords(journal);
+  ASSERT_EQ(records.size(), 5u);
+  for (int i = 0; i < 5; ++i) {
+    EXPECT_EQ(records[i], MakeRecord(i));
+  }
+}
+
+TEST(JournalTest, DiscardsTheReplayedRecords) {
+  JournalDirectory directory;
+  ASSERT_FALSE(directory.GetPath().empty());
+  {
+    Journal journal(directory.GetPath(), 4096, 1000ms, 1000);
+    ASSERT_TRUE(journal.Open()) << journal.GetLastError();
+    for (int i = 0; i < 100; ++i) {
+      ASSERT_NE(journal.Append({MakeRecord(i)}), 0u);
+    }
+  }
+  {
+    Journal journal(directory.GetPath(), 4096, 1000ms, 1000);
+    ASSERT_TRUE(journal.Open()) << journal.GetLastError();
+    ASSERT_EQ(journal.GetNumberOfRecoveredRecords(), 100u);
+    // The replayed records are appended again, and the first half of them
+    // is complete before the restart.
+    for (const std::string &record : ReplayRecords(journal)) {
+      const std::uint64_t sequence = journal.Append({record});
+      if (sequence <= 150) {
+        journal.Complete(sequence);
+      }
+    }
+    journal.DiscardRecoveredRecords();
+    EXPECT_EQ(journal.GetNumberOfRecoveredRecords(), 0u);
+  }
+
+  Journal journal(directory.GetPath(), 4096, 1000ms, 1000);
+  ASSERT_TRUE(journal.Open()) << journal.GetLastError();
+  std::vector<std::string> records = ReplayRecords(journal);
+  ASSERT_EQ(records.size(), 50u);
+  EXPECT_EQ(records.front(), MakeRecord(50));
+}
+
+TEST(JournalTest, CommitsInTheBackgroundAfterEnoughRecords) {
+  JournalDirectory directory;
+  ASSERT_FALSE(directory.GetPath().empty());
+  Journal journal(directory.GetPath(), 1 << 20, 60000ms, 10);
+  ASSERT_TRUE(journal.Open()) << journal.GetLastError();
+  for (int i = 0; i < 10; ++i) {
+    journal.Complete(journal.Append({MakeRecord(i)}));
+  }
+  for (int i = 0; i < 1000 && journal.GetNumberOfPendingRecords() > 0; ++i) {
+    usleep(1000);
+  }
+  EXPECT_EQ(journal.GetNumberOfPendingRecords(), 0);
+  EXPECT_GE(journal.GetNumberOfCommits(), 1);
+}
@@ -30,3 +30,20 @@ TEST(JsonMessageProcessorTest, EmptyMessageId_StillReturnsMessage) {
   ASSERT_TRUE(result.has_value());
   EXPECT_EQ(result->message_id.size(), 0);
 }
+
+TEST(JsonMessageProcessorTest, InPlace_SetsThePublishTimeInTheSamePass) {
+  JsonMessageProcessorImpl processor;
+  std::string json =
+      R"({"publish_time_ns": 1700000000000000500, "message_id": "12345"})";
+  MessageView message{};
+  std::string storage;
+
+  ASSERT_TRUE(processor.ProcessMessageInPlace(json, message, storage));
+  EXPECT_EQ(message.message_id, "12345");
+  EXPECT_EQ(message.publish_time, "1700000000000000500");
+
+  message = MessageView{};
+  ASSERT_TRUE(processor.ProcessMessageInPlace(R"({"message_id": "1"})",
+                                              message, storage));
+  EXPECT_TRUE(message.publish_time.empty());
+}
@@ -0,0 +1,113 @@
+#include "../include/Parsing/JsonScanner.hpp"
+#include <gtest/gtest.h>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace {
+std::vector<JsonScannerKernel> GetSupportedKernels() {
+  std::vector<JsonScannerKernel> kernels;
+  for (JsonScannerKernel kernel :
+       {JsonScannerKernel::Scalar, JsonScannerKernel::Sse42,
+        JsonScannerKernel::Avx2}) {
+    if (IsJsonScannerKernelSupported(kernel)) {
+      kernels.push_back(kernel);
+    }
+  }
+  return kernels;
+}
+} // namespace
+
+TEST(JsonScannerTest, EveryKernelClassifiesLikeTheScalarOne) {
+  const JsonScanner scalar_scanner(JsonScannerKernel::Scalar);
+  std::mt19937 random_generator(7);
+  const std::string alphabet = "{}[]:,\"\\ ab01\n\x7f\x80\xfb\xdd";
+  std::uniform_int_distribution<std::size_t> distribution(
+      0, alphabet.size() - 1);
+
+  for (JsonScannerKernel kernel : GetSupportedKernels()) {
+    const JsonScanner scanner(kernel);
+    EXPECT_EQ(scanner.GetKernel(), kernel);
+    for (int i = 0; i < 1000; ++i) {
+      char block[64];
+      for (char &character : block) {
+        character = alphabet[distribution(random_generator)];
+      }
+      const JsonBlockMasks expected = scalar_scanner.ClassifyBlock(block);
+      const JsonBlockMasks masks = scanner.ClassifyBlock(block);
+      ASSERT_EQ(masks.quotes, expected.quotes)
+          << GetJsonScannerKernelName(kernel);
+      ASSERT_EQ(masks.backslashes, expected.backslashes);
+      ASSERT_EQ(masks.structurals, expected.structurals);
+    }
+  }
+}
+
+TEST(JsonScannerTest, ExtractsSeveralFieldsInASinglePass) {
+  const std::string json =
+      R"({"user": "a\"b", "nested": {"message_id": "inner", "list": [1, "]"]},)"
+      R"( "text": "message_id, }", "count" : 7 , "message_id": "outer"})";
+  const std::string_view field_names[] = {"message_id", "count", "user",
+                                          "nested", "missing"};
+  std::optional<std::string_view> values[5];
+
+  for (JsonScannerKernel kernel : GetSupportedKernels()) {
+    const JsonScanner scanner(kernel);
+    ASSERT_TRUE(scanner.ExtractFields(json, field_names, values, 5));
+    EXPECT_EQ(values[0], "outer");
+    EXPECT_EQ(values[1], "7");
+    EXPECT_EQ(values[2], R"(a\"b)");
+    EXPECT_EQ(values[3], R"({"message_id": "inner", "list": [1, "]"]})");
+    EXPECT_FALSE(values[4].has_value());
+  }
+}
+
+TEST(JsonScannerTest, HandlesStringsAndEscapesAcrossBlocks) {
+  // Moves the fields over the block boundaries, with runs of backslashes
+  // that escape, or do not escape, the following quote.
+  for (JsonScannerKernel kernel : GetSupportedKernels()) {
+    const JsonScanner scanner(kernel);
+    for (std::size_t padding = 0; padding < 140; ++padding) {
+      const std::string json = R"({"pad": ")" + std::string(padding, 'x') +
+                               R"(\\", "escaped": "\"\\\"{,", )"
+                               R"("message_id": "id-)" +
+                               std::to_string(padding) + R"("})";
+      const std::string expected_id = "id-" + std::to_string(padding);
+      EXPECT_EQ(scanner.ExtractField(json, "message_id"), expected_id)
+          << GetJsonScannerKernelName(kernel) << " " << padding;
+      EXPECT_EQ(scanner.ExtractField(json, "escaped"), R"(\"\\\"{,)");
+    }
+  }
+}
+
+TEST(JsonScannerTest, SkipsLargeNestedValues) {
+  std::string json = R"({"items": [)";
+  for (int i = 0; i < 2000; ++i) {
+    json += R"({"message_id": ")" + std::to_string(i) + R"(", "tags": ["a"]},)";
+  }
+  json += R"({}], "message_id": "last"})";
+  ASSERT_GT(json.size(), 64u * 1024);
+
+  for (JsonScannerKernel kernel : GetSupportedKernels()) {
+    EXPECT_EQ(JsonScanner(kernel).ExtractField(json, "message_id"), "last");
+  }
+}
+
+TEST(JsonScannerTest, RejectsMalformedJson) {
+  for (JsonScannerKernel kernel : GetSupportedKernels()) {
+    const JsonScanner scanner(kernel);
+    for (std::string_view json :
+         {"", "  ", "[1, 2]", R"({"message_id": "unterminated)",
+          R"({"a" 1, "message_id": "1"})", R"({"message_id": })",
+          R"({"message_id" x: "1"})", R"({"a": 1 "message_id": "1"})",
+          R"({"a": [1}, "message_id": "1"})", R"({"message_id": "1")"}) {
+      EXPECT_FALSE(scanner.ExtractField(json, "message_id").has_value())
+          << json;
+    }
+    // The scan stops at the requested field.
+    EXPECT_EQ(scanner.ExtractField(R"( {"message_id": 12} trailing)",
+                                   "message_id"),
+              "12");
+    EXPECT_TRUE(scanner.ExtractField("{}", "message_id") == std::nullopt);
+  }
+}
@@ -0,0 +1,115 @@
+#include "../include/Consumer/ConsumerStatistics.hpp"
+#include "../include/Monitoring/LatencyHistogram.hpp"
+#include <cstdint>
+#include <gtest/gtest.h>
+#include <limits>
+#include <thread>
+
+TEST(LatencyHistogramTest, CountsSmallValuesExactly) {
+  for (std::uint64_t value = 0; value < 2 * LatencySnapshot::kSubBucketCount;
+       ++value) {
+    EXPECT_EQ(LatencySnapshot::GetBucketUpperBound(
+                  LatencySnapshot::GetBucketIndex(value)),
+              value);
+  }
+}
+
+TEST(LatencyHistogramTest, BoundsTheRelativeErrorOfLargeValues) {
+  for (std::uint64_t value = 64; value < (std::uint64_t{1} << 36);
+       value = value * 3 / 2 + 7) {
+    std::size_t index = LatencySnapshot::GetBucketIndex(value);
+    ASSERT_LT(index, LatencySnapshot::kNumberOfBuckets);
+    std::uint64_t upper_bound = LatencySnapshot::GetBucketUpperBound(index);
+    EXPECT_GE(upper_bound, value);
+    EXPECT_LE(upper_bound - value, value / LatencySnapshot::kSubBucketCount);
+    // The buckets are contiguous.
+    EXPECT_EQ(LatencySnapshot::GetBucketIndex(upper_bound), index);
+    EXPECT_EQ(LatencySnapshot::GetBucketIndex(upper_bound + 1), index + 1);
+  }
+}
+
+TEST(LatencyHistogramTest, ClampsNegativeAndHugeValues) {
+  LatencyHistogram histogram;
+  histogram.Record(-5);
+  histogram.Record(std::numeric_limits<long long>::max());
+  LatencySnapshot snapshot = histogram.GetSnapshot();
+  EXPECT_EQ(snapshot.GetTotalCount(), 2u);
+  EXPECT_EQ(snapshot.GetValueAtPercentile(50), 0u);
+  EXPECT_EQ(snapshot.GetMaximum(),
+            (std::uint64_t{1} << LatencySnapshot::kMaximumValueBits) - 1);
+}
+
+TEST(LatencyHistogramTest, ComputesPercentiles) {
+  LatencyHistogram histogram;
+  for (long long value = 1; value <= 1000; ++value) {
+    histogram.Record(value * 1000);
+  }
+  LatencySnapshot snapshot = histogram.GetSnapshot();
+  EXPECT_EQ(snapshot.GetTotalCount(), 1000u);
+  auto expect_near = [](std::uint64_t actual, std::uint64_t expected) {
+    EXPECT_GE(actual, expected);
+    EXPECT_LE(actual, expected + expected / LatencySnapshot::kSubBucketCount);
+  };
+  expect_near(snapshot.GetValueAtPercentile(50), 500000);
+  expect_near(snapshot.GetValueAtPercentile(90), 900000);
+  expect_near(snapshot.GetValueAtPercentile(99), 990000);
+  expect_near(snapshot.GetValueAtPercentile(99.9), 999000);
+  expect_near(snapshot.GetMaximum(), 1000000);
+}
+
+TEST(LatencyHistogramTest, EmptySnapshotsHaveNoValues) {
+  LatencySnapshot snapshot;
+  EXPECT_EQ(snapshot.GetTotalCount(), 0u);
+  EXPECT_EQ(snapshot.GetValueAtPercentile(99), 0u);
+  EXPECT_EQ(snapshot.GetMaximum(), 0u);
+  snapshot.Merge(LatencySnapshot{});
+  EXPECT_EQ(snapshot.Since(LatencySnapshot{}).GetTotalCount(), 0u);
+}
+
+TEST(LatencyHistogramTest, MergesAndSubtractsSnapshots) {
+  LatencyHistogram first_histogram;
+  LatencyHistogram second_histogram;
+  first_histogram.Record(100);
+  LatencySnapshot earlier = first_histogram.GetSnapshot();
+  first_histogram.Record(200);
+  second_histogram.Record(300000);
+
+  LatencySnapshot merged;
+  merged.Merge(first_histogram.GetSnapshot());
+  merged.Merge(second_histogram.GetSnapshot());
+  EXPECT_EQ(merged.GetTotalCount(), 3u);
+
+  LatencySnapshot since = merged.Since(earlier);
+  EXPECT_EQ(since.GetTotalCount(), 2u);
+  EXPECT_EQ(since.GetValueAtPercentile(50),
+            LatencySnapshot::GetBucketUpperBound(
+                LatencySnapshot::GetBucketIndex(200)));
+}
+
+TEST(LatencyHistogramTest, MergesTheStagesOfLatencyStatistics) {
+  LatencyHistogram histogram;
+  histogram.Record(1000);
+  LatencyStatistics total{};
+  total.Merge({{}, {}, histogram.GetSnapshot(), {}});
+  total.Merge({{}, {}, histogram.GetSnapshot(), histogram.GetSnapshot()});
+  EXPECT_EQ(total.publish_to_receive.GetTotalCount(), 0u);
+  EXPECT_EQ(total.processing.GetTotalCount(), 2u);
+  EXPECT_EQ(total.stream_write_round_trip.GetTotalCount(), 1u);
+}
+
+TEST(LatencyHistogramTest, CanBeReadWhileItIsRecorded) {
+  LatencyHistogram histogram;
+  constexpr long long kNumberOfValues = 1000000;
+  std::thread recorder([&histogram] {
+    for (long long value = 0; value < kNumberOfValues; ++value) {
+      histogram.Record(value % 5000);
+    }
+  });
+  for (int i = 0; i < 100; ++i) {
+    EXPECT_LE(histogram.GetSnapshot().GetTotalCount(),
+              static_cast<std::uint64_t>(kNumberOfValues));
+  }
+  recorder.join();
+  EXPECT_EQ(histogram.GetSnapshot().GetTotalCount(),
+            static_cast<std::uint64_t>(kNumberOfValues));
+}
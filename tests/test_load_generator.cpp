@@ -0,0 +1,83 @@
+#include "../include/Parsing/JsonFieldExtractor.hpp"
+#include "../include/Publisher/LoadGenerator.hpp"
+#include <gtest/gtest.h>
+#include <string>
+
+TEST(LoadGeneratorTest, FormatsMessagesThatTheConsumersCanParse) {
+  const LoadMessageId id{1234, 42, 1700000000000000000, 1700000000000000500};
+  std::string payload;
+  FormatLoadMessage(payload, id, 300);
+  EXPECT_EQ(payload.size(), 300u);
+
+  auto message_id = ExtractJsonField(payload, "message_id");
+  ASSERT_TRUE(message_id.has_value());
+  EXPECT_EQ(*message_id, "1234-42-1700000000000000000-1700000000000000500");
+  auto publish_time = ExtractJsonField(payload, "publish_time_ns");
+  ASSERT_TRUE(publish_time.has_value());
+  EXPECT_EQ(*publish_time, "1700000000000000500");
+  auto sequence = ExtractJsonField(payload, "sequence");
+  ASSERT_TRUE(sequence.has_value());
+  EXPECT_EQ(*sequence, "42");
+
+  // A payload is never cut short to fit the size.
+  FormatLoadMessage(payload, id, 10);
+  EXPECT_GT(payload.size(), 10u);
+  EXPECT_EQ(payload.back(), '}');
+  EXPECT_TRUE(ExtractJsonField(payload, "padding").has_value());
+}
+
+TEST(LoadGeneratorTest, ParsesTheMessageIdsThatItAppended) {
+  std::string message_id;
+  AppendLoadMessageId(message_id, {7, 123456, 1000, 2500});
+  LoadMessageId id{};
+  ASSERT_TRUE(ParseLoadMessageId(message_id, id));
+  EXPECT_EQ(id.run_id, 7u);
+  EXPECT_EQ(id.sequence, 123456u);
+  EXPECT_EQ(id.intended_publish_time_ns, 1000);
+  EXPECT_EQ(id.publish_time_ns, 2500);
+
+  // The message_ids of other publishers are skipped.
+  EXPECT_FALSE(ParseLoadMessageId("", id));
+  EXPECT_FALSE(ParseLoadMessageId("d7c1a0a4-5f2e-4f5b-8c43-2f1e9b0c3a77", id));
+  EXPECT_FALSE(ParseLoadMessageId("7-123456-1000", id));
+  EXPECT_FALSE(ParseLoadMessageId("7-123456-1000-2500x", id));
+  EXPECT_FALSE(ParseLoadMessageId("7-123456-1000-2500-1", id));
+}
+
+TEST(LoadGeneratorTest, SchedulesTheMessagesAtTheRate) {
+  EXPECT_EQ(GetIntendedPublishOffset(1000, 1), 0);
+  EXPECT_EQ(GetIntendedPublishOffset(1000, 2), 1'000'000);
+  EXPECT_EQ(GetIntendedPublishOffset(1000, 1001), 1'000'000'000);
+  EXPECT_EQ(GetIntendedPublishOffset(3, 2), 333'333'333);
+
+  EXPECT_EQ(GetNumberOfDueMessages(1000, -1), 0u);
+  EXPECT_EQ(GetNumberOfDueMessages(1000, 0), 1u);
+  EXPECT_EQ(GetNumberOfDueMessages(1000, 999'999), 1u);
+  EXPECT_EQ(GetNumberOfDueMessages(1000, 1'000'000), 2u);
+  // A message is due from its scheduled time on.
+  for (std::uint64_t sequence = 1; sequence < 10000; sequence += 7) {
+    const std::int64_t offset = GetIntendedPublishOffset(250000, sequence);
+    EXPECT_EQ(GetNumberOfDueMessages(250000, offset), sequence);
+  }
+}
+
+TEST(LoadGeneratorTest, FindsTheGapsDuplicatesAndReorderedMessages) {
+  SequenceTracker tracker;
+  for (std::uint64_t sequence : {1, 2, 3, 6, 5, 9, 10, 200}) {
+    EXPECT_TRUE(tracker.Record(sequence));
+  }
+  EXPECT_FALSE(tracker.Record(6));
+  EXPECT_EQ(tracker.GetNumberOfReceived(), 8);
+  EXPECT_EQ(tracker.GetNumberOfDuplicates(), 1);
+  EXPECT_EQ(tracker.GetNumberOfReordered(), 1);
+
+  const std::vector<SequenceGap> gaps = tracker.GetGaps(12);
+  ASSERT_EQ(gaps.size(), 3u);
+  EXPECT_EQ(gaps[0].first, 4u);
+  EXPECT_EQ(gaps[0].last, 4u);
+  EXPECT_EQ(gaps[1].first, 7u);
+  EXPECT_EQ(gaps[1].last, 8u);
+  EXPECT_EQ(gaps[2].first, 11u);
+  EXPECT_EQ(gaps[2].last, 12u);
+  EXPECT_TRUE(tracker.GetGaps(3).empty());
+}
@@ -0,0 +1,183 @@
+#include "../include/Logging/Logger.hpp"
+#include <chrono>
+#include <gtest/gtest.h>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+// Collects the formatted records of a logger, and the threads that formatted
+// them.
+class RecordingSink {
+public:
+  LogSink GetSink() {
+    return [this](LogLevel level, std::string_view text) {
+      std::lock_guard<std::mutex> lock(mutex_);
+      levels_.push_back(level);
+      texts_.emplace_back(text);
+      thread_ids_.push_back(std::this_thread::get_id());
+    };
+  }
+
+  std::vector<std::string> GetTexts() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return texts_;
+  }
+
+  std::vector<LogLevel> GetLevels() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return levels_;
+  }
+
+  std::vector<std::thread::id> GetThreadIds() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return thread_ids_;
+  }
+
+private:
+  std::mutex mutex_;
+  std::vector<LogLevel> levels_;
+  std::vector<std::string> texts_;
+  std::vector<std::thread::id> thread_ids_;
+};
+} // namespace
+
+TEST(LoggerTest, FormatsTheRecordsOnTheBackgroundThread) {
+  RecordingSink sink;
+  Logger logger(sink.GetSink());
+  const std::string worker = "Broker Worker 2";
+  logger.Log(LogLevel::Info, "[{}] Processed {} messages, {} unacknowledged",
+             worker, 42, -7LL);
+  logger.Log(LogLevel::Error, "{} {} {} {}", 'c', std::string_view("view"),
+             0.5, 18446744073709551615ULL);
+  logger.Log(LogLevel::Warning, "No arguments {}");
+  logger.Log(LogLevel::Info, "Extra argument:", 1);
+  logger.Write(LogLevel::Info, "Without a line break", false);
+
+  // The records are formatted by the background thread without a flush.
+  auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+  while (sink.GetTexts().size() < 5 &&
+         std::chrono::steady_clock::now() < deadline) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+  EXPECT_EQ(sink.GetTexts(),
+            (std::vector<std::string>{
+                "[Broker Worker 2] Processed 42 messages, -7 unacknowledged\n",
+                "c view 0.5 18446744073709551615\n", "No arguments {}\n",
+                "Extra argument:\n", "Without a line break"}));
+  EXPECT_EQ(sink.GetLevels(),
+            (std::vector<LogLevel>{LogLevel::Info, LogLevel::Error,
+                                   LogLevel::Warning, LogLevel::Info,
+                                   LogLevel::Info}));
+  for (std::thread::id thread_id : sink.GetThreadIds()) {
+    EXPECT_NE(thread_id, std::this_thread::get_id());
+  }
+}
+
+TEST(LoggerTest, FiltersRecordsBelowTheMinimumLevel) {
+  RecordingSink sink;
+  Logger logger(sink.GetSink());
+  EXPECT_FALSE(logger.IsEnabled(LogLevel::Debug));
+  logger.Log(LogLevel::Debug, "hidden");
+  logger.SetMinimumLevel(LogLevel::Debug);
+  logger.Log(LogLevel::Debug, "shown");
+  logger.SetMinimumLevel(LogLevel::Error);
+  logger.Log(LogLevel::Warning, "hidden");
+  logger.Log(LogLevel::Error, "shown");
+  logger.Flush();
+  EXPECT_EQ(sink.GetTexts(), (std::vector<std::string>{"shown\n", "shown\n"}));
+}
+
+TEST(LoggerTest, KeepsTextsThatDoNotFitIntoARecord) {
+  RecordingSink sink;
+  Logger logger(sink.GetSink());
+  const std::string long_text(3 * LogRecord::kInlineTextCapacity, 'x');
+  logger.Log(LogLevel::Error, "{}|{}", long_text, "end");
+  logger.Flush();
+  EXPECT_EQ(sink.GetTexts(),
+            (std::vector<std::string>{long_text + "|end\n"}));
+}
+
+TEST(LoggerTest, KeepsTheOrderOfTheRecordsOfEveryThread) {
+  constexpr int kNumberOfThreads = 4;
+  constexpr int kRecordsPerThread = 200;
+  RecordingSink sink;
+  Logger logger(sink.GetSink());
+  std::vector<std::thread> threads;
+  for (int thread = 0; thread < kNumberOfThreads; ++thread) {
+    threads.emplace_back([&logger, thread] {
+      for (int record = 0; record < kRecordsPerThread; ++record) {
+        logger.Log(LogLevel::Info, "{} {}", thread, record);
+      }
+    });
+  }
+  for (std::thread &thread : threads) {
+    thread.join();
+  }
+  logger.Flush();
+
+  const std::vector<std::string> texts = sink.GetTexts();
+  ASSERT_EQ(texts.size(), kNumberOfThreads * kRecordsPerThread);
+  std::vector<int> next_records(kNumberOfThreads, 0);
+  for (const std::string &text : texts) {
+    const int thread = std::stoi(text);
+    const int record = std::stoi(text.substr(text.find(' ') + 1));
+    EXPECT_EQ(record, next_records[thread]++);
+  }
+  EXPECT_EQ(logger.GetNumberOfDroppedRecords(), 0);
+}
+
+TEST(LoggerTest, DropsRecordsInsteadOfWaitingForAFullBuffer) {
+  RecordingSink sink;
+  // The background thread does not drain the buffer before the flush.
+  Logger logger(sink.GetSink(), 4, std::chrono::hours(1));
+  std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  for (int record = 0; record < 10; ++record) {
+    logger.Log(LogLevel::Info, "{}", record);
+  }
+  EXPECT_EQ(logger.GetNumberOfDroppedRecords(), 6);
+  logger.Flush();
+  EXPECT_EQ(sink.GetTexts(),
+            (std::vector<std::string>{
+                "0\n", "1\n", "2\n", "3\n",
+                "[Logger] 6 log records were dropped because a buffer was "
+                "full\n"}));
+}
+
+TEST(LogRateLimiterTest, SamplesUpToTheRecordsPerSecond) {
+  LogRateLimiter rate_limiter(3);
+  long long number_of_suppressed_records = -1;
+  for (int record = 0; record < 3; ++record) {
+    EXPECT_TRUE(rate_limiter.TryAcquire(100, number_of_suppressed_records));
+    EXPECT_EQ(number_of_suppressed_records, 0);
+  }
+  for (int record = 0; record < 7; ++record) {
+    EXPECT_FALSE(rate_limiter.TryAcquire(100, number_of_suppressed_records));
+  }
+  EXPECT_TRUE(rate_limiter.TryAcquire(101, number_of_suppressed_records));
+  EXPECT_EQ(number_of_suppressed_records, 7);
+  EXPECT_TRUE(rate_limiter.TryAcquire(101, number_of_suppressed_records));
+  EXPECT_EQ(number_of_suppressed_records, 0);
+}
+
+TEST(LogRateLimiterTest, ReportsTheSuppressedRecordsWithTheNextSample) {
+  RecordingSink sink;
+  Logger logger(sink.GetSink());
+  logger.SetMinimumLevel(LogLevel::Debug);
+  LogRateLimiter rate_limiter(1);
+  for (long long second = 0; second < 2; ++second) {
+    for (int record = 0; record < 5; ++record) {
+      long long number_of_suppressed_records = 0;
+      if (rate_limiter.TryAcquire(second, number_of_suppressed_records)) {
+        logger.LogSampled(LogLevel::Debug, number_of_suppressed_records,
+                          "Message {}", record);
+      }
+    }
+  }
+  logger.Flush();
+  EXPECT_EQ(sink.GetTexts(),
+            (std::vector<std::string>{
+                "Message 0\n",
+                "Message 0 (4 similar records were suppressed)\n"}));
+}
@@ -0,0 +1,64 @@
+#include "../include/Consumer/ConsumerGroups/MessageRouter.hpp"
+#include "../include/Parsing/JsonFieldExtractor.hpp"
+#include <gtest/gtest.h>
+#include <set>
+#include <string>
+
+TEST(JsonFieldExtractorTest, ExtractsStringsAndScalars) {
+  std::string json =
+      R"({"message_id": "42", "count":7 , "ok": true, "user":"a\"b"})";
+
+  EXPECT_EQ(ExtractJsonField(json, "message_id"), "42");
+  EXPECT_EQ(ExtractJsonField(json, "count"), "7");
+  EXPECT_EQ(ExtractJsonField(json, "ok"), "true");
+  EXPECT_EQ(ExtractJsonField(json, "user"), R"(a\"b)");
+  EXPECT_FALSE(ExtractJsonField(json, "missing").has_value());
+}
+
+TEST(JsonFieldExtractorTest, OnlyMatchesTopLevelFields) {
+  std::string json = R"({"nested": {"message_id": "inner", "list": [1, "]"]},)"
+                     R"( "text": "message_id", "message_id": "outer"})";
+
+  EXPECT_EQ(ExtractJsonField(json, "message_id"), "outer");
+  EXPECT_EQ(ExtractJsonField(json, "nested"),
+            R"({"message_id": "inner", "list": [1, "]"]})");
+}
+
+TEST(JsonFieldExtractorTest, RejectsMalformedJson) {
+  EXPECT_FALSE(ExtractJsonField("", "message_id").has_value());
+  EXPECT_FALSE(ExtractJsonField("[1, 2]", "message_id").has_value());
+  EXPECT_FALSE(
+      ExtractJsonField(R"({"message_id": "unterminated)", "message_id")
+          .has_value());
+  EXPECT_FALSE(
+      ExtractJsonField(R"({"a" 1, "message_id": "1"})", "message_id")
+          .has_value());
+}
+
+TEST(MessageRouterTest, AssignsTheSameKeyToTheSameWorker) {
+  constexpr std::size_t kNumberOfWorkers = 4;
+  MessageRouter router("user", kNumberOfWorkers);
+
+  std::set<std::size_t> used_workers;
+  for (int user = 0; user < 100; ++user) {
+    std::string key = std::to_string(user);
+    std::size_t worker = router.SelectWorker(R"({"user": ")" + key +
+                                             R"(", "message_id": "1"})");
+    ASSERT_LT(worker, kNumberOfWorkers);
+    used_workers.insert(worker);
+    // A different message with the same key goes to the same worker.
+    EXPECT_EQ(router.SelectWorker(R"({"message_id": "2", "user": ")" + key +
+                                  R"("})"),
+              worker);
+  }
+  EXPECT_EQ(used_workers.size(), kNumberOfWorkers);
+}
+
+TEST(MessageRouterTest, SpreadsMessagesWithoutAKeyOverAllWorkers) {
+  MessageRouter router("message_id", 3);
+
+  EXPECT_EQ(router.SelectWorker("{}"), 0);
+  EXPECT_EQ(router.SelectWorker("not json"), 1);
+  EXPECT_EQ(router.SelectWorker(R"({"other": 1})"), 2);
+  EXPECT_EQ(router.SelectWorker("{}"), 0);
+}
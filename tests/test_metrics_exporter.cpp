@@ -0,0 +1,143 @@
+#include "../include/Monitoring/MetricsExporter.hpp"
+#include <arpa/inet.h>
+#include <gtest/gtest.h>
+#include <string>
+#include <sys/socket.h>
+#include <unistd.h>
+
+namespace {
+class FakeConsumer : public IObservableConsumer {
+public:
+  long long GetNumberOfProcessedMessages() const override { return 42; }
+  IngestStatistics GetIngestStatistics() const override {
+    return {10, 20, 4096, 5, 2};
+  }
+  std::vector<WorkerStatistics> GetWorkerStatistics() const override {
+    return {{1, 30, 0, 0, 3, 7, 11}, {2, 12, 0, 0, 1, 0, 0}};
+  }
+  long long GetNumberOfQueuedMessages() const override { return 9; }
+  QueueStatistics GetQueueStatistics() const override {
+    return {64, 50, 6, 300, 25};
+  }
+  LatencyStatistics GetLatencyStatistics() const override {
+    LatencyStatistics statistics{};
+    statistics.processing = processing_latencies.GetSnapshot();
+    return statistics;
+  }
+
+  LatencyHistogram processing_latencies;
+};
+
+// Sends the request over a plain socket and returns the whole response.
+std::string Scrape(unsigned short port, const std::string &request) {
+  int file_descriptor = socket(AF_INET, SOCK_STREAM, 0);
+  sockaddr_in address{};
+  address.sin_family = AF_INET;
+  address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  address.sin_port = htons(port);
+  if (connect(file_descriptor, reinterpret_cast<sockaddr *>(&address),
+              sizeof(address)) < 0) {
+    close(file_descriptor);
+    return "";
+  }
+  EXPECT_EQ(send(file_descriptor, request.data(), request.size(), 0),
+            static_cast<ssize_t>(request.size()));
+  std::string response;
+  char buffer[4096];
+  ssize_t bytes_received;
+  while ((bytes_received = recv(file_descriptor, buffer, sizeof(buffer), 0)) >
+         0) {
+    response.append(buffer, bytes_received);
+  }
+  close(file_descriptor);
+  return response;
+}
+
+bool Contains(const std::string &text, const std::string &part) {
+  return text.find(part) != std::string::npos;
+}
+} // namespace
+
+TEST(MetricsExporterTest, RendersTheCountersOfConsumersAndWorkers) {
+  FakeConsumer consumer;
+  MetricsExporter metrics_exporter({&consumer});
+  const std::string metrics = metrics_exporter.RenderMetrics();
+
+  EXPECT_TRUE(Contains(metrics, "# TYPE redis_client_processed_messages "
+                                "counter\n"));
+  EXPECT_TRUE(Contains(
+      metrics, "redis_client_processed_messages_total{consumer=\"0\"} 42\n"));
+  EXPECT_TRUE(Contains(
+      metrics, "redis_client_processing_errors_total{consumer=\"0\"} 4\n"));
+  EXPECT_TRUE(Contains(metrics, "redis_client_worker_processed_messages_total{"
+                                "consumer=\"0\",worker=\"2\"} 12\n"));
+  EXPECT_TRUE(Contains(metrics, "redis_client_worker_processing_errors_total{"
+                                "consumer=\"0\",worker=\"1\"} 3\n"));
+  EXPECT_TRUE(Contains(metrics, "redis_client_worker_stream_writes_in_flight{"
+                                "consumer=\"0\",worker=\"1\"} 7\n"));
+  EXPECT_TRUE(Contains(metrics, "redis_client_worker_queued_messages{"
+                                "consumer=\"0\",worker=\"1\"} 11\n"));
+  EXPECT_TRUE(
+      Contains(metrics, "redis_client_queued_messages{consumer=\"0\"} 9\n"));
+  EXPECT_TRUE(Contains(
+      metrics, "redis_client_dropped_messages_total{consumer=\"0\"} 6\n"));
+  EXPECT_TRUE(Contains(
+      metrics, "redis_client_queue_high_water_mark{consumer=\"0\"} 50\n"));
+  EXPECT_TRUE(
+      Contains(metrics, "redis_client_queue_capacity{consumer=\"0\"} 64\n"));
+  EXPECT_TRUE(Contains(
+      metrics, "redis_client_spilled_messages_total{consumer=\"0\"} 300\n"));
+  EXPECT_TRUE(
+      Contains(metrics, "redis_client_messages_on_disk{consumer=\"0\"} 25\n"));
+  EXPECT_TRUE(Contains(
+      metrics, "redis_client_received_bytes_total{consumer=\"0\"} 4096\n"));
+  EXPECT_TRUE(
+      Contains(metrics, "redis_client_reconnects_total{consumer=\"0\"} 2\n"));
+  // Stages without any latencies are left out.
+  EXPECT_FALSE(Contains(metrics, "redis_client_latency_seconds_count"));
+  EXPECT_EQ(metrics.substr(metrics.size() - 6), "# EOF\n");
+}
+
+TEST(MetricsExporterTest, RendersTheLatenciesAsCumulativeBuckets) {
+  FakeConsumer consumer;
+  consumer.processing_latencies.Record(500);
+  consumer.processing_latencies.Record(1500);
+  consumer.processing_latencies.Record(3000000);
+  MetricsExporter metrics_exporter({&consumer});
+  const std::string metrics = metrics_exporter.RenderMetrics();
+
+  const std::string labels = "consumer=\"0\",stage=\"processing\"";
+  EXPECT_TRUE(Contains(metrics, "redis_client_latency_seconds_bucket{" +
+                                    labels + ",le=\"1.024e-06\"} 1\n"));
+  EXPECT_TRUE(Contains(metrics, "redis_client_latency_seconds_bucket{" +
+                                    labels + ",le=\"2.048e-06\"} 2\n"));
+  EXPECT_TRUE(Contains(metrics, "redis_client_latency_seconds_bucket{" +
+                                    labels + ",le=\"0.004194304\"} 3\n"));
+  EXPECT_TRUE(Contains(metrics, "redis_client_latency_seconds_bucket{" +
+                                    labels + ",le=\"+Inf\"} 3\n"));
+  EXPECT_TRUE(Contains(metrics, "redis_client_latency_seconds_count{" +
+                                    labels + "} 3\n"));
+}
+
+TEST(MetricsExporterTest, ServesTheMetricsOverHttp) {
+  FakeConsumer consumer;
+  MetricsExporter metrics_exporter({&consumer});
+  ASSERT_TRUE(metrics_exporter.Start(0)) << metrics_exporter.GetLastError();
+  ASSERT_NE(metrics_exporter.GetPort(), 0);
+
+  for (int i = 0; i < 3; ++i) {
+    const std::string response =
+        Scrape(metrics_exporter.GetPort(),
+               "GET /metrics HTTP/1.1\r\nHost: localhost\r\n\r\n");
+    EXPECT_EQ(response.rfind("HTTP/1.1 200 OK\r\n", 0), 0u);
+    EXPECT_TRUE(Contains(response, "Content-Type: application/openmetrics-text"));
+    EXPECT_TRUE(Contains(
+        response, "redis_client_processed_messages_total{consumer=\"0\"} 42\n"));
+    EXPECT_EQ(response.substr(response.size() - 6), "# EOF\n");
+  }
+
+  const std::string response = Scrape(
+      metrics_exporter.GetPort(), "GET / HTTP/1.1\r\nHost: localhost\r\n\r\n");
+  EXPECT_EQ(response.rfind("HTTP/1.1 404 Not Found\r\n", 0), 0u);
+  metrics_exporter.Stop();
+}
@@ -0,0 +1,371 @@
+#include "../include/Consumer/PipelinedStreamWriter.hpp"
+#include "../include/Parsing/RespWriter.hpp"
+#include "../include/Testing/MockRedisServer.hpp"
+#include <arpa/inet.h>
+#include <chrono>
+#include <gtest/gtest.h>
+#include <initializer_list>
+#include <netinet/in.h>
+#include <string>
+#include <sys/socket.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+// Renders a reply compactly, e.g. [message,news,hello] or :2.
+std::string RenderReply(const RespParser &parser, const RespValue &value) {
+  if (value.is_null) {
+    return "(nil)";
+  }
+  switch (value.type) {
+  case RespType::Integer:
+    return ":" + std::to_string(value.integer);
+  case RespType::SimpleString:
+    return "+" + std::string(value.string);
+  case RespType::Error:
+    return "-" + std::string(value.string);
+  case RespType::Array: {
+    std::string rendered = "[";
+    for (std::size_t i = 0; i < value.number_of_elements; ++i) {
+      rendered += (i > 0 ? "," : "") +
+                  RenderReply(parser, *parser.Child(value, i));
+    }
+    return rendered + "]";
+  }
+  default:
+    return std::string(value.string);
+  }
+}
+
+// A blocking client that sends commands and collects the rendered replies.
+class TestClient {
+public:
+  ~TestClient() {
+    if (file_descriptor_ >= 0) {
+      close(file_descriptor_);
+    }
+  }
+
+  bool Connect(unsigned short port) {
+    file_descriptor_ = socket(AF_INET, SOCK_STREAM, 0);
+    // A missing reply fails the test instead of hanging it.
+    timeval timeout{5, 0};
+    setsockopt(file_descriptor_, SOL_SOCKET, SO_RCVTIMEO, &timeout,
+               sizeof(timeout));
+    sockaddr_in address{};
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    address.sin_port = htons(port);
+    reader_.SetFileDescriptor(file_descriptor_);
+    return connect(file_descriptor_, reinterpret_cast<sockaddr *>(&address),
+                   sizeof(address)) == 0;
+  }
+
+  bool Send(std::initializer_list<std::string_view> arguments,
+            int repetitions = 1) {
+    std::string command;
+    RespWriter writer(command);
+    for (int i = 0; i < repetitions; ++i) {
+      writer.AppendArrayHeader(arguments.size());
+      for (std::string_view argument : arguments) {
+        writer.AppendBulkString(argument);
+      }
+    }
+    return send(file_descriptor_, command.data(), command.size(),
+                MSG_NOSIGNAL) == static_cast<ssize_t>(command.size());
+  }
+
+  // Reads until there are number_of_replies replies. Returns false when the
+  // connection was closed before.
+  bool ReadReplies(std::size_t number_of_replies) {
+    while (replies_.size() < number_of_replies) {
+      if (!reader_.ReadFrames([this](const RespParser &parser) {
+            replies_.push_back(RenderReply(parser, parser.Root()));
+          })) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  std::string Execute(std::initializer_list<std::string_view> arguments) {
+    replies_.clear();
+    if (!Send(arguments) || !ReadReplies(1)) {
+      return "(closed)";
+    }
+    return replies_.front();
+  }
+
+  int GetFileDescriptor() const { return file_descriptor_; }
+  long long GetNumberOfReads() const {
+    return reader_.GetStatistics().number_of_reads;
+  }
+  std::vector<std::string> &GetReplies() { return replies_; }
+
+private:
+  int file_descriptor_ = -1;
+  RespReader reader_;
+  std::vector<std::string> replies_;
+};
+
+class MockRedisServerTest : public ::testing::Test {
+protected:
+  void SetUp() override { ASSERT_TRUE(server_.Start(0)); }
+
+  MockRedisServer server_;
+};
+
+TEST_F(MockRedisServerTest, AnswersPingAndRejectsUnknownCommands) {
+  TestClient client;
+  ASSERT_TRUE(client.Connect(server_.GetPort()));
+  EXPECT_EQ(client.Execute({"PING"}), "+PONG");
+  EXPECT_EQ(client.Execute({"ping", "hello"}), "hello");
+  EXPECT_EQ(client.Execute({"FLUSHALL"}).rfind("-ERR unknown command", 0), 0u);
+  EXPECT_EQ(server_.GetNumberOfCommands(), 3);
+  EXPECT_EQ(server_.GetNumberOfConnections(), 1u);
+}
+
+TEST_F(MockRedisServerTest, PushesPublishedMessagesToSubscribers) {
+  TestClient subscriber;
+  ASSERT_TRUE(subscriber.Connect(server_.GetPort()));
+  ASSERT_TRUE(subscriber.Send({"SUBSCRIBE", "news"}));
+  ASSERT_TRUE(subscriber.Send({"PSUBSCRIBE", "n*"}));
+  ASSERT_TRUE(subscriber.ReadReplies(2));
+  EXPECT_EQ(subscriber.GetReplies()[0], "[subscribe,news,:1]");
+  EXPECT_EQ(subscriber.GetReplies()[1], "[psubscribe,n*,:2]");
+  EXPECT_EQ(server_.GetNumberOfSubscribers("news"), 1u);
+  EXPECT_EQ(server_.GetNumberOfSubscribers("n*"), 1u);
+
+  TestClient publisher;
+  ASSERT_TRUE(publisher.Connect(server_.GetPort()));
+  EXPECT_EQ(publisher.Execute({"PUBSUB", "NUMSUB", "news", "sports"}),
+            "[news,:1,sports,:0]");
+  EXPECT_EQ(publisher.Execute({"PUBLISH", "news", "hello"}), ":2");
+  EXPECT_EQ(publisher.Execute({"PUBLISH", "sports", "goal"}), ":0");
+  EXPECT_EQ(server_.Publish("nights", "moon"), 1);
+
+  ASSERT_TRUE(subscriber.ReadReplies(5));
+  EXPECT_EQ(subscriber.GetReplies()[2], "[message,news,hello]");
+  EXPECT_EQ(subscriber.GetReplies()[3], "[pmessage,n*,news,hello]");
+  EXPECT_EQ(subscriber.GetReplies()[4], "[pmessage,n*,nights,moon]");
+}
+
+TEST_F(MockRedisServerTest, AddsAndReadsStreamEntries) {
+  TestClient client;
+  ASSERT_TRUE(client.Connect(server_.GetPort()));
+  EXPECT_EQ(client.Execute({"XADD", "events", "1-1", "name", "John"}), "1-1");
+  EXPECT_EQ(client.Execute({"XADD", "events", "1-1", "name", "Jane"})
+                .rfind("-ERR The ID specified in XADD", 0),
+            0u);
+  EXPECT_EQ(client.Execute({"XADD", "events", "2", "name", "Jane"}), "2-0");
+  EXPECT_EQ(client.Execute({"XLEN", "events"}), ":2");
+  EXPECT_EQ(client.Execute({"XLEN", "missing"}), ":0");
+  EXPECT_EQ(client.Execute({"XADD", "missing", "NOMKSTREAM", "*", "a", "1"}),
+            "(nil)");
+
+  EXPECT_EQ(client.Execute({"XREAD", "STREAMS", "events", "0"}),
+            "[[events,[[1-1,[name,John]],[2-0,[name,Jane]]]]]");
+  EXPECT_EQ(client.Execute({"XREAD", "COUNT", "1", "STREAMS", "events", "0"}),
+            "[[events,[[1-1,[name,John]]]]]");
+  EXPECT_EQ(client.Execute({"XREAD", "STREAMS", "events", "1-1"}),
+            "[[events,[[2-0,[name,Jane]]]]]");
+  EXPECT_EQ(client.Execute({"XREAD", "STREAMS", "events", "$"}), "(nil)");
+
+  for (int i = 0; i < 5; ++i) {
+    ASSERT_EQ(client.Execute({"XADD", "capped", "MAXLEN", "~", "3", "*", "i",
+                              std::to_string(i)})[0],
+              '1');
+  }
+  EXPECT_EQ(server_.GetStreamLength("capped"), 3u);
+  const auto entries = server_.GetStreamEntries("capped");
+  ASSERT_EQ(entries.size(), 3u);
+  EXPECT_EQ(entries.front(), (std::vector<std::string>{"i", "2"}));
+  EXPECT_EQ(entries.back(), (std::vector<std::string>{"i", "4"}));
+}
+
+TEST_F(MockRedisServerTest, DeliversTheEntriesOfAConsumerGroupOnce) {
+  TestClient client;
+  ASSERT_TRUE(client.Connect(server_.GetPort()));
+  EXPECT_EQ(client.Execute({"XREADGROUP", "GROUP", "workers", "c1", "STREAMS",
+                            "jobs", ">"})
+                .rfind("-NOGROUP", 0),
+            0u);
+  EXPECT_EQ(client.Execute({"XGROUP", "CREATE", "jobs", "workers", "$"})
+                .rfind("-ERR", 0),
+            0u);
+  EXPECT_EQ(client.Execute(
+                {"XGROUP", "CREATE", "jobs", "workers", "$", "MKSTREAM"}),
+            "+OK");
+  EXPECT_EQ(client.Execute({"XGROUP", "CREATE", "jobs", "workers", "$"})
+                .rfind("-BUSYGROUP", 0),
+            0u);
+  for (const char *id : {"1-0", "2-0", "3-0"}) {
+    EXPECT_EQ(client.Execute({"XADD", "jobs", id, "job", id}), id);
+  }
+
+  EXPECT_EQ(client.Execute({"XREADGROUP", "GROUP", "workers", "c1", "COUNT",
+                            "2", "STREAMS", "jobs", ">"}),
+            "[[jobs,[[1-0,[job,1-0]],[2-0,[job,2-0]]]]]");
+  EXPECT_EQ(client.Execute({"XREADGROUP", "GROUP", "workers", "c2", "STREAMS",
+                            "jobs", ">"}),
+            "[[jobs,[[3-0,[job,3-0]]]]]");
+  EXPECT_EQ(client.Execute({"XREADGROUP", "GROUP", "workers", "c2", "STREAMS",
+                            "jobs", ">"}),
+            "(nil)");
+  EXPECT_EQ(server_.GetNumberOfPendingEntries("jobs", "workers"), 3u);
+
+  // A consumer reads its own pending entries from an ID on.
+  EXPECT_EQ(client.Execute({"XREADGROUP", "GROUP", "workers", "c1", "STREAMS",
+                            "jobs", "0"}),
+            "[[jobs,[[1-0,[job,1-0]],[2-0,[job,2-0]]]]]");
+  EXPECT_EQ(client.Execute({"XACK", "jobs", "workers", "1-0", "2-0", "9-0"}),
+            ":2");
+  EXPECT_EQ(server_.GetNumberOfPendingEntries("jobs", "workers"), 1u);
+  EXPECT_EQ(client.Execute({"XREADGROUP", "GROUP", "workers", "c1", "STREAMS",
+                            "jobs", "0"}),
+            "[[jobs,[]]]");
+
+  // Without acknowledgements the entries never become pending.
+  EXPECT_EQ(client.Execute({"XADD", "jobs", "4-0", "job", "4-0"}), "4-0");
+  EXPECT_EQ(client.Execute({"XREADGROUP", "GROUP", "workers", "c1", "NOACK",
+                            "STREAMS", "jobs", ">"}),
+            "[[jobs,[[4-0,[job,4-0]]]]]");
+  EXPECT_EQ(server_.GetNumberOfPendingEntries("jobs", "workers"), 1u);
+}
+
+TEST_F(MockRedisServerTest, BlockingReadsWaitForNewEntries) {
+  TestClient reader;
+  ASSERT_TRUE(reader.Connect(server_.GetPort()));
+  EXPECT_EQ(reader.Execute({"XREAD", "BLOCK", "10", "STREAMS", "events", "0"}),
+            "(nil)");
+
+  // The PING before the blocking read is answered without waiting for it.
+  reader.GetReplies().clear();
+  ASSERT_TRUE(reader.Send({"PING"}));
+  ASSERT_TRUE(reader.Send({"XREAD", "BLOCK", "5000", "STREAMS", "events", "0"}));
+  ASSERT_TRUE(reader.ReadReplies(1));
+  EXPECT_EQ(reader.GetReplies()[0], "+PONG");
+
+  TestClient writer;
+  ASSERT_TRUE(writer.Connect(server_.GetPort()));
+  EXPECT_EQ(writer.Execute({"XADD", "events", "7-0", "name", "John"}), "7-0");
+  ASSERT_TRUE(reader.ReadReplies(2));
+  EXPECT_EQ(reader.GetReplies()[1], "[[events,[[7-0,[name,John]]]]]");
+
+  // A read that blocks forever ends when the server stops.
+  ASSERT_TRUE(reader.Send({"XREAD", "BLOCK", "0", "STREAMS", "events", "$"}));
+  server_.Stop();
+  EXPECT_FALSE(reader.ReadReplies(3));
+}
+
+TEST_F(MockRedisServerTest, DelaysTheReplies) {
+  TestClient client;
+  ASSERT_TRUE(client.Connect(server_.GetPort()));
+  server_.SetReplyDelay(std::chrono::milliseconds(50));
+  const auto start = std::chrono::steady_clock::now();
+  EXPECT_EQ(client.Execute({"PING"}), "+PONG");
+  EXPECT_GE(std::chrono::steady_clock::now() - start,
+            std::chrono::milliseconds(50));
+}
+
+TEST_F(MockRedisServerTest, SplitsTheRepliesIntoPartialWrites) {
+  TestClient client;
+  ASSERT_TRUE(client.Connect(server_.GetPort()));
+  const std::string value(2000, 'x');
+  EXPECT_EQ(client.Execute({"XADD", "events", "1-0", "value", value}), "1-0");
+
+  server_.SetPartialWrites(7, std::chrono::microseconds(200));
+  const long long number_of_reads = client.GetNumberOfReads();
+  EXPECT_EQ(client.Execute({"XREAD", "STREAMS", "events", "0"}),
+            "[[events,[[1-0,[value," + value + "]]]]]");
+  // The reply arrived in pieces, which the client put back together.
+  EXPECT_GT(client.GetNumberOfReads() - number_of_reads, 1);
+}
+
+TEST_F(MockRedisServerTest, AnswersPipelinedCommandsThatAreReadSlowly) {
+  TestClient client;
+  ASSERT_TRUE(client.Connect(server_.GetPort()));
+  server_.SetSlowReads(16, std::chrono::microseconds(100));
+  constexpr int kNumberOfCommands = 200;
+  ASSERT_TRUE(client.Send({"PING"}, kNumberOfCommands));
+  ASSERT_TRUE(client.ReadReplies(kNumberOfCommands));
+  for (const std::string &reply : client.GetReplies()) {
+    EXPECT_EQ(reply, "+PONG");
+  }
+  EXPECT_EQ(server_.GetNumberOfCommands(), kNumberOfCommands);
+}
+
+TEST_F(MockRedisServerTest, DisconnectsAfterTheGivenNumberOfCommands) {
+  TestClient client;
+  ASSERT_TRUE(client.Connect(server_.GetPort()));
+  server_.DisconnectAfterCommands(3);
+  ASSERT_TRUE(client.Send({"PING"}, 5));
+  EXPECT_FALSE(client.ReadReplies(5));
+  // The commands before the last one were answered.
+  EXPECT_EQ(client.GetReplies().size(), 2u);
+
+  // The countdown ended, so a new connection stays open.
+  TestClient other_client;
+  ASSERT_TRUE(other_client.Connect(server_.GetPort()));
+  EXPECT_EQ(other_client.Execute({"PING"}), "+PONG");
+  server_.DisconnectAll();
+  EXPECT_EQ(other_client.Execute({"PING"}), "(closed)");
+  EXPECT_EQ(server_.GetNumberOfConnections(), 0u);
+}
+
+TEST_F(MockRedisServerTest, StreamedFramesReachTheSubscribers) {
+  TestClient subscriber;
+  ASSERT_TRUE(subscriber.Connect(server_.GetPort()));
+  ASSERT_TRUE(subscriber.Send({"SUBSCRIBE", "news"}));
+  ASSERT_TRUE(server_.WaitForSubscribers("news", 1, std::chrono::seconds(5)));
+  EXPECT_FALSE(server_.StreamFrames("sports", "*0\r\n", 1));
+
+  std::string frames;
+  MockRedisServer::AppendMessageFrame(frames, "news", "first");
+  MockRedisServer::AppendMessageFrame(frames, "news", "second");
+  constexpr std::size_t kRepetitions = 20000;
+  // The frames fill the socket buffers long before the client read them.
+  std::thread streaming_thread([&] {
+    EXPECT_TRUE(server_.StreamFrames("news", frames, kRepetitions));
+  });
+  ASSERT_TRUE(subscriber.ReadReplies(1 + 2 * kRepetitions));
+  streaming_thread.join();
+  EXPECT_EQ(subscriber.GetReplies()[0], "[subscribe,news,:1]");
+  EXPECT_EQ(subscriber.GetReplies()[1], "[message,news,first]");
+  EXPECT_EQ(subscriber.GetReplies().back(), "[message,news,second]");
+}
+
+TEST_F(MockRedisServerTest, PipelinedStreamWriterFailsTheUnansweredCommands) {
+  TestClient client;
+  ASSERT_TRUE(client.Connect(server_.GetPort()));
+  server_.DisconnectAfterCommands(5);
+
+  int number_of_successes = 0;
+  int number_of_failures = 0;
+  PipelinedStreamWriter writer(client.GetFileDescriptor(), 8,
+                               [&](const StreamWriteResult &result) {
+                                 result.is_success ? ++number_of_successes
+                                                   : ++number_of_failures;
+                               });
+  std::string command;
+  RespWriter command_writer(command);
+  command_writer.AppendArrayHeader(5);
+  command_writer.AppendBulkString("XADD");
+  command_writer.AppendBulkString("events");
+  command_writer.AppendBulkString("*");
+  command_writer.AppendBulkString("name");
+  command_writer.AppendBulkString("John");
+  // The submission that waits for the window to open finds the connection
+  // closed.
+  int number_of_submissions = 0;
+  bool is_submitted = true;
+  while (is_submitted && number_of_submissions < 20) {
+    is_submitted = writer.Submit(command, number_of_submissions++);
+  }
+  EXPECT_FALSE(is_submitted);
+
+  // Every command was completed once, the unanswered ones as failed.
+  EXPECT_EQ(number_of_successes, 4);
+  EXPECT_EQ(number_of_successes + number_of_failures, number_of_submissions);
+  EXPECT_EQ(server_.GetStreamLength("events"), 4u);
+}
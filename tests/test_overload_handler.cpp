@@ -0,0 +1,121 @@
+#include "../include/Concurrency/SpscRingBuffer.hpp"
+#include "../include/Consumer/ConsumerGroups/OverloadHandler.hpp"
+#include <chrono>
+#include <gtest/gtest.h>
+#include <thread>
+#include <vector>
+
+namespace {
+constexpr std::size_t kCapacity = 4;
+
+// Pushes the values 0 to number_of_values - 1 and returns how many were
+// queued.
+template <typename Queue>
+int PushValues(OverloadHandler<int> &handler, Queue &queue,
+               int number_of_values) {
+  int number_of_queued_values = 0;
+  for (int i = 0; i < number_of_values; ++i) {
+    int value = i;
+    number_of_queued_values += handler.Push(queue, std::move(value));
+  }
+  return number_of_queued_values;
+}
+
+template <typename Queue> std::vector<int> PopValues(Queue &queue) {
+  std::vector<int> values;
+  int value;
+  while (queue.TryPop(value)) {
+    values.push_back(value);
+  }
+  return values;
+}
+} // namespace
+
+TEST(OverloadHandlerTest, DropsTheNewestMessages) {
+  OverloadHandler<int> handler(OverloadPolicy::DropNewest, 1);
+  MpmcRingBuffer<int> queue(kCapacity);
+  EXPECT_EQ(PushValues(handler, queue, 10), 4);
+  EXPECT_EQ(handler.GetNumberOfDroppedMessages(), 6);
+  EXPECT_EQ(handler.GetHighWaterMark(), 4);
+  EXPECT_EQ(PopValues(queue), (std::vector<int>{0, 1, 2, 3}));
+}
+
+TEST(OverloadHandlerTest, DropsTheOldestMessages) {
+  OverloadHandler<int> handler(OverloadPolicy::DropOldest, 1);
+  MpmcRingBuffer<int> queue(kCapacity);
+  EXPECT_EQ(PushValues(handler, queue, 10), 10);
+  EXPECT_EQ(handler.GetNumberOfDroppedMessages(), 6);
+  EXPECT_EQ(handler.GetHighWaterMark(), 4);
+  EXPECT_EQ(PopValues(queue), (std::vector<int>{6, 7, 8, 9}));
+}
+
+TEST(OverloadHandlerTest, DropsTheNewestMessagesOfSingleConsumerQueues) {
+  OverloadHandler<int> handler(OverloadPolicy::DropOldest, 1);
+  SpscRingBuffer<int> queue(kCapacity);
+  EXPECT_EQ(PushValues(handler, queue, 10), 4);
+  EXPECT_EQ(handler.GetNumberOfDroppedMessages(), 6);
+  EXPECT_EQ(PopValues(queue), (std::vector<int>{0, 1, 2, 3}));
+}
+
+TEST(OverloadHandlerTest, BlocksUntilThereIsRoom) {
+  OverloadHandler<int> handler(OverloadPolicy::Block, 1);
+  MpmcRingBuffer<int> queue(kCapacity);
+  constexpr int kNumberOfValues = 10000;
+  std::vector<int> values;
+  std::thread consumer([&]() {
+    int value;
+    while (values.size() < kNumberOfValues) {
+      if (queue.TryPop(value)) {
+        values.push_back(value);
+      }
+    }
+  });
+  EXPECT_EQ(PushValues(handler, queue, kNumberOfValues), kNumberOfValues);
+  consumer.join();
+  EXPECT_EQ(handler.GetNumberOfDroppedMessages(), 0);
+  EXPECT_LE(handler.GetHighWaterMark(), static_cast<long long>(kCapacity));
+  for (int i = 0; i < kNumberOfValues; ++i) {
+    ASSERT_EQ(values[i], i);
+  }
+}
+
+TEST(OverloadHandlerTest, KeepsASampleOfTheMessagesThatFindTheQueueFull) {
+  OverloadHandler<int> handler(OverloadPolicy::Sample, 3);
+  MpmcRingBuffer<int> queue(kCapacity);
+  EXPECT_EQ(PushValues(handler, queue, 4), 4);
+  // The first of every three messages that find the queue full waits until
+  // a consumer makes room for it. The other two are dropped.
+  auto push_with_room_made = [&](int value) {
+    std::thread consumer([&]() {
+      std::this_thread::sleep_for(std::chrono::milliseconds(10));
+      int oldest;
+      EXPECT_TRUE(queue.TryPop(oldest));
+    });
+    EXPECT_TRUE(handler.Push(queue, std::move(value)));
+    consumer.join();
+  };
+  push_with_room_made(4);
+  int value = 5;
+  EXPECT_FALSE(handler.Push(queue, std::move(value)));
+  value = 6;
+  EXPECT_FALSE(handler.Push(queue, std::move(value)));
+  push_with_room_made(7);
+  EXPECT_EQ(handler.GetNumberOfDroppedMessages(), 2);
+  EXPECT_EQ(PopValues(queue), (std::vector<int>{2, 3, 4, 7}));
+}
+
+TEST(OverloadHandlerTest, HandsTheDroppedMessagesToTheDropHandler) {
+  std::vector<int> dropped_values;
+  OverloadHandler<int> handler(OverloadPolicy::DropOldest, 1);
+  handler.SetDropHandler(
+      [&dropped_values](const int &value) { dropped_values.push_back(value); });
+  MpmcRingBuffer<int> queue(kCapacity);
+  EXPECT_EQ(PushValues(handler, queue, 6), 6);
+  EXPECT_EQ(dropped_values, (std::vector<int>{0, 1}));
+
+  OverloadHandler<int> newest_handler(OverloadPolicy::DropNewest, 1);
+  newest_handler.SetDropHandler(
+      [&dropped_values](const int &value) { dropped_values.push_back(value); });
+  EXPECT_EQ(PushValues(newest_handler, queue, 2), 0);
+  EXPECT_EQ(dropped_values, (std::vector<int>{0, 1, 0, 1}));
+}
@@ -0,0 +1,99 @@
+#include "../include/Consumer/PipelinedStreamWriter.hpp"
+#include <gtest/gtest.h>
+#include <string>
+#include <sys/socket.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+// Reads number_of_commands commands from the socket and answers them in order.
+// Every third command is answered with an error.
+void AnswerCommands(int file_descriptor, int number_of_commands,
+                    int &max_commands_before_a_reply) {
+  RespReader reader(file_descriptor);
+  int number_of_answered_commands = 0;
+  while (number_of_answered_commands < number_of_commands) {
+    std::string replies;
+    int commands_in_this_read = 0;
+    ASSERT_TRUE(reader.ReadFrames([&](const RespParser &) {
+      int index = number_of_answered_commands + commands_in_this_read++;
+      if (index % 3 == 2) {
+        replies += "-ERR command " + std::to_string(index) + "\r\n";
+      } else {
+        std::string id = std::to_string(index) + "-0";
+        replies += "$" + std::to_string(id.size()) + "\r\n" + id + "\r\n";
+      }
+    }));
+    max_commands_before_a_reply =
+        std::max(max_commands_before_a_reply, commands_in_this_read);
+    number_of_answered_commands += commands_in_this_read;
+    ASSERT_EQ(write(file_descriptor, replies.data(), replies.size()),
+              static_cast<ssize_t>(replies.size()));
+  }
+}
+
+TEST(PipelinedStreamWriterTest, MatchesRepliesToCommandsInOrder) {
+  int socket_pair[2];
+  ASSERT_EQ(socketpair(AF_UNIX, SOCK_STREAM, 0, socket_pair), 0);
+
+  constexpr int kNumberOfCommands = 100;
+  constexpr std::size_t kMaxInFlight = 8;
+  int max_commands_before_a_reply = 0;
+  std::thread server(AnswerCommands, socket_pair[1], kNumberOfCommands,
+                     std::ref(max_commands_before_a_reply));
+
+  std::vector<std::uint64_t> completed_tags;
+  int number_of_errors = 0;
+  PipelinedStreamWriter writer(
+      socket_pair[0], kMaxInFlight, [&](const StreamWriteResult &result) {
+        completed_tags.push_back(result.tag);
+        if (result.is_success) {
+          EXPECT_EQ(result.reply, std::to_string(result.tag) + "-0");
+        } else {
+          EXPECT_EQ(result.reply, "ERR command " + std::to_string(result.tag));
+          ++number_of_errors;
+        }
+      });
+
+  const std::string command = "*2\r\n$4\r\nPING\r\n$1\r\nx\r\n";
+  for (int i = 0; i < kNumberOfCommands; ++i) {
+    ASSERT_TRUE(writer.Submit(command, i));
+    EXPECT_LE(writer.GetNumberOfInFlightCommands(), kMaxInFlight);
+  }
+  ASSERT_TRUE(writer.Flush());
+  server.join();
+
+  ASSERT_EQ(completed_tags.size(), kNumberOfCommands);
+  for (int i = 0; i < kNumberOfCommands; ++i) {
+    EXPECT_EQ(completed_tags[i], i);
+  }
+  EXPECT_EQ(number_of_errors, kNumberOfCommands / 3);
+  EXPECT_EQ(writer.GetNumberOfInFlightCommands(), 0);
+  EXPECT_LE(max_commands_before_a_reply, kMaxInFlight);
+
+  close(socket_pair[0]);
+  close(socket_pair[1]);
+}
+
+TEST(PipelinedStreamWriterTest, FailsOutstandingCommandsWhenTheServerCloses) {
+  int socket_pair[2];
+  ASSERT_EQ(socketpair(AF_UNIX, SOCK_STREAM, 0, socket_pair), 0);
+
+  int number_of_failures = 0;
+  PipelinedStreamWriter writer(socket_pair[0], 4,
+                               [&](const StreamWriteResult &result) {
+                                 EXPECT_FALSE(result.is_success);
+                                 ++number_of_failures;
+                               });
+
+  const std::string command = "*1\r\n$4\r\nPING\r\n";
+  for (int i = 0; i < 3; ++i) {
+    ASSERT_TRUE(writer.Submit(command, i));
+  }
+  close(socket_pair[1]);
+
+  EXPECT_FALSE(writer.Flush());
+  EXPECT_EQ(number_of_failures, 3);
+  EXPECT_EQ(writer.GetNumberOfInFlightCommands(), 0);
+  close(socket_pair[0]);
+}
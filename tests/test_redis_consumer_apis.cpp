@@ -1,68 +1,47 @@
-#include <cstring>
+#include <atomic>
+#include <chrono>
 #include <gtest/gtest.h>
-#include <hiredis/hiredis.h>
-#include <iostream>
-#include <random>
 #include <thread>
 
+#include "../include/Consumer/ConsumerGroups/RedisReactorConsumer.hpp"
 #include "../include/Consumer/RedisConsumer.hpp"
+#include "../include/Testing/MockRedisServer.hpp"
 
 const std::string valid_server_hostname = "127.0.0.1";
-unsigned short valid_server_port = 6379;
 const std::string invalid_server_hostname = "256.256.256.256";
 unsigned short invalid_server_port = 6380;
 
-// A helper function that tests the availability to the Redis server
-bool IsRedisServerAlive(const std::string &host, int port) {
-  redisContext *c = redisConnect(host.c_str(), port);
-  if (c != NULL && c->err) {
-    std::cerr << "Error: " << c->errstr << std::endl;
-    return false;
-  }
-
-  redisReply *reply = (redisReply *)redisCommand(c, "PING");
-  if (reply != NULL && reply->type == REDIS_REPLY_STATUS &&
-      strcmp(reply->str, "PONG") == 0) {
-    std::cout << "Redis Server is up!" << std::endl;
-    freeReplyObject(reply);
-    redisFree(c);
-    return true;
-  }
-
-  freeReplyObject(reply);
-  redisFree(c);
-  return false;
-}
-
 /*
  The following tests serve as integration tests, but they still utilize the
- GTest library These test require that the redis-server service is up and
- running and will use the function IsRedisServerAlive() to verify that by
- pinging the server.
-
- The tests could possibly be modified to start and stop the server as needed,
- however this would probably require some additional privileges like allowing
- passwordless calls to: sudo systemctl start redis-server and sudo systemctl
- stop redis-server. Because of that for now the test would require manual
- intervention for stopping and starting the service.
+ GTest library. Every test starts an in-process MockRedisServer on a free
+ port, which speaks RESP like a redis-server, so the tests need neither a
+ running Redis service nor hiredis, and inspect the server's state directly
+ instead of querying it with PUBSUB NUMSUB and XLEN.
 */
-TEST(RedisConsumerAPIsTest, WillEstablishAConnectionWhenEverythingIsOk) {
+class RedisConsumerAPIsTest : public ::testing::Test {
+protected:
+  void SetUp() override {
+    ASSERT_TRUE(server_.Start(0)) << server_.GetLastError();
+  }
+
+  MockRedisServer server_;
+};
+
+TEST_F(RedisConsumerAPIsTest, WillEstablishAConnectionWhenEverythingIsOk) {
   RedisConsumer redis_consumer(false);
 
-  // Verify that Redis is working
-  ASSERT_EQ(IsRedisServerAlive(valid_server_hostname, valid_server_port), true);
-  redis_consumer.EstablishConnection(valid_server_hostname, valid_server_port);
+  redis_consumer.EstablishConnection(valid_server_hostname, server_.GetPort());
 }
 
-TEST(RedisConsumerAPIsTest, WillNotEstablishAConnectionWithInvalidHostname) {
+TEST_F(RedisConsumerAPIsTest, WillNotEstablishAConnectionWithInvalidHostname) {
   RedisConsumer redis_consumer(false);
 
   EXPECT_DEATH(redis_consumer.EstablishConnection(invalid_server_hostname,
-                                                  valid_server_port),
+                                                  server_.GetPort()),
                "Unable to connect to a Redis server!");
 }
 
-TEST(RedisConsumerAPIsTest, WillNotEstablishAConnectionWithInvalidPort) {
+TEST_F(RedisConsumerAPIsTest, WillNotEstablishAConnectionWithInvalidPort) {
   RedisConsumer redis_consumer(false);
 
   EXPECT_DEATH(redis_consumer.EstablishConnection(valid_server_hostname,
@@ -70,133 +49,41 @@ TEST(RedisConsumerAPIsTest, WillNotEstablishAConnectionWithInvalidPort) {
                "Unable to connect to a Redis server!");
 }
 
-// Get the number of subscriptions to a given channel
-// Returns -1 in case of an error
-int GetNumberOfSubscriptionsToChannel(const std::string &channel_name) {
-  int number_of_subscriptions = -1;
-  redisContext *c =
-      redisConnect(valid_server_hostname.c_str(), valid_server_port);
-  if (c == nullptr || c->err) {
-    if (c) {
-      std::cerr << "Connection error: " << c->errstr << std::endl;
-    } else {
-      std::cerr << "Connection error: can't allocate redis context"
-                << std::endl;
-    }
-    return number_of_subscriptions;
-  }
-
-  std::string command = "PUBSUB NUMSUB " + channel_name;
-  redisReply *reply = (redisReply *)redisCommand(c, command.c_str());
-
-  if (reply == nullptr) {
-    std::cerr << "Failed to execute command." << std::endl;
-    redisFree(c);
-    return number_of_subscriptions;
-  }
-
-  if (reply->type == REDIS_REPLY_ARRAY && reply->elements == 2) {
-    std::string channel_name = reply->element[0]->str;
-    int subscribers_count = reply->element[1]->integer;
-    std::cout << "Channel: " << channel_name
-              << ", Subscribers: " << subscribers_count << std::endl;
-    number_of_subscriptions = subscribers_count;
-  } else {
-    std::cerr << "Unexpected reply type." << std::endl;
-  }
-
-  freeReplyObject(reply);
-  redisFree(c);
-  return number_of_subscriptions;
-}
-
-std::string GenerateRandomString(size_t length) {
-  const std::string charset =
-      "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789";
-
-  std::random_device rd;
-  std::mt19937 engine(rd());
-
-  std::uniform_int_distribution<> dist(0, charset.size() - 1);
-
-  std::string result{};
-  for (size_t i = 0; i < length; ++i) {
-    result += charset[dist(engine)];
-  }
-
-  return result;
-}
-
-TEST(RedisConsumerAPIsTest, CanSubscribeToAChannel) {
+TEST_F(RedisConsumerAPIsTest, CanSubscribeToAChannel) {
   RedisConsumer redis_consumer(false);
-  // Generate a new channel each time the test is run
-  const std::string testing_channel_name =
-      "testing_channel_" + GenerateRandomString(7);
+  const std::string testing_channel_name = "testing_channel";
 
-  // Verify that Redis is working
-  ASSERT_EQ(IsRedisServerAlive(valid_server_hostname, valid_server_port), true);
   // Verify that there are no subscriptions to the channel
-  ASSERT_EQ(GetNumberOfSubscriptionsToChannel(testing_channel_name), 0);
+  ASSERT_EQ(server_.GetNumberOfSubscribers(testing_channel_name), 0u);
 
   // Connect and subscribe
-  redis_consumer.EstablishConnection(valid_server_hostname, valid_server_port);
+  redis_consumer.EstablishConnection(valid_server_hostname, server_.GetPort());
   // The subscription is on a different thread so the test can continue,
   // otherwise the consumer will block here waiting for messages from the
   // subscription
   std::thread subscription_thread([&redis_consumer, &testing_channel_name]() {
     redis_consumer.SubscribeToChannel(testing_channel_name);
   });
-  subscription_thread.detach();
-
-  // Give some time for the subscription to be established
-  std::this_thread::sleep_for(std::chrono::seconds(2));
 
   // Verify that there is an active subsciption now
-  ASSERT_EQ(GetNumberOfSubscriptionsToChannel(testing_channel_name), 1);
-}
+  EXPECT_TRUE(server_.WaitForSubscribers(testing_channel_name, 1,
+                                         std::chrono::seconds(5)));
+  EXPECT_EQ(server_.GetNumberOfSubscribers(testing_channel_name), 1u);
 
-// Get the length of a given stream
-// Returns -1 in case of an error
-int GetStreamLength(const std::string &stream_name) {
-  int stream_length = -1;
-  redisContext *c =
-      redisConnect(valid_server_hostname.c_str(), valid_server_port);
-  if (c != NULL && c->err) {
-    std::cout << "Error: " << c->errstr << std::endl;
-    return stream_length;
-  }
-
-  std::string command = "XLEN " + stream_name;
-
-  redisReply *reply = (redisReply *)redisCommand(c, command.c_str());
-  if (reply == NULL) {
-    std::cout << "Error: " << c->errstr << std::endl;
-    return stream_length;
-  }
-
-  if (reply->type == REDIS_REPLY_INTEGER) {
-    std::cout << "Stream (" << stream_name << ") length: " << reply->integer
-              << std::endl;
-    stream_length = reply->integer;
-  }
-
-  freeReplyObject(reply);
-  redisFree(c);
-  return stream_length;
+  // Closing the subscription makes the consumer return
+  server_.Stop();
+  subscription_thread.join();
 }
 
-TEST(RedisConsumerAPIsTest, CanWriteDataToAStream) {
+TEST_F(RedisConsumerAPIsTest, CanWriteDataToAStream) {
   RedisConsumer redis_consumer(false);
-  const std::string testing_stream_name =
-      "testing_stream_" + GenerateRandomString(7);
+  const std::string testing_stream_name = "testing_stream";
 
-  // Verify that Redis is working
-  ASSERT_EQ(IsRedisServerAlive(valid_server_hostname, valid_server_port), true);
   // Verify that there are no records in the stream
-  ASSERT_EQ(GetStreamLength(testing_stream_name), 0);
+  ASSERT_EQ(server_.GetStreamLength(testing_stream_name), 0u);
 
   // The consumer needs to be connected before it can send data to a stream
-  redis_consumer.EstablishConnection(valid_server_hostname, valid_server_port);
+  redis_consumer.EstablishConnection(valid_server_hostname, server_.GetPort());
 
   // Send a sample vector of data
   ASSERT_EQ(
@@ -204,7 +91,7 @@ TEST(RedisConsumerAPIsTest, CanWriteDataToAStream) {
       true);
 
   // Verify that there is a record in the stream
-  ASSERT_EQ(GetStreamLength(testing_stream_name), 1);
+  ASSERT_EQ(server_.GetStreamLength(testing_stream_name), 1u);
 
   // Send another vector of data
   ASSERT_EQ(
@@ -212,5 +99,130 @@ TEST(RedisConsumerAPIsTest, CanWriteDataToAStream) {
       true);
 
   // Verify that the second vector was also recorded in the stream
-  ASSERT_EQ(GetStreamLength(testing_stream_name), 2);
-}
\ No newline at end of file
+  ASSERT_EQ(server_.GetStreamLength(testing_stream_name), 2u);
+  EXPECT_EQ(server_.GetStreamEntries(testing_stream_name).back(),
+            (std::vector<std::string>{"value1", "Jane", "value2", "Smith"}));
+}
+
+TEST_F(RedisConsumerAPIsTest, FailsToWriteDataWhenTheServerDisconnects) {
+  RedisConsumer redis_consumer(false);
+  redis_consumer.EstablishConnection(valid_server_hostname, server_.GetPort());
+
+  // The XADD command is never answered
+  server_.DisconnectAfterCommands(1);
+  EXPECT_FALSE(
+      redis_consumer.AddDataToStream("testing_stream", {"John", "Smith"}));
+  EXPECT_EQ(server_.GetStreamLength("testing_stream"), 0u);
+}
+
+TEST_F(RedisConsumerAPIsTest, CountsEveryFailedStreamWriteOnce) {
+  ConsumerOptions options;
+  options.xadd_pipeline_depth = 1;
+  RedisConsumer redis_consumer(false, options);
+  const std::string testing_channel_name = "testing_channel";
+  redis_consumer.EstablishConnection(valid_server_hostname, server_.GetPort());
+  std::thread subscription_thread([&redis_consumer, &testing_channel_name]() {
+    redis_consumer.SubscribeToChannel(testing_channel_name, "testing_stream");
+  });
+  ASSERT_TRUE(server_.WaitForSubscribers(testing_channel_name, 1,
+                                         std::chrono::seconds(5)));
+
+  // The first XADD command is answered and the second one is not. With a
+  // single command in flight, the third one is rejected by Submit().
+  server_.DisconnectAfterCommands(2);
+  std::string frames;
+  for (const char *message_id : {"1", "2", "3"}) {
+    MockRedisServer::AppendMessageFrame(
+        frames, testing_channel_name,
+        std::string(R"({"message_id": ")") + message_id + "\"}");
+  }
+  ASSERT_TRUE(server_.StreamFrames(testing_channel_name, frames, 1));
+
+  const auto deadline =
+      std::chrono::steady_clock::now() + std::chrono::seconds(5);
+  CounterValues counters = redis_consumer.GetCounters();
+  while (counters.Get(CounterId::ProcessedMessages) +
+                 counters.Get(CounterId::ProcessingErrors) <
+             3 &&
+         std::chrono::steady_clock::now() < deadline) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    counters = redis_consumer.GetCounters();
+  }
+
+  server_.Stop();
+  subscription_thread.join();
+  counters = redis_consumer.GetCounters();
+  EXPECT_EQ(counters.Get(CounterId::ProcessedMessages), 1);
+  EXPECT_EQ(counters.Get(CounterId::ProcessingErrors), 2);
+}
+
+namespace {
+// Holds every message back until it is opened, so that the queue of the
+// consumer fills up.
+class GatedMessageProcessor : public IMessageProcessor {
+public:
+  std::optional<Message> ProcessMessage(std::string_view) override {
+    while (!is_open_.load(std::memory_order_acquire)) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    Message message;
+    message.message_id = "1";
+    return message;
+  }
+
+  void Open() { is_open_.store(true, std::memory_order_release); }
+
+private:
+  std::atomic<bool> is_open_{false};
+};
+} // namespace
+
+TEST_F(RedisConsumerAPIsTest, ReactorResumesReadingOnceItsQueueHasRoom) {
+  // More messages than the reactor's queue holds.
+  constexpr std::size_t kQueueCapacity = 1024;
+  constexpr std::size_t kNumberOfMessages = 2 * kQueueCapacity;
+  auto message_processor = std::make_shared<GatedMessageProcessor>();
+  ConsumerOptions options;
+  options.broker_queue_capacity = kQueueCapacity;
+  RedisReactorConsumer reactor_consumer(false, 1, options);
+  const std::string testing_channel_name = "testing_channel";
+  reactor_consumer.EstablishConnection(valid_server_hostname,
+                                       server_.GetPort());
+  std::thread subscription_thread([&]() {
+    reactor_consumer.SubscribeToChannels(
+        {{testing_channel_name, false, "", message_processor}});
+  });
+  ASSERT_TRUE(server_.WaitForSubscribers(testing_channel_name, 1,
+                                         std::chrono::seconds(5)));
+
+  std::string frame;
+  MockRedisServer::AppendMessageFrame(frame, testing_channel_name,
+                                      R"({"message_id": "1"})");
+  std::thread publishing_thread([&]() {
+    EXPECT_TRUE(
+        server_.StreamFrames(testing_channel_name, frame, kNumberOfMessages));
+  });
+  auto wait_for = [](auto &&condition) {
+    const auto deadline =
+        std::chrono::steady_clock::now() + std::chrono::seconds(10);
+    while (!condition() && std::chrono::steady_clock::now() < deadline) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    return condition();
+  };
+  // The reading pauses with a full queue and resumes while the worker takes
+  // the messages.
+  EXPECT_TRUE(wait_for([&] {
+    return reactor_consumer.GetNumberOfQueuedMessages() >=
+           static_cast<long long>(kQueueCapacity);
+  }));
+  message_processor->Open();
+  EXPECT_TRUE(wait_for([&] {
+    return reactor_consumer.GetNumberOfProcessedMessages() ==
+           static_cast<long long>(kNumberOfMessages);
+  }));
+
+  server_.Stop();
+  publishing_thread.join();
+  subscription_thread.join();
+}
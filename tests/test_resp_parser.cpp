@@ -0,0 +1,369 @@
+#include "../include/Parsing/RespParser.hpp"
+#include "../include/Parsing/RespReader.hpp"
+#include "../include/Parsing/RespReceiveBuffer.hpp"
+#include <gtest/gtest.h>
+#include <string>
+#include <sys/socket.h>
+#include <thread>
+#include <unistd.h>
+
+// Parses a single reply that is expected to be complete and to span the whole
+// input. The parsed views point into the input, so it has to outlive them.
+void ParseCompleteReply(RespParser &parser, std::string_view input) {
+  std::size_t bytes_consumed = 0;
+  ASSERT_EQ(parser.Parse(input.data(), input.size(), bytes_consumed),
+            RespParseStatus::Complete);
+  EXPECT_EQ(bytes_consumed, input.size());
+}
+
+TEST(RespParserTest, ParsesScalarTypes) {
+  RespParser parser;
+
+  ParseCompleteReply(parser, "+OK\r\n");
+  EXPECT_EQ(parser.Root().type, RespType::SimpleString);
+  EXPECT_EQ(parser.Root().string, "OK");
+
+  ParseCompleteReply(parser, "-ERR unknown command\r\n");
+  EXPECT_TRUE(parser.Root().IsError());
+  EXPECT_EQ(parser.Root().string, "ERR unknown command");
+
+  ParseCompleteReply(parser, ":-42\r\n");
+  EXPECT_EQ(parser.Root().type, RespType::Integer);
+  EXPECT_EQ(parser.Root().integer, -42);
+
+  ParseCompleteReply(parser, "$15\r\n1700000000000-0\r\n");
+  EXPECT_EQ(parser.Root().type, RespType::BulkString);
+  EXPECT_EQ(parser.Root().string, "1700000000000-0");
+
+  ParseCompleteReply(parser, "$-1\r\n");
+  EXPECT_TRUE(parser.Root().is_null);
+
+  ParseCompleteReply(parser, "$0\r\n\r\n");
+  EXPECT_TRUE(parser.Root().IsString());
+  EXPECT_TRUE(parser.Root().string.empty());
+}
+
+TEST(RespParserTest, ParsesResp3ScalarTypes) {
+  RespParser parser;
+
+  ParseCompleteReply(parser, "_\r\n");
+  EXPECT_TRUE(parser.Root().is_null);
+
+  ParseCompleteReply(parser, "#t\r\n");
+  EXPECT_EQ(parser.Root().type, RespType::Boolean);
+  EXPECT_EQ(parser.Root().integer, 1);
+
+  ParseCompleteReply(parser, ",3.14\r\n");
+  EXPECT_EQ(parser.Root().type, RespType::Double);
+  EXPECT_EQ(parser.Root().string, "3.14");
+
+  ParseCompleteReply(parser, "=15\r\ntxt:Some string\r\n");
+  EXPECT_EQ(parser.Root().type, RespType::VerbatimString);
+  EXPECT_EQ(parser.Root().string, "Some string");
+
+  ParseCompleteReply(parser, "!21\r\nSYNTAX invalid syntax\r\n");
+  EXPECT_TRUE(parser.Root().IsError());
+  EXPECT_EQ(parser.Root().string, "SYNTAX invalid syntax");
+}
+
+TEST(RespParserTest, ParsesNestedAggregates) {
+  RespParser parser;
+  ParseCompleteReply(parser, "*3\r\n:1\r\n*2\r\n+a\r\n+b\r\n$1\r\nc\r\n");
+
+  const RespValue &root = parser.Root();
+  ASSERT_EQ(root.type, RespType::Array);
+  ASSERT_EQ(root.number_of_elements, 3);
+  EXPECT_EQ(root.subtree_size, 6);
+
+  const RespValue *nested = parser.Child(root, 1);
+  ASSERT_NE(nested, nullptr);
+  EXPECT_EQ(nested->type, RespType::Array);
+  EXPECT_EQ(parser.Child(*nested, 1)->string, "b");
+  EXPECT_EQ(parser.Child(root, 2)->string, "c");
+  EXPECT_EQ(parser.Child(root, 3), nullptr);
+}
+
+TEST(RespParserTest, ParsesMapsAndSkipsAttributes) {
+  RespParser parser;
+  ParseCompleteReply(parser, "|1\r\n+ttl\r\n:3600\r\n%1\r\n+key\r\n:7\r\n");
+
+  const RespValue &root = parser.Root();
+  ASSERT_EQ(root.type, RespType::Map);
+  ASSERT_EQ(root.number_of_elements, 2);
+  EXPECT_EQ(parser.Child(root, 0)->string, "key");
+  EXPECT_EQ(parser.Child(root, 1)->integer, 7);
+
+  // An attribute inside an aggregate does not count as one of its elements.
+  ParseCompleteReply(parser, "*2\r\n|1\r\n+a\r\n+b\r\n:1\r\n:2\r\n");
+  ASSERT_EQ(parser.Root().subtree_size, 3);
+  EXPECT_EQ(parser.Child(parser.Root(), 1)->integer, 2);
+}
+
+TEST(RespParserTest, ReportsIncompleteRepliesAtEverySplitPoint) {
+  const std::string reply =
+      "*3\r\n$7\r\nmessage\r\n$18\r\nmessages:published\r\n$23\r\n"
+      "{\"message_id\": \"abc-1\"}\r\n";
+  RespParser parser;
+
+  for (std::size_t length = 0; length < reply.size(); ++length) {
+    std::size_t bytes_consumed = 0;
+    EXPECT_EQ(parser.Parse(reply.data(), length, bytes_consumed),
+              RespParseStatus::Incomplete)
+        << "Prefix length: " << length;
+  }
+
+  ParseCompleteReply(parser, reply);
+}
+
+TEST(RespParserTest, ReportsTheBytesNeededForLargeBulkStrings) {
+  const std::string header = "$100000\r\n";
+  std::string reply = header + std::string(1000, 'x');
+  RespParser parser;
+
+  std::size_t bytes_consumed = 0;
+  ASSERT_EQ(parser.Parse(reply.data(), reply.size(), bytes_consumed),
+            RespParseStatus::Incomplete);
+  EXPECT_EQ(parser.GetBytesNeeded(), header.size() + 100000 + 2);
+}
+
+TEST(RespParserTest, RejectsMalformedReplies) {
+  RespParser parser;
+  std::size_t bytes_consumed = 0;
+
+  for (const std::string &input :
+       {std::string("?what\r\n"), std::string(":12a\r\n"),
+        std::string("$3\r\nabcd\r\n"), std::string("*-2\r\n"),
+        std::string("+OK\rX")}) {
+    EXPECT_EQ(parser.Parse(input.data(), input.size(), bytes_consumed),
+              RespParseStatus::Error)
+        << input;
+  }
+}
+
+TEST(RespParserTest, ParsesConsecutiveRepliesFromOneBuffer) {
+  const std::string input = "+first\r\n:2\r\n$5\r\nthird\r\n";
+  RespParser parser;
+  std::size_t offset = 0;
+  std::size_t number_of_replies = 0;
+
+  while (offset < input.size()) {
+    std::size_t bytes_consumed = 0;
+    ASSERT_EQ(parser.Parse(input.data() + offset, input.size() - offset,
+                           bytes_consumed),
+              RespParseStatus::Complete);
+    offset += bytes_consumed;
+    ++number_of_replies;
+  }
+
+  EXPECT_EQ(number_of_replies, 3);
+  EXPECT_EQ(parser.Root().string, "third");
+}
+
+TEST(RespParserTest, DecodesPubSubMessages) {
+  RespParser parser;
+  PubSubMessage pubsub_message{};
+
+  ParseCompleteReply(parser, "*3\r\n$9\r\nsubscribe\r\n$2\r\nch\r\n:1\r\n");
+  ASSERT_TRUE(ParsePubSubMessage(parser, pubsub_message));
+  EXPECT_EQ(pubsub_message.kind, PubSubMessageKind::Subscribe);
+  EXPECT_EQ(pubsub_message.channel, "ch");
+  EXPECT_EQ(pubsub_message.number_of_subscriptions, 1);
+
+  ParseCompleteReply(parser,
+                     "*3\r\n$7\r\nmessage\r\n$2\r\nch\r\n$5\r\nhello\r\n");
+  ASSERT_TRUE(ParsePubSubMessage(parser, pubsub_message));
+  EXPECT_EQ(pubsub_message.kind, PubSubMessageKind::Message);
+  EXPECT_EQ(pubsub_message.channel, "ch");
+  EXPECT_EQ(pubsub_message.payload, "hello");
+
+  // RESP3 delivers pub/sub messages as push replies.
+  ParseCompleteReply(
+      parser, ">4\r\n$8\r\npmessage\r\n$3\r\nch*\r\n$3\r\nch1\r\n$2\r\nhi\r\n");
+  ASSERT_TRUE(ParsePubSubMessage(parser, pubsub_message));
+  EXPECT_EQ(pubsub_message.kind, PubSubMessageKind::PatternMessage);
+  EXPECT_EQ(pubsub_message.pattern, "ch*");
+  EXPECT_EQ(pubsub_message.channel, "ch1");
+  EXPECT_EQ(pubsub_message.payload, "hi");
+
+  ParseCompleteReply(parser,
+                     ">3\r\n$8\r\nsmessage\r\n$2\r\nch\r\n$5\r\nhello\r\n");
+  ASSERT_TRUE(ParsePubSubMessage(parser, pubsub_message));
+  EXPECT_EQ(pubsub_message.kind, PubSubMessageKind::ShardMessage);
+  EXPECT_EQ(pubsub_message.channel, "ch");
+  EXPECT_EQ(pubsub_message.payload, "hello");
+
+  ParseCompleteReply(parser, "*3\r\n$12\r\nsunsubscribe\r\n$2\r\nch\r\n:0\r\n");
+  ASSERT_TRUE(ParsePubSubMessage(parser, pubsub_message));
+  EXPECT_EQ(pubsub_message.kind, PubSubMessageKind::ShardUnsubscribe);
+  EXPECT_EQ(pubsub_message.channel, "ch");
+  EXPECT_EQ(pubsub_message.number_of_subscriptions, 0);
+
+  ParseCompleteReply(parser, "+OK\r\n");
+  EXPECT_FALSE(ParsePubSubMessage(parser, pubsub_message));
+}
+
+TEST(RespParserTest, DecodesStreamEntries) {
+  RespParser parser;
+  std::vector<StreamEntry> entries;
+
+  ParseCompleteReply(parser, "*1\r\n*2\r\n$1\r\ns\r\n*2\r\n"
+                             "*2\r\n$3\r\n1-0\r\n*4\r\n$1\r\na\r\n$1\r\nb\r\n"
+                             "$7\r\nmessage\r\n$5\r\nhello\r\n"
+                             "*2\r\n$3\r\n2-0\r\n*2\r\n$1\r\na\r\n$1\r\nb\r\n");
+  ASSERT_TRUE(ParseStreamEntries(parser, "message", entries));
+  ASSERT_EQ(entries.size(), 2u);
+  EXPECT_EQ(entries[0].id, "1-0");
+  EXPECT_TRUE(entries[0].has_payload);
+  EXPECT_EQ(entries[0].payload, "hello");
+  EXPECT_EQ(entries[1].id, "2-0");
+  EXPECT_FALSE(entries[1].has_payload);
+
+  // RESP3 replies with a map, and the fields of deleted entries are null.
+  ParseCompleteReply(parser, "%1\r\n$1\r\ns\r\n*1\r\n"
+                             "*2\r\n$3\r\n3-0\r\n_\r\n");
+  ASSERT_TRUE(ParseStreamEntries(parser, "message", entries));
+  ASSERT_EQ(entries.size(), 1u);
+  EXPECT_EQ(entries[0].id, "3-0");
+  EXPECT_FALSE(entries[0].has_payload);
+
+  // A blocking read that timed out.
+  ParseCompleteReply(parser, "*-1\r\n");
+  ASSERT_TRUE(ParseStreamEntries(parser, "message", entries));
+  EXPECT_TRUE(entries.empty());
+
+  ParseCompleteReply(parser, "*1\r\n*2\r\n$1\r\ns\r\n*1\r\n:1\r\n");
+  EXPECT_FALSE(ParseStreamEntries(parser, "message", entries));
+}
+
+TEST(RespReceiveBufferTest, CompactsAndGrowsForLargeReplies) {
+  RespReceiveBuffer receive_buffer(1024);
+  const std::string data(1000, 'a');
+
+  memcpy(receive_buffer.GetWritableData(), data.data(), data.size());
+  receive_buffer.CommitWrite(data.size());
+  receive_buffer.Consume(900);
+
+  // Reclaims the consumed bytes before growing.
+  receive_buffer.EnsureWritable(512);
+  EXPECT_EQ(receive_buffer.GetCapacity(), 1024);
+  EXPECT_EQ(receive_buffer.GetReadableSize(), 100);
+
+  receive_buffer.EnsureWritable(4096);
+  EXPECT_GE(receive_buffer.GetWritableSize(), 4096);
+  EXPECT_EQ(std::string(receive_buffer.GetReadableData(),
+                        receive_buffer.GetReadableSize()),
+            std::string(100, 'a'));
+}
+
+TEST(RespReaderTest, HandlesEveryCompleteReplyOfASingleRead) {
+  int socket_pair[2];
+  ASSERT_EQ(socketpair(AF_UNIX, SOCK_STREAM, 0, socket_pair), 0);
+
+  std::string replies;
+  for (int i = 0; i < 50; ++i) {
+    replies += "*3\r\n$7\r\nmessage\r\n$2\r\nch\r\n$5\r\nhello\r\n";
+  }
+  // A partial reply at the end stays buffered until the next read.
+  replies += "*3\r\n$7\r\nmessage\r\n$2\r\nch";
+  ASSERT_EQ(write(socket_pair[1], replies.data(), replies.size()),
+            static_cast<ssize_t>(replies.size()));
+
+  RespReader reader(socket_pair[0]);
+  int number_of_messages = 0;
+  auto count_messages = [&](const RespParser &parser) {
+    PubSubMessage pubsub_message{};
+    if (ParsePubSubMessage(parser, pubsub_message) &&
+        pubsub_message.payload == "hello") {
+      ++number_of_messages;
+    }
+  };
+
+  ASSERT_TRUE(reader.ReadFrames(count_messages));
+  EXPECT_EQ(number_of_messages, 50);
+
+  const std::string rest = "\r\n$5\r\nhello\r\n";
+  ASSERT_EQ(write(socket_pair[1], rest.data(), rest.size()),
+            static_cast<ssize_t>(rest.size()));
+  ASSERT_TRUE(reader.ReadFrames(count_messages));
+  EXPECT_EQ(number_of_messages, 51);
+
+  IngestStatistics statistics = reader.GetStatistics();
+  EXPECT_EQ(statistics.number_of_reads, 2);
+  EXPECT_EQ(statistics.number_of_frames, 51);
+  EXPECT_EQ(statistics.max_frames_per_read, 50);
+
+  close(socket_pair[1]);
+  EXPECT_FALSE(reader.ReadFrames(count_messages));
+  close(socket_pair[0]);
+}
+
+TEST(RespReaderTest, GrowsForLargeRepliesAndShrinksAfterwards) {
+  int socket_pair[2];
+  ASSERT_EQ(socketpair(AF_UNIX, SOCK_STREAM, 0, socket_pair), 0);
+
+  const std::string payload(300 * 1024, 'p');
+  const std::string reply = "*3\r\n$7\r\nmessage\r\n$2\r\nch\r\n$" +
+                            std::to_string(payload.size()) + "\r\n" +
+                            payload + "\r\n";
+  std::thread writer([&]() {
+    std::size_t offset = 0;
+    while (offset < reply.size()) {
+      ssize_t bytes_written = write(socket_pair[1], reply.data() + offset,
+                                    reply.size() - offset);
+      ASSERT_GT(bytes_written, 0);
+      offset += bytes_written;
+    }
+  });
+
+  RespReader reader(socket_pair[0]);
+  std::size_t received_payload_size = 0;
+  while (received_payload_size == 0) {
+    ASSERT_TRUE(reader.ReadFrames([&](const RespParser &parser) {
+      PubSubMessage pubsub_message{};
+      ASSERT_TRUE(ParsePubSubMessage(parser, pubsub_message));
+      received_payload_size = pubsub_message.payload.size();
+    }));
+  }
+  writer.join();
+
+  EXPECT_EQ(received_payload_size, payload.size());
+  close(socket_pair[0]);
+  close(socket_pair[1]);
+}
+
+TEST(RespReaderTest, ParsesRepliesSplitOverReceivedChunks) {
+  std::string replies;
+  for (int i = 0; i < 10; ++i) {
+    replies += "*3\r\n$7\r\nmessage\r\n$2\r\nch\r\n$5\r\nhello\r\n";
+  }
+
+  RespReader reader;
+  int number_of_messages = 0;
+  auto count_messages = [&](const RespParser &parser) {
+    PubSubMessage pubsub_message{};
+    if (ParsePubSubMessage(parser, pubsub_message) &&
+        pubsub_message.payload == "hello") {
+      ++number_of_messages;
+    }
+  };
+
+  // Hand the data over in chunks of 7 bytes, like small received buffers.
+  for (std::size_t offset = 0; offset < replies.size(); offset += 7) {
+    ASSERT_TRUE(reader.ParseFrames(
+        std::string_view(replies).substr(offset, 7), count_messages));
+  }
+  EXPECT_EQ(number_of_messages, 10);
+  EXPECT_EQ(reader.GetStatistics().number_of_bytes,
+            static_cast<long long>(replies.size()));
+
+  EXPECT_FALSE(reader.ParseFrames("?invalid\r\n", count_messages));
+}
+
+TEST(RespReaderTest, CountsTheReplacedConnectionsAsReconnects) {
+  RespReader reader;
+  reader.SetFileDescriptor(3);
+  EXPECT_EQ(reader.GetStatistics().number_of_reconnects, 0);
+  reader.SetFileDescriptor(4);
+  reader.SetFileDescriptor(5);
+  EXPECT_EQ(reader.GetStatistics().number_of_reconnects, 2);
+}
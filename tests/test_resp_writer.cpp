@@ -0,0 +1,181 @@
+#include "../include/Consumer/RedisConsumerUtils/redis_consumer_utils.hpp"
+#include "../include/Parsing/RespWriter.hpp"
+#include <climits>
+#include <cstddef>
+#include <gtest/gtest.h>
+#include <sstream>
+#include <string>
+#include <sys/socket.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+namespace {
+// The builders that the RESP writer replaced, to check that the commands are
+// still the same, byte for byte.
+std::string LegacyBulkString(const std::string &value) {
+  return "$" + std::to_string(value.length()) + "\r\n" + value + "\r\n";
+}
+
+std::string LegacyWriteMessageToStreamCommand(const std::string &stream_name,
+                                              const Message &message) {
+  std::ostringstream command_output_stream;
+  command_output_stream << "*11\r\n" << LegacyBulkString("XADD")
+                        << LegacyBulkString(stream_name)
+                        << LegacyBulkString("*");
+  command_output_stream << LegacyBulkString("Processor_id")
+                        << LegacyBulkString(
+                               std::to_string(message.processor_id));
+  command_output_stream << LegacyBulkString("Processing_date_time")
+                        << LegacyBulkString(message.processing_date_time);
+  command_output_stream << LegacyBulkString("Source_channel_name")
+                        << LegacyBulkString(message.source_channel_name);
+  command_output_stream << LegacyBulkString("Message_id")
+                        << LegacyBulkString(message.message_id);
+  return command_output_stream.str();
+}
+
+std::string
+LegacyWriteValuesToStreamCommand(const std::string &stream_name,
+                                 const std::vector<std::string> &values) {
+  std::ostringstream command_output_stream;
+  command_output_stream << "*" + std::to_string(3 + (2 * values.size())) +
+                               "\r\n";
+  command_output_stream << LegacyBulkString("XADD")
+                        << LegacyBulkString(stream_name)
+                        << LegacyBulkString("*");
+  for (std::size_t i = 0; i < values.size(); ++i) {
+    command_output_stream << LegacyBulkString("value" + std::to_string(i + 1))
+                          << LegacyBulkString(values[i]);
+  }
+  return command_output_stream.str();
+}
+} // namespace
+
+TEST(RespWriterTest, EncodesConstantsAtCompileTime) {
+  static_assert(kRespXadd.View() == "$4\r\nXADD\r\n");
+  static_assert(EncodeRespBulkString("").View() == "$0\r\n\r\n");
+  static_assert(EncodeRespBulkString("Processing_date_time").View() ==
+                "$20\r\nProcessing_date_time\r\n");
+  EXPECT_EQ(kRespShardedSubscribe.View(), "$10\r\nSSUBSCRIBE\r\n");
+}
+
+TEST(RespWriterTest, SerializesArraysBulkStringsAndIntegers) {
+  std::string buffer;
+  RespWriter writer(buffer);
+  writer.AppendArrayHeader(5);
+  writer.AppendBulkString(std::string_view("a\0b", 3));
+  writer.AppendBulkString("");
+  writer.AppendBulkString(-42LL);
+  writer.AppendBulkString(LLONG_MIN);
+  writer.AppendBulkString(std::string(1000, 'x'));
+
+  std::string expected = "*5\r\n$3\r\na";
+  expected += '\0';
+  expected += "b\r\n$0\r\n\r\n$3\r\n-42\r\n$20\r\n-9223372036854775808\r\n"
+              "$1000\r\n" +
+              std::string(1000, 'x') + "\r\n";
+  EXPECT_EQ(writer.View(), expected);
+  EXPECT_FALSE(writer.HasReferences());
+}
+
+TEST(RespWriterTest, MatchesTheCommandBuilders) {
+  for (const std::string &value :
+       {std::string(), std::string("x"), std::string(9, 'a'),
+        std::string(10, 'b'), std::string(12345, 'c')}) {
+    EXPECT_EQ(StringToRespProtocolFormat(value), LegacyBulkString(value));
+
+    Message message{123456, "2024-01-02 03:04:05.678", value, "id-" + value};
+    EXPECT_EQ(CreateWriteMessageToStreamCommand("stream:" + value, message),
+              LegacyWriteMessageToStreamCommand("stream:" + value, message));
+  }
+
+  std::vector<std::string> values;
+  for (int i = 0; i < 12; ++i) {
+    values.push_back(std::string(i, 'v'));
+    EXPECT_EQ(CreateWriteMessageToStreamCommand("values", values),
+              LegacyWriteValuesToStreamCommand("values", values));
+  }
+  EXPECT_EQ(CreateWriteMessageToStreamCommand("values", std::vector<std::string>()),
+            "");
+
+  EXPECT_EQ(CreateSubscriptionCommand("orders"),
+            "*2\r\n$9\r\nSUBSCRIBE\r\n$6\r\norders\r\n");
+  EXPECT_EQ(CreateShardedSubscriptionCommand({"{a}1", "{a}2"}),
+            "*3\r\n$10\r\nSSUBSCRIBE\r\n$4\r\n{a}1\r\n$4\r\n{a}2\r\n");
+}
+
+TEST(RespWriterTest, ReusesItsBuffer) {
+  std::string buffer;
+  RespWriter writer(buffer);
+  const Message message{7, "2024-01-02 03:04:05.678", "orders", "42"};
+  const MessageView message_view{7, message.processing_date_time,
+                                 message.source_channel_name,
+                                 message.message_id};
+
+  AppendWriteMessageToStreamCommand(writer, "processed", message_view);
+  EXPECT_EQ(writer.View(),
+            LegacyWriteMessageToStreamCommand("processed", message));
+  const char *data = buffer.data();
+  const std::size_t capacity = buffer.capacity();
+
+  writer.Clear();
+  AppendWriteMessageToStreamCommand(writer, "processed", message_view);
+  EXPECT_EQ(writer.View(),
+            LegacyWriteMessageToStreamCommand("processed", message));
+  EXPECT_EQ(buffer.data(), data);
+  EXPECT_EQ(buffer.capacity(), capacity);
+}
+
+TEST(RespWriterTest, WritesReferencedBulkStringsWithoutCopying) {
+  const std::string payload(1024 * 1024, 'p');
+  std::string copied_command;
+  RespWriter copying_writer(copied_command);
+  copying_writer.AppendArrayHeader(4);
+  copying_writer.AppendBulkString("SET");
+  copying_writer.AppendBulkString(payload);
+  copying_writer.AppendBulkString(payload.substr(0, 3));
+  copying_writer.AppendBulkString("EX");
+
+  std::string buffer;
+  RespWriter writer(buffer);
+  writer.AppendArrayHeader(4);
+  writer.AppendBulkString("SET");
+  writer.AppendBulkStringReference(payload);
+  writer.AppendBulkStringReference(std::string_view(payload).substr(0, 3));
+  writer.AppendBulkString("EX");
+  EXPECT_TRUE(writer.HasReferences());
+  EXPECT_LT(buffer.size(), 64u);
+
+  std::vector<iovec> io_vectors;
+  EXPECT_EQ(writer.FillIoVectors(io_vectors), copied_command.size());
+  ASSERT_EQ(io_vectors.size(), 5u);
+  EXPECT_EQ(io_vectors[1].iov_base, payload.data());
+  std::string gathered_command;
+  for (const iovec &io_vector : io_vectors) {
+    gathered_command.append(static_cast<const char *>(io_vector.iov_base),
+                            io_vector.iov_len);
+  }
+  EXPECT_EQ(gathered_command, copied_command);
+
+  // The command is larger than the socket's buffer, so it takes several
+  // partial writes.
+  int socket_pair[2];
+  ASSERT_EQ(socketpair(AF_UNIX, SOCK_STREAM, 0, socket_pair), 0);
+  std::string received_command;
+  std::thread reader([&] {
+    char chunk[64 * 1024];
+    while (received_command.size() < copied_command.size()) {
+      ssize_t bytes_read = read(socket_pair[1], chunk, sizeof(chunk));
+      if (bytes_read <= 0) {
+        return;
+      }
+      received_command.append(chunk, bytes_read);
+    }
+  });
+  EXPECT_TRUE(writer.WriteTo(socket_pair[0]));
+  reader.join();
+  EXPECT_EQ(received_command, copied_command);
+  close(socket_pair[0]);
+  close(socket_pair[1]);
+}
@@ -0,0 +1,68 @@
+#include "../include/Consumer/SchemaProcessor.hpp"
+#include <gtest/gtest.h>
+#include <memory>
+#include <string>
+
+namespace {
+struct UserField {
+  static constexpr std::string_view kKey = "user";
+};
+// Has the length of "message_id", so it is told apart by its hash.
+struct ReceivedAtField {
+  static constexpr std::string_view kKey = "message_at";
+};
+
+using OrderProcessor =
+    SchemaProcessor<MessageIdField, UserField, ReceivedAtField>;
+} // namespace
+
+TEST(SchemaProcessorTest, ExtractsTheFieldsAsOffsetsIntoTheMessage) {
+  const std::string message =
+      R"({"message_at": 1700000000, "nested": {"user": "inner"},)"
+      R"( "user": "jane", "message_id": "42", "ignored": [1, 2]})";
+  OrderProcessor processor;
+  OrderProcessor::Record record;
+
+  ASSERT_TRUE(processor.Extract(message, record));
+  EXPECT_EQ(OrderProcessor::IndexOf<UserField>(), 1u);
+  EXPECT_EQ(OrderProcessor::Get<MessageIdField>(message, record), "42");
+  EXPECT_EQ(OrderProcessor::Get<UserField>(message, record), "jane");
+  EXPECT_EQ(OrderProcessor::Get<ReceivedAtField>(message, record),
+            "1700000000");
+  EXPECT_EQ(record.fields[1].offset, message.find("jane"));
+  EXPECT_EQ(record.fields[1].length, 4u);
+}
+
+TEST(SchemaProcessorTest, RejectsMessagesThatMissAField) {
+  OrderProcessor processor;
+  OrderProcessor::Record record;
+
+  EXPECT_FALSE(processor.Extract(R"({"message_id": "42", "user": "jane"})",
+                                 record));
+  EXPECT_FALSE(record.fields[2].IsPresent());
+  EXPECT_FALSE(processor.Extract(R"({"message_id": "42", "user": )", record));
+  EXPECT_FALSE(processor.ProcessMessage("not json").has_value());
+}
+
+TEST(SchemaProcessorTest, ProcessesMessagesAsAnIMessageProcessor) {
+  std::shared_ptr<IMessageProcessor> processor =
+      std::make_shared<SchemaProcessor<MessageIdField>>();
+
+  auto message = processor->ProcessMessage(
+      R"({"payload": {"message_id": "inner"}, "message_id": "outer"})");
+  ASSERT_TRUE(message.has_value());
+  EXPECT_EQ(message->message_id, "outer");
+  EXPECT_FALSE(processor->ProcessMessage(R"({"id": "1"})").has_value());
+}
+
+TEST(SchemaProcessorTest, SetsThePublishTimeWhenItIsInTheSchema) {
+  SchemaProcessor<MessageIdField, PublishTimeField> processor;
+  MessageView message{};
+  std::string storage;
+
+  ASSERT_TRUE(processor.ProcessMessageInPlace(
+      R"({"message_id": "42", "publish_time_ns": 1700000000})", message,
+      storage));
+  EXPECT_EQ(message.message_id, "42");
+  EXPECT_EQ(message.publish_time, "1700000000");
+}
@@ -0,0 +1,486 @@
+#include "../include/Consumer/ShardedSubscriber.hpp"
+#include "../include/Networking/ClusterTopology.hpp"
+#include <algorithm>
+#include <arpa/inet.h>
+#include <atomic>
+#include <chrono>
+#include <gtest/gtest.h>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <string>
+#include <sys/socket.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+namespace {
+// Waits up to a few seconds for the condition to become true.
+template <typename Condition> bool WaitFor(Condition &&condition) {
+  auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+  while (!condition()) {
+    if (std::chrono::steady_clock::now() > deadline) {
+      return false;
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+  return true;
+}
+
+std::string ToBulkString(const std::string &string) {
+  return "$" + std::to_string(string.size()) + "\r\n" + string + "\r\n";
+}
+
+std::string CreatePush(const std::string &kind, const std::string &channel,
+                       const std::string &last_element) {
+  return "*3\r\n" + ToBulkString(kind) + ToBulkString(channel) + last_element;
+}
+
+void ParseCompleteReply(RespParser &parser, const std::string &reply) {
+  std::size_t bytes_consumed = 0;
+  ASSERT_EQ(parser.Parse(reply.data(), reply.size(), bytes_consumed),
+            RespParseStatus::Complete);
+  ASSERT_EQ(bytes_consumed, reply.size());
+}
+
+/*
+A few in-process cluster nodes that serve CLUSTER SLOTS, SSUBSCRIBE and the
+sharded messages of their slots. The slots that CLUSTER SLOTS reports can
+differ from the ones that the nodes own, to provoke MOVED redirections.
+*/
+class FakeCluster {
+public:
+  explicit FakeCluster(int number_of_nodes)
+      : owners_(kNumberOfHashSlots, 0), reported_owners_(owners_) {
+    for (int i = 0; i < number_of_nodes; ++i) {
+      auto node = std::make_unique<Node>();
+      node->listening_file_descriptor = socket(AF_INET, SOCK_STREAM, 0);
+      sockaddr_in address{};
+      address.sin_family = AF_INET;
+      address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+      socklen_t address_length = sizeof(address);
+      EXPECT_EQ(bind(node->listening_file_descriptor, (sockaddr *)&address,
+                     sizeof(address)),
+                0);
+      EXPECT_EQ(listen(node->listening_file_descriptor, 16), 0);
+      getsockname(node->listening_file_descriptor, (sockaddr *)&address,
+                  &address_length);
+      node->port = ntohs(address.sin_port);
+      nodes_.push_back(std::move(node));
+    }
+    for (int i = 0; i < number_of_nodes; ++i) {
+      nodes_[i]->accepting_thread =
+          std::thread(&FakeCluster::AcceptConnections, this, i);
+    }
+  }
+
+  ~FakeCluster() {
+    for (auto &node : nodes_) {
+      shutdown(node->listening_file_descriptor, SHUT_RDWR);
+      close(node->listening_file_descriptor);
+      node->accepting_thread.join();
+    }
+    std::vector<std::thread> connection_threads;
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      for (auto &[file_descriptor, connection] : connections_) {
+        shutdown(file_descriptor, SHUT_RDWR);
+      }
+      connection_threads.swap(connection_threads_);
+    }
+    for (auto &connection_thread : connection_threads) {
+      connection_thread.join();
+    }
+    for (auto &[file_descriptor, connection] : connections_) {
+      close(file_descriptor);
+    }
+  }
+
+  ClusterNode GetNode(int node_index) const {
+    return {"127.0.0.1", nodes_[node_index]->port};
+  }
+
+  // Gives the slots [first_slot, last_slot] to a node. CLUSTER SLOTS only
+  // reports it when is_reported is set.
+  void Assign(std::uint16_t first_slot, std::uint16_t last_slot,
+              int node_index, bool is_reported = true) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (int slot = first_slot; slot <= last_slot; ++slot) {
+      owners_[slot] = node_index;
+      if (is_reported) {
+        reported_owners_[slot] = node_index;
+      }
+    }
+  }
+
+  // Moves a slot to another node, which unsubscribes its channels on the old
+  // owner, like Redis does.
+  void MigrateSlot(std::uint16_t slot, int node_index) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    const int old_node_index = owners_[slot];
+    owners_[slot] = reported_owners_[slot] = node_index;
+    for (auto &[file_descriptor, connection] : connections_) {
+      if (connection.node_index != old_node_index) {
+        continue;
+      }
+      for (auto it = connection.channels.begin();
+           it != connection.channels.end();) {
+        if (GetHashSlot(*it) == slot) {
+          Send(file_descriptor,
+               CreatePush("sunsubscribe", *it, ":0\r\n"));
+          it = connection.channels.erase(it);
+        } else {
+          ++it;
+        }
+      }
+    }
+  }
+
+  // Delivers a message to the subscribers of the channel on its owner.
+  // Returns the number of subscribers.
+  int Publish(const std::string &channel, const std::string &payload) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    const int node_index = owners_[GetHashSlot(channel)];
+    int number_of_subscribers = 0;
+    for (auto &[file_descriptor, connection] : connections_) {
+      if (connection.node_index == node_index &&
+          connection.channels.count(channel) != 0) {
+        Send(file_descriptor,
+             CreatePush("smessage", channel, ToBulkString(payload)));
+        ++number_of_subscribers;
+      }
+    }
+    return number_of_subscribers;
+  }
+
+  int GetNumberOfSubscribers(int node_index) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    int number_of_subscribers = 0;
+    for (auto &[file_descriptor, connection] : connections_) {
+      if (connection.node_index == node_index) {
+        number_of_subscribers += connection.channels.size();
+      }
+    }
+    return number_of_subscribers;
+  }
+
+private:
+  struct Node {
+    int listening_file_descriptor;
+    unsigned short port;
+    std::thread accepting_thread;
+  };
+
+  struct Connection {
+    int node_index;
+    std::set<std::string> channels;
+  };
+
+  static void Send(int file_descriptor, const std::string &data) {
+    ASSERT_EQ(send(file_descriptor, data.data(), data.size(), MSG_NOSIGNAL),
+              static_cast<ssize_t>(data.size()));
+  }
+
+  void AcceptConnections(int node_index) {
+    int listening_file_descriptor =
+        nodes_[node_index]->listening_file_descriptor;
+    while (true) {
+      int file_descriptor = accept(listening_file_descriptor, nullptr, nullptr);
+      if (file_descriptor < 0) {
+        return;
+      }
+      std::lock_guard<std::mutex> lock(mutex_);
+      connections_[file_descriptor] = {node_index, {}};
+      connection_threads_.emplace_back(&FakeCluster::ServeConnection, this,
+                                       file_descriptor);
+    }
+  }
+
+  void ServeConnection(int file_descriptor) {
+    RespReader reader(file_descriptor);
+    while (reader.ReadFrames([&](const RespParser &request) {
+      std::vector<std::string> arguments;
+      for (std::size_t i = 0; i < request.Root().number_of_elements; ++i) {
+        arguments.emplace_back(request.Child(request.Root(), i)->string);
+      }
+      HandleCommand(file_descriptor, arguments);
+    })) {
+    }
+  }
+
+  void HandleCommand(int file_descriptor,
+                     const std::vector<std::string> &arguments) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    Connection &connection = connections_[file_descriptor];
+    if (arguments[0] == "CLUSTER") {
+      Send(file_descriptor, CreateClusterSlotsReply());
+      return;
+    }
+    ASSERT_EQ(arguments[0], "SSUBSCRIBE");
+    const std::uint16_t slot = GetHashSlot(arguments[1]);
+    if (owners_[slot] != connection.node_index) {
+      Send(file_descriptor, "-MOVED " + std::to_string(slot) + " 127.0.0.1:" +
+                                std::to_string(nodes_[owners_[slot]]->port) +
+                                "\r\n");
+      return;
+    }
+    for (std::size_t i = 1; i < arguments.size(); ++i) {
+      connection.channels.insert(arguments[i]);
+      Send(file_descriptor,
+           CreatePush("ssubscribe", arguments[i],
+                      ":" + std::to_string(connection.channels.size()) +
+                          "\r\n"));
+    }
+  }
+
+  std::string CreateClusterSlotsReply() const {
+    std::string entries;
+    int number_of_entries = 0;
+    for (int first_slot = 0; first_slot < kNumberOfHashSlots;) {
+      int last_slot = first_slot;
+      while (last_slot + 1 < kNumberOfHashSlots &&
+             reported_owners_[last_slot + 1] == reported_owners_[first_slot]) {
+        ++last_slot;
+      }
+      // Nodes that do not know their own address report an empty host.
+      entries += "*3\r\n:" + std::to_string(first_slot) + "\r\n:" +
+                 std::to_string(last_slot) + "\r\n*3\r\n$0\r\n\r\n:" +
+                 std::to_string(nodes_[reported_owners_[first_slot]]->port) +
+                 "\r\n$2\r\nid\r\n";
+      ++number_of_entries;
+      first_slot = last_slot + 1;
+    }
+    return "*" + std::to_string(number_of_entries) + "\r\n" + entries;
+  }
+
+  std::vector<std::unique_ptr<Node>> nodes_;
+  std::mutex mutex_;
+  std::vector<int> owners_;
+  std::vector<int> reported_owners_;
+  std::map<int, Connection> connections_;
+  std::vector<std::thread> connection_threads_;
+};
+
+// Runs a subscriber and records the sharded messages that it receives.
+class SubscriberRunner {
+public:
+  explicit SubscriberRunner(ShardedSubscriber &subscriber)
+      : subscriber_(subscriber) {
+    thread_ = std::thread([this]() {
+      is_successful_ =
+          subscriber_.Run([this](const PubSubMessage &pubsub_message) {
+            if (pubsub_message.kind == PubSubMessageKind::ShardMessage) {
+              std::lock_guard<std::mutex> lock(mutex_);
+              messages_.push_back(std::string(pubsub_message.channel) + "=" +
+                                  std::string(pubsub_message.payload));
+            }
+          });
+    });
+  }
+
+  ~SubscriberRunner() {
+    subscriber_.Stop();
+    thread_.join();
+    EXPECT_TRUE(is_successful_) << subscriber_.GetLastError();
+  }
+
+  std::vector<std::string> GetMessages() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return messages_;
+  }
+
+private:
+  ShardedSubscriber &subscriber_;
+  std::thread thread_;
+  std::atomic<bool> is_successful_{false};
+  std::mutex mutex_;
+  std::vector<std::string> messages_;
+};
+} // namespace
+
+TEST(ClusterTopologyTest, ComputesHashSlots) {
+  // The reference values of the Redis Cluster specification.
+  EXPECT_EQ(GetHashSlot("123456789"), 0x31C3 % kNumberOfHashSlots);
+  EXPECT_EQ(GetHashSlot("foo"), 12182);
+  EXPECT_EQ(GetHashSlot("bar"), 5061);
+  EXPECT_EQ(GetHashSlot(""), 0);
+
+  // Only the first {hash tag} is hashed, unless it is empty.
+  EXPECT_EQ(GetHashSlot("{user1000}.following"), GetHashSlot("user1000"));
+  EXPECT_EQ(GetHashSlot("{user1000}.followers"), GetHashSlot("user1000"));
+  EXPECT_NE(GetHashSlot("foo{}{bar}"), GetHashSlot("bar"));
+  EXPECT_EQ(GetHashSlot("foo{{bar}}zap"), GetHashSlot("{bar"));
+  EXPECT_EQ(GetHashSlot("foo{bar}{zap}"), GetHashSlot("bar"));
+}
+
+TEST(ClusterTopologyTest, ParsesMovedErrors) {
+  std::uint16_t slot = 0;
+  ClusterNode node;
+  ASSERT_TRUE(ParseMovedError("MOVED 3999 127.0.0.1:6381", slot, node));
+  EXPECT_EQ(slot, 3999);
+  EXPECT_EQ(node, (ClusterNode{"127.0.0.1", 6381}));
+
+  // Nodes that do not know the host of the new owner omit it.
+  ASSERT_TRUE(ParseMovedError("MOVED 12182 :7002", slot, node));
+  EXPECT_EQ(slot, 12182);
+  EXPECT_EQ(node, (ClusterNode{"", 7002}));
+
+  EXPECT_FALSE(ParseMovedError("ASK 3999 127.0.0.1:6381", slot, node));
+  EXPECT_FALSE(ParseMovedError("MOVED 16384 127.0.0.1:6381", slot, node));
+  EXPECT_FALSE(ParseMovedError("MOVED 3999 127.0.0.1", slot, node));
+  EXPECT_FALSE(ParseMovedError("MOVED 3999 127.0.0.1:port", slot, node));
+}
+
+TEST(ClusterTopologyTest, LoadsTheSlotsFromClusterSlots) {
+  RespParser parser;
+  // Two masters, the first one with a replica and the second one with an
+  // unknown endpoint.
+  ParseCompleteReply(
+      parser, "*2\r\n"
+              "*4\r\n:0\r\n:5460\r\n"
+              "*3\r\n$8\r\n10.0.0.1\r\n:7000\r\n$2\r\nid\r\n"
+              "*3\r\n$8\r\n10.0.0.4\r\n:7003\r\n$2\r\nid\r\n"
+              "*3\r\n:5461\r\n:16383\r\n"
+              "*4\r\n$1\r\n?\r\n:7001\r\n$2\r\nid\r\n%0\r\n");
+
+  ClusterTopology topology;
+  EXPECT_EQ(topology.GetNode(0), nullptr);
+  ASSERT_TRUE(topology.Update(parser, {"10.0.0.2", 7001}))
+      << topology.GetLastError();
+  EXPECT_EQ(*topology.GetNode(0), (ClusterNode{"10.0.0.1", 7000}));
+  EXPECT_EQ(*topology.GetNode(5460), (ClusterNode{"10.0.0.1", 7000}));
+  EXPECT_EQ(*topology.GetNode(5461), (ClusterNode{"10.0.0.2", 7001}));
+  EXPECT_EQ(*topology.GetNode(16383), (ClusterNode{"10.0.0.2", 7001}));
+  EXPECT_EQ(topology.GetNodes().size(), 2);
+
+  topology.SetNode(0, {"10.0.0.3", 7002});
+  EXPECT_EQ(*topology.GetNode(0), (ClusterNode{"10.0.0.3", 7002}));
+  EXPECT_EQ(topology.GetNodes().size(), 3);
+
+  // A malformed reply does not change the topology.
+  ParseCompleteReply(parser, "*1\r\n*2\r\n:0\r\n:16384\r\n");
+  EXPECT_FALSE(topology.Update(parser, {"10.0.0.2", 7001}));
+  ParseCompleteReply(parser, "-ERR This instance has cluster support "
+                             "disabled\r\n");
+  EXPECT_FALSE(topology.Update(parser, {"10.0.0.2", 7001}));
+  EXPECT_EQ(*topology.GetNode(0), (ClusterNode{"10.0.0.3", 7002}));
+}
+
+TEST(ShardedSubscriberTest, SubscribesOnTheNodesThatOwnTheSlots) {
+  FakeCluster cluster(2);
+  cluster.Assign(8192, 16383, 1);
+
+  ShardedSubscriber subscriber;
+  // "bar" and "{bar}.eu" share a slot on the first node, "foo" is on the
+  // second one.
+  ASSERT_TRUE(subscriber.Subscribe(cluster.GetNode(0),
+                                   {"foo", "bar", "{bar}.eu"}))
+      << subscriber.GetLastError();
+  SubscriberRunner runner(subscriber);
+  ASSERT_TRUE(WaitFor([&] {
+    return cluster.GetNumberOfSubscribers(0) == 2 &&
+           cluster.GetNumberOfSubscribers(1) == 1;
+  }));
+
+  EXPECT_EQ(cluster.Publish("foo", "1"), 1);
+  EXPECT_EQ(cluster.Publish("{bar}.eu", "2"), 1);
+  EXPECT_EQ(cluster.Publish("bar", "3"), 1);
+  ASSERT_TRUE(WaitFor([&] { return runner.GetMessages().size() == 3; }));
+  std::vector<std::string> messages = runner.GetMessages();
+  std::sort(messages.begin(), messages.end());
+  EXPECT_EQ(messages, (std::vector<std::string>{"bar=3", "foo=1",
+                                                "{bar}.eu=2"}));
+  EXPECT_GT(subscriber.GetStatistics().number_of_frames, 3);
+}
+
+TEST(ShardedSubscriberTest, FollowsMovedRedirections) {
+  FakeCluster cluster(2);
+  // The second node owns the slot of "foo", but CLUSTER SLOTS does not say
+  // so yet.
+  cluster.Assign(GetHashSlot("foo"), GetHashSlot("foo"), 1, false);
+
+  ShardedSubscriber subscriber;
+  ASSERT_TRUE(subscriber.Subscribe(cluster.GetNode(0), {"foo", "bar"}))
+      << subscriber.GetLastError();
+  SubscriberRunner runner(subscriber);
+  ASSERT_TRUE(WaitFor([&] {
+    return cluster.GetNumberOfSubscribers(0) == 1 &&
+           cluster.GetNumberOfSubscribers(1) == 1;
+  }));
+
+  EXPECT_EQ(cluster.Publish("foo", "1"), 1);
+  ASSERT_TRUE(WaitFor([&] { return runner.GetMessages().size() == 1; }));
+  EXPECT_EQ(runner.GetMessages().front(), "foo=1");
+}
+
+TEST(ShardedSubscriberTest, ResubscribesWhenASlotMigrates) {
+  FakeCluster cluster(2);
+
+  ShardedSubscriber subscriber;
+  ASSERT_TRUE(subscriber.Subscribe(cluster.GetNode(0), {"foo", "bar"}))
+      << subscriber.GetLastError();
+  SubscriberRunner runner(subscriber);
+  ASSERT_TRUE(WaitFor([&] { return cluster.GetNumberOfSubscribers(0) == 2; }));
+
+  cluster.MigrateSlot(GetHashSlot("foo"), 1);
+  ASSERT_TRUE(WaitFor([&] {
+    return cluster.GetNumberOfSubscribers(0) == 1 &&
+           cluster.GetNumberOfSubscribers(1) == 1;
+  }));
+
+  EXPECT_EQ(cluster.Publish("foo", "1"), 1);
+  EXPECT_EQ(cluster.Publish("bar", "2"), 1);
+  ASSERT_TRUE(WaitFor([&] { return runner.GetMessages().size() == 2; }));
+}
+
+// Runs against a real cluster when one is started locally, e.g. with
+// redis-server --cluster-enabled yes on the ports 7000 to 7005 and
+// redis-cli --cluster create. Skipped otherwise.
+TEST(ShardedSubscriberTest, ReceivesMessagesFromALocalCluster) {
+  const ClusterNode seed_node{"127.0.0.1", 7000};
+  const std::vector<std::string> channels = {"foo", "bar", "{bar}.eu"};
+  ShardedSubscriber subscriber;
+  if (!subscriber.Subscribe(seed_node, channels)) {
+    GTEST_SKIP() << "No Redis Cluster at 127.0.0.1:7000. "
+                 << subscriber.GetLastError();
+  }
+
+  std::vector<const ClusterNode *> owners;
+  for (const std::string &channel : channels) {
+    owners.push_back(subscriber.GetTopology().GetNode(GetHashSlot(channel)));
+    ASSERT_NE(owners.back(), nullptr);
+  }
+  SubscriberRunner runner(subscriber);
+
+  // Publishes on the owner of every channel until the subscriptions are
+  // active and the messages arrive.
+  ASSERT_TRUE(WaitFor([&] {
+    for (std::size_t i = 0; i < channels.size(); ++i) {
+      int file_descriptor = socket(AF_INET, SOCK_STREAM, 0);
+      sockaddr_in address{};
+      address.sin_family = AF_INET;
+      address.sin_addr.s_addr = inet_addr(owners[i]->host.c_str());
+      address.sin_port = htons(owners[i]->port);
+      if (connect(file_descriptor, (sockaddr *)&address, sizeof(address)) ==
+          0) {
+        const std::string command = "*3\r\n" + ToBulkString("SPUBLISH") +
+                                    ToBulkString(channels[i]) +
+                                    ToBulkString("hello");
+        char reply[64];
+        if (send(file_descriptor, command.data(), command.size(), 0) > 0) {
+          (void)read(file_descriptor, reply, sizeof(reply));
+        }
+      }
+      close(file_descriptor);
+    }
+    std::vector<std::string> messages = runner.GetMessages();
+    for (const std::string &channel : channels) {
+      if (std::find(messages.begin(), messages.end(), channel + "=hello") ==
+          messages.end()) {
+        return false;
+      }
+    }
+    return true;
+  }));
+}
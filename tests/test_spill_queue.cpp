@@ -0,0 +1,137 @@
+#include "../include/Storage/SpillQueue.hpp"
+#include <atomic>
+#include <cstdlib>
+#include <gtest/gtest.h>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+std::string GetTemporaryDirectory() {
+  const char *directory = std::getenv("TMPDIR");
+  return directory != nullptr ? directory : "/tmp";
+}
+
+std::string MakeRecord(int number) {
+  return "record " + std::to_string(number) +
+         std::string(static_cast<std::size_t>(number % 50), 'x');
+}
+
+bool PopRecord(SpillQueue &queue, std::string &record) {
+  return queue.TryPop([&record](std::string_view stored_record) {
+    record.assign(stored_record);
+  });
+}
+} // namespace
+
+TEST(SpillQueueTest, ReturnsTheRecordsInOrderAcrossSegments) {
+  SpillQueue queue(GetTemporaryDirectory(), 4096, 64);
+  ASSERT_TRUE(queue.Open()) << queue.GetLastError();
+  std::string record;
+  EXPECT_FALSE(PopRecord(queue, record));
+  EXPECT_TRUE(queue.IsEmpty());
+
+  constexpr int kNumberOfRecords = 1000;
+  for (int i = 0; i < kNumberOfRecords; ++i) {
+    ASSERT_TRUE(queue.TryAppend({"h:", MakeRecord(i)}));
+  }
+  EXPECT_EQ(queue.GetApproximateSize(), std::size_t{kNumberOfRecords});
+  EXPECT_GT(queue.GetNumberOfCreatedSegments(), 1);
+  for (int i = 0; i < kNumberOfRecords; ++i) {
+    ASSERT_TRUE(PopRecord(queue, record));
+    ASSERT_EQ(record, "h:" + MakeRecord(i));
+  }
+  EXPECT_FALSE(PopRecord(queue, record));
+  EXPECT_TRUE(queue.IsEmpty());
+}
+
+TEST(SpillQueueTest, RefusesRecordsWhenEverySegmentIsInUse) {
+  SpillQueue queue(GetTemporaryDirectory(), 1024, 2);
+  ASSERT_TRUE(queue.Open()) << queue.GetLastError();
+  const std::string body(500, 'b');
+  // Two records fit into a segment.
+  for (int i = 0; i < 4; ++i) {
+    ASSERT_TRUE(queue.TryAppend({body}));
+  }
+  EXPECT_FALSE(queue.TryAppend({body}));
+  // Records larger than a segment never fit.
+  EXPECT_FALSE(queue.TryAppend({std::string(2000, 'b')}));
+
+  std::string record;
+  ASSERT_TRUE(PopRecord(queue, record));
+  ASSERT_TRUE(PopRecord(queue, record));
+  // The drained segment makes room once the producer moves on.
+  ASSERT_TRUE(PopRecord(queue, record));
+  EXPECT_TRUE(queue.TryAppend({body}));
+}
+
+TEST(SpillQueueTest, ReusesDrainedSegments) {
+  SpillQueue queue(GetTemporaryDirectory(), 1024, 4);
+  ASSERT_TRUE(queue.Open()) << queue.GetLastError();
+  const std::string body(300, 'b');
+  std::string record;
+  for (int round = 0; round < 100; ++round) {
+    for (int i = 0; i < 3; ++i) {
+      ASSERT_TRUE(queue.TryAppend({body}));
+    }
+    for (int i = 0; i < 3; ++i) {
+      ASSERT_TRUE(PopRecord(queue, record));
+    }
+  }
+  EXPECT_LE(queue.GetNumberOfCreatedSegments(), 3);
+}
+
+TEST(SpillQueueTest, HandsEveryRecordToExactlyOneOfTheConsumers) {
+  SpillQueue queue(GetTemporaryDirectory(), 64 * 1024, 1024);
+  ASSERT_TRUE(queue.Open()) << queue.GetLastError();
+  constexpr int kNumberOfRecords = 100000;
+  constexpr int kNumberOfConsumers = 4;
+  std::atomic<bool> is_producing{true};
+  std::vector<std::vector<int>> consumed_numbers(kNumberOfConsumers);
+  std::vector<std::thread> consumers;
+  for (int i = 0; i < kNumberOfConsumers; ++i) {
+    consumers.emplace_back([&, i]() {
+      std::string record;
+      while (true) {
+        bool is_done = !is_producing.load();
+        if (PopRecord(queue, record)) {
+          consumed_numbers[i].push_back(std::stoi(record));
+        } else if (is_done) {
+          return;
+        }
+      }
+    });
+  }
+  for (int i = 0; i < kNumberOfRecords; ++i) {
+    const std::string body = std::to_string(i);
+    while (!queue.TryAppend({body})) {
+      std::this_thread::yield();
+    }
+  }
+  is_producing = false;
+  for (std::thread &consumer : consumers) {
+    consumer.join();
+  }
+
+  std::vector<bool> is_consumed(kNumberOfRecords, false);
+  for (const std::vector<int> &numbers : consumed_numbers) {
+    // Every consumer gets its records in the order they were appended.
+    for (std::size_t i = 1; i < numbers.size(); ++i) {
+      ASSERT_LT(numbers[i - 1], numbers[i]);
+    }
+    for (int number : numbers) {
+      ASSERT_FALSE(is_consumed[number]);
+      is_consumed[number] = true;
+    }
+  }
+  for (int i = 0; i < kNumberOfRecords; ++i) {
+    ASSERT_TRUE(is_consumed[i]) << i;
+  }
+  EXPECT_TRUE(queue.IsEmpty());
+}
+
+TEST(SpillQueueTest, ReportsADirectoryThatDoesNotExist) {
+  SpillQueue queue("/nonexistent/directory", 4096, 4);
+  EXPECT_FALSE(queue.Open());
+  EXPECT_FALSE(queue.GetLastError().empty());
+}
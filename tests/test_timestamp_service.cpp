@@ -0,0 +1,60 @@
+#include "../include/Consumer/TimestampService.hpp"
+#include <chrono>
+#include <cstdlib>
+#include <gtest/gtest.h>
+#include <string>
+
+namespace {
+// 2023-11-14 22:13:20 UTC
+constexpr std::time_t kSecond = 1700000000;
+
+class TimestampServiceTest : public ::testing::Test {
+protected:
+  void SetUp() override {
+    setenv("TZ", "UTC", 1);
+    tzset();
+  }
+};
+} // namespace
+
+TEST_F(TimestampServiceTest, FormatsTheLocalTimeWithMilliseconds) {
+  TimestampService timestamp_service;
+  EXPECT_EQ(timestamp_service.Format({kSecond, 123456789}),
+            "2023-11-14 22:13:20.123");
+  EXPECT_EQ(timestamp_service.Format({kSecond, 5000000}),
+            "2023-11-14 22:13:20.005");
+  EXPECT_EQ(timestamp_service.Format({kSecond + 1, 999999999}),
+            "2023-11-14 22:13:21.999");
+}
+
+TEST_F(TimestampServiceTest, FormatsTheDateAndTimeOncePerSecond) {
+  TimestampService timestamp_service;
+  for (long milliseconds = 0; milliseconds < 1000; ++milliseconds) {
+    const std::string_view timestamp =
+        timestamp_service.Format({kSecond, milliseconds * 1000000});
+    ASSERT_EQ(std::stol(std::string(timestamp.substr(20))), milliseconds);
+  }
+  EXPECT_EQ(timestamp_service.GetNumberOfFormattedSeconds(), 1);
+
+  EXPECT_EQ(timestamp_service.Format({kSecond + 60, 0}),
+            "2023-11-14 22:14:20.000");
+  EXPECT_EQ(timestamp_service.GetNumberOfFormattedSeconds(), 2);
+}
+
+TEST_F(TimestampServiceTest, FormatsEpochNanoseconds) {
+  TimestampService timestamp_service(TimestampClock::Realtime,
+                                     TimestampFormat::EpochNanoseconds);
+  EXPECT_EQ(timestamp_service.Format({kSecond, 5}), "1700000000000000005");
+  EXPECT_EQ(timestamp_service.Format({0, 0}), "0");
+}
+
+TEST_F(TimestampServiceTest, ReadsTheCoarseClock) {
+  TimestampService timestamp_service(TimestampClock::RealtimeCoarse,
+                                     TimestampFormat::EpochNanoseconds);
+  const long long now = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                            std::chrono::system_clock::now().time_since_epoch())
+                            .count();
+  const long long coarse_now = std::stoll(std::string(timestamp_service.Now()));
+  // The coarse clock trails the precise one by up to a few ticks.
+  EXPECT_LT(std::llabs(coarse_now - now), 100'000'000LL);
+}